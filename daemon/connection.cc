@@ -21,6 +21,7 @@
 #include "cookie.h"
 #include "external_auth_manager_thread.h"
 #include "front_end_thread.h"
+#include "io_uring_backend.h"
 #include "listening_port.h"
 #include "mc_time.h"
 #include "mcaudit.h"
@@ -680,6 +681,7 @@ void Connection::executeCommandPipeline() {
                         "Connection::executeCommandsCallback(): Failed to "
                         "drain buffer");
             }
+            reservedFrameSize = 0;
         }
     }
 
@@ -697,6 +699,8 @@ void Connection::executeCommandPipeline() {
         enableReadEvent();
         if (isPacketAvailable()) {
             triggerCallback();
+        } else {
+            reserveFrameSpace();
         }
     } else {
         // The cookies pipeline is full, and we don't want to start executing
@@ -1016,6 +1020,7 @@ void Connection::copyToOutputStream(cb::const_char_buffer data) {
     }
 
     totalSend += data.size();
+    get_thread_stats(this)->bytes_copied += data.size();
 }
 
 static void sendbuffer_cleanup_cb(const void*, size_t, void* extra) {
@@ -1042,6 +1047,12 @@ void Connection::chainDataToOutputStream(std::unique_ptr<SendBuffer> buffer) {
     // Move the ownership of the buffer!
     (void)buffer.release();
     totalSend += data.size();
+    get_thread_stats(this)->bytes_referenced += data.size();
+}
+
+std::size_t Connection::getSendBufferThreshold() const {
+    return isSslEnabled() ? SendBuffer::MinimumDataSize
+                          : SendBuffer::MinimumPlaintextDataSize;
 }
 
 Connection::Connection(FrontEndThread& thr)
@@ -1091,8 +1102,15 @@ Connection::Connection(SOCKET sfd,
                           Connection::event_callback,
                           static_cast<void*>(this));
     } else {
-        bev.reset(bufferevent_socket_new(
-                base, sfd, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_DEFER_CALLBACKS));
+        if (thread.io_uring) {
+            // The io_uring owns (and closes) the socket
+            bev.reset(thread.io_uring->attach(sfd));
+        } else {
+            bev.reset(bufferevent_socket_new(
+                    base,
+                    sfd,
+                    BEV_OPT_CLOSE_ON_FREE | BEV_OPT_DEFER_CALLBACKS));
+        }
         bufferevent_setcb(bev.get(),
                           Connection::rw_callback,
                           Connection::rw_callback,
@@ -1112,6 +1130,9 @@ Connection::~Connection() {
     }
 
     if (bev) {
+        if (thread.io_uring && !ssl) {
+            thread.io_uring->detach(bev.get());
+        }
         bev.reset();
         stats.curr_conns.fetch_sub(1, std::memory_order_relaxed);
         if (is_listen_disabled()) {
@@ -1152,6 +1173,13 @@ size_t Connection::getNumberOfCookies() const {
     return ret;
 }
 
+/**
+ * Frames larger than this are received directly into a buffer big enough
+ * for the whole frame (see reserveFrameSpace). Smaller frames fit in the
+ * few chains of a socket read, where pulling them up is cheap.
+ */
+static const size_t presizeFrameThreshold = 16 * 1024;
+
 bool Connection::isPacketAvailable() const {
     auto* event = bev.get();
     auto* input = bufferevent_get_input(event);
@@ -1201,6 +1229,58 @@ bool Connection::isPacketAvailable() const {
     return false;
 }
 
+void Connection::reserveFrameSpace() {
+    // A large frame arrives spread over many chains in the input buffer, and
+    // once complete the pullup in isPacketAvailable would allocate a new
+    // chain and copy the entire frame into it (which for a DCP mutation with
+    // a large value is on top of the copy into the engine's value). Make
+    // room for the rest of the frame after the data received so far
+    // instead, so the remaining reads land in place and the final pullup is
+    // a no-op.
+    if (!isAuthenticated() || !isDCP()) {
+        return;
+    }
+
+    auto* input = bufferevent_get_input(bev.get());
+    const auto size = evbuffer_get_length(input);
+    if (size < sizeof(cb::mcbp::Header)) {
+        return;
+    }
+    const auto* header = reinterpret_cast<const cb::mcbp::Header*>(
+            evbuffer_pullup(input, sizeof(cb::mcbp::Header)));
+    if (header == nullptr) {
+        throw std::runtime_error(
+                "Connection::reserveFrameSpace(): Failed to reallocate event "
+                "input buffer: " +
+                std::to_string(sizeof(cb::mcbp::Header)));
+    }
+
+    // Only reserve once the peer sent half of the frame (so we never pin
+    // more than it sent), and only once per frame: the reads fill the
+    // reserved space, and pulling up again on every partial read would
+    // copy the frame over and over.
+    const auto framesize = sizeof(*header) + header->getBodylen();
+    if (framesize <= presizeFrameThreshold || size >= framesize ||
+        size < framesize / 2 || reservedFrameSize == framesize) {
+        return;
+    }
+
+    reservedFrameSize = framesize;
+    if (evbuffer_get_contiguous_space(input) != size &&
+        evbuffer_pullup(input, size) == nullptr) {
+        throw std::runtime_error(
+                "Connection::reserveFrameSpace(): Failed to reallocate event "
+                "input buffer: " +
+                std::to_string(size));
+    }
+    if (evbuffer_expand(input, framesize - size) == -1) {
+        throw std::runtime_error(
+                "Connection::reserveFrameSpace(): Failed to expand event "
+                "input buffer: " +
+                std::to_string(framesize));
+    }
+}
+
 const cb::mcbp::Header& Connection::getPacket() const {
     // Drain all of the data available in bufferevent into the
     // socket read buffer
@@ -1373,7 +1453,9 @@ bool Connection::havePendingData() const {
 }
 
 size_t Connection::getSendQueueSize() const {
-    return evbuffer_get_length(bufferevent_get_output(bev.get()));
+    // With the io_uring backend this includes what's been passed on to the
+    // io_uring but not sent yet
+    return IoUringBackend::getSendQueueSize(bev.get());
 }
 
 void Connection::sendResponseHeaders(Cookie& cookie,
@@ -1755,7 +1837,7 @@ ENGINE_ERROR_CODE Connection::mutation(uint32_t opaque,
 
         // Add the value
         if (!value.empty()) {
-            if (value.size() > SendBuffer::MinimumDataSize) {
+            if (value.size() > getSendBufferThreshold()) {
                 auto sendbuffer = std::make_unique<ItemSendBuffer>(
                         std::move(it), value, getBucket());
                 chainDataToOutputStream(std::move(sendbuffer));
@@ -2234,7 +2316,7 @@ ENGINE_ERROR_CODE Connection::prepare(uint32_t opaque,
 
         // Add the value
         if (!buffer.empty()) {
-            if (buffer.size() > SendBuffer::MinimumDataSize) {
+            if (buffer.size() > getSendBufferThreshold()) {
                 auto sendbuffer = std::make_unique<ItemSendBuffer>(
                         std::move(it), buffer, getBucket());
                 chainDataToOutputStream(std::move(sendbuffer));
@@ -398,6 +398,13 @@ public:
      */
     void chainDataToOutputStream(std::unique_ptr<SendBuffer> buffer);
 
+    /**
+     * Get the size a value must exceed before it should be chained to the
+     * output stream with a SendBuffer instead of being copied (see
+     * SendBuffer::MinimumDataSize and SendBuffer::MinimumPlaintextDataSize)
+     */
+    std::size_t getSendBufferThreshold() const;
+
     /**
      * Enable the datatype which corresponds to the feature
      *
@@ -748,6 +755,20 @@ public:
                             uint64_t abort_seqno) override;
 
 protected:
+    /**
+     * Called when the packet at the head of the input pipe is incomplete.
+     * If it's a large frame on an authenticated DCP connection, and at
+     * least half of it is received, reserve room for the rest of it in the
+     * input pipe (once per frame). The remaining reads then land in place,
+     * rather than the frame being copied together once complete.
+     *
+     * The room is only reserved once the peer has sent half of the frame,
+     * so the memory pinned for a frame is never more than twice what was
+     * received (the header alone doesn't make us allocate up to the max
+     * packet size).
+     */
+    void reserveFrameSpace();
+
     /**
      * Protected constructor so that it may only be used by MockSubclasses
      */
@@ -975,6 +996,12 @@ protected:
 
     std::unique_ptr<bufferevent, EventDeleter> bev;
 
+    /**
+     * The size of the partly received frame at the head of the input buffer
+     * which room was reserved for (see reserveFrameSpace), 0 if none
+     */
+    size_t reservedFrameSize = 0;
+
     /**
      * If the client enabled the mutation seqno feature each mutation
      * command will return the vbucket UUID and sequence number for the
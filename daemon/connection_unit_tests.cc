@@ -19,8 +19,12 @@
 #include "front_end_thread.h"
 #include "log_macros.h"
 #include "memcached.h"
+#include "settings.h"
 
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
 #include <folly/portability/GTest.h>
+#include <mcbp/protocol/request.h>
 
 /// A mock connection which doesn't own a socket and isn't bound to libevent
 class MockConnection : public Connection {
@@ -28,6 +32,23 @@ public:
     explicit MockConnection(FrontEndThread& frontEndThread)
         : Connection(frontEndThread) {
     }
+
+    /// Give the connection a bufferevent (without a socket) to receive into
+    void setBufferevent(bufferevent* event) {
+        bev.reset(event);
+    }
+
+    evbuffer* getInput() {
+        return bufferevent_get_input(bev.get());
+    }
+
+    /// Make the connection an (authenticated) DCP connection
+    void setAuthenticatedDcp() {
+        authenticated = true;
+        setDCP(true);
+    }
+
+    using Connection::reserveFrameSpace;
 };
 
 class ConnectionUnitTests : public ::testing::Test {
@@ -51,3 +72,116 @@ protected:
     MockConnection connection;
 };
 
+/// @return the first chain of the buffer, and how many chains it has
+static std::pair<const void*, int> getChains(evbuffer* buffer) {
+    evbuffer_iovec vec{};
+    const int chains = evbuffer_peek(buffer, -1, nullptr, &vec, 1);
+    return {vec.iov_base, chains};
+}
+
+/// @return the room available for a read into the buffer without allocating
+static size_t getFreeSpace(evbuffer* buffer) {
+    evbuffer_iovec vec{};
+    if (evbuffer_reserve_space(buffer, 1, &vec, 1) < 1) {
+        return 0;
+    }
+    return vec.iov_len;
+}
+
+/// Tests receiving a 1MB frame in several parts
+class LargeFrameTest : public ConnectionUnitTests {
+protected:
+    void SetUp() override {
+        Settings::instance().setMaxPacketSize(30 * 1024 * 1024);
+        base.reset(event_base_new());
+        connection.setBufferevent(bufferevent_socket_new(base.get(), -1, 0));
+        input = connection.getInput();
+
+        request.setMagic(cb::mcbp::Magic::ClientRequest);
+        request.setOpcode(cb::mcbp::ClientOpcode::Set);
+        request.setExtlen(8);
+        request.setKeylen(3);
+        request.setBodylen(uint32_t(body.size()));
+        evbuffer_add(input, &request, sizeof(request));
+    }
+
+    void TearDown() override {
+        // The bufferevent must go before its event base
+        connection.setBufferevent(nullptr);
+    }
+
+    /**
+     * Receive the next part of the body like the read path does (reserving
+     * room for the frame if it's still incomplete)
+     *
+     * @return true if the frame is complete
+     */
+    bool receive(size_t length) {
+        length = std::min(length, body.size() - received);
+        evbuffer_add(input, body.data() + received, length);
+        received += length;
+        if (connection.isPacketAvailable()) {
+            return true;
+        }
+        connection.reserveFrameSpace();
+        return false;
+    }
+
+    /// @return the size of the frame not received yet
+    size_t getRemaining() const {
+        return body.size() - received;
+    }
+
+    std::unique_ptr<event_base, decltype(&event_base_free)> base{
+            nullptr, event_base_free};
+    evbuffer* input = nullptr;
+    cb::mcbp::Request request{};
+    const std::string body = std::string(8 + 3 + 1024 * 1024, 'x');
+    size_t received = 0;
+};
+
+/**
+ * Test that a large frame on a DCP connection is received in place once
+ * half of it arrived: room for the rest of the frame is reserved once, and
+ * neither the partial nor the complete frame is copied afterwards.
+ */
+TEST_F(LargeFrameTest, ReceivedInPlace) {
+    connection.setAuthenticatedDcp();
+
+    // Nothing is reserved for the header and the start of the body
+    const size_t readSize = 64 * 1024;
+    ASSERT_FALSE(receive(1000));
+    EXPECT_LT(getFreeSpace(input), readSize);
+    while (received < body.size() / 2 - readSize) {
+        ASSERT_FALSE(receive(readSize));
+        EXPECT_LT(getFreeSpace(input), getRemaining());
+    }
+
+    // Once half of it arrived, room for the rest of the frame is reserved
+    ASSERT_FALSE(receive(readSize));
+    ASSERT_LE(body.size() / 2, received);
+    const auto frame = getChains(input).first;
+    EXPECT_EQ(1, getChains(input).second);
+    EXPECT_LE(getRemaining(), getFreeSpace(input));
+
+    // The rest arrives in reads of 64KB, which land in the reserved room
+    while (!receive(readSize)) {
+        EXPECT_EQ(std::make_pair(frame, 1), getChains(input));
+    }
+    EXPECT_EQ(0, getRemaining());
+    EXPECT_EQ(frame, static_cast<const void*>(&connection.getPacket()));
+    EXPECT_EQ(std::make_pair(frame, 1), getChains(input));
+}
+
+/**
+ * Test that no room is reserved for a large frame on a connection which
+ * isn't an authenticated DCP connection, as a header alone could otherwise
+ * make us allocate up to the max packet size.
+ */
+TEST_F(LargeFrameTest, NotReservedUnlessDcp) {
+    const size_t readSize = 64 * 1024;
+    while (!receive(readSize)) {
+        EXPECT_LT(getFreeSpace(input), getRemaining());
+    }
+    EXPECT_EQ(0, getRemaining());
+}
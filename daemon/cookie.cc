@@ -198,6 +198,22 @@ void Cookie::setEwouldblock(bool ewouldblock) {
     Cookie::ewouldblock = ewouldblock;
 }
 
+bool Cookie::addPendingIo(int count) {
+    return pendingIo.fetch_add(count) + count == 0;
+}
+
+bool Cookie::completePendingIo(ENGINE_ERROR_CODE status) {
+    if (status != ENGINE_SUCCESS) {
+        auto expected = ENGINE_SUCCESS;
+        batchedIoStatus.compare_exchange_strong(expected, status);
+    }
+    return pendingIo.fetch_sub(1) == 1;
+}
+
+ENGINE_ERROR_CODE Cookie::swapBatchedIoStatus() {
+    return batchedIoStatus.exchange(ENGINE_SUCCESS);
+}
+
 void Cookie::sendNotMyVBucket() {
     auto pair = connection.getBucket().clusterConfiguration.getConfiguration();
     if (pair.first == -1 || (pair.first == connection.getClustermapRevno() &&
@@ -480,6 +496,9 @@ void Cookie::reset() {
     commandContext.reset();
     tracer.clear();
     ewouldblock = false;
+    batchedIo = false;
+    pendingIo = 0;
+    batchedIoStatus = ENGINE_SUCCESS;
     openTracingContext.clear();
     authorized = false;
     reorder = connection.allowUnorderedExecution();
@@ -524,7 +543,8 @@ void Cookie::collectTimings() {
     getTracer().end(cb::tracing::Code::Request, endTime);
 
     // aggregated timing for all buckets
-    all_buckets[0].timings.collect(opcode, elapsed);
+    const auto thread = connection.getThread().index;
+    all_buckets[0].timings.collect(thread, opcode, elapsed);
 
     // timing for current bucket
     const auto bucketid = connection.getBucketIndex();
@@ -533,7 +553,7 @@ void Cookie::collectTimings() {
      * to delete the bucket you're associated with and your're idle.
      */
     if (bucketid != 0) {
-        all_buckets[bucketid].timings.collect(opcode, elapsed);
+        all_buckets[bucketid].timings.collect(thread, opcode, elapsed);
     }
 
     // Log operations taking longer than the "slow" threshold for the opcode.
@@ -23,6 +23,7 @@
 #include <memcached/tracer.h>
 #include <nlohmann/json.hpp>
 #include <platform/sized_buffer.h>
+#include <atomic>
 #include <chrono>
 
 // Forward decls
@@ -297,6 +298,43 @@ public:
      */
     void setEwouldblock(bool ewouldblock);
 
+    /**
+     * Commands which may have multiple engine operations blocked at the
+     * same time (GetMulti) put the cookie in batched IO mode. In this mode
+     * notify_io_complete only schedules the cookie once all of the
+     * notifications registered with addPendingIo have arrived.
+     */
+    void setBatchedIo(bool enable) {
+        batchedIo = enable;
+    }
+
+    bool isBatchedIo() const {
+        return batchedIo;
+    }
+
+    /**
+     * Register that the engine will call notify_io_complete count more
+     * times for the current command (batched IO mode only)
+     *
+     * @return true if all of those notifications already arrived (and the
+     *         command should continue without blocking)
+     */
+    bool addPendingIo(int count);
+
+    /**
+     * Account for a single call to notify_io_complete in batched IO mode
+     *
+     * @param status the status passed to notify_io_complete
+     * @return true if this was the last outstanding notification
+     */
+    bool completePendingIo(ENGINE_ERROR_CODE status);
+
+    /**
+     * Get (and reset) the first non-success status passed to
+     * completePendingIo since the last call
+     */
+    ENGINE_ERROR_CODE swapBatchedIoStatus();
+
     /**
      *
      * @return
@@ -552,6 +590,17 @@ protected:
 
     bool ewouldblock = false;
 
+    /// see setBatchedIo
+    bool batchedIo = false;
+
+    /// The number of notify_io_complete calls we're still waiting for in
+    /// batched IO mode. May temporarily go negative as the engine may
+    /// notify us before we've registered the operations with addPendingIo
+    std::atomic<int> pendingIo{0};
+
+    /// The first non-success status reported in batched IO mode
+    std::atomic<ENGINE_ERROR_CODE> batchedIoStatus{ENGINE_SUCCESS};
+
     /// The number of times someone tried to reserve the cookie (to avoid
     /// releasing it while other parties think they reserved the object.
     /// Previously reserve would lock the connection, but with OOO we
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include "io_uring_backend.h"
+
 #include <JSON_checker.h>
 #include <event.h>
 #include <memcached/engine_error.h>
@@ -61,6 +63,10 @@ struct FrontEndThread {
     /// libevent handle this thread uses
     struct event_base* base = nullptr;
 
+    /// The io_uring driving the I/O of the thread's connections (if the
+    /// network backend is NetworkBackend::IoUring)
+    std::unique_ptr<IoUringBackend> io_uring;
+
     /// listen event for notify pipe
     struct event notify_event = {};
 
@@ -0,0 +1,605 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "io_uring_backend.h"
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/util.h>
+#include <logger/logger.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef ENABLE_LIBURING
+#include <liburing.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+void IoUringBackend::EventDeleter::operator()(event* ev) {
+    event_free(ev);
+}
+
+size_t IoUringBackend::getSendQueueSize(bufferevent* bev) {
+    size_t ret = evbuffer_get_length(bufferevent_get_output(bev));
+    auto* partner = bufferevent_pair_get_partner(bev);
+    if (partner) {
+        ret += evbuffer_get_length(bufferevent_get_input(partner));
+    }
+    return ret;
+}
+
+#ifdef ENABLE_LIBURING
+
+/// Number of submission queue entries of a ring
+static const unsigned ringEntries = 256;
+
+/// Number (a power of two) and size of the receive buffers of a ring
+static const unsigned recvBufferCount = 256;
+static const size_t recvBufferSize = 16 * 1024;
+
+/// Buffer group id of the receive buffers
+static const int recvBufferGroup = 0;
+
+/**
+ * Receiving is paused while this much has been received for a connection
+ * which isn't reading it (e.g. it's throttled), and resumed once half of it
+ * has been read.
+ */
+static const size_t maxReceivedPending = 1024 * 1024;
+
+/// Max number of buffers in a single sendmsg
+static const size_t maxSendIovecs = 64;
+
+/// Tags of the requests, in the low bits of their user data
+enum class Request : uint64_t { Recv = 1, Send = 2, Accept = 3 };
+static const uint64_t requestMask = 0x3;
+
+static uint64_t encode(const void* object, Request request) {
+    return reinterpret_cast<uintptr_t>(object) | uint64_t(request);
+}
+
+struct IoUringBackend::Ring {
+    Ring() = default;
+
+    ~Ring() {
+        if (bufferRing) {
+            io_uring_free_buf_ring(
+                    &ring, bufferRing, recvBufferCount, recvBufferGroup);
+        }
+        if (initialised) {
+            io_uring_queue_exit(&ring);
+        }
+        if (eventFd != -1) {
+            close(eventFd);
+        }
+    }
+
+    /// @return 0 or -errno
+    int init() {
+        auto ret = io_uring_queue_init(ringEntries, &ring, 0);
+        if (ret < 0) {
+            return ret;
+        }
+        initialised = true;
+
+        // Saves looking up the ring's descriptor on every submit (not
+        // supported by older kernels, which is fine)
+        io_uring_register_ring_fd(&ring);
+
+        eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (eventFd == -1) {
+            return -errno;
+        }
+        ret = io_uring_register_eventfd(&ring, eventFd);
+        if (ret < 0) {
+            return ret;
+        }
+
+        bufferRing = io_uring_setup_buf_ring(
+                &ring, recvBufferCount, recvBufferGroup, 0, &ret);
+        if (!bufferRing) {
+            return ret;
+        }
+        buffers.reset(new char[recvBufferCount * recvBufferSize]);
+        for (unsigned ii = 0; ii < recvBufferCount; ++ii) {
+            io_uring_buf_ring_add(bufferRing,
+                                  buffer(ii),
+                                  recvBufferSize,
+                                  ii,
+                                  io_uring_buf_ring_mask(recvBufferCount),
+                                  ii);
+        }
+        io_uring_buf_ring_advance(bufferRing, recvBufferCount);
+        return 0;
+    }
+
+    char* buffer(unsigned id) {
+        return buffers.get() + size_t(id) * recvBufferSize;
+    }
+
+    /// Give a receive buffer back to the kernel
+    void recycle(unsigned id) {
+        io_uring_buf_ring_add(bufferRing,
+                              buffer(id),
+                              recvBufferSize,
+                              id,
+                              io_uring_buf_ring_mask(recvBufferCount),
+                              0);
+        io_uring_buf_ring_advance(bufferRing, 1);
+    }
+
+    struct io_uring ring;
+    bool initialised = false;
+    int eventFd = -1;
+    struct io_uring_buf_ring* bufferRing = nullptr;
+    std::unique_ptr<char[]> buffers;
+};
+
+struct IoUringBackend::Socket {
+    IoUringBackend* backend = nullptr;
+    SOCKET sfd = INVALID_SOCKET;
+    /// Our end of the pair (input: to send, output: received)
+    bufferevent* bev = nullptr;
+    /// The connection's end of the pair, nullptr once detached
+    bufferevent* connection = nullptr;
+    msghdr msg = {};
+    std::array<iovec, maxSendIovecs> iov;
+    /// Requests in flight (a multishot recv counts once)
+    size_t inflight = 0;
+    bool recvArmed = false;
+    bool sending = false;
+    /// Receiving paused as the connection isn't reading
+    bool paused = false;
+    /// The stream ended (or failed), nothing more to receive or send
+    bool finished = false;
+};
+
+struct IoUringBackend::Listener {
+    SOCKET sfd = INVALID_SOCKET;
+    AcceptCallback callback;
+    size_t inflight = 0;
+    bool armed = false;
+    bool closed = false;
+};
+
+bool IoUringBackend::isSupported() {
+    return true;
+}
+
+std::unique_ptr<IoUringBackend> IoUringBackend::create(event_base* base) {
+    auto ring = std::make_unique<Ring>();
+    const auto ret = ring->init();
+    if (ret < 0) {
+        LOG_WARNING("Failed to set up io_uring for the network backend: {}",
+                    strerror(-ret));
+        return {};
+    }
+    return std::unique_ptr<IoUringBackend>(
+            new IoUringBackend(base, std::move(ring)));
+}
+
+IoUringBackend::IoUringBackend(event_base* base, std::unique_ptr<Ring> ring)
+    : base(base), ring(std::move(ring)) {
+    completionEvent.reset(event_new(base,
+                                    this->ring->eventFd,
+                                    EV_READ | EV_PERSIST,
+                                    completionCallback,
+                                    this));
+    submitEvent.reset(event_new(base, -1, 0, submitCallback, this));
+    if (!completionEvent || !submitEvent ||
+        event_add(completionEvent.get(), nullptr) == -1) {
+        throw std::runtime_error(
+                "IoUringBackend: Failed to add the ring to the event base");
+    }
+}
+
+IoUringBackend::~IoUringBackend() {
+    // Cancel everything and wait for the kernel to be done with the
+    // buffers of the requests before releasing them
+    while (!sockets.empty()) {
+        detach(sockets.begin()->first);
+    }
+    std::vector<SOCKET> listening;
+    for (const auto& listener : listeners) {
+        listening.push_back(listener->sfd);
+    }
+    for (auto sfd : listening) {
+        unlisten(sfd);
+    }
+    while (!detached.empty() || !listeners.empty()) {
+        submit();
+        io_uring_cqe* cqe;
+        if (io_uring_wait_cqe(&ring->ring, &cqe) < 0) {
+            break;
+        }
+        reap();
+    }
+}
+
+bufferevent* IoUringBackend::attach(SOCKET sfd) {
+    bufferevent* pair[2];
+    if (bufferevent_pair_new(base, BEV_OPT_DEFER_CALLBACKS, pair) == -1) {
+        throw std::bad_alloc();
+    }
+
+    auto sock = std::make_unique<Socket>();
+    sock->backend = this;
+    sock->sfd = sfd;
+    sock->bev = pair[1];
+    sock->connection = pair[0];
+    bufferevent_setcb(
+            sock->bev, sendCallback, drainedCallback, nullptr, sock.get());
+    bufferevent_setwatermark(sock->bev, EV_WRITE, maxReceivedPending / 2, 0);
+    bufferevent_enable(sock->bev, EV_READ | EV_WRITE);
+    armRecv(*sock);
+
+    sockets.emplace(pair[0], std::move(sock));
+    return pair[0];
+}
+
+void IoUringBackend::detach(bufferevent* bev) {
+    auto iter = sockets.find(bev);
+    if (iter == sockets.end()) {
+        throw std::invalid_argument(
+                "IoUringBackend::detach: Unknown bufferevent");
+    }
+    auto sock = std::move(iter->second);
+    sockets.erase(iter);
+
+    sock->connection = nullptr;
+    sock->finished = true;
+    if (sock->recvArmed) {
+        cancel(encode(sock.get(), Request::Recv));
+    }
+    auto* ptr = sock.get();
+    detached.emplace(ptr, std::move(sock));
+    maybeRelease(*ptr);
+}
+
+void IoUringBackend::listen(SOCKET sfd, AcceptCallback callback) {
+    auto listener = std::make_unique<Listener>();
+    listener->sfd = sfd;
+    listener->callback = std::move(callback);
+    armAccept(*listener);
+    listeners.push_back(std::move(listener));
+}
+
+void IoUringBackend::unlisten(SOCKET sfd) {
+    for (auto& listener : listeners) {
+        if (listener->sfd == sfd && !listener->closed) {
+            listener->closed = true;
+            if (listener->armed) {
+                cancel(encode(listener.get(), Request::Accept));
+            }
+        }
+    }
+    listeners.erase(std::remove_if(listeners.begin(),
+                                   listeners.end(),
+                                   [](const std::unique_ptr<Listener>& l) {
+                                       return l->closed && l->inflight == 0;
+                                   }),
+                    listeners.end());
+}
+
+void IoUringBackend::completionCallback(int, short, void* arg) {
+    auto& backend = *reinterpret_cast<IoUringBackend*>(arg);
+    uint64_t value;
+    while (read(backend.ring->eventFd, &value, sizeof(value)) > 0) {
+        // drain the counter
+    }
+    backend.reap();
+}
+
+void IoUringBackend::submitCallback(int, short, void* arg) {
+    reinterpret_cast<IoUringBackend*>(arg)->submit();
+}
+
+void IoUringBackend::sendCallback(bufferevent*, void* arg) {
+    auto& sock = *reinterpret_cast<Socket*>(arg);
+    sock.backend->startSend(sock);
+}
+
+void IoUringBackend::drainedCallback(bufferevent*, void* arg) {
+    // The connection has read enough of what we received to resume
+    auto& sock = *reinterpret_cast<Socket*>(arg);
+    if (sock.paused && !sock.finished) {
+        sock.paused = false;
+        if (!sock.recvArmed) {
+            sock.backend->armRecv(sock);
+        }
+    }
+}
+
+void* IoUringBackend::getSqe() {
+    auto* sqe = io_uring_get_sqe(&ring->ring);
+    if (!sqe) {
+        // The submission queue is full, submit what we've got so far
+        submit();
+        sqe = io_uring_get_sqe(&ring->ring);
+        if (!sqe) {
+            throw std::runtime_error(
+                    "IoUringBackend::getSqe: Submission queue is full");
+        }
+    }
+    if (!submitPending) {
+        submitPending = true;
+        event_active(submitEvent.get(), EV_TIMEOUT, 0);
+    }
+    return sqe;
+}
+
+void IoUringBackend::submit() {
+    submitPending = false;
+    const auto ret = io_uring_submit(&ring->ring);
+    ++submitCalls;
+    if (ret > 0) {
+        submitted += ret;
+    } else if (ret < 0 && ret != -EBUSY && ret != -EAGAIN) {
+        LOG_WARNING("IoUringBackend::submit: io_uring_submit failed: {}",
+                    strerror(-ret));
+    }
+}
+
+void IoUringBackend::reap() {
+    do {
+        unsigned head;
+        unsigned count = 0;
+        io_uring_cqe* cqe;
+        io_uring_for_each_cqe(&ring->ring, head, cqe) {
+            ++count;
+            const auto data = io_uring_cqe_get_data64(cqe);
+            auto* object = reinterpret_cast<void*>(data & ~requestMask);
+            switch (Request(data & requestMask)) {
+            case Request::Recv:
+                onRecv(*reinterpret_cast<Socket*>(object),
+                       cqe->res,
+                       cqe->flags);
+                break;
+            case Request::Send:
+                onSend(*reinterpret_cast<Socket*>(object), cqe->res);
+                break;
+            case Request::Accept:
+                onAccept(*reinterpret_cast<Listener*>(object),
+                         cqe->res,
+                         cqe->flags);
+                break;
+            default:
+                // Cancel requests, nothing to do
+                break;
+            }
+        }
+        io_uring_cq_advance(&ring->ring, count);
+        // Completions which didn't fit in the completion queue are only
+        // posted when we enter the kernel
+        if (!io_uring_cq_has_overflow(&ring->ring)) {
+            break;
+        }
+        io_uring_get_events(&ring->ring);
+    } while (true);
+}
+
+void IoUringBackend::armRecv(Socket& sock) {
+    auto* sqe = static_cast<io_uring_sqe*>(getSqe());
+    io_uring_prep_recv_multishot(sqe, sock.sfd, nullptr, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = recvBufferGroup;
+    io_uring_sqe_set_data64(sqe, encode(&sock, Request::Recv));
+    sock.recvArmed = true;
+    ++sock.inflight;
+}
+
+void IoUringBackend::startSend(Socket& sock) {
+    if (sock.sending || sock.finished) {
+        return;
+    }
+    auto* input = bufferevent_get_input(sock.bev);
+    auto nvec = evbuffer_peek(
+            input, -1, nullptr, sock.iov.data(), int(sock.iov.size()));
+    if (nvec <= 0) {
+        return;
+    }
+    sock.msg = {};
+    sock.msg.msg_iov = sock.iov.data();
+    sock.msg.msg_iovlen = std::min(size_t(nvec), sock.iov.size());
+
+    auto* sqe = static_cast<io_uring_sqe*>(getSqe());
+    io_uring_prep_sendmsg(sqe, sock.sfd, &sock.msg, MSG_NOSIGNAL);
+    io_uring_sqe_set_data64(sqe, encode(&sock, Request::Send));
+    sock.sending = true;
+    ++sock.inflight;
+
+    // Leave what the connection writes meanwhile in its own output buffer
+    // (where it sees it as not sent), and don't move the data being sent
+    bufferevent_disable(sock.bev, EV_READ);
+}
+
+void IoUringBackend::armAccept(Listener& listener) {
+    auto* sqe = static_cast<io_uring_sqe*>(getSqe());
+    io_uring_prep_multishot_accept(sqe, listener.sfd, nullptr, nullptr, 0);
+    io_uring_sqe_set_data64(sqe, encode(&listener, Request::Accept));
+    listener.armed = true;
+    ++listener.inflight;
+}
+
+void IoUringBackend::cancel(uint64_t userData) {
+    auto* sqe = static_cast<io_uring_sqe*>(getSqe());
+    io_uring_prep_cancel64(sqe, userData, 0);
+    io_uring_sqe_set_data64(sqe, 0);
+}
+
+void IoUringBackend::onRecv(Socket& sock, int res, unsigned flags) {
+    if ((flags & IORING_CQE_F_MORE) == 0) {
+        sock.recvArmed = false;
+        --sock.inflight;
+    }
+    if ((flags & IORING_CQE_F_BUFFER) != 0) {
+        const auto id = flags >> IORING_CQE_BUFFER_SHIFT;
+        if (res > 0 && !sock.finished) {
+            // Into the connection's input (through our output)
+            bufferevent_write(sock.bev, ring->buffer(id), size_t(res));
+        }
+        ring->recycle(id);
+    }
+
+    if (sock.finished) {
+        maybeRelease(sock);
+        return;
+    }
+
+    if (res == 0) {
+        finish(sock, false);
+    } else if (res < 0 && res != -ENOBUFS && res != -ECANCELED &&
+               res != -EAGAIN && res != -EINTR) {
+        errno = -res;
+        finish(sock, true);
+    } else if (evbuffer_get_length(bufferevent_get_output(sock.bev)) >=
+               maxReceivedPending) {
+        if (!sock.paused) {
+            sock.paused = true;
+            if (sock.recvArmed) {
+                cancel(encode(&sock, Request::Recv));
+            }
+        }
+    } else if (!sock.recvArmed && !sock.paused) {
+        // The multishot recv ended (e.g. ran out of buffers), re-arm it
+        armRecv(sock);
+    }
+}
+
+void IoUringBackend::onSend(Socket& sock, int res) {
+    sock.sending = false;
+    --sock.inflight;
+    if (res > 0) {
+        evbuffer_drain(bufferevent_get_input(sock.bev), size_t(res));
+    }
+
+    if (sock.finished) {
+        maybeRelease(sock);
+        return;
+    }
+
+    if (res < 0 && res != -EAGAIN && res != -EINTR) {
+        errno = -res;
+        finish(sock, true);
+        return;
+    }
+
+    // Move over what the connection wrote meanwhile, and send the rest
+    bufferevent_enable(sock.bev, EV_READ);
+    startSend(sock);
+}
+
+void IoUringBackend::onAccept(Listener& listener, int res, unsigned flags) {
+    if (listener.closed) {
+        if (res >= 0) {
+            evutil_closesocket(res);
+        }
+    } else if (res >= 0) {
+        listener.callback(SOCKET(res), 0);
+    } else if (res != -ECANCELED) {
+        listener.callback(INVALID_SOCKET, -res);
+    }
+
+    // Only now, as the callback may unlisten (which would otherwise free
+    // the listener under our feet)
+    if ((flags & IORING_CQE_F_MORE) == 0) {
+        listener.armed = false;
+        --listener.inflight;
+    }
+
+    // The callback may have stopped the listener
+    if (!listener.closed && !listener.armed) {
+        armAccept(listener);
+    } else if (listener.closed && listener.inflight == 0) {
+        listeners.erase(
+                std::find_if(listeners.begin(),
+                             listeners.end(),
+                             [&listener](const std::unique_ptr<Listener>& l) {
+                                 return l.get() == &listener;
+                             }));
+    }
+}
+
+void IoUringBackend::finish(Socket& sock, bool error) {
+    sock.finished = true;
+    if (sock.recvArmed) {
+        cancel(encode(&sock, Request::Recv));
+    }
+    // Hand the connection what's left, followed by EOF (which it handles
+    // like an error: it closes the connection)
+    if (error) {
+        LOG_DEBUG("IoUringBackend: Socket {} failed: {}",
+                  sock.sfd,
+                  strerror(errno));
+    }
+    bufferevent_flush(sock.bev, EV_WRITE, BEV_FINISHED);
+}
+
+void IoUringBackend::maybeRelease(Socket& sock) {
+    if (sock.connection || sock.inflight != 0) {
+        return;
+    }
+    auto iter = detached.find(&sock);
+    if (iter == detached.end()) {
+        return;
+    }
+    bufferevent_free(sock.bev);
+    evutil_closesocket(sock.sfd);
+    detached.erase(iter);
+}
+
+#else
+
+struct IoUringBackend::Ring {};
+struct IoUringBackend::Socket {};
+struct IoUringBackend::Listener {};
+
+bool IoUringBackend::isSupported() {
+    return false;
+}
+
+std::unique_ptr<IoUringBackend> IoUringBackend::create(event_base*) {
+    return {};
+}
+
+IoUringBackend::~IoUringBackend() = default;
+
+bufferevent* IoUringBackend::attach(SOCKET) {
+    throw std::logic_error("IoUringBackend::attach: Not supported");
+}
+
+void IoUringBackend::detach(bufferevent*) {
+    throw std::logic_error("IoUringBackend::detach: Not supported");
+}
+
+void IoUringBackend::listen(SOCKET, AcceptCallback) {
+    throw std::logic_error("IoUringBackend::listen: Not supported");
+}
+
+void IoUringBackend::unlisten(SOCKET) {
+    throw std::logic_error("IoUringBackend::unlisten: Not supported");
+}
+
+#endif
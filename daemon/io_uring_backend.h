@@ -0,0 +1,175 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <platform/socket.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct bufferevent;
+struct event;
+struct event_base;
+
+/**
+ * The io_uring network backend (NetworkBackend::IoUring) of a front end
+ * thread.
+ *
+ * The socket I/O of the thread's plain (non-SSL) connections, and the
+ * accepting of new clients on the dispatcher thread, is done through an
+ * io_uring instead of readiness notifications and read/write calls:
+ *
+ *  - Every socket has a multishot recv armed, picking its buffers from a
+ *    ring of buffers registered with the kernel, so a connection costs no
+ *    system call per read. Listening sockets likewise have a multishot
+ *    accept armed.
+ *  - Sends are sendmsg requests of the iovecs of the data queued by the
+ *    connection (no copy).
+ *  - All of the requests queued while the thread processes an iteration of
+ *    its event loop are submitted together by one io_uring_submit, and all
+ *    of the completions are reaped together when the ring's eventfd fires.
+ *
+ * The connection code still talks to a libevent bufferevent: attach()
+ * returns one end of a bufferevent pair, whose other end is fed by the
+ * received data and drained by the sends. The event base keeps running the
+ * thread (the eventfd of the ring is one of its events), which keeps the
+ * notification pipe, timers and the SSL connections as they are.
+ *
+ * Only available if memcached was built with liburing (KV_USE_LIBURING);
+ * a backend must only be used by the thread running its event base.
+ */
+class IoUringBackend {
+public:
+    /// Called for every client accepted; error is set if the accept failed
+    using AcceptCallback = std::function<void(SOCKET client, int error)>;
+
+    /// @return true if memcached was built with io_uring support
+    static bool isSupported();
+
+    /**
+     * Create a backend driven by the given event base, which must outlive
+     * the backend.
+     *
+     * @return the backend, or nullptr if io_uring isn't available (not
+     *         built in, or not supported by the kernel)
+     */
+    static std::unique_ptr<IoUringBackend> create(event_base* base);
+
+    IoUringBackend(const IoUringBackend&) = delete;
+    IoUringBackend& operator=(const IoUringBackend&) = delete;
+
+    /// Cancels all of the requests in flight, and waits for them
+    ~IoUringBackend();
+
+    /**
+     * Start driving the I/O of a connected socket.
+     *
+     * @param sfd The (non-blocking) socket, owned by the backend from now on
+     * @return the bufferevent the connection should use; it must be passed
+     *         to detach() before it's freed
+     */
+    bufferevent* attach(SOCKET sfd);
+
+    /**
+     * Stop driving the socket of the bufferevent. The socket is closed
+     * once the requests in flight for it have completed.
+     */
+    void detach(bufferevent* bev);
+
+    /**
+     * @return the number of bytes written to the bufferevent (returned by
+     *         attach()) which have not been sent yet
+     */
+    static size_t getSendQueueSize(bufferevent* bev);
+
+    /// Accept clients on the listening socket with a multishot accept
+    void listen(SOCKET sfd, AcceptCallback callback);
+
+    /// Stop accepting clients on the listening socket
+    void unlisten(SOCKET sfd);
+
+    /// Number of io_uring_submit calls made
+    size_t getSubmitCalls() const {
+        return submitCalls;
+    }
+
+    /// Number of requests submitted
+    size_t getSubmitted() const {
+        return submitted;
+    }
+
+protected:
+    struct Ring;
+    struct Socket;
+    struct Listener;
+
+    explicit IoUringBackend(event_base* base, std::unique_ptr<Ring> ring);
+
+    static void completionCallback(int, short, void* arg);
+    static void submitCallback(int, short, void* arg);
+    static void sendCallback(bufferevent* bev, void* arg);
+    static void drainedCallback(bufferevent* bev, void* arg);
+
+    /// Get a submission queue entry, scheduling the submission of the batch
+    void* getSqe();
+
+    /// Submit the requests queued
+    void submit();
+
+    /// Process all of the completions available
+    void reap();
+
+    void armRecv(Socket& sock);
+    void startSend(Socket& sock);
+    void armAccept(Listener& listener);
+    void cancel(uint64_t userData);
+
+    void onRecv(Socket& sock, int res, unsigned flags);
+    void onSend(Socket& sock, int res);
+    void onAccept(Listener& listener, int res, unsigned flags);
+
+    /// Hand the end of the stream (or an error) to the connection
+    void finish(Socket& sock, bool error);
+
+    /// Free the socket if it's detached and has no requests in flight
+    void maybeRelease(Socket& sock);
+
+    event_base* const base;
+    std::unique_ptr<Ring> ring;
+
+    struct EventDeleter {
+        void operator()(event* ev);
+    };
+    /// Fires when the ring posts completions (on its eventfd)
+    std::unique_ptr<event, EventDeleter> completionEvent;
+    /// Activated to submit the requests queued in this loop iteration
+    std::unique_ptr<event, EventDeleter> submitEvent;
+    bool submitPending = false;
+
+    /// The sockets attached, by the bufferevent of their connection
+    std::unordered_map<bufferevent*, std::unique_ptr<Socket>> sockets;
+    /// Sockets detached with requests still in flight
+    std::unordered_map<Socket*, std::unique_ptr<Socket>> detached;
+    std::vector<std::unique_ptr<Listener>> listeners;
+
+    size_t submitCalls = 0;
+    size_t submitted = 0;
+};
@@ -0,0 +1,263 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Functional tests of the io_uring network backend. The "server" end of a
+ * socketpair is driven by an IoUringBackend (like the connections of the
+ * front end threads), and the test plays the client on the other end.
+ */
+
+#include "io_uring_backend.h"
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/util.h>
+#include <folly/portability/GTest.h>
+#include <liburing.h>
+#include <logger/logger.h>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+class IoUringBackendTest : public ::testing::Test {
+protected:
+    static void SetUpTestCase() {
+        cb::logger::createBlackholeLogger();
+    }
+
+    void SetUp() override {
+        base = event_base_new();
+        ASSERT_NE(nullptr, base);
+        backend = IoUringBackend::create(base);
+        if (!backend) {
+            // Only acceptable if the kernel doesn't support io_uring
+            struct io_uring ring;
+            const auto ret = io_uring_queue_init(1, &ring, 0);
+            ASSERT_LT(ret, 0) << "io_uring is available, but the backend "
+                                 "failed to set it up";
+            std::cout << "Note: skipping test '"
+                      << ::testing::UnitTest::GetInstance()
+                                 ->current_test_info()
+                                 ->name()
+                      << "' as io_uring isn't supported: " << strerror(-ret)
+                      << "\n";
+            return;
+        }
+
+        evutil_socket_t fds[2];
+        ASSERT_NE(-1, evutil_socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+        evutil_make_socket_nonblocking(fds[0]);
+        evutil_make_socket_nonblocking(fds[1]);
+        peer = fds[1];
+
+        server = backend->attach(fds[0]);
+        ASSERT_NE(nullptr, server);
+        bufferevent_setcb(server, nullptr, nullptr, eventCallback, this);
+        bufferevent_enable(server, EV_READ | EV_WRITE);
+    }
+
+    void TearDown() override {
+        if (server) {
+            backend->detach(server);
+            bufferevent_free(server);
+        }
+        // Waits for the requests in flight
+        backend.reset();
+        if (peer != INVALID_SOCKET) {
+            evutil_closesocket(peer);
+        }
+        if (base) {
+            event_base_free(base);
+        }
+    }
+
+    bool isSupported() const {
+        return backend != nullptr;
+    }
+
+    static void eventCallback(bufferevent*, short event, void* ctx) {
+        reinterpret_cast<IoUringBackendTest*>(ctx)->events |= event;
+    }
+
+    /**
+     * Run the event loop until the condition is met (or a timeout)
+     *
+     * @return true if the condition is met
+     */
+    bool runUntil(const std::function<bool()>& condition) {
+        const auto timeout =
+                std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > timeout) {
+                return false;
+            }
+            event_base_loop(base, EVLOOP_NONBLOCK);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        return true;
+    }
+
+    /// Read whatever is available on the peer's end of the socketpair
+    /// @return the number of bytes read, 0 on EOF, -1 if nothing available
+    ssize_t readPeer(std::string& received) {
+        char buffer[64 * 1024];
+        const auto nr = recv(peer, buffer, sizeof(buffer), 0);
+        if (nr > 0) {
+            received.append(buffer, nr);
+        }
+        return nr;
+    }
+
+    /// @return a payload of the given size which isn't the same byte all over
+    static std::string makePayload(size_t size) {
+        std::string payload(size, '\0');
+        for (size_t ii = 0; ii < size; ++ii) {
+            payload[ii] = char('a' + ii % 23);
+        }
+        return payload;
+    }
+
+    std::string getServerInput() const {
+        auto* input = bufferevent_get_input(server);
+        const auto size = evbuffer_get_length(input);
+        return {reinterpret_cast<const char*>(evbuffer_pullup(input, -1)),
+                size};
+    }
+
+    event_base* base = nullptr;
+    std::unique_ptr<IoUringBackend> backend;
+    bufferevent* server = nullptr;
+    SOCKET peer = INVALID_SOCKET;
+    short events = 0;
+};
+
+// Data sent by the peer shows up in the input of the bufferevent
+TEST_F(IoUringBackendTest, Receive) {
+    if (!isSupported()) {
+        return;
+    }
+
+    const std::string request = "hello";
+    ASSERT_EQ(ssize_t(request.size()),
+              send(peer, request.data(), request.size(), 0));
+    ASSERT_TRUE(runUntil([this, &request]() {
+        return evbuffer_get_length(bufferevent_get_input(server)) >=
+               request.size();
+    }));
+    EXPECT_EQ(request, getServerInput());
+
+    // More than the size of a receive buffer, in several sends
+    const auto payload = makePayload(256 * 1024);
+    size_t sent = 0;
+    std::string expected = request;
+    ASSERT_TRUE(runUntil([this, &payload, &sent]() {
+        if (sent < payload.size()) {
+            const auto nw = send(
+                    peer, payload.data() + sent, payload.size() - sent, 0);
+            if (nw > 0) {
+                sent += nw;
+            }
+        }
+        return sent == payload.size() &&
+               evbuffer_get_length(bufferevent_get_input(server)) ==
+                       request.size() + payload.size();
+    }));
+    expected.append(payload);
+    EXPECT_EQ(expected, getServerInput());
+    EXPECT_EQ(0, events);
+}
+
+// Data written to the bufferevent arrives at the peer, in order, even when
+// the socket only takes part of it at a time (the peer reads slowly)
+TEST_F(IoUringBackendTest, SendPartialWrites) {
+    if (!isSupported()) {
+        return;
+    }
+
+    const auto payload = makePayload(4 * 1024 * 1024);
+    ASSERT_EQ(0, bufferevent_write(server, payload.data(), payload.size()));
+
+    std::string received;
+    ASSERT_TRUE(runUntil([this, &received, &payload]() {
+        readPeer(received);
+        return received.size() >= payload.size();
+    }));
+    EXPECT_EQ(payload.size(), received.size());
+    EXPECT_TRUE(payload == received);
+    EXPECT_TRUE(runUntil([this]() {
+        return IoUringBackend::getSendQueueSize(server) == 0;
+    }));
+
+    // Several writes in a row are sent in order too
+    received.clear();
+    for (const auto* part : {"one", "two", "three"}) {
+        bufferevent_write(server, part, strlen(part));
+    }
+    ASSERT_TRUE(runUntil([this, &received]() {
+        readPeer(received);
+        return received.size() >= strlen("onetwothree");
+    }));
+    EXPECT_EQ("onetwothree", received);
+    EXPECT_LT(0, backend->getSubmitted());
+}
+
+// The data received before the peer closed its end is delivered, followed
+// by EOF
+TEST_F(IoUringBackendTest, EOFAfterData) {
+    if (!isSupported()) {
+        return;
+    }
+
+    const std::string request = "goodbye";
+    ASSERT_EQ(ssize_t(request.size()),
+              send(peer, request.data(), request.size(), 0));
+    evutil_closesocket(peer);
+    peer = INVALID_SOCKET;
+
+    ASSERT_TRUE(runUntil([this]() { return events != 0; }));
+    EXPECT_TRUE(events & BEV_EVENT_EOF) << events;
+    EXPECT_EQ(request, getServerInput());
+}
+
+// Detaching closes the socket (once the requests in flight are done), so
+// the peer sees EOF
+TEST_F(IoUringBackendTest, DetachCloses) {
+    if (!isSupported()) {
+        return;
+    }
+
+    // Exchange some data first, so there's a recv armed and completed
+    ASSERT_EQ(1, send(peer, "x", 1, 0));
+    ASSERT_TRUE(runUntil([this]() {
+        return evbuffer_get_length(bufferevent_get_input(server)) == 1;
+    }));
+
+    backend->detach(server);
+    bufferevent_free(server);
+    server = nullptr;
+
+    std::string received;
+    ASSERT_TRUE(runUntil([this, &received]() {
+        return readPeer(received) == 0;
+    }));
+    EXPECT_TRUE(received.empty());
+}
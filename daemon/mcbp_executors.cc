@@ -41,6 +41,7 @@
 #include "protocol/mcbp/flush_command_context.h"
 #include "protocol/mcbp/gat_context.h"
 #include "protocol/mcbp/get_context.h"
+#include "protocol/mcbp/get_multi_context.h"
 #include "protocol/mcbp/get_locked_context.h"
 #include "protocol/mcbp/get_meta_context.h"
 #include "protocol/mcbp/mutation_context.h"
@@ -181,6 +182,10 @@ static void get_executor(Cookie& cookie) {
     process_bin_get(cookie);
 }
 
+static void get_multi_executor(Cookie& cookie) {
+    cookie.obtainContext<GetMultiCommandContext>(cookie).drive();
+}
+
 static void get_meta_executor(Cookie& cookie) {
     process_bin_get_meta(cookie);
 }
@@ -750,6 +755,7 @@ void initialize_mbcp_lookup_map() {
     setup_handler(cb::mcbp::ClientOpcode::Getq, get_executor);
     setup_handler(cb::mcbp::ClientOpcode::Getk, get_executor);
     setup_handler(cb::mcbp::ClientOpcode::Getkq, get_executor);
+    setup_handler(cb::mcbp::ClientOpcode::GetMulti, get_multi_executor);
     setup_handler(cb::mcbp::ClientOpcode::GetMeta, get_meta_executor);
     setup_handler(cb::mcbp::ClientOpcode::GetqMeta, get_meta_executor);
     setup_handler(cb::mcbp::ClientOpcode::Gat, gat_executor);
@@ -159,6 +159,7 @@ McbpPrivilegeChains::McbpPrivilegeChains() {
     /* Vbucket command to get the VBUCKET sequence numbers for all
      * vbuckets on the node */
     setup(cb::mcbp::ClientOpcode::GetAllVbSeqnos, require<Privilege::MetaRead>);
+    setup(cb::mcbp::ClientOpcode::GetMulti, require<Privilege::Read>);
 
     /* DCP */
     setup(cb::mcbp::ClientOpcode::DcpOpen, empty);
@@ -35,8 +35,10 @@
 using cb::mcbp::Status;
 
 bool is_document_key_valid(Cookie& cookie) {
-    const auto& req = cookie.getRequest();
-    const auto& key = req.getKey();
+    return is_document_key_valid(cookie, cookie.getRequest().getKey());
+}
+
+bool is_document_key_valid(Cookie& cookie, cb::const_byte_buffer key) {
     if (!cookie.getConnection().isCollectionsSupported()) {
         return true;
     }
@@ -1207,6 +1209,49 @@ static Status get_validator(Cookie& cookie) {
     return Status::Success;
 }
 
+static Status get_multi_validator(Cookie& cookie) {
+    auto status = McbpValidator::verify_header(cookie,
+                                               0,
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::NonZero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    using cb::mcbp::request::GetMultiKeyHeader;
+    auto value = cookie.getRequest().getValue();
+    size_t nkeys = 0;
+    while (!value.empty()) {
+        if (value.size() < sizeof(GetMultiKeyHeader)) {
+            cookie.setErrorContext("Truncated key header");
+            return Status::Einval;
+        }
+        const auto* hdr =
+                reinterpret_cast<const GetMultiKeyHeader*>(value.data());
+        value = {value.data() + sizeof(GetMultiKeyHeader),
+                 value.size() - sizeof(GetMultiKeyHeader)};
+        const auto keylen = hdr->getKeylen();
+        if (keylen == 0 || keylen > value.size()) {
+            cookie.setErrorContext("Invalid key length");
+            return Status::Einval;
+        }
+        if (!is_document_key_valid(cookie, {value.data(), keylen})) {
+            return Status::Einval;
+        }
+        value = {value.data() + keylen, value.size() - keylen};
+        if (++nkeys > cb::mcbp::request::GetMultiMaxKeys) {
+            cookie.setErrorContext(
+                    "Too many keys (max " +
+                    std::to_string(cb::mcbp::request::GetMultiMaxKeys) + ")");
+            return Status::E2big;
+        }
+    }
+
+    return Status::Success;
+}
+
 static Status gat_validator(Cookie& cookie) {
     auto status =
             McbpValidator::verify_header(cookie,
@@ -2270,6 +2315,7 @@ McbpValidator::McbpValidator() {
     setup(cb::mcbp::ClientOpcode::DeleteBucket, delete_bucket_validator);
     setup(cb::mcbp::ClientOpcode::SelectBucket, select_bucket_validator);
     setup(cb::mcbp::ClientOpcode::GetAllVbSeqnos, get_all_vb_seqnos_validator);
+    setup(cb::mcbp::ClientOpcode::GetMulti, get_multi_validator);
 
     setup(cb::mcbp::ClientOpcode::EvictKey, evict_key_validator);
     setup(cb::mcbp::ClientOpcode::Scrub, scrub_validator);
@@ -23,6 +23,7 @@
 #include <mcbp/protocol/datatype.h>
 #include <mcbp/protocol/opcode.h>
 #include <mcbp/protocol/status.h>
+#include <platform/sized_buffer.h>
 #include <array>
 #include <functional>
 
@@ -75,3 +76,12 @@ protected:
  * @return true if the keylen represents a valid key for the connection
  */
 bool is_document_key_valid(Cookie& cookie);
+
+/**
+ * Validate a key which isn't located in the key field of the request (for
+ * instance one of the keys packed into the value of a GetMulti request)
+ * @param cookie non const reference as failure will update the error context
+ * @param key the key to validate
+ * @return true if key represents a valid key for the connection
+ */
+bool is_document_key_valid(Cookie& cookie, cb::const_byte_buffer key);
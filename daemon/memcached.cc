@@ -26,6 +26,7 @@
 #include "executorpool.h"
 #include "external_auth_manager_thread.h"
 #include "front_end_thread.h"
+#include "io_uring_backend.h"
 #include "ioctl.h"
 #include "libevent_locking.h"
 #include "listening_port.h"
@@ -154,6 +155,8 @@ std::vector<std::unique_ptr<ServerSocket>> listen_conn;
 std::atomic_bool check_listen_conn;
 
 static struct event_base *main_base;
+/// The io_uring accepting clients (with NetworkBackend::IoUring)
+static std::unique_ptr<IoUringBackend> dispatcher_io_uring;
 
 static engine_event_handler_array_t engine_event_handlers;
 
@@ -801,6 +804,34 @@ void listen_event_handler(evutil_socket_t, short, void *arg) {
     }
 }
 
+/**
+ * The listen_accept_handler is the callback from the io_uring when it
+ * accepted a client (or failed to) on one of the server sockets.
+ */
+void listen_accept_handler(ServerSocket& c, SOCKET client, int error) {
+    if (memcached_shutdown) {
+        if (client != INVALID_SOCKET) {
+            safe_close(client);
+        }
+        LOG_INFO("Stopping listen thread");
+        event_base_loopbreak(main_base);
+        return;
+    }
+
+    if (client == INVALID_SOCKET) {
+        c.acceptFailed(error);
+        return;
+    }
+
+    try {
+        c.acceptNewClient(client);
+    } catch (std::invalid_argument& e) {
+        LOG_WARNING("{}: exception occurred while accepting clients: {}",
+                    c.getSocket(),
+                    e.what());
+    }
+}
+
 static void dispatch_event_handler(evutil_socket_t fd, short, void *) {
     // Start by draining the notification pipe fist
     drain_notification_channel(fd);
@@ -1154,8 +1185,8 @@ static bool server_socket(const std::string& tag,
                                                      system_port,
                                                      sslkey,
                                                      sslcert);
-        listen_conn.emplace_back(
-                std::make_unique<ServerSocket>(sfd, main_base, inter));
+        listen_conn.emplace_back(std::make_unique<ServerSocket>(
+                sfd, main_base, inter, dispatcher_io_uring.get()));
         stats.daemon_conns++;
         stats.curr_conns.fetch_add(1, std::memory_order_relaxed);
     }
@@ -1643,6 +1674,7 @@ void initialize_buckets() {
     size_t numthread = Settings::instance().getNumWorkerThreads() + 1;
     for (auto &b : all_buckets) {
         b.stats.resize(numthread);
+        b.timings.initialize(numthread);
     }
 
     // To make the life easier for us in the code, index 0
@@ -1970,6 +2002,14 @@ extern "C" int memcached_main(int argc, char **argv) {
 
     /* initialize main thread libevent instance */
     main_base = event_base_new();
+    if (Settings::instance().getNetworkBackend() == NetworkBackend::IoUring) {
+        dispatcher_io_uring = IoUringBackend::create(main_base);
+        if (!dispatcher_io_uring) {
+            LOG_WARNING(
+                    "io_uring isn't available, accepting clients with the "
+                    "default network backend");
+        }
+    }
 
     cb::console::set_sigint_handler(sigint_handler);
 
@@ -2049,6 +2089,7 @@ extern "C" int memcached_main(int argc, char **argv) {
 
     LOG_INFO("Releasing server sockets");
     listen_conn.clear();
+    dispatcher_io_uring.reset();
 
     LOG_INFO("Releasing bucket resources");
     cleanup_buckets();
@@ -76,6 +76,8 @@ int add_conn_to_pending_io_list(Connection* c,
                                 Cookie* cookie,
                                 ENGINE_ERROR_CODE status);
 void listen_event_handler(evutil_socket_t, short, void *);
+class ServerSocket;
+void listen_accept_handler(ServerSocket& socket, SOCKET client, int error);
 
 void perform_callbacks(ENGINE_EVENT_TYPE type,
                        const void *data,
@@ -0,0 +1,74 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "network_backend.h"
+
+#include <event2/event.h>
+#include <memory>
+#include <stdexcept>
+
+std::string to_string(NetworkBackend backend) {
+    switch (backend) {
+    case NetworkBackend::Default:
+        return "default";
+    case NetworkBackend::EpollChangelist:
+        return "epoll_changelist";
+    case NetworkBackend::IoUring:
+        return "io_uring";
+    }
+    throw std::invalid_argument("to_string(NetworkBackend): Invalid value: " +
+                                std::to_string(int(backend)));
+}
+
+NetworkBackend parse_network_backend(const std::string& str) {
+    if (str == "default") {
+        return NetworkBackend::Default;
+    }
+    if (str == "epoll_changelist") {
+        return NetworkBackend::EpollChangelist;
+    }
+    if (str == "io_uring") {
+        return NetworkBackend::IoUring;
+    }
+    throw std::invalid_argument(
+            R"(parse_network_backend: Unknown backend ")" + str + R"(")");
+}
+
+struct EventConfigDeleter {
+    void operator()(event_config* cfg) {
+        event_config_free(cfg);
+    }
+};
+
+event_base* create_event_base(NetworkBackend backend) {
+    if (backend == NetworkBackend::Default ||
+        backend == NetworkBackend::IoUring) {
+        // The io_uring backend only needs the event base for what it
+        // doesn't handle itself
+        return event_base_new();
+    }
+
+    std::unique_ptr<event_config, EventConfigDeleter> cfg(event_config_new());
+    if (!cfg) {
+        return nullptr;
+    }
+
+    // The flag is ignored by all other methods than epoll, so we'll fall
+    // back to whatever libevent would have picked by default on other
+    // platforms
+    event_config_set_flag(cfg.get(), EVENT_BASE_FLAG_EPOLL_USE_CHANGELIST);
+    return event_base_new_with_config(cfg.get());
+}
@@ -0,0 +1,68 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <string>
+
+struct event_base;
+
+/**
+ * The network backend used by the front end threads to drive the
+ * connections.
+ *
+ * All of the backends use libevent (and the bufferevents owned by the
+ * connections), but they differ in how the I/O reaches the kernel.
+ */
+enum class NetworkBackend {
+    /// Let libevent pick the best method available with its default
+    /// configuration
+    Default,
+    /// Use epoll with the changelist enabled. Every time a bufferevent
+    /// flush its output it'll toggle EV_WRITE on and off, and with
+    /// the changelist all of these changes gets folded together and
+    /// submitted as part of the next epoll_wait instead of one epoll_ctl
+    /// per change. This reduce the number of system calls per operation
+    /// for workloads with many connections and small values.
+    /// Falls back to the default method on platforms without epoll.
+    EpollChangelist,
+    /// Do the socket I/O of the plain (non-SSL) connections, and accept
+    /// new clients, through io_uring (see IoUringBackend); everything else
+    /// runs on a default event base. Falls back to Default if memcached
+    /// wasn't built with liburing or the kernel doesn't support it.
+    IoUring
+};
+
+std::string to_string(NetworkBackend backend);
+
+/**
+ * Parse the textual representation of a network backend
+ *
+ * @param str the string to parse ("default", "epoll_changelist" or
+ *            "io_uring")
+ * @return the network backend
+ * @throws std::invalid_argument if the string isn't a known backend
+ */
+NetworkBackend parse_network_backend(const std::string& str);
+
+/**
+ * Create a new event base configured for the requested network backend
+ *
+ * @param backend the backend to use
+ * @return the newly created event base (or nullptr if libevent failed to
+ *         create the event base)
+ */
+event_base* create_event_base(NetworkBackend backend);
@@ -186,6 +186,21 @@ cb::EngineErrorItemPair bucket_get(Cookie& cookie,
     return ret;
 }
 
+void bucket_get_multi(Cookie& cookie,
+                      const std::vector<cb::GetMultiKey>& keys,
+                      std::vector<cb::EngineErrorItemPair>& results) {
+    auto& c = cookie.getConnection();
+    c.getBucketEngine()->get_multi(&cookie, keys, results);
+    for (const auto& r : results) {
+        if (r.first == cb::engine_errc::disconnect) {
+            LOG_WARNING("{}: {} bucket_get_multi return ENGINE_DISCONNECT",
+                        c.getId(),
+                        c.getDescription());
+            break;
+        }
+    }
+}
+
 BucketCompressionMode bucket_get_compression_mode(Cookie& cookie) {
     auto& c = cookie.getConnection();
     return c.getBucketEngine()->getCompressionMode();
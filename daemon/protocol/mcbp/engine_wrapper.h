@@ -85,6 +85,10 @@ cb::EngineErrorItemPair bucket_get(
         Vbid vbucket,
         DocStateFilter documentStateFilter = DocStateFilter::Alive);
 
+void bucket_get_multi(Cookie& cookie,
+                      const std::vector<cb::GetMultiKey>& keys,
+                      std::vector<cb::EngineErrorItemPair>& results);
+
 cb::EngineErrorItemPair bucket_get_if(
         Cookie& cookie,
         const DocKey& key,
@@ -127,7 +127,7 @@ ENGINE_ERROR_CODE GatCommandContext::sendResponse() {
     cookie.setCas(info.cas);
 
     std::unique_ptr<SendBuffer> sendbuffer;
-    if (payload.size() > SendBuffer::MinimumDataSize) {
+    if (payload.size() > connection.getSendBufferThreshold()) {
         // we may use the item if we've didn't inflate it
         if (buffer.empty()) {
             sendbuffer = std::make_unique<ItemSendBuffer>(
@@ -34,7 +34,7 @@
  *         and the second being the histogram (only valid if the first
  *         parameter is ENGINE_SUCCESS)
  */
-static std::pair<ENGINE_ERROR_CODE, Hdr1sfMicroSecHistogram> get_timings(
+static std::pair<ENGINE_ERROR_CODE, Hdr1sfNanoSecHistogram> get_timings(
         Cookie& cookie, const Bucket& bucket, uint8_t opcode) {
     // Don't creata a new privilege context if the one we've got is for the
     // connected bucket:
@@ -65,14 +65,9 @@ static std::pair<ENGINE_ERROR_CODE, Hdr1sfMicroSecHistogram> get_timings(
         }
     }
 
-    auto* histo = bucket.timings.get_timing_histogram(opcode);
-    if (histo) {
-        return {ENGINE_SUCCESS, *histo};
-    } else {
-        // histogram for this opcode hasn't been created yet so just
-        // return an histogram with no data in it
-        return {ENGINE_SUCCESS, {}};
-    }
+    // The histogram is merged from the per-thread histograms (and is
+    // empty if no thread has recorded the opcode yet)
+    return {ENGINE_SUCCESS, bucket.timings.get_timing_histogram(opcode)};
 }
 
 /**
@@ -86,7 +81,7 @@ static std::pair<ENGINE_ERROR_CODE, Hdr1sfMicroSecHistogram> get_timings(
  * @param opcode The opcode we're interested in
  * @param bucketname The name of the bucket we want
  */
-static std::pair<ENGINE_ERROR_CODE, Hdr1sfMicroSecHistogram> maybe_get_timings(
+static std::pair<ENGINE_ERROR_CODE, Hdr1sfNanoSecHistogram> maybe_get_timings(
         Cookie& cookie,
         const Bucket& bucket,
         uint8_t opcode,
@@ -106,7 +101,7 @@ static std::pair<ENGINE_ERROR_CODE, Hdr1sfMicroSecHistogram> maybe_get_timings(
  */
 static std::pair<ENGINE_ERROR_CODE, std::string> get_aggregated_timings(
         Cookie& cookie, uint8_t opcode) {
-    Hdr1sfMicroSecHistogram timings;
+    Hdr1sfNanoSecHistogram timings;
     bool found = false;
 
     for (auto& bucket : all_buckets) {
@@ -118,7 +113,7 @@ static std::pair<ENGINE_ERROR_CODE, std::string> get_aggregated_timings(
     }
 
     if (found) {
-        return std::make_pair(ENGINE_SUCCESS, timings.to_string());
+        return std::make_pair(ENGINE_SUCCESS, Timings::to_string(timings));
     }
 
     // We didn't have access to any buckets!
@@ -147,14 +142,15 @@ std::pair<ENGINE_ERROR_CODE, std::string> get_cmd_timer(Cookie& cookie) {
         auto& connection = cookie.getConnection();
         auto bt = get_timings(cookie, connection.getBucket(), opcode);
         if (bt.first == ENGINE_SUCCESS) {
-            return std::make_pair(ENGINE_SUCCESS, bt.second.to_string());
+            return std::make_pair(ENGINE_SUCCESS,
+                                  Timings::to_string(bt.second));
         }
 
         return std::make_pair(bt.first, std::string{});
     }
 
     // The user specified a bucket... let's locate the bucket
-    std::pair<ENGINE_ERROR_CODE, Hdr1sfMicroSecHistogram> ret;
+    std::pair<ENGINE_ERROR_CODE, Hdr1sfNanoSecHistogram> ret;
 
     for (auto& b : all_buckets) {
         ret = maybe_get_timings(cookie, b, opcode, bucket);
@@ -164,7 +160,8 @@ std::pair<ENGINE_ERROR_CODE, std::string> get_cmd_timer(Cookie& cookie) {
     }
 
     if (ret.first == ENGINE_SUCCESS) {
-        return std::make_pair(ENGINE_SUCCESS, ret.second.to_string());
+        return std::make_pair(ENGINE_SUCCESS,
+                              Timings::to_string(ret.second));
     }
 
     if (ret.first == ENGINE_KEY_ENOENT) {
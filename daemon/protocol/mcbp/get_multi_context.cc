@@ -0,0 +1,238 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "get_multi_context.h"
+
+#include "engine_errc_2_mcbp.h"
+#include "engine_wrapper.h"
+
+#include <daemon/buckets.h>
+#include <daemon/cookie.h>
+#include <daemon/mcaudit.h>
+#include <daemon/memcached.h>
+#include <daemon/sendbuffer.h>
+#include <daemon/stats.h>
+#include <logger/logger.h>
+#include <mcbp/protocol/header.h>
+#include <memcached/protocol_binary.h>
+#include <platform/compress.h>
+#include <xattr/utils.h>
+#include <gsl/gsl>
+
+GetMultiCommandContext::GetMultiCommandContext(Cookie& cookie)
+    : SteppableCommandContext(cookie) {
+    using cb::mcbp::request::GetMultiKeyHeader;
+
+    // The validator already verified the layout of the value
+    auto value = cookie.getRequest().getValue();
+    while (!value.empty()) {
+        const auto* hdr =
+                reinterpret_cast<const GetMultiKeyHeader*>(value.data());
+        value = {value.data() + sizeof(GetMultiKeyHeader),
+                 value.size() - sizeof(GetMultiKeyHeader)};
+        const auto keylen = hdr->getKeylen();
+        entries.emplace_back(cb::const_byte_buffer{value.data(), keylen},
+                             hdr->getVBucket());
+        value = {value.data() + keylen, value.size() - keylen};
+    }
+
+    pendingKeys.reserve(entries.size());
+    pendingIndex.reserve(entries.size());
+    results.reserve(entries.size());
+}
+
+ENGINE_ERROR_CODE GetMultiCommandContext::getItems() {
+    pendingKeys.clear();
+    pendingIndex.clear();
+    for (size_t ii = 0; ii < entries.size(); ++ii) {
+        if (entries[ii].status == cb::engine_errc::would_block) {
+            pendingKeys.push_back({getKey(entries[ii]), entries[ii].vbucket});
+            pendingIndex.push_back(ii);
+        }
+    }
+
+    if (pendingKeys.empty()) {
+        state = State::SendResponses;
+        return ENGINE_SUCCESS;
+    }
+
+    cookie.setBatchedIo(true);
+    bucket_get_multi(cookie, pendingKeys, results);
+    if (results.size() != pendingKeys.size()) {
+        LOG_WARNING(
+                "{}: GetMultiCommandContext::getItems: engine returned {} "
+                "results for {} keys",
+                connection.getId(),
+                results.size(),
+                pendingKeys.size());
+        return ENGINE_FAILED;
+    }
+
+    int blocked = 0;
+    for (size_t ii = 0; ii < results.size(); ++ii) {
+        auto& entry = entries[pendingIndex[ii]];
+        entry.status = results[ii].first;
+        if (entry.status == cb::engine_errc::would_block) {
+            ++blocked;
+        } else {
+            entry.item = std::move(results[ii].second);
+        }
+    }
+    results.clear();
+
+    if (blocked == 0) {
+        state = State::SendResponses;
+        return ENGINE_SUCCESS;
+    }
+
+    if (cookie.addPendingIo(blocked)) {
+        // All of the notifications arrived while we were busy processing
+        // the result. Check if any of them failed, otherwise retry the
+        // blocked keys right away
+        return cookie.swapBatchedIoStatus();
+    }
+
+    return ENGINE_EWOULDBLOCK;
+}
+
+DocKey GetMultiCommandContext::getKey(const Entry& entry) const {
+    return connection.makeDocKey(
+            {reinterpret_cast<const uint8_t*>(entry.key.data()),
+             entry.key.size()});
+}
+
+ENGINE_ERROR_CODE GetMultiCommandContext::sendItem(Entry& entry) {
+    item_info info;
+    if (!bucket_get_item_info(connection, entry.item.get(), &info)) {
+        LOG_WARNING("{}: Failed to get item info", connection.getId());
+        return ENGINE_FAILED;
+    }
+
+    cb::const_char_buffer payload{
+            static_cast<const char*>(info.value[0].iov_base),
+            info.value[0].iov_len};
+    cb::compression::Buffer buffer;
+
+    if (mcbp::datatype::is_snappy(info.datatype) &&
+        (mcbp::datatype::is_xattr(info.datatype) ||
+         !connection.isSnappyEnabled())) {
+        try {
+            if (!cb::compression::inflate(cb::compression::Algorithm::Snappy,
+                                          payload,
+                                          buffer)) {
+                LOG_WARNING("{}: Failed to inflate item", connection.getId());
+                return ENGINE_FAILED;
+            }
+        } catch (const std::bad_alloc&) {
+            return ENGINE_ENOMEM;
+        }
+        payload = buffer;
+        info.datatype &= ~PROTOCOL_BINARY_DATATYPE_SNAPPY;
+    }
+
+    if (mcbp::datatype::is_xattr(info.datatype)) {
+        payload = cb::xattr::get_body(payload);
+        info.datatype &= ~PROTOCOL_BINARY_DATATYPE_XATTR;
+    }
+
+    info.datatype = connection.getEnabledDatatypes(info.datatype);
+
+    auto key = info.key;
+    if (!connection.isCollectionsSupported()) {
+        key = key.makeDocKeyWithoutCollectionID();
+    }
+
+    cookie.setCas(info.cas);
+
+    std::unique_ptr<SendBuffer> sendbuffer;
+    if (payload.size() > connection.getSendBufferThreshold()) {
+        if (buffer.empty()) {
+            sendbuffer = std::make_unique<ItemSendBuffer>(
+                    std::move(entry.item), payload, connection.getBucket());
+        } else {
+            sendbuffer =
+                    std::make_unique<CompressionSendBuffer>(buffer, payload);
+        }
+    }
+
+    connection.sendResponse(
+            cookie,
+            cb::mcbp::Status::Success,
+            {reinterpret_cast<const char*>(&info.flags), sizeof(info.flags)},
+            {reinterpret_cast<const char*>(key.data()), key.size()},
+            payload,
+            info.datatype,
+            std::move(sendbuffer));
+
+    cb::audit::document::add(cookie, cb::audit::document::Operation::Read);
+    STATS_HIT(&connection, get);
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE GetMultiCommandContext::sendResponses() {
+    for (auto& entry : entries) {
+        if (entry.status == cb::engine_errc::success) {
+            auto ret = sendItem(entry);
+            if (ret != ENGINE_SUCCESS) {
+                return ret;
+            }
+            continue;
+        }
+
+        const auto status = connection.remapErrorCode(entry.status);
+        if (status == cb::engine_errc::disconnect) {
+            return ENGINE_DISCONNECT;
+        }
+        if (status == cb::engine_errc::no_such_key) {
+            STATS_MISS(&connection, get);
+        }
+
+        auto key = getKey(entry);
+        if (!connection.isCollectionsSupported()) {
+            key = key.makeDocKeyWithoutCollectionID();
+        }
+        cookie.setCas(0);
+        connection.sendResponse(
+                cookie,
+                cb::mcbp::to_status(status),
+                {},
+                {reinterpret_cast<const char*>(key.data()), key.size()},
+                {},
+                PROTOCOL_BINARY_RAW_BYTES,
+                {});
+    }
+
+    state = State::Done;
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE GetMultiCommandContext::step() {
+    auto ret = ENGINE_SUCCESS;
+    do {
+        switch (state) {
+        case State::GetItems:
+            ret = getItems();
+            break;
+        case State::SendResponses:
+            ret = sendResponses();
+            break;
+        case State::Done:
+            return ENGINE_SUCCESS;
+        }
+    } while (ret == ENGINE_SUCCESS);
+
+    return ret;
+}
@@ -0,0 +1,95 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "steppable_command_context.h"
+
+#include <memcached/engine.h>
+#include <string>
+#include <vector>
+
+/**
+ * The GetMultiCommandContext is a state machine used by the memcached
+ * core to implement the GetMulti operation. All of the requested keys
+ * are handed to the engine in a single call (allowing it to group the
+ * lookups per vbucket and batch the disk fetches), and we'll send one
+ * response per key (in the order they appear in the request) once all
+ * of them have been resolved.
+ */
+class GetMultiCommandContext : public SteppableCommandContext {
+public:
+    // The internal states. Look at the function headers below to
+    // for the functions with the same name to figure out what each
+    // state does
+    enum class State : uint8_t { GetItems, SendResponses, Done };
+
+    explicit GetMultiCommandContext(Cookie& cookie);
+
+protected:
+    ENGINE_ERROR_CODE step() override;
+
+    /**
+     * Ask the engine for all of the keys which isn't resolved yet. The
+     * engine may block on some of them; in that case we register the
+     * number of notifications we expect with the cookie and return
+     * ENGINE_EWOULDBLOCK (we'll be called again once all of them arrived
+     * and retry the keys which blocked).
+     *
+     * @return ENGINE_EWOULDBLOCK if the engine blocked on one or more keys
+     *         ENGINE_SUCCESS if we want to continue to run the state diagram
+     *         a standard engine error code if something goes wrong
+     */
+    ENGINE_ERROR_CODE getItems();
+
+    /**
+     * Send one response for each of the keys in the request
+     *
+     * @return ENGINE_SUCCESS or a standard engine error code if something
+     *         goes wrong
+     */
+    ENGINE_ERROR_CODE sendResponses();
+
+private:
+    struct Entry {
+        Entry(cb::const_byte_buffer key, Vbid vbucket)
+            : key(reinterpret_cast<const char*>(key.data()), key.size()),
+              vbucket(vbucket),
+              status(cb::engine_errc::would_block) {
+        }
+        /// A copy of the key in the request; the request may be moved
+        /// while the command is blocked
+        std::string key;
+        Vbid vbucket;
+        cb::engine_errc status;
+        cb::unique_item_ptr item;
+    };
+
+    ENGINE_ERROR_CODE sendItem(Entry& entry);
+
+    /// @return the key of the entry (valid as long as the entry)
+    DocKey getKey(const Entry& entry) const;
+
+    std::vector<Entry> entries;
+
+    /// The keys passed to the engine (only the ones not resolved yet)
+    std::vector<cb::GetMultiKey> pendingKeys;
+    /// The index in entries for each element in pendingKeys
+    std::vector<size_t> pendingIndex;
+    std::vector<cb::EngineErrorItemPair> results;
+
+    State state = State::GetItems;
+};
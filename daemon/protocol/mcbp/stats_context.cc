@@ -165,6 +165,10 @@ static ENGINE_ERROR_CODE server_stats(const AddStatFn& add_stat_callback,
         add_stat(cookie, add_stat_callback, "bytes_read", thread_stats.bytes_read);
         add_stat(cookie, add_stat_callback, "bytes_written",
                  thread_stats.bytes_written);
+        add_stat(cookie, add_stat_callback, "bytes_copied",
+                 thread_stats.bytes_copied);
+        add_stat(cookie, add_stat_callback, "bytes_referenced",
+                 thread_stats.bytes_referenced);
         add_stat(cookie, add_stat_callback, "accepting_conns",
                  is_listen_disabled() ? 0 : 1);
         add_stat(cookie, add_stat_callback, "listen_disabled_num",
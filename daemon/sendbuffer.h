@@ -35,9 +35,16 @@ public:
     /// system call (for TLS it gets even worse as it'll result in multiple
     /// TLS frames which add extra CPU cycles and network overhead)
     ///.
-    /// A sendbuffer should not be used unless the payload is >4k
+    /// A sendbuffer should not be used over TLS unless the payload is >4k
     constexpr static std::size_t MinimumDataSize = 4096;
 
+    /// For plaintext connections libevent passes the chained reference
+    /// straight to writev() together with the rest of the output buffer,
+    /// so the only overhead left is allocating the SendBuffer (and the
+    /// evbuffer chain). That is cheaper than copying the data for all but
+    /// the smallest payloads.
+    constexpr static std::size_t MinimumPlaintextDataSize = 256;
+
     explicit SendBuffer(cb::const_char_buffer view) : payload(view) {
     }
     virtual ~SendBuffer() = default;
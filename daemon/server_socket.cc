@@ -18,6 +18,7 @@
 #include "server_socket.h"
 
 #include "connections.h"
+#include "io_uring_backend.h"
 #include "listening_port.h"
 #include "memcached.h"
 #include "network_interface.h"
@@ -37,7 +38,8 @@
 
 ServerSocket::ServerSocket(SOCKET fd,
                            event_base* b,
-                           std::shared_ptr<ListeningPort> interf)
+                           std::shared_ptr<ListeningPort> interf,
+                           IoUringBackend* io_uring)
     : sfd(fd),
       interface(interf),
       sockname(cb::net::getsockname(fd)),
@@ -45,7 +47,8 @@ ServerSocket::ServerSocket(SOCKET fd,
                    sfd,
                    EV_READ | EV_PERSIST,
                    listen_event_handler,
-                   reinterpret_cast<void*>(this))) {
+                   reinterpret_cast<void*>(this))),
+      io_uring(io_uring) {
     if (!ev) {
         throw std::bad_alloc();
     }
@@ -84,7 +87,12 @@ void ServerSocket::enable() {
                         cb_strerror(cb::net::get_socket_error()));
         }
 
-        if (event_add(ev.get(), nullptr) == -1) {
+        if (io_uring) {
+            io_uring->listen(sfd, [this](SOCKET client, int error) {
+                listen_accept_handler(*this, client, error);
+            });
+            registered_in_libevent = true;
+        } else if (event_add(ev.get(), nullptr) == -1) {
             LOG_WARNING("Failed to add connection to libevent: {}",
                         cb_strerror());
         } else {
@@ -109,7 +117,10 @@ void ServerSocket::disable() {
                             cb_strerror(cb::net::get_socket_error()));
             }
         }
-        if (event_del(ev.get()) == -1) {
+        if (io_uring) {
+            io_uring->unlisten(sfd);
+            registered_in_libevent = false;
+        } else if (event_del(ev.get()) == -1) {
             LOG_WARNING("Failed to remove connection to libevent: {}",
                         cb_strerror());
         } else {
@@ -125,24 +136,29 @@ void ServerSocket::acceptNewClient() {
             sfd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen);
 
     if (client == INVALID_SOCKET) {
-        auto error = cb::net::get_socket_error();
-        if (cb::net::is_emfile(error)) {
+        acceptFailed(cb::net::get_socket_error());
+        return;
+    }
+
+    acceptNewClient(client);
+}
+
+void ServerSocket::acceptFailed(int error) {
+    if (cb::net::is_emfile(error)) {
 #if defined(WIN32)
-            LOG_WARNING("Too many open files.");
+        LOG_WARNING("Too many open files.");
 #else
-            struct rlimit limit = {0};
-            getrlimit(RLIMIT_NOFILE, &limit);
-            LOG_WARNING("Too many open files. Current limit: {}",
-                        limit.rlim_cur);
+        struct rlimit limit = {0};
+        getrlimit(RLIMIT_NOFILE, &limit);
+        LOG_WARNING("Too many open files. Current limit: {}", limit.rlim_cur);
 #endif
-            disable_listen();
-        } else if (!cb::net::is_blocking(error)) {
-            LOG_WARNING("Failed to accept new client: {}", cb_strerror(error));
-        }
-
-        return;
+        disable_listen();
+    } else if (!cb::net::is_blocking(error)) {
+        LOG_WARNING("Failed to accept new client: {}", cb_strerror(error));
     }
+}
 
+void ServerSocket::acceptNewClient(SOCKET client) {
     stats.curr_conns.fetch_add(1, std::memory_order_relaxed);
 
     // Check if we're exceeding the connection limits
@@ -21,6 +21,7 @@
 #include <nlohmann/json_fwd.hpp>
 #include <memory>
 
+class IoUringBackend;
 class ListeningPort;
 class NetworkInterface;
 
@@ -38,10 +39,13 @@ public:
      * @param sfd The socket to operate on
      * @param b The event base to use (the caller owns the event base)
      * @param interf The interface object containing properties to use
+     * @param io_uring If set, accept the clients through the io_uring
+     *                 instead of the event base (the caller owns it)
      */
     ServerSocket(SOCKET sfd,
                  event_base* b,
-                 std::shared_ptr<ListeningPort> interf);
+                 std::shared_ptr<ListeningPort> interf,
+                 IoUringBackend* io_uring = nullptr);
 
     ~ServerSocket();
 
@@ -56,8 +60,15 @@ public:
 
     void disable();
 
+    /// Accept a new client from the socket
     void acceptNewClient();
 
+    /// Set up a client accepted from the socket (by us or the io_uring)
+    void acceptNewClient(SOCKET client);
+
+    /// Handle the failure to accept a client (error is the socket error)
+    void acceptFailed(int error);
+
     const ListeningPort& getInterfaceDescription() const {
         return *interface;
     }
@@ -87,9 +98,12 @@ protected:
         void operator()(struct event* e);
     };
 
-    /// Are we currently registered in libevent or not
+    /// Are we currently registered in libevent (or the io_uring) or not
     bool registered_in_libevent = {false};
 
     /// The libevent object we're using
     std::unique_ptr<struct event, EventDeleter> ev;
+
+    /// The io_uring accepting the clients instead (if set)
+    IoUringBackend* const io_uring;
 };
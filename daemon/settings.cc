@@ -446,6 +446,21 @@ static void handle_max_packet_size(Settings& s, const nlohmann::json& obj) {
                        1024);
 }
 
+/**
+ * Handle the "network_backend" tag in the settings
+ *
+ * The value must be a string containing one of the known backends
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_network_backend(Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_string()) {
+        cb::throwJsonTypeError(R"("network_backend" must be a string)");
+    }
+    s.setNetworkBackend(parse_network_backend(obj.get<std::string>()));
+}
+
 static void handle_max_connections(Settings& s, const nlohmann::json& obj) {
     if (!obj.is_number_unsigned()) {
         cb::throwJsonTypeError(
@@ -695,6 +710,7 @@ void Settings::reconfigure(const nlohmann::json& json) {
             {"ssl_minimum_protocol", handle_ssl_minimum_protocol},
             {"breakpad", handle_breakpad},
             {"max_packet_size", handle_max_packet_size},
+            {"network_backend", handle_network_backend},
             {"max_connections", handle_max_connections},
             {"system_connections", handle_system_connections},
             {"sasl_mechanisms", handle_sasl_mechanisms},
@@ -780,6 +796,12 @@ void Settings::updateSettings(const Settings& other, bool apply) {
                 "topkeys_size can't be changed dynamically");
         }
     }
+    if (other.has.network_backend) {
+        if (other.network_backend != network_backend) {
+            throw std::invalid_argument(
+                    "network_backend can't be changed dynamically");
+        }
+    }
 
     if (other.has.stdin_listener) {
         if (other.stdin_listener.load() != stdin_listener.load()) {
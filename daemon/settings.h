@@ -19,6 +19,7 @@
 
 #include "client_cert_config.h"
 #include "logger/logger_config.h"
+#include "network_backend.h"
 #include "network_interface.h"
 #include "opentracing_config.h"
 
@@ -563,6 +564,24 @@ public:
         has.topkeys_size = true;
     }
 
+    /**
+     * Get the network backend the front end threads should use
+     */
+    NetworkBackend getNetworkBackend() const {
+        return network_backend;
+    }
+
+    /**
+     * Set the network backend the front end threads should use (only
+     * used when the front end threads are created)
+     *
+     * @param backend the new backend
+     */
+    void setNetworkBackend(NetworkBackend backend) {
+        network_backend = backend;
+        has.network_backend = true;
+    }
+
     /**
      * Get the list of available SASL Mechanisms
      *
@@ -926,6 +945,9 @@ protected:
      */
     int topkeys_size = 0;
 
+    /// The network backend used by the front end threads
+    NetworkBackend network_backend = NetworkBackend::Default;
+
     /// The available sasl mechanism list
     folly::Synchronized<std::string> sasl_mechanisms;
 
@@ -1047,6 +1069,7 @@ public:
         bool ssl_minimum_protocol = false;
         bool client_cert_auth = false;
         bool topkeys_size = false;
+        bool network_backend = false;
         bool sasl_mechanisms = false;
         bool ssl_sasl_mechanisms = false;
         bool dedupe_nmvb_maps = false;
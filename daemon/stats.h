@@ -46,6 +46,8 @@ struct thread_stats {
         cas_misses = 0;
         bytes_written = 0;
         bytes_read = 0;
+        bytes_copied = 0;
+        bytes_referenced = 0;
         cmd_flush = 0;
         conn_yields = 0;
         auth_cmds = 0;
@@ -80,6 +82,8 @@ struct thread_stats {
         cas_misses += other.cas_misses;
         bytes_read += other.bytes_read;
         bytes_written += other.bytes_written;
+        bytes_copied += other.bytes_copied;
+        bytes_referenced += other.bytes_referenced;
         cmd_flush += other.cmd_flush;
         conn_yields += other.conn_yields;
         auth_cmds += other.auth_cmds;
@@ -122,6 +126,10 @@ struct thread_stats {
     cb::RelaxedAtomic<uint64_t> cas_misses;
     cb::RelaxedAtomic<uint64_t> bytes_read;
     cb::RelaxedAtomic<uint64_t> bytes_written;
+    /// Bytes copied into the connections output buffers
+    cb::RelaxedAtomic<uint64_t> bytes_copied;
+    /// Bytes sent by chaining a reference to the data (SendBuffer)
+    cb::RelaxedAtomic<uint64_t> bytes_referenced;
     cb::RelaxedAtomic<uint64_t> cmd_flush;
     cb::RelaxedAtomic<uint64_t>
             conn_yields; /* # of yields for connections (-R option)*/
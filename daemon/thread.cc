@@ -6,6 +6,7 @@
 #include "connections.h"
 #include "cookie.h"
 #include "front_end_thread.h"
+#include "io_uring_backend.h"
 #include "listening_port.h"
 #include "log_macros.h"
 #include "memcached.h"
@@ -182,12 +183,23 @@ static void setup_dispatcher(struct event_base *main_base,
  * Set up a thread's information.
  */
 static void setup_thread(FrontEndThread& me) {
-    me.base = event_base_new();
+    const auto backend = Settings::instance().getNetworkBackend();
+    me.base = create_event_base(backend);
 
     if (!me.base) {
         FATAL_ERROR(EXIT_FAILURE, "Can't allocate event base");
     }
 
+    if (backend == NetworkBackend::IoUring) {
+        me.io_uring = IoUringBackend::create(me.base);
+        if (!me.io_uring) {
+            LOG_WARNING(
+                    "Thread {}: io_uring isn't available, using the default "
+                    "network backend",
+                    me.index);
+        }
+    }
+
     /* Listen for notifications from other threads */
     if ((event_assign(&me.notify_event,
                       me.base,
@@ -361,6 +373,14 @@ void notify_io_complete(gsl::not_null<const void*> void_cookie,
               cookie.getConnection().getId(),
               status);
 
+    if (cookie.isBatchedIo()) {
+        if (!cookie.completePendingIo(status)) {
+            // The command is still waiting for other operations to complete
+            return;
+        }
+        status = cookie.swapBatchedIoStatus();
+    }
+
     /* kick the thread in the butt */
     if (add_conn_to_pending_io_list(&cookie.getConnection(), &cookie, status)) {
         notify_thread(thr);
@@ -478,6 +498,8 @@ void threads_shutdown() {
 
 void threads_cleanup() {
     for (auto& thread : threads) {
+        // The ring has events in the base
+        thread.io_uring.reset();
         event_base_free(thread.base);
     }
 }
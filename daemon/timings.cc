@@ -16,27 +16,43 @@
  */
 #include "timings.h"
 #include <memcached/protocol_binary.h>
+#include <nlohmann/json.hpp>
 
 Timings::Timings() {
     reset();
 }
 
-Timings::~Timings() {
-    std::lock_guard<std::mutex> lg(histogram_mutex);
+Timings::~Timings() = default;
+
+Timings::ThreadTimings::~ThreadTimings() {
     for (auto& t : timings) {
-        delete t;
+        delete t.load();
     }
 }
 
-void Timings::reset() {
-    {
-        std::lock_guard<std::mutex> lg(histogram_mutex);
-        for (auto& t : timings) {
-            if (t) {
-                t.load()->reset();
-            }
-        }
+Hdr1sfNanoSecHistogram& Timings::ThreadTimings::get_or_create(
+        uint8_t opcode) {
+    auto* histo = timings[opcode].load(std::memory_order_relaxed);
+    if (histo == nullptr) {
+        // Only the owning thread creates histograms, but readers may be
+        // looking at the array so publish it with release semantics
+        histo = new Hdr1sfNanoSecHistogram();
+        timings[opcode].store(histo, std::memory_order_release);
+    }
+    return *histo;
+}
+
+void Timings::initialize(size_t numThreads) {
+    threads.clear();
+    threads.reserve(numThreads);
+    for (size_t ii = 0; ii < numThreads; ++ii) {
+        threads.emplace_back(std::make_unique<ThreadTimings>());
     }
+}
+
+void Timings::reset() {
+    // The per-thread histograms are cleared lazily by their owning thread
+    generation++;
 
     {
         std::lock_guard<std::mutex> lg(lock);
@@ -45,28 +61,63 @@ void Timings::reset() {
     }
 }
 
-void Timings::collect(cb::mcbp::ClientOpcode opcode,
+void Timings::collect(size_t thread,
+                      cb::mcbp::ClientOpcode opcode,
                       std::chrono::nanoseconds nsec) {
-    using namespace std::chrono;
-    get_or_create_timing_histogram(
-            std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode))
-            .add(duration_cast<microseconds>(nsec));
-    auto& interval =
-            interval_counters
-                    .get()[std::underlying_type<cb::mcbp::ClientOpcode>::type(
-                            opcode)];
+    auto& mine = *threads.at(thread);
+    const auto current = generation.load(std::memory_order_relaxed);
+    if (mine.generation.load(std::memory_order_relaxed) != current) {
+        for (auto& t : mine.timings) {
+            auto* histo = t.load(std::memory_order_relaxed);
+            if (histo) {
+                histo->reset();
+            }
+        }
+        mine.generation.store(current, std::memory_order_release);
+    }
+
+    const auto op = std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode);
+    mine.get_or_create(op).add(nsec);
+    auto& interval = interval_counters.get()[op];
     interval.count++;
     interval.duration_ns += nsec.count();
 }
 
+template <typename Visitor>
+void Timings::for_each_histogram(uint8_t opcode, Visitor visitor) const {
+    const auto current = generation.load(std::memory_order_acquire);
+    for (const auto& t : threads) {
+        if (t->generation.load(std::memory_order_acquire) != current) {
+            // Not reset by the owning thread since the last call to reset()
+            continue;
+        }
+        const auto* histo = t->timings[opcode].load(std::memory_order_acquire);
+        if (histo) {
+            visitor(*histo);
+        }
+    }
+}
+
+Hdr1sfNanoSecHistogram Timings::get_timing_histogram(uint8_t opcode) const {
+    Hdr1sfNanoSecHistogram ret;
+    for_each_histogram(opcode,
+                       [&ret](const Hdr1sfNanoSecHistogram& h) { ret += h; });
+    return ret;
+}
+
+std::string Timings::to_string(Hdr1sfNanoSecHistogram& histogram) {
+    auto json = histogram.to_json();
+    json["unit"] = "ns";
+    return json.dump();
+}
+
 std::string Timings::generate(cb::mcbp::ClientOpcode opcode) {
-    auto* histoPtr =
-            timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode)]
-                    .load();
-    if (histoPtr) {
-        return histoPtr->to_string();
+    auto histo = get_timing_histogram(
+            std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode));
+    if (histo.getValueCount() == 0) {
+        return std::string("{}");
     }
-    return std::string("{}");
+    return to_string(histo);
 }
 
 static const cb::mcbp::ClientOpcode timings_mutations[] = {
@@ -119,12 +170,11 @@ uint64_t Timings::get_aggregated_mutation_stats() {
 
     uint64_t ret = 0;
     for (auto cmd : timings_mutations) {
-        auto* histoPtr =
-                timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd)]
-                        .load();
-        if (histoPtr) {
-            ret += histoPtr->getValueCount();
-        }
+        for_each_histogram(
+                std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd),
+                [&ret](const Hdr1sfNanoSecHistogram& h) {
+                    ret += h.getValueCount();
+                });
     }
     return ret;
 }
@@ -133,12 +183,11 @@ uint64_t Timings::get_aggregated_retrieval_stats() {
 
     uint64_t ret = 0;
     for (auto cmd : timings_retrievals) {
-        auto* histoPtr =
-                timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd)]
-                        .load();
-        if (histoPtr) {
-            ret += histoPtr->getValueCount();
-        }
+        for_each_histogram(
+                std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd),
+                [&ret](const Hdr1sfNanoSecHistogram& h) {
+                    ret += h.getValueCount();
+                });
     }
     return ret;
 }
@@ -153,21 +202,6 @@ cb::sampling::Interval Timings::get_interval_lookup_latency() {
     return interval_latency_lookups.getAggregate();
 }
 
-Hdr1sfMicroSecHistogram& Timings::get_or_create_timing_histogram(
-        uint8_t opcode) {
-    if (!timings[opcode]) {
-        std::lock_guard<std::mutex> allocLock(histogram_mutex);
-        if (!timings[opcode]) {
-            timings[opcode] = new Hdr1sfMicroSecHistogram();
-        }
-    }
-    return *(timings[opcode].load());
-}
-
-Hdr1sfMicroSecHistogram* Timings::get_timing_histogram(uint8_t opcode) const {
-    return timings[opcode].load();
-}
-
 void Timings::sample(std::chrono::seconds sample_interval) {
     cb::sampling::Interval interval_lookup, interval_mutation;
 
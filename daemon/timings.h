@@ -23,13 +23,21 @@
 #include <platform/corestore.h>
 #include <utilities/hdrhistogram.h>
 #include <array>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #define MAX_NUM_OPCODES 0x100
 
 /** Records timings for each memcached opcode. Each opcode has a histogram of
  * times.
+ *
+ * The histograms have nanosecond resolution and are kept per front-end
+ * thread: collect() only ever touches the histograms owned by the calling
+ * thread, so recording a sample doesn't need any locks or read-modify-write
+ * atomics. The per-thread histograms are merged when the timings are read.
  */
 class Timings {
 public:
@@ -37,8 +45,27 @@ public:
     Timings(const Timings&) = delete;
     ~Timings();
 
+    /**
+     * Allocate the per-thread histogram sets. Must be called before any
+     * calls to collect() (it is called from initialize_buckets()).
+     *
+     * @param numThreads the number of threads which may call collect()
+     */
+    void initialize(size_t numThreads);
+
     void reset();
-    void collect(cb::mcbp::ClientOpcode opcode, std::chrono::nanoseconds nsec);
+
+    /**
+     * Record the execution time for the given opcode.
+     *
+     * @param thread the index of the calling front-end thread. Each index
+     *               must only be used by a single thread.
+     * @param opcode the opcode which was executed
+     * @param nsec the time it took to execute the command
+     */
+    void collect(size_t thread,
+                 cb::mcbp::ClientOpcode opcode,
+                 std::chrono::nanoseconds nsec);
     void sample(std::chrono::seconds sample_interval);
     std::string generate(cb::mcbp::ClientOpcode opcode);
     uint64_t get_aggregated_mutation_stats();
@@ -48,18 +75,55 @@ public:
     cb::sampling::Interval get_interval_lookup_latency();
 
     /**
-     * Get a pointer to the underlying histogram for the specified opcode
-     * @return a pointer to the underling HdrMicroSecHistogram for this opcode
-     * if there isn't one allocated already a nullptr will be returned.
+     * Get the histogram for the specified opcode, merged across all of
+     * the threads.
+     * @return the merged histogram, or an empty histogram if no samples
+     *         have been recorded for the opcode.
+     */
+    Hdr1sfNanoSecHistogram get_timing_histogram(uint8_t opcode) const;
+
+    /**
+     * Format a (merged) timing histogram as the JSON document returned
+     * by the timings stat group and GetCmdTimer. The document is tagged
+     * with the unit of the values so that clients (mctimings) may scale
+     * the buckets.
      */
-    Hdr1sfMicroSecHistogram* get_timing_histogram(uint8_t opcode) const;
+    static std::string to_string(Hdr1sfNanoSecHistogram& histogram);
 
 private:
     /**
-     * Method to get histogram for timing, if the histogram hasn't been created
-     * yet, for the given opcode then we will allocate one
+     * The histograms owned by a single thread. The histograms are created
+     * lazily (by the owning thread) as their foot print is larger than
+     * our old histogram class.
      */
-    Hdr1sfMicroSecHistogram& get_or_create_timing_histogram(uint8_t opcode);
+    struct ThreadTimings {
+        ThreadTimings() {
+            for (auto& t : timings) {
+                t.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+        ThreadTimings(const ThreadTimings&) = delete;
+        ~ThreadTimings();
+
+        /// Get the histogram for the opcode, creating it if needed. Must
+        /// only be called by the owning thread.
+        Hdr1sfNanoSecHistogram& get_or_create(uint8_t opcode);
+
+        std::array<std::atomic<Hdr1sfNanoSecHistogram*>, MAX_NUM_OPCODES>
+                timings;
+
+        /**
+         * The value of Timings::generation when the owning thread last
+         * reset the histograms. Only written by the owning thread; readers
+         * ignore the histograms while it differs from Timings::generation.
+         */
+        std::atomic<uint64_t> generation{0};
+    };
+
+    /// Visit each thread's histogram for the opcode which contains data
+    /// recorded since the last reset.
+    template <typename Visitor>
+    void for_each_histogram(uint8_t opcode, Visitor visitor) const;
 
     // This lock is only held by sample() and some blocks within generate().
     // It guards the various IntervalSeries variables which internally
@@ -68,11 +132,16 @@ private:
 
     cb::sampling::IntervalSeries interval_latency_lookups;
     cb::sampling::IntervalSeries interval_latency_mutations;
-    // create an array of unique_ptrs as we want to create HdrHistograms
-    // in a lazy manner as their foot print is larger than our old
-    // histogram class
-    std::array<std::atomic<Hdr1sfMicroSecHistogram*>, MAX_NUM_OPCODES> timings;
-    std::mutex histogram_mutex;
+
+    /// One set of histograms per front-end thread
+    std::vector<std::unique_ptr<ThreadTimings>> threads;
+
+    /**
+     * Bumped by reset(). Rather than clearing histograms which another
+     * thread may be updating, each thread clears its own histograms the
+     * next time it records a value and notices the generation changed.
+     */
+    std::atomic<uint64_t> generation{0};
 
     // Sharded by core as cache contention was observed due to the number of
     // threads attempting to update the same timings stats.
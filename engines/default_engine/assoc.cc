@@ -8,23 +8,43 @@
 #include <logger/logger.h>
 #include <platform/cbassert.h>
 #include <platform/crc32c.h>
-#include <platform/platform_thread.h>
-#include <platform/strerror.h>
 
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <chrono>
 #include <mutex>
-#include <thread>
 #include <vector>
 
 
 #define hashsize(n) ((size_t)1<<(n))
 #define hashmask(n) (hashsize(n)-1)
 
+/*
+ * The hash table is split into a number of partitions selected by the most
+ * significant bits of the hash value (the least significant bits select the
+ * bucket within the partition). Each partition has its own lock and is
+ * expanded independently, so operations on keys in different partitions
+ * don't contend with each other.
+ */
+#define ASSOC_PARTITION_BITS 6
+#define ASSOC_PARTITIONS (1 << ASSOC_PARTITION_BITS)
+
+/* The initial size of the table (summed over all of the partitions) */
+#define ASSOC_INITIAL_HASHPOWER 16
+
+/*
+ * While a partition is expanding, every mutation (insert / delete) in the
+ * partition moves this many buckets from the old table to the new one.
+ * This bounds the time the partition lock is held by a single mutation
+ * (and hence the time a lookup may wait for the lock), and the expansion
+ * completes after hashsize(hashpower - 1) / ASSOC_EXPAND_STEP mutations.
+ * Lookups during the expansion check the old table for buckets which
+ * haven't been moved yet.
+ */
+#define ASSOC_EXPAND_STEP 4
+
 struct Assoc {
     Assoc(unsigned int hp) : hashpower(hp) {
         primary_hashtable.resize(hashsize(hashpower));
@@ -61,8 +81,13 @@ struct Assoc {
     std::mutex mutex;
 };
 
-/* One hashtable for all */
-static struct Assoc* global_assoc = nullptr;
+/* One (partitioned) hashtable for all */
+static struct Assoc* global_assoc[ASSOC_PARTITIONS];
+
+/* Get the partition of the hashtable the hash value belongs to */
+static struct Assoc* assoc_get_partition(uint32_t hash) {
+    return global_assoc[hash >> (32 - ASSOC_PARTITION_BITS)];
+}
 
 /* assoc factory. returns one new assoc or NULL if out-of-memory */
 static struct Assoc* assoc_consruct(int hashpower) {
@@ -77,19 +102,22 @@ ENGINE_ERROR_CODE assoc_init(struct default_engine *engine) {
     /*
         construct and save away one assoc for use by all buckets.
     */
-    if (global_assoc == nullptr) {
-        global_assoc = assoc_consruct(16);
+    for (auto& partition : global_assoc) {
+        if (partition == nullptr) {
+            partition = assoc_consruct(ASSOC_INITIAL_HASHPOWER -
+                                       ASSOC_PARTITION_BITS);
+            if (partition == nullptr) {
+                return ENGINE_ENOMEM;
+            }
+        }
     }
-    return (global_assoc != NULL) ? ENGINE_SUCCESS : ENGINE_ENOMEM;
+    return ENGINE_SUCCESS;
 }
 
 void assoc_destroy() {
-    if (global_assoc != nullptr) {
-        while (global_assoc->expanding) {
-            std::this_thread::sleep_for(std::chrono::microseconds(250));
-        }
-        delete global_assoc;
-        global_assoc = nullptr;
+    for (auto& partition : global_assoc) {
+        delete partition;
+        partition = nullptr;
     }
 }
 
@@ -98,13 +126,14 @@ hash_item *assoc_find(uint32_t hash, const hash_key *key) {
     unsigned int oldbucket;
     hash_item *ret = NULL;
     int depth = 0;
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
-    if (global_assoc->expanding &&
-        (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
+    auto* assoc = assoc_get_partition(hash);
+    std::lock_guard<std::mutex> guard(assoc->mutex);
+    if (assoc->expanding &&
+        (oldbucket = (hash & hashmask(assoc->hashpower - 1))) >= assoc->expand_bucket)
     {
-        it = global_assoc->old_hashtable[oldbucket];
+        it = assoc->old_hashtable[oldbucket];
     } else {
-        it = global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
+        it = assoc->primary_hashtable[hash & hashmask(assoc->hashpower)];
     }
 
     while (it) {
@@ -127,16 +156,18 @@ hash_item *assoc_find(uint32_t hash, const hash_key *key) {
     the item wasn't found
     assoc->lock is assumed to be held by the caller.
 */
-static hash_item** _hashitem_before(uint32_t hash, const hash_key* key) {
+static hash_item** _hashitem_before(struct Assoc* assoc,
+                                    uint32_t hash,
+                                    const hash_key* key) {
     hash_item **pos;
     unsigned int oldbucket;
 
-    if (global_assoc->expanding &&
-        (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
+    if (assoc->expanding &&
+        (oldbucket = (hash & hashmask(assoc->hashpower - 1))) >= assoc->expand_bucket)
     {
-        pos = &global_assoc->old_hashtable[oldbucket];
+        pos = &assoc->old_hashtable[oldbucket];
     } else {
-        pos = &global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
+        pos = &assoc->primary_hashtable[hash & hashmask(assoc->hashpower)];
     }
 
     while (*pos) {
@@ -154,78 +185,123 @@ static hash_item** _hashitem_before(uint32_t hash, const hash_key* key) {
     return pos;
 }
 
-static void assoc_maintenance_thread(void *arg);
-
 /*
-    grows the hashtable to the next power of 2.
+    Move up to ASSOC_EXPAND_STEP buckets from the old table to the primary
+    table. When the last bucket is moved the old table is handed over in
+    retired so that the caller may release the memory after dropping the
+    lock.
     assoc->lock is assumed to be held by the caller.
 */
-static void assoc_expand() {
-    global_assoc->old_hashtable.swap(global_assoc->primary_hashtable);
+static void assoc_expand_step(struct Assoc* assoc,
+                              std::vector<hash_item*>& retired) {
+    for (int ii = 0; ii < ASSOC_EXPAND_STEP && assoc->expanding; ++ii) {
+        hash_item *it, *next;
+        size_t bucket;
+
+        for (it = assoc->old_hashtable[assoc->expand_bucket];
+             NULL != it; it = next) {
+            next = it->h_next;
+            const hash_key* key = item_get_key(it);
+            bucket = crc32c(hash_key_get_key(key),
+                            hash_key_get_key_len(key),
+                            0) & hashmask(assoc->hashpower);
+            it->h_next = assoc->primary_hashtable[bucket];
+            assoc->primary_hashtable[bucket] = it;
+        }
 
+        assoc->old_hashtable[assoc->expand_bucket] = NULL;
+        assoc->expand_bucket++;
+        if (assoc->expand_bucket == hashsize(assoc->hashpower - 1)) {
+            assoc->expanding = false;
+            retired.swap(assoc->old_hashtable);
+            LOG_DEBUG("Hash table partition expansion done (hashpower:{})",
+                      assoc->hashpower);
+        }
+    }
+}
+
+/*
+    grows the hashtable partition to the next power of 2 (from hashpower).
+    The new table is allocated without holding the lock, and we only
+    install it if no one else expanded the partition in the meantime.
+    The buckets are then moved over incrementally by assoc_expand_step().
+*/
+static void assoc_expand(struct Assoc* assoc, unsigned int hashpower) {
+    std::vector<hash_item*> table;
     try {
-        global_assoc->primary_hashtable.resize(hashsize(global_assoc->hashpower + 1));
+        table.resize(hashsize(hashpower + 1));
     } catch (const std::bad_alloc&) {
-        global_assoc->primary_hashtable.swap(global_assoc->old_hashtable);
         /* Bad news, but we can keep running. */
         return;
     }
 
-    int ret = 0;
-    cb_thread_t tid;
-
-    global_assoc->hashpower++;
-    global_assoc->expanding = true;
-    global_assoc->expand_bucket = 0;
-
-    /* start a thread to do the expansion */
-    if ((ret = cb_create_named_thread(&tid, assoc_maintenance_thread,
-                                      nullptr, 1, "mc:assoc_maint")) != 0)
-    {
-        LOG_ERROR("Can't create thread for rebalance assoc table: {}",
-                  cb_strerror());
-        global_assoc->hashpower--;
-        global_assoc->expanding = false;
-        global_assoc->primary_hashtable.swap(global_assoc->old_hashtable);
-        global_assoc->old_hashtable.resize(0);
-        global_assoc->old_hashtable.shrink_to_fit();
+    std::lock_guard<std::mutex> guard(assoc->mutex);
+    if (assoc->expanding || assoc->hashpower != hashpower) {
+        /* Someone else beat us to it; table is released on return */
+        return;
     }
+
+    assoc->old_hashtable.swap(assoc->primary_hashtable);
+    assoc->primary_hashtable.swap(table);
+    assoc->hashpower++;
+    assoc->expanding = true;
+    assoc->expand_bucket = 0;
 }
 
 /* Note: this isn't an assoc_update.  The key must not already exist to call this */
 int assoc_insert(uint32_t hash, hash_item *it) {
     unsigned int oldbucket;
+    bool grow = false;
+    unsigned int hashpower;
 
     cb_assert(assoc_find(hash, item_get_key(it)) == 0);  /* shouldn't have duplicately named things defined */
 
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
-    if (global_assoc->expanding &&
-        (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
+    auto* assoc = assoc_get_partition(hash);
+    // Declared before the guard so that a retired table is freed after
+    // the lock is released
+    std::vector<hash_item*> retired;
     {
-        it->h_next = global_assoc->old_hashtable[oldbucket];
-        global_assoc->old_hashtable[oldbucket] = it;
-    } else {
-        it->h_next = global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
-        global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)] = it;
+        std::lock_guard<std::mutex> guard(assoc->mutex);
+        if (assoc->expanding &&
+            (oldbucket = (hash & hashmask(assoc->hashpower - 1))) >= assoc->expand_bucket)
+        {
+            it->h_next = assoc->old_hashtable[oldbucket];
+            assoc->old_hashtable[oldbucket] = it;
+        } else {
+            it->h_next = assoc->primary_hashtable[hash & hashmask(assoc->hashpower)];
+            assoc->primary_hashtable[hash & hashmask(assoc->hashpower)] = it;
+        }
+
+        assoc->hash_items++;
+        if (assoc->expanding) {
+            assoc_expand_step(assoc, retired);
+        } else if (assoc->hash_items > (hashsize(assoc->hashpower) * 3) / 2) {
+            grow = true;
+        }
+        hashpower = assoc->hashpower;
     }
 
-    global_assoc->hash_items++;
-    if (! global_assoc->expanding && global_assoc->hash_items > (hashsize(global_assoc->hashpower) * 3) / 2) {
-        assoc_expand();
+    if (grow) {
+        assoc_expand(assoc, hashpower);
     }
     return 1;
 }
 
 void assoc_delete(uint32_t hash, const hash_key *key) {
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
-    hash_item **before = _hashitem_before(hash, key);
+    auto* assoc = assoc_get_partition(hash);
+    std::vector<hash_item*> retired;
+    std::lock_guard<std::mutex> guard(assoc->mutex);
+    hash_item **before = _hashitem_before(assoc, hash, key);
 
     if (*before) {
         hash_item *nxt;
-        global_assoc->hash_items--;
+        assoc->hash_items--;
         nxt = (*before)->h_next;
         (*before)->h_next = 0;   /* probably pointless, but whatever. */
         *before = nxt;
+        if (assoc->expanding) {
+            assoc_expand_step(assoc, retired);
+        }
         return;
     }
     /* Note:  we never actually get here.  the callers don't delete things
@@ -233,48 +309,16 @@ void assoc_delete(uint32_t hash, const hash_key *key) {
     cb_assert(*before != 0);
 }
 
-
-
-#define DEFAULT_HASH_BULK_MOVE 1
-int hash_bulk_move = DEFAULT_HASH_BULK_MOVE;
-
-static void assoc_maintenance_thread(void *arg) {
-    bool done = false;
-    do {
-        int ii;
-        std::lock_guard<std::mutex> guard(global_assoc->mutex);
-
-        for (ii = 0; ii < hash_bulk_move && global_assoc->expanding; ++ii) {
-            hash_item *it, *next;
-            int bucket;
-
-            for (it = global_assoc->old_hashtable[global_assoc->expand_bucket];
-                 NULL != it; it = next) {
-                next = it->h_next;
-                const hash_key* key = item_get_key(it);
-                bucket = crc32c(hash_key_get_key(key),
-                                hash_key_get_key_len(key),
-                                0) & hashmask(global_assoc->hashpower);
-                it->h_next = global_assoc->primary_hashtable[bucket];
-                global_assoc->primary_hashtable[bucket] = it;
-            }
-
-            global_assoc->old_hashtable[global_assoc->expand_bucket] = NULL;
-            global_assoc->expand_bucket++;
-            if (global_assoc->expand_bucket == hashsize(global_assoc->hashpower - 1)) {
-                global_assoc->expanding = false;
-                global_assoc->old_hashtable.resize(0);
-                global_assoc->old_hashtable.shrink_to_fit();
-                LOG_INFO("Hash table expansion done");
-            }
-        }
-        if (!global_assoc->expanding) {
-            done = true;
-        }
-    } while (!done);
+static bool assoc_expanding(struct Assoc* assoc) {
+    std::lock_guard<std::mutex> guard(assoc->mutex);
+    return assoc->expanding;
 }
 
 bool assoc_expanding() {
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
-    return global_assoc->expanding;
+    for (auto* partition : global_assoc) {
+        if (partition != nullptr && assoc_expanding(partition)) {
+            return true;
+        }
+    }
+    return false;
 }
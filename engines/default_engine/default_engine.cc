@@ -78,6 +78,7 @@ void default_engine_constructor(struct default_engine* engine, bucket_id_t id)
     engine->config.factor = 1.25;
     engine->config.chunk_size = 48;
     engine->config.item_size_max= 1024 * 1024;
+    engine->config.item_partitions = DEFAULT_ITEM_PARTITIONS;
     engine->config.xattr_enabled = true;
     engine->config.compression_mode = BucketCompressionMode::Off;
     engine->config.min_compression_ratio = default_min_compression_ratio;
@@ -127,6 +128,11 @@ ENGINE_ERROR_CODE default_engine::initialize(const char* config_str) {
         return ret;
     }
 
+    ret = items_init(this);
+    if (ret != ENGINE_SUCCESS) {
+        return ret;
+    }
+
     ret = slabs_init(this, config.maxbytes, config.factor, config.preallocate);
     if (ret != ENGINE_SUCCESS) {
         return ret;
@@ -603,7 +609,7 @@ static ENGINE_ERROR_CODE initalize_configuration(struct default_engine *se,
    se->config.vb0 = true;
 
    if (cfg_str != NULL) {
-       struct config_item items[13];
+       struct config_item items[14];
        int ii = 0;
 
        memset(&items, 0, sizeof(items));
@@ -666,9 +672,14 @@ static ENGINE_ERROR_CODE initalize_configuration(struct default_engine *se,
        items[ii].value.dt_bool = &se->config.keep_deleted;
        ++ii;
 
+       items[ii].key = "item_partitions";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.item_partitions;
+       ++ii;
+
        items[ii].key = NULL;
        ++ii;
-       cb_assert(ii == 13);
+       cb_assert(ii == 14);
        ret = ENGINE_ERROR_CODE(se->server.core->parse_config(cfg_str,
                                                              items,
                                                              stderr));
@@ -39,7 +39,7 @@ struct default_engine;
 
 struct config {
    size_t verbose;
-   rel_time_t oldest_live;
+   std::atomic<rel_time_t> oldest_live;
    bool evict_to_free;
    size_t maxbytes;
    bool preallocate;
@@ -50,6 +50,7 @@ struct config {
    bool vb0;
    char *uuid;
    bool keep_deleted;
+   size_t item_partitions;
    std::atomic<bool> xattr_enabled;
    std::atomic<BucketCompressionMode> compression_mode;
    std::atomic<float> min_compression_ratio;
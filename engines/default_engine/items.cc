@@ -7,6 +7,7 @@
 #include <string.h>
 #include <time.h>
 #include <gsl/gsl>
+#include <algorithm>
 
 #include "default_engine_internal.h"
 #include "engine_manager.h"
@@ -20,8 +21,9 @@
 /* Forward Declarations */
 static void item_link_q(struct default_engine *engine, hash_item *it);
 static void item_unlink_q(struct default_engine *engine, hash_item *it);
-static hash_item *do_item_alloc(struct default_engine *engine,
-                                const hash_key *key,
+static hash_item* do_item_alloc(struct default_engine* engine,
+                                unsigned int partition,
+                                const hash_key* key,
                                 const int flags, const rel_time_t exptime,
                                 const int nbytes,
                                 const void *cookie,
@@ -50,6 +52,8 @@ static bool hash_key_create(hash_key* hkey,
 
 static void hash_key_destroy(hash_key* hkey);
 static void hash_key_copy_to_item(hash_item* dst, const hash_key* src);
+static unsigned int hash_key_get_partition(struct default_engine* engine,
+                                           const hash_key* key);
 
 /*
  * We only reposition items in the LRU queue if they haven't been repositioned
@@ -63,9 +67,35 @@ static void hash_key_copy_to_item(hash_item* dst, const hash_key* src);
  */
 static const int search_items = 50;
 
+ENGINE_ERROR_CODE items_init(struct default_engine* engine) {
+    auto num = engine->config.item_partitions;
+    if (num == 0 || num > MAX_ITEM_PARTITIONS) {
+        LOG_WARNING("items_init: invalid number of item partitions ({})",
+                    num);
+        return ENGINE_EINVAL;
+    }
+
+    try {
+        engine->items.partitions.reset(new item_partition[num]());
+    } catch (const std::bad_alloc&) {
+        return ENGINE_ENOMEM;
+    }
+    engine->items.num_partitions = gsl::narrow<unsigned int>(num);
+    return ENGINE_SUCCESS;
+}
+
+/* Get the partition the given item belongs to */
+static item_partition& item_get_partition(struct default_engine* engine,
+                                          const hash_item* it) {
+    return engine->items.partitions[it->partition];
+}
+
 void item_stats_reset(struct default_engine *engine) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
-    memset(engine->items.itemstats, 0, sizeof(engine->items.itemstats));
+    for (unsigned int ii = 0; ii < engine->items.num_partitions; ++ii) {
+        auto& part = engine->items.partitions[ii];
+        std::lock_guard<std::mutex> guard(part.lock);
+        memset(part.itemstats, 0, sizeof(part.itemstats));
+    }
 }
 
 
@@ -78,7 +108,8 @@ static size_t ITEM_ntotal(struct default_engine *engine,
 
 /* Get the next CAS id for a new item. */
 static uint64_t get_cas_id(void) {
-    static uint64_t cas_id = 0;
+    /* Items in different partitions are linked concurrently */
+    static std::atomic<uint64_t> cas_id{0};
     return ++cas_id;
 }
 
@@ -94,9 +125,77 @@ static uint64_t get_cas_id(void) {
 #endif
 
 
+/*
+ * Evict (or reclaim) the first unlocked item from the tail of the given
+ * LRU. The partition lock must be held by the caller.
+ * @return true if an item was unlinked
+ */
+static bool do_item_evict_tail(struct default_engine* engine,
+                               item_partition& part,
+                               unsigned int id,
+                               rel_time_t current_time) {
+    int tries = search_items;
+    hash_item* search;
+    for (search = part.tails[id]; tries > 0 && search != NULL; tries--, search=search->prev) {
+        if (search->refcount == 0 && search->locktime <= current_time) {
+            if (search->exptime == 0 || search->exptime > current_time) {
+                part.itemstats[id].evicted++;
+                part.itemstats[id].evicted_time = current_time - search->time;
+                if (search->exptime != 0) {
+                    part.itemstats[id].evicted_nonzero++;
+                }
+                engine->stats.evictions++;
+            } else {
+                part.itemstats[id].reclaimed++;
+                engine->stats.reclaimed++;
+            }
+            do_item_unlink(engine, search);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Evict an item of the slab class from one of the other partitions, and
+ * allocate the memory it freed for an item of the given partition. The
+ * lock of the given partition must be held by the caller; the other
+ * partitions are only try-locked (skipping those which are busy) so that
+ * two allocations can't deadlock on each other's partitions.
+ */
+/*@null@*/
+static void* do_item_evict_other_partitions(struct default_engine* engine,
+                                            unsigned int partition,
+                                            size_t ntotal,
+                                            unsigned int id,
+                                            rel_time_t current_time) {
+    const auto num = engine->items.num_partitions;
+    for (unsigned int ii = 1; ii < num; ++ii) {
+        const auto other = (partition + ii) % num;
+        auto& part = engine->items.partitions[other];
+        std::unique_lock<std::mutex> guard(part.lock, std::try_to_lock);
+        if (!guard.owns_lock() || part.tails[id] == 0) {
+            continue;
+        }
+        if (!do_item_evict_tail(engine, part, id, current_time)) {
+            continue;
+        }
+        void* ptr = slabs_alloc(engine, ntotal, id, other);
+        if (ptr != nullptr) {
+            /* The chunk is freed to the item's partition; move the
+             * requested bytes there with it */
+            slabs_adjust_mem_requested(engine, id, other, ntotal, 0);
+            slabs_adjust_mem_requested(engine, id, partition, 0, ntotal);
+            return ptr;
+        }
+    }
+    return nullptr;
+}
+
 /*@null@*/
-hash_item *do_item_alloc(struct default_engine *engine,
-                         const hash_key *key,
+hash_item* do_item_alloc(struct default_engine* engine,
+                         unsigned int partition,
+                         const hash_key* key,
                          const int flags,
                          const rel_time_t exptime,
                          const int nbytes,
@@ -110,6 +209,7 @@ hash_item *do_item_alloc(struct default_engine *engine,
     unsigned int id;
 
     size_t ntotal = sizeof(hash_item) + hash_key_get_alloc_size(key) + nbytes;
+    auto& part = engine->items.partitions[partition];
 
     if ((id = slabs_clsid(engine, ntotal)) == 0) {
         return 0;
@@ -119,7 +219,7 @@ hash_item *do_item_alloc(struct default_engine *engine,
     oldest_live = engine->config.oldest_live;
     current_time = engine->server.core->get_current_time();
 
-    for (search = engine->items.tails[id];
+    for (search = part.tails[id];
          tries > 0 && search != NULL;
          tries--, search=search->prev) {
         if (search->refcount == 0 &&
@@ -131,9 +231,13 @@ hash_item *do_item_alloc(struct default_engine *engine,
              * the item to avoid to grab the slab mutex twice ;-)
              */
             engine->stats.reclaimed++;
-            engine->items.itemstats[id].reclaimed++;
+            part.itemstats[id].reclaimed++;
             it->refcount = 1;
-            slabs_adjust_mem_requested(engine, it->slabs_clsid, ITEM_ntotal(engine, it), ntotal);
+            slabs_adjust_mem_requested(engine,
+                                       it->slabs_clsid,
+                                       partition,
+                                       ITEM_ntotal(engine, it),
+                                       ntotal);
             do_item_unlink(engine, it);
             /* Initialize the item block: */
             it->slabs_clsid = 0;
@@ -143,19 +247,18 @@ hash_item *do_item_alloc(struct default_engine *engine,
     }
 
     if (it == NULL &&
-        (it = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id))) == NULL) {
+        (it = static_cast<hash_item*>(
+                 slabs_alloc(engine, ntotal, id, partition))) == NULL) {
         /*
         ** Could not find an expired item at the tail, and memory allocation
         ** failed. Try to evict some items!
         */
-        tries = search_items;
-
         /* If requested to not push old items out of cache when memory runs out,
          * we're out of luck at this point...
          */
 
         if (engine->config.evict_to_free == 0) {
-            engine->items.itemstats[id].outofmemory++;
+            part.itemstats[id].outofmemory++;
             return NULL;
         }
 
@@ -166,31 +269,19 @@ hash_item *do_item_alloc(struct default_engine *engine,
          * tries
          */
 
-        if (engine->items.tails[id] == 0) {
-            engine->items.itemstats[id].outofmemory++;
-            return NULL;
+        if (do_item_evict_tail(engine, part, id, current_time)) {
+            it = static_cast<hash_item*>(
+                    slabs_alloc(engine, ntotal, id, partition));
         }
-
-        for (search = engine->items.tails[id]; tries > 0 && search != NULL; tries--, search=search->prev) {
-            if (search->refcount == 0 && search->locktime <= current_time) {
-                if (search->exptime == 0 || search->exptime > current_time) {
-                    engine->items.itemstats[id].evicted++;
-                    engine->items.itemstats[id].evicted_time = current_time - search->time;
-                    if (search->exptime != 0) {
-                        engine->items.itemstats[id].evicted_nonzero++;
-                    }
-                    engine->stats.evictions++;
-                } else {
-                    engine->items.itemstats[id].reclaimed++;
-                    engine->stats.reclaimed++;
-                }
-                do_item_unlink(engine, search);
-                break;
-            }
+        if (it == 0) {
+            /* Nothing (left) to evict in this partition, but the memory
+             * may be held by items of the same class in the others.
+             */
+            it = static_cast<hash_item*>(do_item_evict_other_partitions(
+                    engine, partition, ntotal, id, current_time));
         }
-        it = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id));
         if (it == 0) {
-            engine->items.itemstats[id].outofmemory++;
+            part.itemstats[id].outofmemory++;
             /* Last ditch effort. There is a very rare bug which causes
              * refcount leaks. We've fixed most of them, but it still happens,
              * and it may happen in the future.
@@ -199,15 +290,15 @@ hash_item *do_item_alloc(struct default_engine *engine,
              * free it anyway.
              */
             tries = search_items;
-            for (search = engine->items.tails[id]; tries > 0 && search != NULL; tries--, search=search->prev) {
+            for (search = part.tails[id]; tries > 0 && search != NULL; tries--, search=search->prev) {
                 if (search->refcount != 0 && search->time + TAIL_REPAIR_TIME < current_time) {
-                    engine->items.itemstats[id].tailrepairs++;
+                    part.itemstats[id].tailrepairs++;
                     search->refcount = 0;
                     do_item_unlink(engine, search);
                     break;
                 }
             }
-            it = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id));
+            it = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id, partition));
             if (it == 0) {
                 return NULL;
             }
@@ -217,8 +308,9 @@ hash_item *do_item_alloc(struct default_engine *engine,
     cb_assert(it->slabs_clsid == 0);
 
     it->slabs_clsid = id;
+    it->partition = gsl::narrow_cast<uint8_t>(partition);
 
-    cb_assert(it != engine->items.heads[it->slabs_clsid]);
+    cb_assert(it != part.heads[it->slabs_clsid]);
 
     it->next = it->prev = it->h_next = 0;
     it->refcount = 1;     /* the caller will have a reference */
@@ -237,8 +329,8 @@ static void item_free(struct default_engine *engine, hash_item *it) {
     size_t ntotal = ITEM_ntotal(engine, it);
     unsigned int clsid;
     cb_assert((it->iflag & ITEM_LINKED) == 0);
-    cb_assert(it != engine->items.heads[it->slabs_clsid]);
-    cb_assert(it != engine->items.tails[it->slabs_clsid]);
+    cb_assert(it != item_get_partition(engine, it).heads[it->slabs_clsid]);
+    cb_assert(it != item_get_partition(engine, it).tails[it->slabs_clsid]);
     cb_assert(it->refcount == 0 || engine->scrubber.force_delete);
 
     /* so slab size changer can tell later if item is already free or not */
@@ -246,7 +338,7 @@ static void item_free(struct default_engine *engine, hash_item *it) {
     it->slabs_clsid = 0;
     it->iflag |= ITEM_SLABBED;
     DEBUG_REFCNT(it, 'F');
-    slabs_free(engine, it, ntotal, clsid);
+    slabs_free(engine, it, ntotal, clsid, it->partition);
 }
 
 static void item_link_q(struct default_engine *engine, hash_item *it) { /* item is the new head */
@@ -254,8 +346,9 @@ static void item_link_q(struct default_engine *engine, hash_item *it) { /* item
     cb_assert(it->slabs_clsid < POWER_LARGEST);
     cb_assert((it->iflag & ITEM_SLABBED) == 0);
 
-    head = &engine->items.heads[it->slabs_clsid];
-    tail = &engine->items.tails[it->slabs_clsid];
+    auto& part = item_get_partition(engine, it);
+    head = &part.heads[it->slabs_clsid];
+    tail = &part.tails[it->slabs_clsid];
     cb_assert(it != *head);
     cb_assert((*head && *tail) || (*head == 0 && *tail == 0));
     it->prev = 0;
@@ -263,15 +356,16 @@ static void item_link_q(struct default_engine *engine, hash_item *it) { /* item
     if (it->next) it->next->prev = it;
     *head = it;
     if (*tail == 0) *tail = it;
-    engine->items.sizes[it->slabs_clsid]++;
+    part.sizes[it->slabs_clsid]++;
     return;
 }
 
 static void item_unlink_q(struct default_engine *engine, hash_item *it) {
     hash_item **head, **tail;
     cb_assert(it->slabs_clsid < POWER_LARGEST);
-    head = &engine->items.heads[it->slabs_clsid];
-    tail = &engine->items.tails[it->slabs_clsid];
+    auto& part = item_get_partition(engine, it);
+    head = &part.heads[it->slabs_clsid];
+    tail = &part.tails[it->slabs_clsid];
 
     if (*head == it) {
         cb_assert(it->prev == 0);
@@ -286,7 +380,7 @@ static void item_unlink_q(struct default_engine *engine, hash_item *it) {
 
     if (it->next) it->next->prev = it->prev;
     if (it->prev) it->prev->next = it->next;
-    engine->items.sizes[it->slabs_clsid]--;
+    part.sizes[it->slabs_clsid]--;
     return;
 }
 
@@ -412,51 +506,93 @@ int do_item_replace(struct default_engine *engine,
     return do_item_link(engine, cookie, new_it);
 }
 
+/*
+ * Purge expired items from the tail of the given slab class in the
+ * partition, and add the statistics for the class to the summary.
+ * The partition lock must be held by the caller.
+ */
+static void do_item_stats_class(struct default_engine* engine,
+                                item_partition& part,
+                                int i,
+                                rel_time_t current_time,
+                                itemstats_t& stats,
+                                unsigned int& size,
+                                rel_time_t& oldest) {
+    int search = search_items;
+    while (search > 0 &&
+           part.tails[i] != NULL &&
+           ((engine->config.oldest_live != 0 && /* Item flushd */
+             engine->config.oldest_live <= current_time &&
+             part.tails[i]->time <= engine->config.oldest_live) ||
+            (part.tails[i]->exptime != 0 && /* and not expired */
+             part.tails[i]->exptime < current_time))) {
+        --search;
+        if (part.tails[i]->refcount == 0) {
+            do_item_unlink(engine, part.tails[i]);
+        } else {
+            break;
+        }
+    }
+    if (part.tails[i] == NULL) {
+        /* We removed all of the items in this slab class */
+        return;
+    }
+
+    if (size == 0 || part.tails[i]->time < oldest) {
+        oldest = part.tails[i]->time;
+    }
+    size += part.sizes[i];
+    stats.evicted += part.itemstats[i].evicted;
+    stats.evicted_nonzero += part.itemstats[i].evicted_nonzero;
+    stats.evicted_time =
+            std::max(stats.evicted_time, part.itemstats[i].evicted_time);
+    stats.outofmemory += part.itemstats[i].outofmemory;
+    stats.tailrepairs += part.itemstats[i].tailrepairs;
+    stats.reclaimed += part.itemstats[i].reclaimed;
+}
+
+/*
+ * Report the item statistics per slab class (summed over all of the
+ * partitions). Each partition lock is only held while collecting the
+ * numbers for that partition.
+ */
 static void do_item_stats(struct default_engine* engine,
                           const AddStatFn& add_stats,
                           const void* c) {
-    int i;
     rel_time_t current_time = engine->server.core->get_current_time();
-    for (i = 0; i < POWER_LARGEST; i++) {
-        if (engine->items.tails[i] != NULL) {
-            const char *prefix = "items";
-            int search = search_items;
-            while (search > 0 &&
-                   engine->items.tails[i] != NULL &&
-                   ((engine->config.oldest_live != 0 && /* Item flushd */
-                     engine->config.oldest_live <= current_time &&
-                     engine->items.tails[i]->time <= engine->config.oldest_live) ||
-                    (engine->items.tails[i]->exptime != 0 && /* and not expired */
-                     engine->items.tails[i]->exptime < current_time))) {
-                --search;
-                if (engine->items.tails[i]->refcount == 0) {
-                    do_item_unlink(engine, engine->items.tails[i]);
-                } else {
-                    break;
-                }
-            }
-            if (engine->items.tails[i] == NULL) {
-                /* We removed all of the items in this slab class */
-                continue;
+    for (int i = 0; i < POWER_LARGEST; i++) {
+        itemstats_t stats = {};
+        unsigned int size = 0;
+        rel_time_t oldest = 0;
+
+        for (unsigned int ii = 0; ii < engine->items.num_partitions; ++ii) {
+            auto& part = engine->items.partitions[ii];
+            std::lock_guard<std::mutex> guard(part.lock);
+            if (part.tails[i] != NULL) {
+                do_item_stats_class(
+                        engine, part, i, current_time, stats, size, oldest);
             }
+        }
 
-            add_statistics(c, add_stats, prefix, i, "number", "%u",
-                           engine->items.sizes[i]);
-            add_statistics(c, add_stats, prefix, i, "age", "%u",
-                           engine->items.tails[i]->time);
-            add_statistics(c, add_stats, prefix, i, "evicted",
-                           "%u", engine->items.itemstats[i].evicted);
-            add_statistics(c, add_stats, prefix, i, "evicted_nonzero",
-                           "%u", engine->items.itemstats[i].evicted_nonzero);
-            add_statistics(c, add_stats, prefix, i, "evicted_time",
-                           "%u", engine->items.itemstats[i].evicted_time);
-            add_statistics(c, add_stats, prefix, i, "outofmemory",
-                           "%u", engine->items.itemstats[i].outofmemory);
-            add_statistics(c, add_stats, prefix, i, "tailrepairs",
-                           "%u", engine->items.itemstats[i].tailrepairs);;
-            add_statistics(c, add_stats, prefix, i, "reclaimed",
-                           "%u", engine->items.itemstats[i].reclaimed);;
+        if (size == 0) {
+            continue;
         }
+
+        const char* prefix = "items";
+        add_statistics(c, add_stats, prefix, i, "number", "%u", size);
+        add_statistics(c, add_stats, prefix, i, "age", "%u", oldest);
+        add_statistics(c, add_stats, prefix, i, "evicted",
+                       "%u", stats.evicted);
+        add_statistics(c, add_stats, prefix, i, "evicted_nonzero",
+                       "%u", stats.evicted_nonzero);
+        add_statistics(c, add_stats, prefix, i, "evicted_time",
+                       "%u", stats.evicted_time);
+        add_statistics(c, add_stats, prefix, i, "outofmemory",
+                       "%u", stats.outofmemory);
+        add_statistics(c, add_stats, prefix, i, "tailrepairs",
+                       "%u", stats.tailrepairs);
+        add_statistics(c, add_stats, prefix, i, "reclaimed",
+                       "%u", stats.reclaimed);
     }
 }
 
@@ -474,18 +610,22 @@ static void do_item_stats_sizes(struct default_engine* engine,
         int i;
 
         /* build the histogram */
-        for (i = 0; i < POWER_LARGEST; i++) {
-            hash_item *iter = engine->items.heads[i];
-            while (iter) {
-                size_t ntotal = ITEM_ntotal(engine, iter);
-                size_t bucket = ntotal / 32;
-                if ((ntotal % 32) != 0) {
-                    bucket++;
-                }
-                if (bucket < num_buckets) {
-                    histogram[bucket]++;
+        for (unsigned int ii = 0; ii < engine->items.num_partitions; ++ii) {
+            auto& part = engine->items.partitions[ii];
+            std::lock_guard<std::mutex> guard(part.lock);
+            for (i = 0; i < POWER_LARGEST; i++) {
+                hash_item* iter = part.heads[i];
+                while (iter) {
+                    size_t ntotal = ITEM_ntotal(engine, iter);
+                    size_t bucket = ntotal / 32;
+                    if ((ntotal % 32) != 0) {
+                        bucket++;
+                    }
+                    if (bucket < num_buckets) {
+                        histogram[bucket]++;
+                    }
+                    iter = iter->next;
                 }
-                iter = iter->next;
             }
         }
 
@@ -518,12 +658,12 @@ hash_item* do_item_get(struct default_engine* engine,
     if (it != NULL && engine->config.oldest_live != 0 &&
         engine->config.oldest_live <= current_time &&
         it->time <= engine->config.oldest_live) {
-        do_item_unlink(engine, it);           /* MTSAFE - items.lock held */
+        do_item_unlink(engine, it);           /* MTSAFE - partition lock held */
         it = NULL;
     }
 
     if (it != NULL && it->exptime != 0 && it->exptime <= current_time) {
-        do_item_unlink(engine, it);           /* MTSAFE - items.lock held */
+        do_item_unlink(engine, it);           /* MTSAFE - partition lock held */
         it = NULL;
     }
 
@@ -638,9 +778,17 @@ hash_item *item_alloc(struct default_engine *engine,
     }
 
     {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
-        it = do_item_alloc(
-                engine, &hkey, flags, exptime, nbytes, cookie, datatype);
+        const auto partition = hash_key_get_partition(engine, &hkey);
+        std::lock_guard<std::mutex> guard(
+                engine->items.partitions[partition].lock);
+        it = do_item_alloc(engine,
+                           partition,
+                           &hkey,
+                           flags,
+                           exptime,
+                           nbytes,
+                           cookie,
+                           datatype);
     }
     hash_key_destroy(&hkey);
     return it;
@@ -673,7 +821,8 @@ hash_item* item_get(struct default_engine* engine,
                     const void* cookie,
                     const hash_key& key,
                     const DocStateFilter state) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    const auto partition = hash_key_get_partition(engine, &key);
+    std::lock_guard<std::mutex> guard(engine->items.partitions[partition].lock);
     return do_item_get(engine, &key, state);
 }
 
@@ -682,7 +831,7 @@ hash_item* item_get(struct default_engine* engine,
  * needed.
  */
 void item_release(struct default_engine *engine, hash_item *item) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_get_partition(engine, item).lock);
     do_item_release(engine, item);
 }
 
@@ -690,13 +839,13 @@ void item_release(struct default_engine *engine, hash_item *item) {
  * Unlinks an item from the LRU and hashtable.
  */
 void item_unlink(struct default_engine *engine, hash_item *item) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_get_partition(engine, item).lock);
     do_item_unlink(engine, item);
 }
 
 ENGINE_ERROR_CODE safe_item_unlink(struct default_engine *engine,
                                    hash_item *it) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_get_partition(engine, it).lock);
     return do_safe_item_unlink(engine, it);
 }
 
@@ -715,7 +864,7 @@ ENGINE_ERROR_CODE store_item(struct default_engine *engine,
         item->iflag |= ITEM_ZOMBIE;
     }
 
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_get_partition(engine, item).lock);
     ret = do_store_item(engine, item, operation, cookie, &stored_item);
     if (ret == ENGINE_SUCCESS) {
         *cas = stored_item->cas;
@@ -765,8 +914,14 @@ ENGINE_ERROR_CODE do_item_get_locked(struct default_engine* engine,
 
         // Unfortunately I can't return the actual object as that'll cause
         // the item's cas to be masked out ;-)
-        auto* clone = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                    item->nbytes, cookie, item->datatype);
+        auto* clone = do_item_alloc(engine,
+                                    item->partition,
+                                    hkey,
+                                    item->flags,
+                                    item->exptime,
+                                    item->nbytes,
+                                    cookie,
+                                    item->datatype);
         if (clone == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
@@ -786,15 +941,27 @@ ENGINE_ERROR_CODE do_item_get_locked(struct default_engine* engine,
     } else {
         // Multiple entities holds a reference to the object. We
         // need to do a copy/replace.
-        auto* clone1 = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                     item->nbytes, cookie, item->datatype);
+        auto* clone1 = do_item_alloc(engine,
+                                     item->partition,
+                                     hkey,
+                                     item->flags,
+                                     item->exptime,
+                                     item->nbytes,
+                                     cookie,
+                                     item->datatype);
         if (clone1 == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
         }
 
-        auto* clone2 = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                     item->nbytes, cookie, item->datatype);
+        auto* clone2 = do_item_alloc(engine,
+                                     item->partition,
+                                     hkey,
+                                     item->flags,
+                                     item->exptime,
+                                     item->nbytes,
+                                     cookie,
+                                     item->datatype);
         if (clone2 == nullptr) {
             do_item_release(engine, item);
             do_item_release(engine, clone1);
@@ -833,7 +1000,9 @@ ENGINE_ERROR_CODE item_get_locked(struct default_engine* engine,
 
     ENGINE_ERROR_CODE ret;
     {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
+        const auto partition = hash_key_get_partition(engine, &hkey);
+        std::lock_guard<std::mutex> guard(
+                engine->items.partitions[partition].lock);
         ret = do_item_get_locked(engine, cookie, it, &hkey, locktime);
     }
     hash_key_destroy(&hkey);
@@ -872,8 +1041,14 @@ static ENGINE_ERROR_CODE do_item_unlock(struct default_engine* engine,
         do_item_release(engine, item);
     } else {
         // Someone else holds a reference to the object.
-        auto* clone = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                    item->nbytes, cookie, item->datatype);
+        auto* clone = do_item_alloc(engine,
+                                    item->partition,
+                                    hkey,
+                                    item->flags,
+                                    item->exptime,
+                                    item->nbytes,
+                                    cookie,
+                                    item->datatype);
         if (clone == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
@@ -903,7 +1078,9 @@ ENGINE_ERROR_CODE item_unlock(struct default_engine* engine,
 
     ENGINE_ERROR_CODE ret;
     {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
+        const auto partition = hash_key_get_partition(engine, &hkey);
+        std::lock_guard<std::mutex> guard(
+                engine->items.partitions[partition].lock);
         ret = do_item_unlock(engine, cookie, &hkey, cas);
     }
     hash_key_destroy(&hkey);
@@ -948,8 +1125,14 @@ ENGINE_ERROR_CODE do_item_get_and_touch(struct default_engine* engine,
     } else {
         // Multiple entities holds a reference to the object. We
         // need to do a copy/replace.
-        auto* clone = do_item_alloc(engine, hkey, item->flags, exptime,
-                                    item->nbytes, cookie, item->datatype);
+        auto* clone = do_item_alloc(engine,
+                                    item->partition,
+                                    hkey,
+                                    item->flags,
+                                    exptime,
+                                    item->nbytes,
+                                    cookie,
+                                    item->datatype);
         if (clone == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
@@ -981,7 +1164,9 @@ ENGINE_ERROR_CODE item_get_and_touch(struct default_engine* engine,
 
     ENGINE_ERROR_CODE ret;
     {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
+        const auto partition = hash_key_get_partition(engine, &hkey);
+        std::lock_guard<std::mutex> guard(
+                engine->items.partitions[partition].lock);
         ret = do_item_get_and_touch(engine, cookie, it, &hkey, exptime);
     }
     hash_key_destroy(&hkey);
@@ -993,31 +1178,36 @@ ENGINE_ERROR_CODE item_get_and_touch(struct default_engine* engine,
  * Flushes expired items after a flush_all call
  */
 void item_flush_expired(struct default_engine *engine) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
-
     rel_time_t now = engine->server.core->get_current_time();
     if (now > engine->config.oldest_live) {
         engine->config.oldest_live = now - 1;
     }
-
-    for (int ii = 0; ii < POWER_LARGEST; ii++) {
-        hash_item *iter, *next;
-        /*
-         * The LRU is sorted in decreasing time order, and an item's
-         * timestamp is never newer than its last access time, so we
-         * only need to walk back until we hit an item older than the
-         * oldest_live time.
-         * The oldest_live checking will auto-expire the remaining items.
-         */
-        for (iter = engine->items.heads[ii]; iter != NULL; iter = next) {
-            if (iter->time >= engine->config.oldest_live) {
-                next = iter->next;
-                if ((iter->iflag & ITEM_SLABBED) == 0) {
-                    do_item_unlink(engine, iter);
+    const rel_time_t oldest_live = engine->config.oldest_live;
+
+    for (unsigned int pp = 0; pp < engine->items.num_partitions; ++pp) {
+        auto& part = engine->items.partitions[pp];
+        std::lock_guard<std::mutex> guard(part.lock);
+
+        for (int ii = 0; ii < POWER_LARGEST; ii++) {
+            hash_item *iter, *next;
+            /*
+             * The LRU is sorted in decreasing time order, and an item's
+             * timestamp is never newer than its last access time, so we
+             * only need to walk back until we hit an item older than the
+             * oldest_live time.
+             * The oldest_live checking will auto-expire the remaining items.
+             */
+            for (iter = part.heads[ii]; iter != NULL; iter = next) {
+                if (iter->time >= oldest_live) {
+                    next = iter->next;
+                    if ((iter->iflag & ITEM_SLABBED) == 0) {
+                        do_item_unlink(engine, iter);
+                    }
+                } else {
+                    /* We've hit the first old item. Continue to the next
+                     * queue. */
+                    break;
                 }
-            } else {
-                /* We've hit the first old item. Continue to the next queue. */
-                break;
             }
         }
     }
@@ -1026,26 +1216,25 @@ void item_flush_expired(struct default_engine *engine) {
 void item_stats(struct default_engine* engine,
                 const AddStatFn& add_stat,
                 const void* cookie) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
     do_item_stats(engine, add_stat, cookie);
 }
 
 void item_stats_sizes(struct default_engine* engine,
                       const AddStatFn& add_stat,
                       const void* cookie) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
     do_item_stats_sizes(engine, add_stat, cookie);
 }
 
 static void do_item_link_cursor(struct default_engine *engine,
                                 hash_item *cursor, int ii)
 {
+    auto& part = item_get_partition(engine, cursor);
     cursor->slabs_clsid = (uint8_t)ii;
     cursor->next = NULL;
-    cursor->prev = engine->items.tails[ii];
-    engine->items.tails[ii]->next = cursor;
-    engine->items.tails[ii] = cursor;
-    engine->items.sizes[ii]++;
+    cursor->prev = part.tails[ii];
+    part.tails[ii]->next = cursor;
+    part.tails[ii] = cursor;
+    part.sizes[ii]++;
 }
 
 typedef ENGINE_ERROR_CODE (*ITERFUNC)(struct default_engine *engine,
@@ -1069,7 +1258,8 @@ static bool do_item_walk_cursor(struct default_engine *engine,
         ++ii;
         item_unlink_q(engine, cursor);
 
-        if (ptr == engine->items.heads[cursor->slabs_clsid]) {
+        const auto& part = item_get_partition(engine, cursor);
+        if (ptr == part.heads[cursor->slabs_clsid]) {
             done = true;
             cursor->prev = NULL;
         } else {
@@ -1128,7 +1318,8 @@ static void item_scrub_class(struct default_engine *engine,
     ENGINE_ERROR_CODE ret;
     bool more;
     do {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
+        std::lock_guard<std::mutex> guard(
+                item_get_partition(engine, cursor).lock);
         more = do_item_walk_cursor(engine, cursor, 200, item_scrub, NULL, &ret);
         if (ret != ENGINE_SUCCESS) {
             break;
@@ -1143,20 +1334,24 @@ void item_scrubber_main(struct default_engine *engine)
 
     memset(&cursor, 0, sizeof(cursor));
     cursor.refcount = 1;
-    for (ii = 0; ii < POWER_LARGEST; ++ii) {
-        bool skip = false;
-        {
-            std::lock_guard<std::mutex> guard(engine->items.lock);
-            if (engine->items.heads[ii] == NULL) {
-                skip = true;
-            } else {
-                /* add the item at the tail */
-                do_item_link_cursor(engine, &cursor, ii);
+    for (unsigned int pp = 0; pp < engine->items.num_partitions; ++pp) {
+        auto& part = engine->items.partitions[pp];
+        cursor.partition = gsl::narrow_cast<uint8_t>(pp);
+        for (ii = 0; ii < POWER_LARGEST; ++ii) {
+            bool skip = false;
+            {
+                std::lock_guard<std::mutex> guard(part.lock);
+                if (part.heads[ii] == NULL) {
+                    skip = true;
+                } else {
+                    /* add the item at the tail */
+                    do_item_link_cursor(engine, &cursor, ii);
+                }
             }
-        }
 
-        if (!skip) {
-            item_scrub_class(engine, &cursor);
+            if (!skip) {
+                item_scrub_class(engine, &cursor);
+            }
         }
     }
 
@@ -1209,6 +1404,15 @@ static void hash_key_destroy(hash_key* hkey) {
     }
 }
 
+/*
+ * Get the index of the item partition the key belongs to
+ */
+static unsigned int hash_key_get_partition(struct default_engine* engine,
+                                           const hash_key* key) {
+    return crc32c(hash_key_get_key(key), hash_key_get_key_len(key), 0) %
+           engine->items.num_partitions;
+}
+
 /*
  * The item object stores a hash_key in a contiguous allocation
  * This method ensures correct copying into a contiguous hash_key
@@ -7,6 +7,7 @@
 #include <atomic>
 #include <cstddef>
 #include <cstring>
+#include <memory>
 
 /*
  * You should not try to aquire any of the item locks before calling these
@@ -60,7 +61,10 @@ typedef struct _hash_item {
     /** to identify the type of the data */
     uint8_t datatype;
 
-    // There is 3 spare bytes due to alignment
+    /** which item partition (LRU / slab free lists) the item belongs to */
+    uint8_t partition;
+
+    // There is 2 spare bytes due to alignment
 } hash_item;
 
 /*
@@ -147,17 +151,48 @@ typedef struct {
     unsigned int reclaimed;
 } itemstats_t;
 
-struct items {
+/** The default number of item partitions in an engine instance */
+#define DEFAULT_ITEM_PARTITIONS 16
+
+/** The maximum number of item partitions (must fit in hash_item::partition) */
+#define MAX_ITEM_PARTITIONS 256
+
+/**
+ * The item cache is split into a number of partitions, and the partition
+ * an item belongs to is selected by the hash of its key. Each partition
+ * has its own LRU lists, statistics and slab free lists (see
+ * slab_partition) and is protected by its own lock, so that operations on
+ * keys living in different partitions don't serialise on a single mutex.
+ *
+ * Note that the LRU is maintained per partition, so the eviction order is
+ * only approximately LRU across the entire cache when running with more
+ * than one partition.
+ */
+struct item_partition {
    hash_item *heads[POWER_LARGEST];
    hash_item *tails[POWER_LARGEST];
    itemstats_t itemstats[POWER_LARGEST];
    unsigned int sizes[POWER_LARGEST];
    /*
-    * serialise access to the items data
+    * serialise access to the items data in this partition
    */
    std::mutex lock;
 };
 
+struct items {
+   std::unique_ptr<item_partition[]> partitions;
+   unsigned int num_partitions;
+};
+
+/**
+ * Initialize the item partitions for the engine (the number of
+ * partitions is taken from the engine configuration)
+ *
+ * @param engine handle to the storage engine
+ * @return ENGINE_SUCCESS on success
+ */
+ENGINE_ERROR_CODE items_init(struct default_engine* engine);
+
 
 /**
  * Allocate and initialize a new item structure
@@ -27,7 +27,9 @@
 /*
  * Forward Declarations
  */
-static int do_slabs_newslab(struct default_engine *engine, const unsigned int id);
+static int do_slabs_newslab(struct default_engine* engine,
+                            slab_partition* partition,
+                            const unsigned int id);
 static void *memory_allocate(struct default_engine *engine, size_t size);
 
 #ifndef DONT_PREALLOC_SLABS
@@ -53,7 +55,9 @@ unsigned int slabs_clsid(struct default_engine *engine, const size_t size) {
 
     if (size == 0)
         return 0;
-    while (size > engine->slabs.slabclass[res].size)
+    /* All partitions share the same slab class sizes */
+    const auto* slabclass = engine->slabs.partitions[0].slabclass;
+    while (size > slabclass[res].size)
         if (res++ == engine->slabs.power_largest)     /* won't fit in the biggest slab */
             return 0;
     return res;
@@ -93,6 +97,15 @@ ENGINE_ERROR_CODE slabs_init(struct default_engine *engine,
     unsigned int size = sizeof(hash_item) + (unsigned int)engine->config.chunk_size;
 
     engine->slabs.mem_limit = limit;
+    memset(engine->slabs.class_slabs, 0, sizeof(engine->slabs.class_slabs));
+
+    try {
+        engine->slabs.num_partitions = engine->items.num_partitions;
+        engine->slabs.partitions.reset(
+                new slab_partition[engine->slabs.num_partitions]);
+    } catch (const std::bad_alloc&) {
+        return ENGINE_ENOMEM;
+    }
 
     if (prealloc) {
         /* Allocate everything in a big chunk with malloc */
@@ -105,21 +118,28 @@ ENGINE_ERROR_CODE slabs_init(struct default_engine *engine,
         }
     }
 
-    memset(engine->slabs.slabclass, 0, sizeof(engine->slabs.slabclass));
+    slabclass_t slabclass[MAX_NUMBER_OF_SLAB_CLASSES];
+    memset(slabclass, 0, sizeof(slabclass));
 
     while (++i < POWER_LARGEST && size <= engine->config.item_size_max / factor) {
         /* Make sure items are always n-byte aligned */
         if (size % CHUNK_ALIGN_BYTES)
             size += CHUNK_ALIGN_BYTES - (size % CHUNK_ALIGN_BYTES);
 
-        engine->slabs.slabclass[i].size = size;
-        engine->slabs.slabclass[i].perslab = (unsigned int)engine->config.item_size_max / engine->slabs.slabclass[i].size;
+        slabclass[i].size = size;
+        slabclass[i].perslab = (unsigned int)engine->config.item_size_max / slabclass[i].size;
         size = (unsigned int)(size * factor);
     }
 
     engine->slabs.power_largest = i;
-    engine->slabs.slabclass[engine->slabs.power_largest].size = (unsigned int)engine->config.item_size_max;
-    engine->slabs.slabclass[engine->slabs.power_largest].perslab = 1;
+    slabclass[engine->slabs.power_largest].size = (unsigned int)engine->config.item_size_max;
+    slabclass[engine->slabs.power_largest].perslab = 1;
+
+    for (unsigned int ii = 0; ii < engine->slabs.num_partitions; ++ii) {
+        memcpy(engine->slabs.partitions[ii].slabclass,
+               slabclass,
+               sizeof(slabclass));
+    }
 
     /* for the test suite:  faking of how much we've already malloc'd */
     {
@@ -163,8 +183,8 @@ static void slabs_preallocate (const unsigned int maxslabs) {
 }
 #endif
 
-static int grow_slab_list (struct default_engine *engine, const unsigned int id) {
-    slabclass_t *p = &engine->slabs.slabclass[id];
+static int grow_slab_list(slab_partition* partition, const unsigned int id) {
+    slabclass_t *p = &partition->slabclass[id];
     if (p->slabs == p->list_size) {
         unsigned int new_size =  (p->list_size != 0) ? p->list_size * 2 : 16;
         void** new_list = static_cast<void**>
@@ -176,30 +196,50 @@ static int grow_slab_list (struct default_engine *engine, const unsigned int id)
     return 1;
 }
 
-static int do_slabs_newslab(struct default_engine *engine, const unsigned int id) {
-    slabclass_t *p = &engine->slabs.slabclass[id];
+/*
+ * Allocate a new page for the given slab class in the partition. The
+ * partition lock must be held by the caller; the memory limit is shared
+ * by all partitions so we need the global slabs lock while checking and
+ * updating it.
+ */
+static int do_slabs_newslab(struct default_engine* engine,
+                            slab_partition* partition,
+                            const unsigned int id) {
+    slabclass_t *p = &partition->slabclass[id];
     int len = p->size * p->perslab;
-    char *ptr;
-
-    if ((engine->slabs.mem_limit && engine->slabs.mem_malloced + len > engine->slabs.mem_limit && p->slabs > 0) ||
-        (grow_slab_list(engine, id) == 0) ||
-        ((ptr = static_cast<char*>(memory_allocate(engine, (size_t)len))) == 0)) {
+    char* ptr = nullptr;
 
+    if (grow_slab_list(partition, id) == 0) {
         return 0;
     }
 
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        if ((engine->slabs.mem_limit &&
+             engine->slabs.mem_malloced + len > engine->slabs.mem_limit &&
+             engine->slabs.class_slabs[id] > 0) ||
+            ((ptr = static_cast<char*>(
+                      memory_allocate(engine, (size_t)len))) == 0)) {
+            return 0;
+        }
+        engine->slabs.mem_malloced += len;
+        engine->slabs.class_slabs[id]++;
+    }
+
     memset(ptr, 0, (size_t)len);
     p->end_page_ptr = ptr;
     p->end_page_free = p->perslab;
 
     p->slab_list[p->slabs++] = ptr;
-    engine->slabs.mem_malloced += len;
 
     return 1;
 }
 
 /*@null@*/
-static void *do_slabs_alloc(struct default_engine *engine, const size_t size, unsigned int id) {
+static void* do_slabs_alloc(struct default_engine* engine,
+                            slab_partition* partition,
+                            const size_t size,
+                            unsigned int id) {
     slabclass_t *p;
     void *ret = NULL;
 
@@ -207,14 +247,18 @@ static void *do_slabs_alloc(struct default_engine *engine, const size_t size, un
         return NULL;
     }
 
-    p = &engine->slabs.slabclass[id];
+    p = &partition->slabclass[id];
 
 #ifdef USE_SYSTEM_MALLOC
-    if (engine->slabs.mem_limit && engine->slabs.mem_malloced + size > engine->slabs.mem_limit) {
-        MEMCACHED_SLABS_ALLOCATE_FAILED(size, id);
-        return 0;
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        if (engine->slabs.mem_limit &&
+            engine->slabs.mem_malloced + size > engine->slabs.mem_limit) {
+            MEMCACHED_SLABS_ALLOCATE_FAILED(size, id);
+            return 0;
+        }
+        engine->slabs.mem_malloced += size;
     }
-    engine->slabs.mem_malloced += size;
     ret = cb_calloc(1, size);
     MEMCACHED_SLABS_ALLOCATE(size, id, 0, ret);
     return ret;
@@ -223,7 +267,7 @@ static void *do_slabs_alloc(struct default_engine *engine, const size_t size, un
     /* fail unless we have space at the end of a recently allocated page,
        we have something on our freelist, or we could allocate a new page */
     if (! (p->end_page_ptr != 0 || p->sl_curr != 0 ||
-           do_slabs_newslab(engine, id) != 0)) {
+           do_slabs_newslab(engine, partition, id) != 0)) {
         /* We don't have more memory available */
         ret = NULL;
     } else if (p->sl_curr != 0) {
@@ -247,16 +291,23 @@ static void *do_slabs_alloc(struct default_engine *engine, const size_t size, un
     return ret;
 }
 
-static void do_slabs_free(struct default_engine *engine, void *ptr, const size_t size, unsigned int id) {
+static void do_slabs_free(struct default_engine* engine,
+                          slab_partition* partition,
+                          void* ptr,
+                          const size_t size,
+                          unsigned int id) {
     slabclass_t *p;
 
     if (id < POWER_SMALLEST || id > engine->slabs.power_largest)
         return;
 
-    p = &engine->slabs.slabclass[id];
+    p = &partition->slabclass[id];
 
 #ifdef USE_SYSTEM_MALLOC
-    engine->slabs.mem_malloced -= size;
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        engine->slabs.mem_malloced -= size;
+    }
     cb_free(ptr);
     return;
 #endif
@@ -324,6 +375,11 @@ void add_statistics(const void* cookie,
     add_stats(name, val, cookie);
 }
 
+/*
+ * Collect the statistics for each slab class summed over all of the
+ * partitions (each partition lock is only held while copying out its
+ * counters)
+ */
 /*@null@*/
 static void do_slabs_stats(struct default_engine* engine,
                            const AddStatFn& add_stats,
@@ -331,15 +387,36 @@ static void do_slabs_stats(struct default_engine* engine,
     unsigned int i;
     unsigned int total = 0;
 
+    struct {
+        unsigned int slabs;
+        unsigned int sl_curr;
+        unsigned int end_page_free;
+        uint64_t requested;
+    } summary[MAX_NUMBER_OF_SLAB_CLASSES];
+    memset(summary, 0, sizeof(summary));
+
+    for (unsigned int ii = 0; ii < engine->slabs.num_partitions; ++ii) {
+        auto& partition = engine->slabs.partitions[ii];
+        std::lock_guard<std::mutex> guard(partition.lock);
+        for (i = POWER_SMALLEST; i <= engine->slabs.power_largest; i++) {
+            const slabclass_t* p = &partition.slabclass[i];
+            summary[i].slabs += p->slabs;
+            summary[i].sl_curr += p->sl_curr;
+            summary[i].end_page_free += p->end_page_free;
+            summary[i].requested += p->requested;
+        }
+    }
+
+    const auto* slabclass = engine->slabs.partitions[0].slabclass;
     for(i = POWER_SMALLEST; i <= engine->slabs.power_largest; i++) {
-        slabclass_t *p = &engine->slabs.slabclass[i];
-        if (p->slabs != 0) {
+        const auto& p = summary[i];
+        if (p.slabs != 0) {
             uint32_t perslab, slabs;
-            slabs = p->slabs;
-            perslab = p->perslab;
+            slabs = p.slabs;
+            perslab = slabclass[i].perslab;
 
             add_statistics(cookie, add_stats, NULL, i, "chunk_size", "%u",
-                           p->size);
+                           slabclass[i].size);
             add_statistics(cookie, add_stats, NULL, i, "chunks_per_page", "%u",
                            perslab);
             add_statistics(cookie, add_stats, NULL, i, "total_pages", "%u",
@@ -347,23 +424,29 @@ static void do_slabs_stats(struct default_engine* engine,
             add_statistics(cookie, add_stats, NULL, i, "total_chunks", "%u",
                            slabs * perslab);
             add_statistics(cookie, add_stats, NULL, i, "used_chunks", "%u",
-                           slabs*perslab - p->sl_curr - p->end_page_free);
+                           slabs*perslab - p.sl_curr - p.end_page_free);
             add_statistics(cookie, add_stats, NULL, i, "free_chunks", "%u",
-                           p->sl_curr);
+                           p.sl_curr);
             add_statistics(cookie, add_stats, NULL, i, "free_chunks_end", "%u",
-                           p->end_page_free);
+                           p.end_page_free);
             add_statistics(cookie, add_stats, NULL, i, "mem_requested",
                            "%" PRIu64,
-                           (uint64_t)p->requested);
+                           p.requested);
             total++;
         }
     }
 
+    size_t malloced;
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        malloced = engine->slabs.mem_malloced;
+    }
+
     /* add overall slab stats and append terminator */
 
     add_statistics(cookie, add_stats, NULL, -1, "active_slabs", "%d", total);
     add_statistics(cookie, add_stats, NULL, -1, "total_malloced", "%" PRIu64,
-                   (uint64_t)engine->slabs.mem_malloced);
+                   (uint64_t)malloced);
 }
 
 static void *memory_allocate(struct default_engine *engine, size_t size) {
@@ -395,34 +478,46 @@ static void *memory_allocate(struct default_engine *engine, size_t size) {
     return ret;
 }
 
-void *slabs_alloc(struct default_engine *engine, size_t size, unsigned int id) {
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
-    return do_slabs_alloc(engine, size, id);
+void* slabs_alloc(struct default_engine* engine,
+                  size_t size,
+                  unsigned int id,
+                  unsigned int partition) {
+    auto& p = engine->slabs.partitions[partition];
+    std::lock_guard<std::mutex> guard(p.lock);
+    return do_slabs_alloc(engine, &p, size, id);
 }
 
-void slabs_free(struct default_engine *engine, void *ptr, size_t size, unsigned int id) {
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
-    do_slabs_free(engine, ptr, size, id);
+void slabs_free(struct default_engine* engine,
+                void* ptr,
+                size_t size,
+                unsigned int id,
+                unsigned int partition) {
+    auto& p = engine->slabs.partitions[partition];
+    std::lock_guard<std::mutex> guard(p.lock);
+    do_slabs_free(engine, &p, ptr, size, id);
 }
 
 void slabs_stats(struct default_engine* engine,
                  const AddStatFn& add_stats,
                  const void* c) {
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
     do_slabs_stats(engine, add_stats, c);
 }
 
-void slabs_adjust_mem_requested(struct default_engine *engine, unsigned int id, size_t old, size_t ntotal)
-{
+void slabs_adjust_mem_requested(struct default_engine* engine,
+                                unsigned int id,
+                                unsigned int partition,
+                                size_t old,
+                                size_t ntotal) {
     slabclass_t *p;
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
     if (id < POWER_SMALLEST || id > engine->slabs.power_largest) {
         throw std::invalid_argument(
                 "slabs_adjust_mem_requested: Internal error! Invalid slab "
                 "class");
     }
 
-    p = &engine->slabs.slabclass[id];
+    auto& part = engine->slabs.partitions[partition];
+    std::lock_guard<std::mutex> guard(part.lock);
+    p = &part.slabclass[id];
     p->requested = p->requested - old + ntotal;
 }
 
@@ -438,9 +533,13 @@ void slabs_destroy(struct default_engine *e)
     cb_free(e->slabs.allocs.ptrs);
 
     /* Release the freelists */
-    for (jj = POWER_SMALLEST; jj <= e->slabs.power_largest; jj++) {
-        slabclass_t *p = &e->slabs.slabclass[jj];
-        cb_free(p->slots);
-        cb_free(p->slab_list);
+    for (unsigned int pp = 0; pp < e->slabs.num_partitions; ++pp) {
+        for (jj = POWER_SMALLEST; jj <= e->slabs.power_largest; jj++) {
+            slabclass_t* p = &e->slabs.partitions[pp].slabclass[jj];
+            cb_free(p->slots);
+            cb_free(p->slab_list);
+        }
     }
+    e->slabs.partitions.reset();
+    e->slabs.num_partitions = 0;
 }
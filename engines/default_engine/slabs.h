@@ -4,6 +4,7 @@
 #include <memcached/engine_common.h>
 #include <memcached/engine_error.h>
 
+#include <memory>
 #include <mutex>
 
 /* Slab sizing definitions. */
@@ -35,10 +36,32 @@ typedef struct {
     size_t requested; /* The number of requested bytes */
 } slabclass_t;
 
-struct slabs {
+/**
+ * Each item partition owns its own set of slab classes (free lists and the
+ * pages carved up for them) so that allocating and freeing items in
+ * different partitions don't contend on the same lock. Only the allocation
+ * of new pages (and the accounting of the memory limit) is shared across
+ * all partitions and protected by slabs::lock.
+ */
+typedef struct {
    slabclass_t slabclass[MAX_NUMBER_OF_SLAB_CLASSES];
+
+   /**
+    * Access to the slab classes in this partition is protected by this lock
+    */
+   std::mutex lock;
+} slab_partition;
+
+struct slabs {
+   std::unique_ptr<slab_partition[]> partitions;
+   unsigned int num_partitions;
    size_t mem_limit;
    size_t mem_malloced;
+   /**
+    * Number of pages allocated for each slab class, over all partitions
+    * (the first page of a class may exceed the memory limit)
+    */
+   unsigned int class_slabs[MAX_NUMBER_OF_SLAB_CLASSES];
    unsigned int power_largest;
 
    void *mem_base;
@@ -52,7 +75,8 @@ struct slabs {
    } allocs;
 
    /**
-    * Access to the slab allocator is protected by this lock
+    * Allocation of new slab pages (and the memory accounting) is protected
+    * by this lock
     */
    std::mutex lock;
 };
@@ -80,14 +104,25 @@ void slabs_destroy(struct default_engine *engine);
 
 unsigned int slabs_clsid(struct default_engine *engine, const size_t size);
 
-/** Allocate object of given length. 0 on error */ /*@null@*/
-void *slabs_alloc(struct default_engine *engine, size_t size, unsigned int id);
+/** Allocate object of given length from the given partition. 0 on error */ /*@null@*/
+void* slabs_alloc(struct default_engine* engine,
+                  size_t size,
+                  unsigned int id,
+                  unsigned int partition);
 
-/** Free previously allocated object */
-void slabs_free(struct default_engine *engine, void *ptr, size_t size, unsigned int id);
+/** Free previously allocated object back to the partition it belongs to */
+void slabs_free(struct default_engine* engine,
+                void* ptr,
+                size_t size,
+                unsigned int id,
+                unsigned int partition);
 
 /** Adjust the stats for memory requested */
-void slabs_adjust_mem_requested(struct default_engine *engine, unsigned int id, size_t old, size_t ntotal);
+void slabs_adjust_mem_requested(struct default_engine* engine,
+                                unsigned int id,
+                                unsigned int partition,
+                                size_t old,
+                                size_t ntotal);
 
 /** Fill buffer with stats */ /*@null@*/
 void slabs_stats(struct default_engine* engine,
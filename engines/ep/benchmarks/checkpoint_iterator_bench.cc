@@ -21,14 +21,21 @@
 
 #include "atomic.h"
 #include "checkpoint_iterator.h"
+#include "chunked_queue.h"
 
 #include <benchmark/benchmark.h>
+#include <utilities/memory_tracking_allocator.h>
 #include <list>
+#include <vector>
 
 typedef std::unique_ptr<int> TestItem;
 typedef std::list<TestItem> ListContainer;
 typedef CheckpointIterator<ListContainer> ListContainerIterator;
 
+typedef std::list<TestItem, MemoryTrackingAllocator<TestItem>> TrackedList;
+typedef ChunkedQueue<TestItem, MemoryTrackingAllocator<TestItem>>
+        TrackedChunkedQueue;
+
 ListContainerIterator listContainerBegin(ListContainer& c) {
     return ListContainerIterator(c, ListContainerIterator::Position::begin);
 }
@@ -59,3 +66,72 @@ static void BM_CheckpointIteratorCompare(benchmark::State& state) {
 
 // Register the function as a benchmark
 BENCHMARK(BM_CheckpointIteratorCompare);
+
+/**
+ * Benchmark the cost of walking a cursor over a checkpoint queue of
+ * state.range(0) elements (where every 8th element is de-duplicated away),
+ * comparing std::list (which the queue used to be) with the ChunkedQueue.
+ * The elements are allocated interleaved with other allocations (like
+ * items queued from many front end threads would be), and the memory used
+ * by the container is reported in the "QueueBytesPerItem" counter.
+ */
+template <class Container>
+static void BM_CheckpointQueueIterate(benchmark::State& state) {
+    MemoryTrackingAllocator<TestItem> allocator;
+    Container c(allocator);
+    std::vector<std::unique_ptr<char[]>> noise;
+    for (int64_t ii = 0; ii < state.range(0); ++ii) {
+        c.push_back(std::make_unique<int>(ii));
+        noise.emplace_back(new char[48]);
+    }
+    // De-duplicate every 8th element
+    int64_t ii = 0;
+    for (auto it = c.begin(); it != c.end();) {
+        auto current = it++;
+        if ((ii++ % 8) == 0) {
+            c.erase(current);
+        }
+    }
+
+    using Iterator = CheckpointIterator<Container>;
+    while (state.KeepRunning()) {
+        int64_t sum = 0;
+        for (Iterator cursor(c, Iterator::Position::begin),
+             end(c, Iterator::Position::end);
+             cursor != end;
+             ++cursor) {
+            sum += **cursor;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * c.size());
+    state.counters["QueueBytesPerItem"] =
+            double(*allocator.getBytesAllocated()) / c.size();
+}
+
+/**
+ * Benchmark the cost of queueing state.range(0) items and then expelling
+ * them again (the work done by queueDirty and the expel/removal of
+ * checkpoints).
+ */
+template <class Container>
+static void BM_CheckpointQueuePushAndClear(benchmark::State& state) {
+    MemoryTrackingAllocator<TestItem> allocator;
+    while (state.KeepRunning()) {
+        Container c(allocator);
+        for (int64_t ii = 0; ii < state.range(0); ++ii) {
+            c.push_back(std::make_unique<int>(ii));
+        }
+        benchmark::DoNotOptimize(c);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_CheckpointQueueIterate, TrackedList)
+        ->Range(64, 64 * 1024);
+BENCHMARK_TEMPLATE(BM_CheckpointQueueIterate, TrackedChunkedQueue)
+        ->Range(64, 64 * 1024);
+BENCHMARK_TEMPLATE(BM_CheckpointQueuePushAndClear, TrackedList)
+        ->Range(64, 64 * 1024);
+BENCHMARK_TEMPLATE(BM_CheckpointQueuePushAndClear, TrackedChunkedQueue)
+        ->Range(64, 64 * 1024);
@@ -27,28 +27,49 @@
 #include <folly/portability/GTest.h>
 #include <spdlog/fmt/fmt.h>
 
-// Benchmarks inserting items into a HashTable
+// Benchmarks inserting items into a HashTable.
+// The first parameter specifies the HashTableIndexMode of the HashTable
+// being benchmarked.
 class HashTableBench : public benchmark::Fixture {
 public:
     HashTableBench()
-        : ht(stats,
-             std::make_unique<StoredValueFactory>(stats),
-             Configuration().getHtSize(),
-             Configuration().getHtLocks()) {
+        : chainedHt(stats,
+                    std::make_unique<StoredValueFactory>(stats),
+                    Configuration().getHtSize(),
+                    Configuration().getHtLocks(),
+                    HashTableIndexMode::Chained),
+          fingerprintHt(stats,
+                        std::make_unique<StoredValueFactory>(stats),
+                        Configuration().getHtSize(),
+                        Configuration().getHtLocks(),
+                        HashTableIndexMode::Fingerprint) {
     }
 
     void SetUp(benchmark::State& state) {
         if (state.thread_index == 0) {
-            ht.resize(numItems);
+            state.SetLabel(to_string(getHashTable(state).getIndexMode()));
+            getHashTable(state).resize(numItems);
         }
     }
 
     void TearDown(benchmark::State& state) {
         if (state.thread_index == 0) {
-            ht.clear();
+            getHashTable(state).clear();
         }
     }
 
+    /// @return the HashTable selected by the benchmark's first parameter
+    HashTable& getHashTable(const benchmark::State& state) {
+        switch (state.range(0)) {
+        case 0:
+            return chainedHt;
+        case 1:
+            return fingerprintHt;
+        }
+        throw std::invalid_argument("Invalid input param(0) value:" +
+                                    std::to_string(state.range(0)));
+    }
+
     /**
      * Create numItems Items, giving each key the given prefix.
      * @param prefix String to prefix each key with.
@@ -84,7 +105,7 @@ public:
         return items;
     }
 
-    void addItemToHashTable(const Item& item) {
+    void addItemToHashTable(HashTable& ht, const Item& item) {
         if (item.isPending()) {
             // Calling ht.set will overwrite the committed SV so we have to
             // manually add our prepare
@@ -122,7 +143,8 @@ public:
     }
 
     EPStats stats;
-    HashTable ht;
+    HashTable chainedHt;
+    HashTable fingerprintHt;
     static const size_t numItems = 100000;
     /// Shared vector of items for tests which want to use the same
     /// data across multiple threads.
@@ -139,12 +161,13 @@ public:
 // high percentage in a real-world, but want to measure any performance impact
 // in having such items present in the HashTable.
 BENCHMARK_DEFINE_F(HashTableBench, FindForRead)(benchmark::State& state) {
+    auto& ht = getHashTable(state);
     // Populate the HashTable with numItems.
     if (state.thread_index == 0) {
         sharedItems = createItems(
                 "Thread" + std::to_string(state.thread_index) + "::", 50);
         for (auto& item : sharedItems) {
-            addItemToHashTable(item);
+            addItemToHashTable(ht, item);
         }
     }
 
@@ -162,12 +185,13 @@ BENCHMARK_DEFINE_F(HashTableBench, FindForRead)(benchmark::State& state) {
 // high percentage in a real-world, but want to measure any performance impact
 // in having such items present in the HashTable.
 BENCHMARK_DEFINE_F(HashTableBench, FindForWrite)(benchmark::State& state) {
+    auto& ht = getHashTable(state);
     // Populate the HashTable with numItems.
     if (state.thread_index == 0) {
         sharedItems = createItems(
                 "Thread" + std::to_string(state.thread_index) + "::", 50);
         for (auto& item : sharedItems) {
-            addItemToHashTable(item);
+            addItemToHashTable(ht, item);
         }
     }
 
@@ -180,8 +204,31 @@ BENCHMARK_DEFINE_F(HashTableBench, FindForWrite)(benchmark::State& state) {
     state.SetItemsProcessed(state.iterations());
 }
 
+// Benchmark looking up keys which are not in the HashTable - the case the
+// fingerprint index is designed to speed up.
+BENCHMARK_DEFINE_F(HashTableBench, FindMissing)(benchmark::State& state) {
+    auto& ht = getHashTable(state);
+    // Populate the HashTable with numItems, and create another set of items
+    // which are never inserted.
+    if (state.thread_index == 0) {
+        for (auto& item : createItems("Present::")) {
+            addItemToHashTable(ht, item);
+        }
+        sharedItems = createItems("Missing::");
+    }
+
+    // Benchmark - try to find the missing ones.
+    while (state.KeepRunning()) {
+        auto& key = sharedItems[state.iterations() % numItems].getKey();
+        benchmark::DoNotOptimize(ht.findForRead(key));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
 // Benchmark inserting an item into the HashTable.
 BENCHMARK_DEFINE_F(HashTableBench, Insert)(benchmark::State& state) {
+    auto& ht = getHashTable(state);
     // To ensure we insert and not replace items, create a per-thread items
     // vector so each thread inserts a different set of items.
     auto items =
@@ -189,7 +236,7 @@ BENCHMARK_DEFINE_F(HashTableBench, Insert)(benchmark::State& state) {
 
     while (state.KeepRunning()) {
         const auto index = state.iterations() % numItems;
-        addItemToHashTable(items[index]);
+        addItemToHashTable(ht, items[index]);
 
         // Once a thread gets to the end of it's items; pause timing and let
         // the *last* thread clear them all - this is to avoid measuring any
@@ -200,7 +247,7 @@ BENCHMARK_DEFINE_F(HashTableBench, Insert)(benchmark::State& state) {
         // wrapped.
         if (index == 0) {
             state.PauseTiming();
-            waitForAllThreadsThenExecuteOnce(state, [this]() { ht.clear(); });
+            waitForAllThreadsThenExecuteOnce(state, [&ht]() { ht.clear(); });
             state.ResumeTiming();
         }
     }
@@ -210,11 +257,12 @@ BENCHMARK_DEFINE_F(HashTableBench, Insert)(benchmark::State& state) {
 
 // Benchmark replacing an existing item in the HashTable.
 BENCHMARK_DEFINE_F(HashTableBench, Replace)(benchmark::State& state) {
+    auto& ht = getHashTable(state);
     // Populate the HashTable with numItems.
     auto items =
             createItems("Thread" + std::to_string(state.thread_index) + "::");
     for (auto& item : items) {
-        addItemToHashTable(item);
+        addItemToHashTable(ht, item);
     }
 
     // Benchmark - update them.
@@ -227,6 +275,7 @@ BENCHMARK_DEFINE_F(HashTableBench, Replace)(benchmark::State& state) {
 }
 
 BENCHMARK_DEFINE_F(HashTableBench, Delete)(benchmark::State& state) {
+    auto& ht = getHashTable(state);
     auto items =
             createItems("Thread" + std::to_string(state.thread_index) + "::");
 
@@ -242,10 +291,10 @@ BENCHMARK_DEFINE_F(HashTableBench, Delete)(benchmark::State& state) {
         // other threads are trying to delete.
         if (index == 1) {
             state.PauseTiming();
-            waitForAllThreadsThenExecuteOnce(state, [this, &items]() {
+            waitForAllThreadsThenExecuteOnce(state, [this, &ht, &items]() {
                 // re-populate HashTable.
                 for (auto& item : items) {
-                    addItemToHashTable(item);
+                    addItemToHashTable(ht, item);
                 }
             });
             state.ResumeTiming();
@@ -263,17 +312,32 @@ BENCHMARK_DEFINE_F(HashTableBench, Delete)(benchmark::State& state) {
 }
 
 BENCHMARK_REGISTER_F(HashTableBench, FindForRead)
+        ->Arg(0)
+        ->Arg(1)
         ->ThreadPerCpu()
         ->Iterations(HashTableBench::numItems);
 BENCHMARK_REGISTER_F(HashTableBench, FindForWrite)
+        ->Arg(0)
+        ->Arg(1)
+        ->ThreadPerCpu()
+        ->Iterations(HashTableBench::numItems);
+BENCHMARK_REGISTER_F(HashTableBench, FindMissing)
+        ->Arg(0)
+        ->Arg(1)
         ->ThreadPerCpu()
         ->Iterations(HashTableBench::numItems);
 BENCHMARK_REGISTER_F(HashTableBench, Insert)
+        ->Arg(0)
+        ->Arg(1)
         ->ThreadPerCpu()
         ->Iterations(HashTableBench::numItems);
 BENCHMARK_REGISTER_F(HashTableBench, Replace)
+        ->Arg(0)
+        ->Arg(1)
         ->ThreadPerCpu()
         ->Iterations(HashTableBench::numItems);
 BENCHMARK_REGISTER_F(HashTableBench, Delete)
+        ->Arg(0)
+        ->Arg(1)
         ->ThreadPerCpu()
         ->Iterations(HashTableBench::numItems);
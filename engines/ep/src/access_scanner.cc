@@ -20,7 +20,7 @@
 #include "ep_time.h"
 #include "hash_table.h"
 #include "kv_bucket.h"
-#include "mutation_log.h"
+#include "sorted_access_log.h"
 #include "stats.h"
 #include "vb_count_visitor.h"
 
@@ -57,16 +57,14 @@ public:
         prev = name + ".old";
         next = name + ".next";
 
-        log = std::make_unique<MutationLog>(next, conf.getAlogBlockSize());
-        log->open();
-        if (!log->isOpen()) {
-            EP_LOG_WARN("Failed to open access log: '{}'", next);
-            log.reset();
-        } else {
+        try {
+            log = std::make_unique<SortedAccessLogWriter>(next);
             EP_LOG_INFO(
                     "Attempting to generate new access file "
                     "'{}'",
                     next);
+        } catch (const std::exception& e) {
+            EP_LOG_WARN("Failed to open access log: '{}': {}", next, e.what());
         }
     }
 
@@ -84,18 +82,7 @@ public:
         return true;
     }
 
-    void update(Vbid vbid) {
-        if (log != nullptr) {
-            for (auto it = accessed.begin(); it != accessed.end(); ++it) {
-                log->newItem(vbid, *it);
-            }
-        }
-        accessed.clear();
-    }
-
     void visitBucket(const VBucketPtr& vb) override {
-        update(vb->getId());
-
         if (log == nullptr) {
             return;
         }
@@ -103,12 +90,22 @@ public:
         if (vBucketFilter(vb->getId())) {
             while (ht_start != vb->ht.endPosition()) {
                 ht_start = vb->ht.pauseResumeVisit(*this, ht_start);
-                update(vb->getId());
-                log->commit1();
-                log->commit2();
                 items_scanned = 0;
             }
+
+            // The keys of each vBucket are written as a single sorted
+            // section of the log
+            try {
+                log->addVBucket(vb->getId(), std::move(accessed));
+            } catch (const std::exception& e) {
+                EP_LOG_WARN("Failed to write access log '{}': {}",
+                            next,
+                            e.what());
+                log.reset();
+                remove(next.c_str());
+            }
         }
+        accessed.clear();
     }
 
     void complete() override {
@@ -116,9 +113,18 @@ public:
         if (log == nullptr) {
             updateStateFinalizer(false);
         } else {
-            size_t num_items = log->itemsLogged[int(MutationLogType::New)];
-            log->commit1();
-            log->commit2();
+            size_t num_items = log->getNumKeys();
+            try {
+                log->commit();
+            } catch (const std::exception& e) {
+                EP_LOG_WARN("Failed to write access log '{}': {}",
+                            next,
+                            e.what());
+                log.reset();
+                remove(next.c_str());
+                updateStateFinalizer(false);
+                return;
+            }
             log.reset();
             stats.alogRuntime.store(ep_real_time() - startTime);
             stats.alogNumItems.store(num_items);
@@ -217,7 +223,7 @@ private:
 
     std::vector<StoredDocKey> accessed;
 
-    std::unique_ptr<MutationLog> log;
+    std::unique_ptr<SortedAccessLogWriter> log;
     std::atomic<bool> &stateFinalizer;
     AccessScanner &as;
 
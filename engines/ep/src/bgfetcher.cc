@@ -58,8 +58,29 @@ void BgFetcher::stop() {
     ExecutorPool::get()->cancel(taskId);
 }
 
+BgFetcher::BatchGuard::BatchGuard(BgFetcher* fetcher) : fetcher(fetcher) {
+    if (fetcher) {
+        ++fetcher->batchesInProgress;
+    }
+}
+
+BgFetcher::BatchGuard::~BatchGuard() {
+    if (fetcher && --fetcher->batchesInProgress == 0 &&
+        fetcher->wakeDeferred.exchange(false)) {
+        fetcher->wakeUpTaskIfSnoozed();
+    }
+}
+
 void BgFetcher::notifyBGEvent(void) {
     ++stats.numRemainingBgItems;
+    if (batchesInProgress.load() > 0) {
+        wakeDeferred.store(true);
+        // Check again; the last batch may have completed before we set
+        // the flag (and we'd never be woken up)
+        if (batchesInProgress.load() > 0) {
+            return;
+        }
+    }
     wakeUpTaskIfSnoozed();
 }
 
@@ -34,6 +34,26 @@ class GlobalTask;
  */
 class BgFetcher {
 public:
+    /**
+     * While a BatchGuard is alive notifyBGEvent() won't wake up the
+     * fetcher task; the wakeup is deferred until the last guard goes out
+     * of scope. This is used when queueing a batch of fetches (GetMulti)
+     * so that all of them end up in the same KVStore::getMulti call instead
+     * of the task racing the front end thread and fetching them piecemeal.
+     */
+    class BatchGuard {
+    public:
+        /// @param fetcher the fetcher to hold back (may be nullptr)
+        explicit BatchGuard(BgFetcher* fetcher);
+        ~BatchGuard();
+
+        BatchGuard(const BatchGuard&) = delete;
+        BatchGuard& operator=(const BatchGuard&) = delete;
+
+    private:
+        BgFetcher* fetcher;
+    };
+
     /**
      * Construct a BgFetcher
      *
@@ -85,4 +105,9 @@ private:
 
     std::atomic<bool> pendingFetch;
     std::set<Vbid> pendingVbs;
+
+    /// The number of BatchGuards currently alive
+    std::atomic<int> batchesInProgress{0};
+    /// Set if notifyBGEvent() was called while a batch was in progress
+    std::atomic<bool> wakeDeferred{false};
 };
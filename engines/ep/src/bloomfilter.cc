@@ -21,7 +21,15 @@
 
 #include "murmurhash3.h"
 
+#include <platform/socket.h>
+
 #include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BFILTER_SSE2 1
+#endif
 
 #if __x86_64__ || __ppc64__
 #define MURMURHASH_3 MurmurHash3_x64_128
@@ -29,19 +37,44 @@
 #define MURMURHASH_3 MurmurHash3_x86_128
 #endif
 
+/// Odd multipliers selecting the bit of each word of a block for a key
+static const uint32_t blockSalts[] = {0x47b6137bU,
+                                      0x44974d91U,
+                                      0x8824ad5bU,
+                                      0xa2b7289dU,
+                                      0x705495c7U,
+                                      0x2df1424bU,
+                                      0x9efc4947U,
+                                      0x5c6bfb31U};
+
+/// Header of a serialised filter, followed by the blocks. The header and
+/// the words of the blocks are in network byte order.
+struct SerialisedHeader {
+    static constexpr uint32_t Magic = 0x42464c32; // "BFL2"
+    uint32_t magic;
+    uint32_t wordsPerBlock;
+    uint64_t numBlocks;
+    uint64_t keyCounter;
+};
+
 BloomFilter::BloomFilter(size_t key_count, double false_positive_prob,
-                         bfilter_status_t new_status) {
+                         bfilter_status_t new_status)
+    : BloomFilter(
+              (estimateFilterSize(key_count, false_positive_prob) + 255) / 256,
+              new_status) {
+}
 
+BloomFilter::BloomFilter(size_t numBlocks, bfilter_status_t new_status) {
     status = new_status;
-    filterSize = estimateFilterSize(key_count, false_positive_prob);
-    noOfHashes = estimateNoOfHashes(key_count);
+    blocks.assign(std::max(numBlocks, size_t(1)), Block{});
+    filterSize = blocks.size() * Block::Words * 32;
+    noOfHashes = Block::Words;
     keyCounter = 0;
-    bitArray.assign(filterSize, false);
 }
 
 BloomFilter::~BloomFilter() {
     status = BFILTER_DISABLED;
-    bitArray.clear();
+    blocks.clear();
 }
 
 size_t BloomFilter::estimateFilterSize(size_t key_count,
@@ -50,10 +83,6 @@ size_t BloomFilter::estimateFilterSize(size_t key_count,
                                                     / (pow(log(2.0), 2))));
 }
 
-size_t BloomFilter::estimateNoOfHashes(size_t key_count) {
-    return round(((double) filterSize / key_count) * (log(2.0)));
-}
-
 uint64_t BloomFilter::hashDocKey(const DocKey& key, uint32_t iteration) {
     uint64_t result = 0;
     auto hashable = key.getIdAndKey();
@@ -62,6 +91,22 @@ uint64_t BloomFilter::hashDocKey(const DocKey& key, uint32_t iteration) {
     return result;
 }
 
+BloomFilter::Block& BloomFilter::getBlock(uint64_t hash) {
+    // The upper half of the hash selects the block (scaled into the number
+    // of blocks rather than taking the remainder)
+    return blocks[((hash >> 32) * blocks.size()) >> 32];
+}
+
+BloomFilter::Block BloomFilter::getMask(uint64_t hash) {
+    // The lower half of the hash selects one of the 32 bits of each word
+    Block mask;
+    const auto key = uint32_t(hash);
+    for (size_t ii = 0; ii < Block::Words; ++ii) {
+        mask.words[ii] = 1U << ((key * blockSalts[ii]) >> 27);
+    }
+    return mask;
+}
+
 void BloomFilter::setStatus(bfilter_status_t to) {
     switch (status) {
         case BFILTER_DISABLED:
@@ -72,7 +117,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_PENDING:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                blocks.clear();
             } else if (to == BFILTER_COMPACTING) {
                 status = to;
             }
@@ -80,7 +125,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_COMPACTING:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                blocks.clear();
             } else if (to == BFILTER_ENABLED) {
                 status = to;
             }
@@ -88,7 +133,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_ENABLED:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                blocks.clear();
             } else if (to == BFILTER_COMPACTING) {
                 status = to;
             }
@@ -116,13 +161,15 @@ std::string BloomFilter::getStatusString() {
 
 void BloomFilter::addKey(const DocKey& key) {
     if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
+        const auto hash = hashDocKey(key, 0);
+        auto& block = getBlock(hash);
+        const auto mask = getMask(hash);
         bool overlap = true;
-        for (uint32_t i = 0; i < noOfHashes; i++) {
-            uint64_t result = hashDocKey(key, i);
-            if (overlap && bitArray[result % filterSize] == 0) {
+        for (size_t ii = 0; ii < Block::Words; ++ii) {
+            if ((block.words[ii] & mask.words[ii]) == 0) {
                 overlap = false;
             }
-            bitArray[result % filterSize] = 1;
+            block.words[ii] |= mask.words[ii];
         }
         if (!overlap) {
             keyCounter++;
@@ -132,13 +179,25 @@ void BloomFilter::addKey(const DocKey& key) {
 
 bool BloomFilter::maybeKeyExists(const DocKey& key) {
     if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
-        for (uint32_t i = 0; i < noOfHashes; i++) {
-            uint64_t result = hashDocKey(key, i);
-            if (bitArray[result % filterSize] == 0) {
-                // The key does NOT exist.
-                return false;
-            }
+        const auto hash = hashDocKey(key, 0);
+        const auto& block = getBlock(hash);
+        const auto mask = getMask(hash);
+#ifdef BFILTER_SSE2
+        // The key does NOT exist if any of its bits is not set in the block
+        const auto* b = reinterpret_cast<const __m128i*>(block.words);
+        const auto* m = reinterpret_cast<const __m128i*>(mask.words);
+        const auto missing = _mm_or_si128(_mm_andnot_si128(b[0], m[0]),
+                                          _mm_andnot_si128(b[1], m[1]));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(
+                       missing, _mm_setzero_si128())) == 0xffff;
+#else
+        uint32_t missing = 0;
+        for (size_t ii = 0; ii < Block::Words; ++ii) {
+            missing |= mask.words[ii] & ~block.words[ii];
         }
+        // The key does NOT exist if any of its bits is not set.
+        return missing == 0;
+#endif
     }
     // The key may exist.
     return true;
@@ -159,3 +218,49 @@ size_t BloomFilter::getFilterSize() {
         return 0;
     }
 }
+
+std::string BloomFilter::serialise() const {
+    SerialisedHeader header;
+    header.magic = htonl(SerialisedHeader::Magic);
+    header.wordsPerBlock = htonl(Block::Words);
+    header.numBlocks = htonll(blocks.size());
+    header.keyCounter = htonll(keyCounter);
+
+    std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+    data.reserve(sizeof(header) + blocks.size() * sizeof(Block));
+    for (const auto& block : blocks) {
+        for (auto word : block.words) {
+            word = htonl(word);
+            data.append(reinterpret_cast<const char*>(&word), sizeof(word));
+        }
+    }
+    return data;
+}
+
+std::unique_ptr<BloomFilter> BloomFilter::deserialise(
+        cb::const_char_buffer data, bfilter_status_t newStatus) {
+    SerialisedHeader header;
+    if (data.size() < sizeof(header)) {
+        return {};
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    const uint64_t numBlocks = ntohll(header.numBlocks);
+    if (ntohl(header.magic) != SerialisedHeader::Magic ||
+        ntohl(header.wordsPerBlock) != Block::Words || numBlocks == 0 ||
+        data.size() - sizeof(header) != numBlocks * sizeof(Block)) {
+        return {};
+    }
+
+    // Can't use make_unique as the constructor is protected
+    std::unique_ptr<BloomFilter> filter(new BloomFilter(numBlocks, newStatus));
+    const char* next = data.data() + sizeof(header);
+    for (auto& block : filter->blocks) {
+        for (auto& word : block.words) {
+            std::memcpy(&word, next, sizeof(word));
+            word = ntohl(word);
+            next += sizeof(word);
+        }
+    }
+    filter->keyCounter = ntohll(header.keyCounter);
+    return filter;
+}
@@ -16,6 +16,10 @@
  */
 #pragma once
 
+#include <platform/sized_buffer.h>
+
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -33,6 +37,11 @@ enum bfilter_status_t {
  * We are to maintain the vbucket-number of these instances.
  *
  * Each vbucket will hold one such object.
+ *
+ * The filter is split into blocks of 8 32-bit words, and all the bits of a
+ * key are set in a single block (one bit per word) - a key is hashed once
+ * to select the block and the bits, and a lookup touches a single block
+ * which is probed with SIMD instructions where available.
  */
 class BloomFilter {
 public:
@@ -50,17 +59,46 @@ public:
     size_t getNumOfKeysInFilter();
     size_t getFilterSize();
 
+    /// @return the filter's keys and bits, to be restored by deserialise()
+    std::string serialise() const;
+
+    /**
+     * Restore a filter saved by serialise().
+     *
+     * @param data The serialised filter
+     * @param newStatus The status of the restored filter
+     * @return the filter, or nullptr if data isn't a valid serialised filter
+     */
+    static std::unique_ptr<BloomFilter> deserialise(cb::const_char_buffer data,
+                                                    bfilter_status_t newStatus);
+
 protected:
-    size_t estimateFilterSize(size_t key_count, double false_positive_prob);
-    size_t estimateNoOfHashes(size_t key_count);
+    /// The bits of a key are all set within a single block
+    struct alignas(16) Block {
+        static constexpr size_t Words = 8;
+        uint32_t words[Words];
+    };
+    static_assert(sizeof(Block) == 32, "BloomFilter::Block should be 32 bytes");
+
+    /// Only used by deserialise()
+    BloomFilter(size_t numBlocks, bfilter_status_t newStatus);
+
+    static size_t estimateFilterSize(size_t key_count,
+                                     double false_positive_prob);
 
     uint64_t hashDocKey(const DocKey& key, uint32_t iteration);
 
+    /// @return the block of the given key hash
+    Block& getBlock(uint64_t hash);
+
+    /// @return the bits of the given key hash in its block
+    static Block getMask(uint64_t hash);
+
     size_t filterSize;
     size_t noOfHashes;
 
     size_t keyCounter;
 
     bfilter_status_t status;
-    std::vector<bool> bitArray;
+    std::vector<Block> blocks;
 };
@@ -15,6 +15,7 @@
  *   limitations under the License.
  */
 
+#include <algorithm>
 #include <boost/optional/optional_io.hpp>
 #include <gsl.h>
 #include <platform/checked_snprintf.h>
@@ -265,7 +266,8 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
                 // Reduce the size of the checkpoint by the size of the
                 // item being removed.
                 queuedItemsMemUsage -= ((*currPos)->size());
-                // Remove the existing item for the same key from the list.
+                // Remove the existing item for the same key from the queue.
+                removeFromSeqnoIndex(currMutationId);
                 toWrite.erase(currPos);
             } else {
                 // The old item has been expelled, but we can continue to use
@@ -391,12 +393,19 @@ void Checkpoint::addItemToCheckpoint(const queued_item& qi) {
     } else {
         // Not a meta item
         ++numItems;
+        if (++itemsSinceSeqnoIndexed == seqnoIndexInterval) {
+            itemsSinceSeqnoIndexed = 0;
+            auto last = toWrite.end();
+            seqnoIndex.emplace_back(qi->getBySeqno(), --last);
+        }
     }
 }
 
 CheckpointQueue Checkpoint::expelItems(
         CheckpointCursor& expelUpToAndIncluding) {
-    CheckpointQueue expelledItems(toWrite.get_allocator());
+    // The expelled items use their own allocator so that they're not
+    // accounted for as part of this checkpoint's memory usage
+    CheckpointQueue expelledItems;
 
     ChkptQueueIterator iterator = expelUpToAndIncluding.currentPos;
 
@@ -404,6 +413,13 @@ CheckpointQueue Checkpoint::expelItems(
     highestExpelledSeqno =
             (*iterator)->getBySeqno();
 
+    // The positions of the expelled items become invalid (and the last one
+    // is about to become the dummy item)
+    while (!seqnoIndex.empty() &&
+           seqnoIndex.front().first <= highestExpelledSeqno) {
+        seqnoIndex.pop_front();
+    }
+
     auto firstItemToExpel = std::next(begin());
     auto lastItemToExpel = iterator;
 
@@ -462,15 +478,42 @@ CheckpointQueue Checkpoint::expelItems(
      * (but not including) the item pointed to by iterator.  The item pointed
      * to by iterator is now the new dummy item for the checkpoint queue.
      */
-    expelledItems.splice(expelledItems.begin(),
-                         toWrite,
-                         begin(),
-                         iterator);
+    toWrite.splice_front(expelledItems, iterator);
 
     // Return the items that have been expelled in a separate queue.
     return expelledItems;
 }
 
+ChkptQueueIterator Checkpoint::seekBySeqno(uint64_t bySeqno) const {
+    // Find the first entry past bySeqno; the one before it (if any) is
+    // where to start from
+    const auto next = std::upper_bound(
+            seqnoIndex.begin(),
+            seqnoIndex.end(),
+            bySeqno,
+            [](uint64_t seqno, const auto& entry) {
+                return seqno < static_cast<uint64_t>(entry.first);
+            });
+    if (next == seqnoIndex.begin()) {
+        return begin();
+    }
+    return ChkptQueueIterator(const_cast<CheckpointQueue&>(toWrite),
+                              std::prev(next)->second);
+}
+
+void Checkpoint::removeFromSeqnoIndex(int64_t bySeqno) {
+    const auto it = std::lower_bound(
+            seqnoIndex.begin(),
+            seqnoIndex.end(),
+            bySeqno,
+            [](const auto& entry, int64_t seqno) {
+                return entry.first < seqno;
+            });
+    if (it != seqnoIndex.end() && it->first == bySeqno) {
+        seqnoIndex.erase(it);
+    }
+}
+
 int64_t Checkpoint::getMutationId(const CheckpointCursor& cursor) const {
     if ((*cursor.currentPos)->isCheckPointMetaItem()) {
         auto cursor_item_idx =
@@ -574,7 +617,8 @@ std::ostream& operator <<(std::ostream& os, const Checkpoint& c) {
        << " numCursors:" << c.getNumCursorsInCheckpoint()
        << " type:" << to_string(c.getCheckpointType())
        << " hcs:" << c.getHighCompletedSeqno() << " items:[" << std::endl;
-    for (const auto& e : c.toWrite) {
+    for (auto itr = c.begin(); itr != c.end(); ++itr) {
+        const auto& e = *itr;
         os << "\t{" << e->getBySeqno() << "," << to_string(e->getOperation());
         e->isDeleted() ? os << "[d]," : os << ",";
         os << e->getKey() << "," << e->size() << ",";
@@ -19,6 +19,7 @@
 
 #include "checkpoint_iterator.h"
 #include "checkpoint_types.h"
+#include "chunked_queue.h"
 #include "ep_types.h"
 #include "item.h"
 #include "monotonic.h"
@@ -29,7 +30,7 @@
 #include <platform/non_negative_counter.h>
 #include <utilities/memory_tracking_allocator.h>
 
-#include <list>
+#include <deque>
 #include <map>
 #include <set>
 #include <unordered_map>
@@ -57,11 +58,14 @@ enum checkpoint_state {
 
 const char* to_string(enum checkpoint_state);
 
-// List is used for queueing mutations as vector incurs shift operations for
-// de-duplication.  We template the list on a queued_item and our own
+// A chunked queue is used for queueing mutations. It has the stable
+// iterators of a list (which the cursors and the keyIndex rely on), but
+// de-duplication leaves a hole in the queue instead of shifting the
+// elements, and the items are stored in contiguous blocks instead of one
+// heap node per item. We template the queue on a queued_item and our own
 // memory allocator which allows memory usage to be tracked.
-typedef std::list<queued_item, MemoryTrackingAllocator<queued_item>>
-        CheckpointQueue;
+using CheckpointQueue =
+        ChunkedQueue<queued_item, MemoryTrackingAllocator<queued_item>>;
 
 // Iterator for the Checkpoint queue.  The iterator is templated on the
 // queue type (CheckpointQueue).
@@ -604,6 +608,14 @@ public:
                                   ChkptQueueIterator::Position::end);
     }
 
+    /**
+     * Returns an iterator to search the queue for the given seqno from:
+     * the last item in the seqno index with a seqno not greater than bySeqno,
+     * or begin() if there is none. Every item between begin() and the
+     * returned position has a seqno not greater than bySeqno.
+     */
+    ChkptQueueIterator seekBySeqno(uint64_t bySeqno) const;
+
     /**
      * Returns the memory held by the checkpoint, which is the sum of the
      * memory used by all items held in the checkpoint plus the checkpoint
@@ -692,6 +704,12 @@ private:
      */
     int64_t getMutationId(const CheckpointCursor& item) const;
 
+    /// Remove the seqno index entry of the item with the given seqno, if any
+    void removeFromSeqnoIndex(int64_t bySeqno);
+
+    /// A seqno index entry is added for every this many non-meta items
+    static const size_t seqnoIndexInterval = 64;
+
     EPStats& stats;
     uint64_t                       checkpointId;
     uint64_t                       snapStartSeqno;
@@ -722,6 +740,16 @@ private:
     /* Index for meta keys like "dummy_key" */
     meta_checkpoint_index metaKeyIndex;
 
+    /**
+     * Sparse index of toWrite by seqno, for registering cursors at a seqno
+     * without walking the queue: the position of every seqnoIndexInterval'th
+     * non-meta item queued, in seqno order. An entry is removed as soon as
+     * its item is de-duplicated or expelled, so the positions remain valid.
+     */
+    std::deque<std::pair<int64_t, CheckpointQueue::iterator>> seqnoIndex;
+    /// Non-meta items queued since the last seqnoIndex entry
+    size_t itemsSinceSeqnoIndexed = 0;
+
     // Record the memory overhead of maintaining the keyIndex and metaKeyIndex.
     // This includes each item's key size and sizeof(index_entry).
     cb::NonNegativeCounter<size_t> keyIndexMemUsage;
@@ -64,6 +64,11 @@ public:
         }
     }
 
+    /// Construct an iterator at the given (non-null) element of c.
+    CheckpointIterator(std::reference_wrapper<C> c, underlying_iterator i)
+        : container(c), iter(i) {
+    }
+
     auto operator++() {
         moveForward();
 
@@ -286,11 +286,9 @@ CursorRegResult CheckpointManager::registerCursorBySeqno_UNLOCKED(
 
     // If cursor exists with the same name as the one being created, then
     // remove it.
-    for (const auto& cursor : cursors) {
-        if (cursor.first == name) {
-            removeCursor_UNLOCKED(cursor.second.get());
-            break;
-        }
+    const auto existing = cursors.find(name);
+    if (existing != cursors.end()) {
+        removeCursor_UNLOCKED(existing->second.get());
     }
 
     CursorRegResult result;
@@ -315,8 +313,9 @@ CursorRegResult CheckpointManager::registerCursorBySeqno_UNLOCKED(
             break;
         } else if (startBySeqno <= en) {
             // Requested sequence number lies within this checkpoint.
-            // Calculate which item to position the cursor at.
-            ChkptQueueIterator iitr = (*itr)->begin();
+            // Calculate which item to position the cursor at, skipping
+            // ahead using the checkpoint's seqno index.
+            ChkptQueueIterator iitr = (*itr)->seekBySeqno(startBySeqno);
             while (++iitr != (*itr)->end() &&
                     (startBySeqno >=
                      static_cast<uint64_t>((*iitr)->getBySeqno()))) {
@@ -518,6 +517,7 @@ size_t CheckpointManager::removeClosedUnrefCheckpoints(
 CheckpointManager::ExpelResult
 CheckpointManager::expelUnreferencedCheckpointItems() {
     CheckpointQueue expelledItems;
+    size_t queueMemoryReleased{0};
     {
         LockHolder lh(queueLock);
 
@@ -606,7 +606,12 @@ CheckpointManager::expelUnreferencedCheckpointItems() {
          * queue thereby ensuring they still have a reference whilst
          * the queuelock is being held.
          */
+        const auto queueMemoryBefore =
+                oldestCheckpoint->getWriteQueueAllocatorBytes();
         expelledItems = oldestCheckpoint->expelItems(expelUpToAndIncluding);
+        queueMemoryReleased =
+                queueMemoryBefore -
+                oldestCheckpoint->getWriteQueueAllocatorBytes();
     }
 
     // If called currentCheckpoint->expelItems but did not manage to expel
@@ -622,12 +627,10 @@ CheckpointManager::expelUnreferencedCheckpointItems() {
      * This is comprised of two parts:
      * 1. Memory used by each item to be expelled.  For each item this
      *    is calculated as the sizeof(Item) + key size + value size.
-     * 2. Memory used to hold the items in the checkpoint list.
-     *    The checkpoint list will be shorter by expelledItems.size().
-     *    This saving is equal to the memory allocated by the
-     *    expelledItems list.  Note: On Windows this is not strictly
-     *    true as we allocate space for size + 1.  However as its
-     *    an estimate we do not need to adjust.
+     * 2. Memory used to hold the items in the checkpoint queue.
+     *    The queue releases the chunks which no longer hold any items,
+     *    so the saving is the reduction of the memory allocated by
+     *    the checkpoint queue.
      *
      * It is an optimistic estimate as it assumes that each queued_item
      * is not referenced by anyone else (e.g. a DCP stream) and therefore
@@ -642,8 +645,7 @@ CheckpointManager::expelUnreferencedCheckpointItems() {
     }
 
     // Part 2 of calculating the estimate (see comment above).
-    estimateOfAmountOfRecoveredMemory +=
-            *(expelledItems.get_allocator().getBytesAllocated());
+    estimateOfAmountOfRecoveredMemory += queueMemoryReleased;
 
     /*
      * We are now outside of the queueLock when the method exits,
@@ -0,0 +1,380 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+ * A queue of nullable pointer-like elements (e.g. queued_item) which stores
+ * its elements in a doubly linked list of contiguous chunks.
+ *
+ * It is used for the checkpoint queue, and provides the subset of the
+ * std::list interface needed there with the same iterator stability:
+ *
+ *  - push_back never moves existing elements, so iterators (including
+ *    end()) remain valid.
+ *  - erase() doesn't shift any elements. The element is reset to null,
+ *    which leaves a "hole" in the queue which is skipped by
+ *    CheckpointIterator (just like the de-duplicated entries it was
+ *    written to skip). A chunk is released as soon as all of its elements
+ *    are erased, so the holes can't accumulate.
+ *  - splice_front() moves a prefix of the queue into another queue, and
+ *    only invalidates iterators to the elements moved.
+ *
+ * Compared to a std::list this saves the heap allocation and the two
+ * link pointers per element, and lets cursors walk the queue within a
+ * cache-friendly block of memory. The first chunk is small (so that the
+ * many nearly empty checkpoints don't waste memory) and the chunk size
+ * doubles up to MaxChunkCapacity as the queue grows.
+ *
+ * Null elements are treated as holes: they are stored (and visited by
+ * the raw iterators) but not counted by size(), and they are dropped
+ * by splice_front().
+ */
+template <class T, class Allocator = std::allocator<T>>
+class ChunkedQueue {
+    /// The links and bookkeeping shared by the chunks and the sentinel
+    /// (which is embedded in the queue and represents end())
+    struct Links {
+        Links* next = nullptr;
+        Links* prev = nullptr;
+        /// Index of the first constructed element in the chunk
+        uint32_t first = 0;
+        /// Index one past the last constructed element in the chunk
+        uint32_t last = 0;
+        /// Number of elements the chunk may hold (0 for the sentinel)
+        uint32_t capacity = 0;
+        /// Number of non-null elements in the chunk
+        uint32_t live = 0;
+    };
+
+    struct Chunk : public Links {
+        T* slots();
+    };
+
+    /// The elements are stored immediately after the chunk header
+    static constexpr std::size_t headerSize =
+            (sizeof(Chunk) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+    using ByteAllocator = typename std::allocator_traits<
+            Allocator>::template rebind_alloc<char>;
+
+    template <bool Const>
+    class IteratorImpl {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        IteratorImpl() = default;
+
+        /// Allow conversion from iterator to const_iterator
+        template <bool C = Const, class = std::enable_if_t<C>>
+        IteratorImpl(const IteratorImpl<false>& other)
+            : chunk(other.chunk), index(other.index) {
+        }
+
+        reference operator*() const {
+            return static_cast<Chunk*>(chunk)->slots()[index];
+        }
+
+        pointer operator->() const {
+            return &operator*();
+        }
+
+        IteratorImpl& operator++() {
+            // Incrementing end() wraps around to begin() (like std::list)
+            if (chunk->capacity == 0 || ++index == chunk->last) {
+                chunk = chunk->next;
+                index = chunk->first;
+            }
+            return *this;
+        }
+
+        IteratorImpl operator++(int) {
+            auto ret = *this;
+            operator++();
+            return ret;
+        }
+
+        IteratorImpl& operator--() {
+            if (chunk->capacity == 0 || index == chunk->first) {
+                chunk = chunk->prev;
+                index = chunk->capacity == 0 ? 0 : chunk->last - 1;
+            } else {
+                --index;
+            }
+            return *this;
+        }
+
+        IteratorImpl operator--(int) {
+            auto ret = *this;
+            operator--();
+            return ret;
+        }
+
+        bool operator==(const IteratorImpl& other) const {
+            return chunk == other.chunk && index == other.index;
+        }
+
+        bool operator!=(const IteratorImpl& other) const {
+            return !operator==(other);
+        }
+
+    private:
+        friend class ChunkedQueue;
+        friend class IteratorImpl<!Const>;
+
+        IteratorImpl(Links* c, uint32_t i) : chunk(c), index(i) {
+        }
+
+        Links* chunk = nullptr;
+        uint32_t index = 0;
+    };
+
+public:
+    using value_type = T;
+    using allocator_type = Allocator;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = IteratorImpl<false>;
+    using const_iterator = IteratorImpl<true>;
+
+    /// The number of elements in the first chunk in the queue
+    static constexpr uint32_t MinChunkCapacity = 8;
+    /// The maximum number of elements in a chunk
+    static constexpr uint32_t MaxChunkCapacity = 128;
+
+    ChunkedQueue() : ChunkedQueue(Allocator()) {
+    }
+
+    explicit ChunkedQueue(const Allocator& alloc) : allocator(alloc) {
+        sentinel.next = sentinel.prev = &sentinel;
+    }
+
+    ChunkedQueue(ChunkedQueue&& other) noexcept : allocator(other.allocator) {
+        sentinel.next = sentinel.prev = &sentinel;
+        steal(other);
+    }
+
+    /// Move assignment takes over the allocator of the other queue (the
+    /// chunks was allocated (and accounted for) by that allocator)
+    ChunkedQueue& operator=(ChunkedQueue&& other) noexcept {
+        if (this != &other) {
+            clear();
+            allocator = other.allocator;
+            steal(other);
+        }
+        return *this;
+    }
+
+    ChunkedQueue(const ChunkedQueue&) = delete;
+    ChunkedQueue& operator=(const ChunkedQueue&) = delete;
+
+    ~ChunkedQueue() {
+        clear();
+    }
+
+    allocator_type get_allocator() const {
+        return allocator_type(allocator);
+    }
+
+    iterator begin() {
+        return {sentinel.next, sentinel.next->first};
+    }
+
+    iterator end() {
+        return {&sentinel, 0};
+    }
+
+    const_iterator begin() const {
+        return {sentinel.next, sentinel.next->first};
+    }
+
+    const_iterator end() const {
+        return {const_cast<Links*>(&sentinel), 0};
+    }
+
+    /// @return the number of non-null elements in the queue
+    size_type size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    void push_back(const T& value) {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+    template <class... Args>
+    reference emplace_back(Args&&... args) {
+        Links* tail = sentinel.prev;
+        if (tail == &sentinel || tail->last == tail->capacity) {
+            tail = allocateChunk(
+                    tail == &sentinel
+                            ? MinChunkCapacity
+                            : std::min(tail->capacity * 2, MaxChunkCapacity));
+        }
+        auto* chunk = static_cast<Chunk*>(tail);
+        T* slot = chunk->slots() + chunk->last;
+        new (slot) T(std::forward<Args>(args)...);
+        ++chunk->last;
+        if (slot->get() != nullptr) {
+            ++chunk->live;
+            ++count;
+        }
+        return *slot;
+    }
+
+    /**
+     * Erase the element at the given position by resetting it to null.
+     * All iterators (including the one provided) remain valid, unless
+     * it was the last non-null element in a chunk (in which case the chunk
+     * gets released).
+     *
+     * @throws std::logic_error if the element is already erased
+     */
+    void erase(const_iterator pos) {
+        auto* chunk = static_cast<Chunk*>(pos.chunk);
+        T& slot = chunk->slots()[pos.index];
+        if (slot.get() == nullptr) {
+            throw std::logic_error(
+                    "ChunkedQueue::erase: element is already erased");
+        }
+        slot = T{};
+        --chunk->live;
+        --count;
+
+        // Keep the tail around if there is room left in it as we'll
+        // most likely append to the queue soon
+        if (chunk->live == 0 &&
+            (chunk != sentinel.prev || chunk->last == chunk->capacity)) {
+            releaseChunk(chunk);
+        }
+    }
+
+    /**
+     * Move all elements before the given position to the end of the
+     * destination queue (dropping any holes) and remove them from this
+     * queue. Iterators to the remaining elements stay valid.
+     *
+     * @param dest the queue to move the elements to
+     * @param last the first element to keep in this queue
+     */
+    void splice_front(ChunkedQueue& dest, const_iterator last) {
+        while (sentinel.next != &sentinel) {
+            auto* chunk = static_cast<Chunk*>(sentinel.next);
+            const bool lastInChunk = (last.chunk == chunk);
+            const uint32_t stop = lastInChunk ? last.index : chunk->last;
+            while (chunk->first < stop) {
+                T& slot = chunk->slots()[chunk->first];
+                if (slot.get() != nullptr) {
+                    dest.push_back(std::move(slot));
+                    --chunk->live;
+                    --count;
+                }
+                slot.~T();
+                ++chunk->first;
+            }
+            if (lastInChunk) {
+                return;
+            }
+            releaseChunk(chunk);
+        }
+    }
+
+    /// Remove all elements (and release all memory) from the queue
+    void clear() {
+        while (sentinel.next != &sentinel) {
+            releaseChunk(static_cast<Chunk*>(sentinel.next));
+        }
+        count = 0;
+    }
+
+private:
+    static std::size_t chunkBytes(uint32_t capacity) {
+        return headerSize + capacity * sizeof(T);
+    }
+
+    Links* allocateChunk(uint32_t capacity) {
+        auto* chunk = new (allocator.allocate(chunkBytes(capacity))) Chunk();
+        chunk->capacity = capacity;
+        chunk->prev = sentinel.prev;
+        chunk->next = &sentinel;
+        sentinel.prev->next = chunk;
+        sentinel.prev = chunk;
+        return chunk;
+    }
+
+    /// Unlink the chunk from the queue, destroy the remaining elements in
+    /// the chunk and release the memory
+    void releaseChunk(Chunk* chunk) {
+        chunk->prev->next = chunk->next;
+        chunk->next->prev = chunk->prev;
+        for (auto ii = chunk->first; ii < chunk->last; ++ii) {
+            chunk->slots()[ii].~T();
+        }
+        count -= chunk->live;
+        const auto bytes = chunkBytes(chunk->capacity);
+        chunk->~Chunk();
+        allocator.deallocate(reinterpret_cast<char*>(chunk), bytes);
+    }
+
+    /// Take over all of the chunks from the other queue
+    void steal(ChunkedQueue& other) {
+        if (other.sentinel.next == &other.sentinel) {
+            return;
+        }
+        sentinel.next = other.sentinel.next;
+        sentinel.prev = other.sentinel.prev;
+        sentinel.next->prev = &sentinel;
+        sentinel.prev->next = &sentinel;
+        count = other.count;
+        other.sentinel.next = other.sentinel.prev = &other.sentinel;
+        other.count = 0;
+    }
+
+    ByteAllocator allocator;
+    Links sentinel;
+    size_type count = 0;
+};
+
+template <class T, class Allocator>
+T* ChunkedQueue<T, Allocator>::Chunk::slots() {
+    return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + headerSize);
+}
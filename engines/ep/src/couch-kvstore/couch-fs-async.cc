@@ -0,0 +1,394 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-fs-async.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef EP_USE_LIBURING
+#include <fcntl.h>
+#include <liburing.h>
+#include <unistd.h>
+#endif
+
+/// Reads ahead are aligned to blocks of this size (couchstore's block size)
+static const cs_off_t readAlignment = 4096;
+
+/// Larger ranges are split into reads of at most this size
+static const cs_off_t maxReadSize = 128 * 1024;
+
+struct AsyncReadOps::Ring {
+#ifdef EP_USE_LIBURING
+    explicit Ring(size_t depth) {
+        initialised = io_uring_queue_init(unsigned(depth), &ring, 0) == 0;
+    }
+
+    ~Ring() {
+        if (initialised) {
+            io_uring_queue_exit(&ring);
+        }
+    }
+
+    struct io_uring ring;
+    bool initialised = false;
+#endif
+};
+
+struct AsyncReadOps::Read {
+    Read(cs_off_t offset, size_t size)
+        : offset(offset), size(size), buffer(new char[size]) {
+    }
+
+    cs_off_t end() const {
+        return offset + cs_off_t(size);
+    }
+
+    const cs_off_t offset;
+    const size_t size;
+    std::unique_ptr<char[]> buffer;
+    /// Bytes read (or -errno), valid once complete
+    ssize_t result = 0;
+    bool complete = false;
+};
+
+struct AsyncReadOps::AsyncFile {
+    explicit AsyncFile(couch_file_handle orig_handle)
+        : orig_handle(orig_handle) {
+    }
+
+    couch_file_handle orig_handle;
+    std::string path;
+    /// Descriptor the reads ahead are issued on, opened on first use
+    int fd = -1;
+    /// Set if the file can't be read ahead (couldn't open it, or no ring)
+    bool failed = false;
+    std::unique_ptr<Ring> ring;
+    /// Reads submitted, by offset; none overlap
+    std::map<cs_off_t, std::unique_ptr<Read>> reads;
+    size_t inFlight = 0;
+};
+
+AsyncReadOps::AsyncReadOps(FileOpsInterface& ops, size_t queueDepth)
+    : wrapped_ops(ops), queueDepth(std::max(queueDepth, size_t(1))) {
+}
+
+AsyncReadOps::~AsyncReadOps() = default;
+
+bool AsyncReadOps::isSupported() {
+#ifdef EP_USE_LIBURING
+    return true;
+#else
+    return false;
+#endif
+}
+
+couch_file_handle AsyncReadOps::constructor(couchstore_error_info_t* errinfo) {
+    auto* file = new AsyncFile(wrapped_ops.constructor(errinfo));
+    return reinterpret_cast<couch_file_handle>(file);
+}
+
+couchstore_error_t AsyncReadOps::open(couchstore_error_info_t* errinfo,
+                                      couch_file_handle* h,
+                                      const char* path,
+                                      int flags) {
+    auto* file = reinterpret_cast<AsyncFile*>(*h);
+    file->path = path;
+    file->failed = false;
+    return wrapped_ops.open(errinfo, &file->orig_handle, path, flags);
+}
+
+couchstore_error_t AsyncReadOps::close(couchstore_error_info_t* errinfo,
+                                       couch_file_handle h) {
+    auto* file = reinterpret_cast<AsyncFile*>(h);
+    drain(*file);
+    if (file->ring) {
+        releaseRing(std::move(file->ring));
+    }
+#ifdef EP_USE_LIBURING
+    if (file->fd != -1) {
+        ::close(file->fd);
+        file->fd = -1;
+    }
+#endif
+    return wrapped_ops.close(errinfo, file->orig_handle);
+}
+
+couchstore_error_t AsyncReadOps::set_periodic_sync(couch_file_handle h,
+                                                   uint64_t period_bytes) {
+    auto* file = reinterpret_cast<AsyncFile*>(h);
+    return wrapped_ops.set_periodic_sync(file->orig_handle, period_bytes);
+}
+
+couchstore_error_t AsyncReadOps::set_tracing_enabled(couch_file_handle h) {
+    auto* file = reinterpret_cast<AsyncFile*>(h);
+    return wrapped_ops.set_tracing_enabled(file->orig_handle);
+}
+
+couchstore_error_t AsyncReadOps::set_write_validation_enabled(
+        couch_file_handle h) {
+    auto* file = reinterpret_cast<AsyncFile*>(h);
+    return wrapped_ops.set_write_validation_enabled(file->orig_handle);
+}
+
+couchstore_error_t AsyncReadOps::set_mprotect_enabled(couch_file_handle h) {
+    auto* file = reinterpret_cast<AsyncFile*>(h);
+    return wrapped_ops.set_mprotect_enabled(file->orig_handle);
+}
+
+ssize_t AsyncReadOps::pread(couchstore_error_info_t* errinfo,
+                            couch_file_handle h,
+                            void* buf,
+                            size_t sz,
+                            cs_off_t off) {
+    auto& file = *reinterpret_cast<AsyncFile*>(h);
+    auto it = file.reads.upper_bound(off);
+    if (it != file.reads.begin()) {
+        --it;
+        auto& read = *it->second;
+        const cs_off_t end = off + cs_off_t(sz);
+        if (end <= read.end()) {
+            while (!read.complete && reap(file, true)) {
+            }
+            if (read.complete && read.result >= end - read.offset) {
+                std::memcpy(buf, read.buffer.get() + (off - read.offset), sz);
+                ++readsServed;
+                // Reads are consumed moving forward through the file; the
+                // completed reads before this one won't be needed again.
+                while (file.reads.begin() != it &&
+                       file.reads.begin()->second->complete) {
+                    file.reads.erase(file.reads.begin());
+                }
+                return ssize_t(sz);
+            }
+            // Failed or short (EOF) - let the wrapped ops report it
+        }
+    }
+    return wrapped_ops.pread(errinfo, file.orig_handle, buf, sz, off);
+}
+
+ssize_t AsyncReadOps::pwrite(couchstore_error_info_t* errinfo,
+                             couch_file_handle h,
+                             const void* buf,
+                             size_t sz,
+                             cs_off_t off) {
+    auto* file = reinterpret_cast<AsyncFile*>(h);
+    // Couchstore only appends, but don't risk serving stale data
+    if (!file->reads.empty()) {
+        drain(*file);
+    }
+    return wrapped_ops.pwrite(errinfo, file->orig_handle, buf, sz, off);
+}
+
+cs_off_t AsyncReadOps::goto_eof(couchstore_error_info_t* errinfo,
+                                couch_file_handle h) {
+    auto* file = reinterpret_cast<AsyncFile*>(h);
+    return wrapped_ops.goto_eof(errinfo, file->orig_handle);
+}
+
+couchstore_error_t AsyncReadOps::sync(couchstore_error_info_t* errinfo,
+                                      couch_file_handle h) {
+    auto* file = reinterpret_cast<AsyncFile*>(h);
+    return wrapped_ops.sync(errinfo, file->orig_handle);
+}
+
+couchstore_error_t AsyncReadOps::advise(couchstore_error_info_t* errinfo,
+                                        couch_file_handle h,
+                                        cs_off_t offs,
+                                        cs_off_t len,
+                                        couchstore_file_advice_t adv) {
+    auto* file = reinterpret_cast<AsyncFile*>(h);
+    if (adv == COUCHSTORE_FILE_ADVICE_WILLNEED && isSupported() &&
+        !file->failed) {
+        submit(*file, offs, len);
+        if (!file->failed) {
+            return COUCHSTORE_SUCCESS;
+        }
+    }
+    return wrapped_ops.advise(errinfo, file->orig_handle, offs, len, adv);
+}
+
+FileOpsInterface::FHStats* AsyncReadOps::get_stats(couch_file_handle h) {
+    auto* file = reinterpret_cast<AsyncFile*>(h);
+    return wrapped_ops.get_stats(file->orig_handle);
+}
+
+void AsyncReadOps::destructor(couch_file_handle h) {
+    auto* file = reinterpret_cast<AsyncFile*>(h);
+    drain(*file);
+    if (file->ring) {
+        releaseRing(std::move(file->ring));
+    }
+#ifdef EP_USE_LIBURING
+    if (file->fd != -1) {
+        ::close(file->fd);
+    }
+#endif
+    wrapped_ops.destructor(file->orig_handle);
+    delete file;
+}
+
+void AsyncReadOps::submit(AsyncFile& file, cs_off_t offset, cs_off_t len) {
+#ifdef EP_USE_LIBURING
+    if (!file.ring) {
+        if (file.fd == -1) {
+            file.fd = ::open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+        }
+        if (file.fd != -1) {
+            file.ring = acquireRing();
+        }
+        if (!file.ring) {
+            file.failed = true;
+            return;
+        }
+    }
+    auto* ring = &file.ring->ring;
+
+    cs_off_t start = offset - (offset % readAlignment);
+    const cs_off_t end =
+            ((offset + len + readAlignment - 1) / readAlignment) *
+            readAlignment;
+    bool pending = false;
+    while (start < end) {
+        // Skip anything an earlier read already covers
+        auto next = file.reads.upper_bound(start);
+        if (next != file.reads.begin()) {
+            const auto prevEnd = std::prev(next)->second->end();
+            if (prevEnd > start) {
+                start = prevEnd;
+                continue;
+            }
+        }
+        cs_off_t readEnd = std::min(end, start + maxReadSize);
+        if (next != file.reads.end()) {
+            readEnd = std::min(readEnd, next->first);
+        }
+
+        // Bound the memory held by reads not consumed yet; couchstore is
+        // still to read them, so leave the rest of the range to be read
+        // synchronously rather than drop any of them
+        if (file.reads.size() >= 2 * queueDepth) {
+            break;
+        }
+        // Wait for a read to complete if the queue is full
+        while (file.inFlight >= queueDepth) {
+            if (pending) {
+                io_uring_submit(ring);
+                pending = false;
+            }
+            if (!reap(file, true)) {
+                return;
+            }
+        }
+
+        auto* sqe = io_uring_get_sqe(ring);
+        if (sqe == nullptr) {
+            break;
+        }
+        auto read = std::make_unique<Read>(start, size_t(readEnd - start));
+        io_uring_prep_read(sqe,
+                           file.fd,
+                           read->buffer.get(),
+                           unsigned(read->size),
+                           uint64_t(start));
+        io_uring_sqe_set_data(sqe, read.get());
+        file.reads.emplace(start, std::move(read));
+        ++file.inFlight;
+        ++readsSubmitted;
+        pending = true;
+        start = readEnd;
+    }
+    if (pending) {
+        io_uring_submit(ring);
+    }
+#else
+    (void)file;
+    (void)offset;
+    (void)len;
+#endif
+}
+
+bool AsyncReadOps::reap(AsyncFile& file, bool wait) {
+#ifdef EP_USE_LIBURING
+    if (file.inFlight == 0) {
+        return false;
+    }
+    auto* ring = &file.ring->ring;
+    struct io_uring_cqe* cqe = nullptr;
+    int rv;
+    do {
+        rv = wait ? io_uring_wait_cqe(ring, &cqe)
+                  : io_uring_peek_cqe(ring, &cqe);
+    } while (rv == -EINTR);
+    if (rv < 0 || cqe == nullptr) {
+        return false;
+    }
+    auto* read = static_cast<Read*>(io_uring_cqe_get_data(cqe));
+    read->result = cqe->res;
+    read->complete = true;
+    io_uring_cqe_seen(ring, cqe);
+    --file.inFlight;
+    return true;
+#else
+    (void)file;
+    (void)wait;
+    return false;
+#endif
+}
+
+void AsyncReadOps::drain(AsyncFile& file) {
+    while (file.inFlight > 0 && reap(file, true)) {
+    }
+    if (file.inFlight > 0) {
+        // The ring failed with reads still in flight; the kernel may still
+        // write to their buffers, so leak them (and the ring) rather than
+        // free them.
+        for (auto& read : file.reads) {
+            if (!read.second->complete) {
+                read.second->buffer.release();
+            }
+        }
+        file.ring.release();
+        file.inFlight = 0;
+        file.failed = true;
+    }
+    file.reads.clear();
+}
+
+std::unique_ptr<AsyncReadOps::Ring> AsyncReadOps::acquireRing() {
+    {
+        std::lock_guard<std::mutex> lh(ringsMutex);
+        if (!rings.empty()) {
+            auto ring = std::move(rings.back());
+            rings.pop_back();
+            return ring;
+        }
+    }
+#ifdef EP_USE_LIBURING
+    auto ring = std::make_unique<Ring>(queueDepth);
+    if (ring->initialised) {
+        return ring;
+    }
+#endif
+    return {};
+}
+
+void AsyncReadOps::releaseRing(std::unique_ptr<Ring> ring) {
+    std::lock_guard<std::mutex> lh(ringsMutex);
+    rings.push_back(std::move(ring));
+}
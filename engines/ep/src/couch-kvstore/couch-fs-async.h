@@ -0,0 +1,144 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <libcouchstore/couch_db.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * FileOpsInterface implementation which keeps many reads of a file in
+ * flight, using io_uring.
+ *
+ * Couchstore reads synchronously, one pread at a time, so on its own a
+ * reader thread has a single read outstanding. Reads known to be coming
+ * are instead announced with advise(COUCHSTORE_FILE_ADVICE_WILLNEED) - as
+ * getMulti does for a window of the next documents of a bgfetch batch, and
+ * StatsOps does for the window it reads ahead of bgfetches, backfills and
+ * warmup - and are submitted to the file's ring without waiting. The preads
+ * couchstore issues later are served from the completed reads (waiting for
+ * them if still in flight), falling back to the wrapped ops for anything not
+ * announced, or announced while too many reads weren't consumed yet.
+ *
+ * Each open file takes a ring from a pool when it first reads ahead, and
+ * returns it when closed; a file (and so its ring) is only used by one
+ * thread at a time, but may move between threads (e.g. a backfill resumed
+ * on another AuxIO thread).
+ *
+ * Only available if ep-engine was built with liburing (EP_USE_LIBURING),
+ * otherwise advise() is passed to the wrapped ops (and the OS reads ahead).
+ */
+class AsyncReadOps : public FileOpsInterface {
+public:
+    /**
+     * @param ops The FileOps to wrap
+     * @param queueDepth Max number of reads in flight per file
+     */
+    AsyncReadOps(FileOpsInterface& ops, size_t queueDepth);
+
+    ~AsyncReadOps() override;
+
+    /// @return true if ep-engine was built with io_uring support
+    static bool isSupported();
+
+    couch_file_handle constructor(couchstore_error_info_t* errinfo) override;
+    couchstore_error_t open(couchstore_error_info_t* errinfo,
+                            couch_file_handle* handle,
+                            const char* path,
+                            int oflag) override;
+    couchstore_error_t close(couchstore_error_info_t* errinfo,
+                             couch_file_handle handle) override;
+    couchstore_error_t set_periodic_sync(couch_file_handle handle,
+                                         uint64_t period_bytes) override;
+    couchstore_error_t set_tracing_enabled(couch_file_handle handle) override;
+    couchstore_error_t set_write_validation_enabled(
+            couch_file_handle handle) override;
+    couchstore_error_t set_mprotect_enabled(couch_file_handle handle) override;
+
+    ssize_t pread(couchstore_error_info_t* errinfo,
+                  couch_file_handle handle,
+                  void* buf,
+                  size_t nbytes,
+                  cs_off_t offset) override;
+    ssize_t pwrite(couchstore_error_info_t* errinfo,
+                   couch_file_handle handle,
+                   const void* buf,
+                   size_t nbytes,
+                   cs_off_t offset) override;
+    cs_off_t goto_eof(couchstore_error_info_t* errinfo,
+                      couch_file_handle handle) override;
+    couchstore_error_t sync(couchstore_error_info_t* errinfo,
+                            couch_file_handle handle) override;
+    couchstore_error_t advise(couchstore_error_info_t* errinfo,
+                              couch_file_handle handle,
+                              cs_off_t offset,
+                              cs_off_t len,
+                              couchstore_file_advice_t advice) override;
+    FHStats* get_stats(couch_file_handle handle) override;
+    void destructor(couch_file_handle handle) override;
+
+    /// Max number of reads in flight per file
+    size_t getQueueDepth() const {
+        return queueDepth;
+    }
+
+    /// Number of reads submitted ahead of couchstore
+    size_t getReadsSubmitted() const {
+        return readsSubmitted;
+    }
+
+    /// Number of preads served from reads submitted ahead
+    size_t getReadsServed() const {
+        return readsServed;
+    }
+
+protected:
+    struct Ring;
+    struct AsyncFile;
+    struct Read;
+
+    /**
+     * Submit reads of [offset, offset + len) not already submitted. Stops
+     * early (leaving the rest to be read synchronously) once the file holds
+     * too many reads not consumed yet; those are never dropped to make room.
+     */
+    void submit(AsyncFile& file, cs_off_t offset, cs_off_t len);
+
+    /// Reap a completed read, waiting for one if wait is set
+    bool reap(AsyncFile& file, bool wait);
+
+    /// Wait for all the reads in flight and discard all the reads
+    void drain(AsyncFile& file);
+
+    std::unique_ptr<Ring> acquireRing();
+    void releaseRing(std::unique_ptr<Ring> ring);
+
+    FileOpsInterface& wrapped_ops;
+    const size_t queueDepth;
+
+    std::mutex ringsMutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    std::atomic<size_t> readsSubmitted{0};
+    std::atomic<size_t> readsServed{0};
+};
@@ -0,0 +1,158 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-fs-group-sync.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef EP_USE_LIBURING
+#include <liburing.h>
+#endif
+
+/// Max syncs submitted to the ring at once
+static const size_t maxBatchSize = 256;
+
+GroupSync::~GroupSync() {
+#ifndef WIN32
+    for (auto fd : fds) {
+        ::close(fd);
+    }
+#endif
+}
+
+bool GroupSync::isSupported() {
+#ifdef EP_USE_LIBURING
+    // The kernel may not support io_uring (or it may be disabled)
+    static const bool supported = []() {
+        struct io_uring ring;
+        if (io_uring_queue_init(1, &ring, 0) != 0) {
+            return false;
+        }
+        io_uring_queue_exit(&ring);
+        return true;
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+bool GroupSync::add(const std::string& path) {
+#ifndef WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    fds.push_back(fd);
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+bool GroupSync::sync() {
+    if (fds.empty()) {
+        return true;
+    }
+    bool success = true;
+    if (!syncBatch(success)) {
+        success = syncEach();
+    }
+#ifndef WIN32
+    for (auto fd : fds) {
+        ::close(fd);
+    }
+#endif
+    fds.clear();
+    return success;
+}
+
+bool GroupSync::syncEach() {
+    bool success = true;
+#ifndef WIN32
+    for (auto fd : fds) {
+#ifdef __linux__
+        const int rv = ::fdatasync(fd);
+#else
+        const int rv = ::fsync(fd);
+#endif
+        if (rv != 0) {
+            success = false;
+        }
+    }
+#endif
+    return success;
+}
+
+bool GroupSync::syncBatch(bool& success) {
+#ifdef EP_USE_LIBURING
+    struct io_uring ring;
+    const auto depth = std::min(fds.size(), maxBatchSize);
+    if (io_uring_queue_init(unsigned(depth), &ring, 0) != 0) {
+        return false;
+    }
+
+    success = true;
+    size_t next = 0;
+    size_t inFlight = 0;
+    while (next < fds.size() || inFlight > 0) {
+        bool submitted = false;
+        while (next < fds.size() && inFlight < depth) {
+            auto* sqe = io_uring_get_sqe(&ring);
+            if (sqe == nullptr) {
+                break;
+            }
+            io_uring_prep_fsync(sqe, fds[next], IORING_FSYNC_DATASYNC);
+            ++next;
+            ++inFlight;
+            submitted = true;
+        }
+        if (submitted && io_uring_submit(&ring) < 0) {
+            // Nothing we submitted can be relied on; sync every file
+            io_uring_queue_exit(&ring);
+            return false;
+        }
+
+        struct io_uring_cqe* cqe = nullptr;
+        int rv;
+        do {
+            rv = io_uring_wait_cqe(&ring, &cqe);
+        } while (rv == -EINTR);
+        if (rv < 0) {
+            io_uring_queue_exit(&ring);
+            return false;
+        }
+        if (cqe->res < 0) {
+            success = false;
+        }
+        io_uring_cqe_seen(&ring, cqe);
+        --inFlight;
+    }
+    io_uring_queue_exit(&ring);
+    return true;
+#else
+    (void)success;
+    return false;
+#endif
+}
@@ -0,0 +1,76 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * The files of a commit group (see KVStore::openCommitGroup()) whose final
+ * sync has been deferred by StatsOps, to be synced together.
+ *
+ * Each file is re-opened when it's added, so that couchstore can close its
+ * own handle as usual; an fdatasync of any descriptor of a file makes all
+ * its written data durable. The syncs of the group are submitted to the
+ * kernel in one io_uring batch, letting the filesystem share journal commits
+ * and device cache flushes between them. (If the ring fails at runtime the
+ * files are synced one after the other, so they are durable regardless.)
+ */
+class GroupSync {
+public:
+    GroupSync() = default;
+
+    GroupSync(const GroupSync&) = delete;
+    GroupSync& operator=(const GroupSync&) = delete;
+
+    virtual ~GroupSync();
+
+    /**
+     * @return true if the syncs of a group can be batched: ep-engine was
+     *         built with liburing (EP_USE_LIBURING) and the kernel supports
+     *         io_uring
+     */
+    static bool isSupported();
+
+    /**
+     * Add a file to sync.
+     * @return false if the file couldn't be opened, in which case the caller
+     *         must sync it itself
+     */
+    bool add(const std::string& path);
+
+    /**
+     * Sync all the files added since the last sync.
+     * @return false if any of the syncs failed
+     */
+    virtual bool sync();
+
+    /// @return the number of files waiting to be synced
+    size_t size() const {
+        return fds.size();
+    }
+
+private:
+    /// Sync the files one after the other
+    bool syncEach();
+
+    /// Submit the syncs as one batch, @return false if io_uring failed
+    bool syncBatch(bool& success);
+
+    std::vector<int> fds;
+};
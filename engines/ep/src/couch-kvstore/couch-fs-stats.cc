@@ -17,12 +17,19 @@
 
 #include "couch-kvstore/couch-fs-stats.h"
 #include "common.h"
+#include "couch-kvstore/couch-fs-group-sync.h"
 #include "kvstore.h"
 #include <platform/histogram.h>
 
+#include <algorithm>
+
+/// Smallest window read ahead once reads step forward through a file
+static const size_t minReadAhead = 16 * 1024;
+
 std::unique_ptr<FileOpsInterface> getCouchstoreStatsOps(
-    FileStats& stats, FileOpsInterface& base_ops) {
-    return std::unique_ptr<FileOpsInterface>(new StatsOps(stats, base_ops));
+        FileStats& stats, FileOpsInterface& base_ops, size_t readAheadMax) {
+    return std::unique_ptr<FileOpsInterface>(
+            new StatsOps(stats, base_ops, readAheadMax));
 }
 
 StatsOps::StatFile::StatFile(FileOpsInterface* _orig_ops,
@@ -33,7 +40,11 @@ StatsOps::StatFile::StatFile(FileOpsInterface* _orig_ops,
       last_offs(_last_offs),
       read_count_since_open(0),
       write_count_since_open(0),
-      write_bytes_since_open(0) {
+      write_bytes_since_open(0),
+      readahead_end(0),
+      readahead_window(0),
+      group_sync(nullptr),
+      sync_deferred(false) {
 }
 
 size_t StatsOps::StatFile::getReadCount() {
@@ -64,6 +75,11 @@ couchstore_error_t StatsOps::open(couchstore_error_info_t* errinfo,
     sf->read_count_since_open = 0;
     sf->write_count_since_open = 0;
     sf->write_bytes_since_open = 0;
+    sf->readahead_end = 0;
+    sf->readahead_window = 0;
+    sf->path = path;
+    sf->group_sync = nullptr;
+    sf->sync_deferred = false;
     return sf->orig_ops->open(errinfo, &sf->orig_handle, path, flags);
 }
 
@@ -80,6 +96,20 @@ couchstore_error_t StatsOps::close(couchstore_error_info_t* errinfo,
         stats.writeCountHisto.add(sf->write_count_since_open);
     }
 
+    if (sf->sync_deferred) {
+        // Leave the sync to the group, unless the group can't take the file
+        if (sf->group_sync->add(sf->path)) {
+            sf->sync_deferred = false;
+        } else {
+            const auto errcode = syncDeferred(errinfo, sf);
+            if (errcode != COUCHSTORE_SUCCESS) {
+                sf->orig_ops->close(errinfo, sf->orig_handle);
+                return errcode;
+            }
+        }
+    }
+    sf->group_sync = nullptr;
+
     return sf->orig_ops->close(errinfo, sf->orig_handle);
 }
 
@@ -112,6 +142,9 @@ ssize_t StatsOps::pread(couchstore_error_info_t* errinfo,
     if(sf->last_offs) {
         stats.readSeekHisto.add(std::abs(off - sf->last_offs));
     }
+    if (readAheadMax) {
+        maybeReadAhead(sf, sz, off);
+    }
     sf->last_offs = off;
     HdrMicroSecBlockTimer bt(&stats.readTimeHisto);
     ssize_t result = sf->orig_ops->pread(errinfo, sf->orig_handle, buf,
@@ -129,6 +162,10 @@ ssize_t StatsOps::pwrite(couchstore_error_info_t*errinfo,
                          size_t sz,
                          cs_off_t off) {
     StatFile* sf = reinterpret_cast<StatFile*>(h);
+    const auto errcode = syncDeferred(errinfo, sf);
+    if (errcode != COUCHSTORE_SUCCESS) {
+        return errcode;
+    }
     stats.writeSizeHisto.add(sz);
     HdrMicroSecBlockTimer bt(&stats.writeTimeHisto);
     ssize_t result = sf->orig_ops->pwrite(errinfo, sf->orig_handle, buf,
@@ -150,6 +187,20 @@ cs_off_t StatsOps::goto_eof(couchstore_error_info_t* errinfo,
 couchstore_error_t StatsOps::sync(couchstore_error_info_t* errinfo,
                                   couch_file_handle h) {
     StatFile* sf = reinterpret_cast<StatFile*>(h);
+    if (sf->group_sync) {
+        sf->sync_deferred = true;
+        return COUCHSTORE_SUCCESS;
+    }
+    HdrMicroSecBlockTimer bt(&stats.syncTimeHisto);
+    return sf->orig_ops->sync(errinfo, sf->orig_handle);
+}
+
+couchstore_error_t StatsOps::syncDeferred(couchstore_error_info_t* errinfo,
+                                          StatFile* sf) {
+    if (!sf->sync_deferred) {
+        return COUCHSTORE_SUCCESS;
+    }
+    sf->sync_deferred = false;
     HdrMicroSecBlockTimer bt(&stats.syncTimeHisto);
     return sf->orig_ops->sync(errinfo, sf->orig_handle);
 }
@@ -163,6 +214,51 @@ couchstore_error_t StatsOps::advise(couchstore_error_info_t* errinfo,
     return sf->orig_ops->advise(errinfo, sf->orig_handle, offs, len, adv);
 }
 
+void StatsOps::maybeReadAhead(StatFile* sf, size_t sz, cs_off_t off) {
+    const cs_off_t end = off + sz;
+    if (end <= sf->readahead_end) {
+        // Already read ahead
+        return;
+    }
+    if (sf->last_offs == 0 || off < sf->last_offs ||
+        size_t(off - sf->last_offs) > readAheadMax) {
+        sf->readahead_window = 0;
+        return;
+    }
+
+    sf->readahead_window = std::min(
+            std::max(sf->readahead_window * 2, minReadAhead), readAheadMax);
+    // Only a hint - a failure doesn't affect the read itself
+    couchstore_error_info_t errinfo;
+    sf->orig_ops->advise(&errinfo,
+                         sf->orig_handle,
+                         end,
+                         sf->readahead_window,
+                         COUCHSTORE_FILE_ADVICE_WILLNEED);
+    sf->readahead_end = end + sf->readahead_window;
+}
+
+void StatsOps::willNeed(FHStats* stats, cs_off_t offset, cs_off_t len) {
+    auto* sf = dynamic_cast<StatFile*>(stats);
+    if (sf == nullptr) {
+        return;
+    }
+    couchstore_error_info_t errinfo;
+    sf->orig_ops->advise(&errinfo,
+                         sf->orig_handle,
+                         offset,
+                         len,
+                         COUCHSTORE_FILE_ADVICE_WILLNEED);
+}
+
+void StatsOps::deferSyncs(FHStats* stats, GroupSync& group) {
+    auto* sf = dynamic_cast<StatFile*>(stats);
+    if (sf == nullptr) {
+        return;
+    }
+    sf->group_sync = &group;
+}
+
 FileOpsInterface::FHStats* StatsOps::get_stats(couch_file_handle h) {
     // StatFile implements FHStats interface directly.
     StatFile* sf = reinterpret_cast<StatFile*>(h);
@@ -19,27 +19,37 @@
 
 #include <atomic>
 #include <memory>
+#include <string>
 
 #include <libcouchstore/couch_db.h>
 
 struct FileStats;
+class GroupSync;
 
 /**
  * Returns an instance of StatsOps from a FileStats reference and
  * a reference to a base FileOps implementation to wrap
  */
 std::unique_ptr<FileOpsInterface> getCouchstoreStatsOps(
-    FileStats& stats, FileOpsInterface& base_ops);
+        FileStats& stats, FileOpsInterface& base_ops, size_t readAheadMax = 0);
 
 /**
  * FileOpsInterface implementation which records various statistics
  * about OS-level file operations performed by Couchstore.
+ *
+ * Optionally it also reads ahead of reads which move forward through a file
+ * in small steps (such as the reads of a bgfetch batch sorted by offset, or
+ * of a scan), by advising the wrapped ops that the bytes which follow will
+ * be needed. The window doubles while the reads stay close to each other,
+ * up to readAheadMax, and is reset by a read which seeks backwards or far
+ * ahead. The OS (or AsyncReadOps) can then read the following documents in
+ * the background while the current one is processed.
  */
 class StatsOps : public FileOpsInterface {
 public:
-    StatsOps(FileStats& _stats, FileOpsInterface& ops)
-        : stats(_stats),
-          wrapped_ops(ops) {}
+    StatsOps(FileStats& _stats, FileOpsInterface& ops, size_t readAheadMax = 0)
+        : stats(_stats), wrapped_ops(ops), readAheadMax(readAheadMax) {
+    }
 
     couch_file_handle constructor(couchstore_error_info_t* errinfo) override ;
     couchstore_error_t open(couchstore_error_info_t* errinfo,
@@ -71,9 +81,42 @@ public:
     FHStats* get_stats(couch_file_handle handle) override;
     void destructor(couch_file_handle handle) override;
 
+    /**
+     * Advise the ops wrapped by StatsOps that [offset, offset + len) of a
+     * file will be read soon (see AsyncReadOps).
+     *
+     * @param stats The stats of the file (couchstore_get_db_filestats()); no
+     *        effect unless the file was opened with StatsOps
+     */
+    static void willNeed(FHStats* stats, cs_off_t offset, cs_off_t len);
+
+    /**
+     * Defer the syncs of a file to a commit group. A deferred sync is only
+     * performed before the next write to the file, which keeps the order
+     * couchstore relies on (the data of a commit is durable before its
+     * header is written); the last sync before the file is closed - the one
+     * making the header durable - is instead left to the group.
+     *
+     * @param stats The stats of the file (couchstore_get_db_filestats()); no
+     *        effect unless the file was opened with StatsOps
+     * @param group The group to add the file to when it's closed
+     */
+    static void deferSyncs(FHStats* stats, GroupSync& group);
+
 protected:
+    struct StatFile;
+
+    /// Perform the sync deferred on the file, if any
+    couchstore_error_t syncDeferred(couchstore_error_info_t* errinfo,
+                                    StatFile* sf);
+
+    /// Advise the OS of the bytes following a read, if it's a forward step
+    void maybeReadAhead(StatFile* sf, size_t sz, cs_off_t off);
+
     FileStats& stats;
     FileOpsInterface& wrapped_ops;
+    /// Max bytes to read ahead, zero if read-ahead is disabled
+    const size_t readAheadMax;
 
     struct StatFile : public FileOpsInterface::FHStats {
         StatFile(FileOpsInterface* _orig_ops,
@@ -94,5 +137,16 @@ protected:
         size_t write_count_since_open;
         /// Count of bytes written to this file since it was last opened.
         size_t write_bytes_since_open;
+        /// End of the range last advised to be read ahead.
+        cs_off_t readahead_end;
+        /// Current read-ahead window, zero until reads step forward.
+        size_t readahead_window;
+
+        /// Path the file was opened with.
+        std::string path;
+        /// Group the syncs of the file are deferred to, if any.
+        GroupSync* group_sync;
+        /// Set if a sync has been deferred and not yet performed.
+        bool sync_deferred;
     };
 };
@@ -35,6 +35,7 @@
 #include <platform/compress.h>
 #include <platform/dirutils.h>
 #include <gsl/gsl>
+#include <algorithm>
 #include <shared_mutex>
 
 extern "C" {
@@ -211,6 +212,8 @@ struct GetMultiCbCtx {
     CouchKVStore &cks;
     Vbid vbId;
     vb_bgfetch_queue_t &fetches;
+    /// DocInfos of the keys found, owned until the documents are fetched
+    std::vector<DocInfo*> docinfos;
 };
 
 struct AllKeysCtx {
@@ -331,6 +334,21 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config,
     statCollectingFileOps = getCouchstoreStatsOps(st.fsStats, base_ops);
     statCollectingFileOpsCompaction = getCouchstoreStatsOps(
         st.fsStatsCompaction, base_ops);
+    if (config.getAsyncReadQueueDepth() != 0) {
+        if (AsyncReadOps::isSupported()) {
+            asyncReadOps = std::make_unique<AsyncReadOps>(
+                    base_ops, config.getAsyncReadQueueDepth());
+        } else {
+            logger.warn(
+                    "CouchKVStore: couchstore_async_read_queue_depth is set "
+                    "but ep-engine was built without io_uring support, "
+                    "reading synchronously");
+        }
+    }
+    statCollectingFileOpsRead = getCouchstoreStatsOps(
+            st.fsStats,
+            asyncReadOps ? *asyncReadOps : base_ops,
+            config.getReadAheadMax());
 
     // init db file map with default revision number, 1
     numDbFiles = configuration.getMaxVBuckets();
@@ -557,7 +575,10 @@ void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
     int numItems = itms.size();
 
     DbHolder db(*this);
-    couchstore_error_t errCode = openDB(vb, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errCode = openDB(vb,
+                                        db,
+                                        COUCHSTORE_OPEN_FLAG_RDONLY,
+                                        statCollectingFileOpsRead.get());
     if (errCode != COUCHSTORE_SUCCESS) {
         logger.warn(
                 "CouchKVStore::getMulti: openDB error:{}, "
@@ -580,9 +601,57 @@ void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
     }
 
     GetMultiCbCtx ctx(*this, vb, itms);
+    ctx.docinfos.reserve(itms.size());
 
+    // Look up all the keys first (in key order, as laid out in the by-id
+    // B-tree), then read the documents in the order they are in the file, so
+    // the reads of a batch sweep forward through the file rather than seek
+    // back and forth in hash order.
     errCode = couchstore_docinfos_by_id(
             db, ids.data(), itms.size(), 0, getMultiCbC, &ctx);
+    std::sort(ctx.docinfos.begin(),
+              ctx.docinfos.end(),
+              [](const DocInfo* a, const DocInfo* b) { return a->bp < b->bp; });
+    // With asyncReadOps, keep the reads of the next queue depth document
+    // bodies in flight ahead of the documents being fetched (rather than
+    // the whole batch, which would hold all of its bodies in memory)
+    std::vector<const DocInfo*> bodies;
+    if (asyncReadOps) {
+        for (const auto* docinfo : ctx.docinfos) {
+            auto qitr = itms.find(makeDiskDocKey(docinfo->id));
+            if (qitr != itms.end() &&
+                qitr->second.isMetaOnly == GetMetaOnly::No) {
+                bodies.push_back(docinfo);
+            }
+        }
+    }
+    auto* fileStats = couchstore_get_db_filestats(db);
+    size_t bodiesAnnounced = 0;
+    auto announceBody = [&bodies, &bodiesAnnounced, fileStats]() {
+        if (bodiesAnnounced < bodies.size()) {
+            const auto* docinfo = bodies[bodiesAnnounced++];
+            // The body is stored with a header, and a marker every 4K
+            StatsOps::willNeed(fileStats,
+                               docinfo->bp,
+                               docinfo->size + docinfo->size / 4095 + 16);
+        }
+    };
+    const size_t window = asyncReadOps ? asyncReadOps->getQueueDepth() : 0;
+    while (bodiesAnnounced < std::min(window, bodies.size())) {
+        announceBody();
+    }
+
+    size_t bodiesFetched = 0;
+    for (auto* docinfo : ctx.docinfos) {
+        fetchMultiDoc(db, docinfo, ctx);
+        if (bodiesFetched < bodies.size() &&
+            bodies[bodiesFetched] == docinfo) {
+            ++bodiesFetched;
+            announceBody();
+        }
+        couchstore_free_docinfo(docinfo);
+    }
+
     if (errCode != COUCHSTORE_SUCCESS) {
         st.numGetFailure += numItems;
         logger.warn(
@@ -1410,6 +1479,13 @@ bool CouchKVStore::getStat(const char* name, size_t& value)  {
     } else if (strcmp("io_bg_fetch_read_count", name) == 0) {
         value = st.getMultiFsReadCount;
         return true;
+    } else if (asyncReadOps &&
+               strcmp("io_async_reads_submitted", name) == 0) {
+        value = asyncReadOps->getReadsSubmitted();
+        return true;
+    } else if (asyncReadOps && strcmp("io_async_reads_served", name) == 0) {
+        value = asyncReadOps->getReadsServed();
+        return true;
     }
 
     return false;
@@ -1450,8 +1526,10 @@ ScanContext* CouchKVStore::initScanContext(
         DocumentFilter options,
         ValueFilter valOptions) {
     DbHolder db(*this);
-    couchstore_error_t errorCode =
-            openDB(vbid, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errorCode = openDB(vbid,
+                                          db,
+                                          COUCHSTORE_OPEN_FLAG_RDONLY,
+                                          statCollectingFileOpsRead.get());
     if (errorCode != COUCHSTORE_SUCCESS) {
         logger.warn(
                 "CouchKVStore::initScanContext: openDB error:{}, "
@@ -1597,6 +1675,40 @@ scan_error_t CouchKVStore::scan(ScanContext* ctx) {
     return scan_success;
 }
 
+bool CouchKVStore::getScanItemCount(ScanContext* sctx,
+                                    uint64_t startSeqno,
+                                    uint64_t endSeqno,
+                                    uint64_t& count) {
+    if (!sctx) {
+        return false;
+    }
+
+    Db* db;
+    {
+        LockHolder lh(scanLock);
+        auto itr = scans.find(sctx->scanId);
+        if (itr == scans.end()) {
+            return false;
+        }
+        db = itr->second;
+    }
+
+    couchstore_error_t errorCode =
+            couchstore_changes_count(db, startSeqno, endSeqno, &count);
+    if (errorCode != COUCHSTORE_SUCCESS) {
+        logger.warn(
+                "CouchKVStore::getScanItemCount: couchstore_changes_count "
+                "{} start_seqno:{} end_seqno:{} error:{} [{}]",
+                sctx->vbid,
+                startSeqno,
+                endSeqno,
+                couchstore_strerror(errorCode),
+                couchkvstore_strerrno(db, errorCode));
+        return false;
+    }
+    return true;
+}
+
 void CouchKVStore::destroyScanContext(ScanContext* ctx) {
     if (!ctx) {
         return;
@@ -2090,12 +2202,69 @@ bool CouchKVStore::commit2couchstore(Collections::VB::Flush& collectionsFlush) {
                 vbucket2flush);
     }
 
-    commitCallback(pendingReqsQ, kvctx, errCode);
+    if (groupSync && success) {
+        // Only complete once the commit group is synced
+        groupedCommits.push_back({std::move(pendingReqsQ),
+                                  std::move(kvctx.keyStats),
+                                  std::move(transactionCtx)});
+    } else {
+        commitCallback(pendingReqsQ, *transactionCtx, kvctx.keyStats, errCode);
+    }
 
     pendingReqsQ.clear();
     return success;
 }
 
+bool CouchKVStore::openCommitGroup() {
+    if (isReadOnly()) {
+        throw std::logic_error(
+                "CouchKVStore::openCommitGroup: Not valid on a read-only "
+                "object.");
+    }
+    if (groupSync) {
+        throw std::logic_error(
+                "CouchKVStore::openCommitGroup: A group is already open");
+    }
+    groupSync = createGroupSync();
+    return groupSync != nullptr;
+}
+
+std::unique_ptr<GroupSync> CouchKVStore::createGroupSync() {
+    if (!GroupSync::isSupported()) {
+        return {};
+    }
+    return std::make_unique<GroupSync>();
+}
+
+void CouchKVStore::closeCommitGroup() {
+    if (!groupSync) {
+        return;
+    }
+
+    couchstore_error_t errCode = COUCHSTORE_SUCCESS;
+    {
+        TRACE_EVENT1("CouchKVStore",
+                     "closeCommitGroup",
+                     "files",
+                     groupSync->size());
+        HdrMicroSecBlockTimer timer(&st.fsStats.syncTimeHisto);
+        if (!groupSync->sync()) {
+            errCode = COUCHSTORE_ERROR_WRITE;
+            logger.warn(
+                    "CouchKVStore::closeCommitGroup: sync of the group "
+                    "failed, commits:{}",
+                    groupedCommits.size());
+        }
+    }
+    groupSync.reset();
+
+    auto commits = std::move(groupedCommits);
+    groupedCommits.clear();
+    for (auto& commit : commits) {
+        commitCallback(commit.reqs, *commit.txCtx, commit.keyStats, errCode);
+    }
+}
+
 // Callback when the btree is updated which we use for tracking create/update
 // type statistics.
 static void saveDocsCallback(const DocInfo* oldInfo,
@@ -2206,6 +2375,10 @@ couchstore_error_t CouchKVStore::saveDocs(Vbid vbid,
                                    vbid.to_string() + "] is NULL");
         }
 
+        if (groupSync) {
+            StatsOps::deferSyncs(couchstore_get_db_filestats(db), *groupSync);
+        }
+
         uint64_t maxDBSeqno = 0;
 
         // Count of logical bytes written (key + ep-engine meta + value),
@@ -2341,7 +2514,8 @@ couchstore_error_t CouchKVStore::saveDocs(Vbid vbid,
 }
 
 void CouchKVStore::commitCallback(PendingRequestQueue& committedReqs,
-                                  kvstats_ctx& kvctx,
+                                  TransactionContext& txCtx,
+                                  std::unordered_map<DiskDocKey, bool>& keyStats,
                                   couchstore_error_t errCode) {
     for (auto& committed : committedReqs) {
         const auto docLogicalSize =
@@ -2354,7 +2528,7 @@ void CouchKVStore::commitCallback(PendingRequestQueue& committedReqs,
             auto mutationStatus = getMutationStatus(errCode);
             if (mutationStatus != MutationStatus::Failed) {
                 const auto& key = committed.getKey();
-                if (kvctx.keyStats[key]) {
+                if (keyStats[key]) {
                     mutationStatus =
                             MutationStatus::Success; // Deletion is for an
                                                      // existing item on
@@ -2371,11 +2545,11 @@ void CouchKVStore::commitCallback(PendingRequestQueue& committedReqs,
             } else {
                 st.delTimeHisto.add(committed.getDelta());
             }
-            committed.getDelCallback()(*transactionCtx, mutationStatus);
+            committed.getDelCallback()(txCtx, mutationStatus);
         } else {
             auto mutationStatus = getMutationStatus(errCode);
             const auto& key = committed.getKey();
-            bool insertion = !kvctx.keyStats[key];
+            bool insertion = !keyStats[key];
             if (errCode) {
                 ++st.numSetFailure;
             } else {
@@ -2393,7 +2567,7 @@ void CouchKVStore::commitCallback(PendingRequestQueue& committedReqs,
             } else if (mutationStatus == MutationStatus::DocNotFound) {
                 setState = MutationSetResultState::DocNotFound;
             }
-            committed.getSetCallback()(*transactionCtx, setState);
+            committed.getSetCallback()(txCtx, setState);
         }
     }
 }
@@ -2660,34 +2834,41 @@ int CouchKVStore::getMultiCb(Db *db, DocInfo *docinfo, void *ctx) {
                 "be non-NULL");
     }
 
-    GetMultiCbCtx *cbCtx = static_cast<GetMultiCbCtx *>(ctx);
+    // Keep the docinfo (returning 1 tells couchstore not to free it); the
+    // documents are fetched once all the keys have been looked up.
+    static_cast<GetMultiCbCtx*>(ctx)->docinfos.push_back(docinfo);
+    return 1;
+}
+
+void CouchKVStore::fetchMultiDoc(Db* db,
+                                 DocInfo* docinfo,
+                                 GetMultiCbCtx& ctx) {
     auto key = makeDiskDocKey(docinfo->id);
-    KVStoreStats& st = cbCtx->cks.getKVStoreStat();
 
-    vb_bgfetch_queue_t::iterator qitr = cbCtx->fetches.find(key);
-    if (qitr == cbCtx->fetches.end()) {
+    vb_bgfetch_queue_t::iterator qitr = ctx.fetches.find(key);
+    if (qitr == ctx.fetches.end()) {
         // this could be a serious race condition in couchstore,
         // log a warning message and continue
-        cbCtx->cks.logger.warn(
-                "CouchKVStore::getMultiCb: Couchstore returned "
+        logger.warn(
+                "CouchKVStore::fetchMultiDoc: Couchstore returned "
                 "invalid docinfo, no pending bgfetch has been "
                 "issued for a key in {}, "
                 "seqno:{}",
-                cbCtx->vbId,
+                ctx.vbId,
                 docinfo->rev_seq);
-        return 0;
+        return;
     }
 
     vb_bgfetch_item_ctx_t& bg_itm_ctx = (*qitr).second;
     GetMetaOnly meta_only = bg_itm_ctx.isMetaOnly;
 
-    couchstore_error_t errCode = cbCtx->cks.fetchDoc(
-            db, docinfo, bg_itm_ctx.value, cbCtx->vbId, meta_only);
+    couchstore_error_t errCode = fetchDoc(
+            db, docinfo, bg_itm_ctx.value, ctx.vbId, meta_only);
     if (errCode != COUCHSTORE_SUCCESS && (meta_only == GetMetaOnly::No)) {
         st.numGetFailure++;
     }
 
-    bg_itm_ctx.value.setStatus(cbCtx->cks.couchErr2EngineErr(errCode));
+    bg_itm_ctx.value.setStatus(couchErr2EngineErr(errCode));
 
     bool return_val_ownership_transferred = false;
     for (auto& fetch : bg_itm_ctx.bgfetched_list) {
@@ -2704,14 +2885,12 @@ int CouchKVStore::getMultiCb(Db *db, DocInfo *docinfo, void *ctx) {
         }
     }
     if (!return_val_ownership_transferred) {
-        cbCtx->cks.logger.warn(
-                "CouchKVStore::getMultiCb called with zero"
+        logger.warn(
+                "CouchKVStore::fetchMultiDoc called with zero"
                 "items in bgfetched_list, {}, seqno:{}",
-                cbCtx->vbId,
+                ctx.vbId,
                 docinfo->rev_seq);
     }
-
-    return 0;
 }
 
 
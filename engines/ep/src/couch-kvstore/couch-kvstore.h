@@ -18,6 +18,8 @@
 
 #include "atomicqueue.h"
 #include "configuration.h"
+#include "couch-kvstore/couch-fs-async.h"
+#include "couch-kvstore/couch-fs-group-sync.h"
 #include "couch-kvstore/couch-fs-stats.h"
 #include "couch-kvstore/couch-kvstore-metadata.h"
 #include "kvstore.h"
@@ -34,6 +36,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #define COUCHSTORE_NO_OPTIONS 0
@@ -90,6 +93,7 @@ protected:
 };
 
 struct kvstats_ctx;
+struct GetMultiCbCtx;
 
 /**
  * KVStore with couchstore as the underlying storage system
@@ -163,6 +167,20 @@ public:
      */
     bool commit(Collections::VB::Flush& collectionsFlush) override;
 
+    /**
+     * Open a commit group: the final (header) sync of each file committed
+     * to is deferred to closeCommitGroup, where the files are synced in one
+     * io_uring batch, as are the callbacks of the commits. The data sync of
+     * each commit still runs before its header is written.
+     *
+     * @return false unless the syncs can be batched (see
+     *         GroupSync::isSupported), in which case every commit remains
+     *         durable on return
+     */
+    bool openCommitGroup() override;
+
+    void closeCommitGroup() override;
+
     /**
      * Rollback a transaction (unless not currently in one).
      */
@@ -329,6 +347,9 @@ public:
     static int recordDbStat(Db *db, DocInfo *docinfo, void *ctx);
     static int getMultiCb(Db *db, DocInfo *docinfo, void *ctx);
 
+    /// Fetch the document of a docinfo found by getMulti()
+    void fetchMultiDoc(Db* db, DocInfo* docinfo, GetMultiCbCtx& ctx);
+
     couchstore_error_t fetchDoc(Db* db,
                                 DocInfo* docinfo,
                                 GetValue& docValue,
@@ -359,6 +380,11 @@ public:
 
     void destroyScanContext(ScanContext* ctx) override;
 
+    bool getScanItemCount(ScanContext* sctx,
+                          uint64_t startSeqno,
+                          uint64_t endSeqno,
+                          uint64_t& count) override;
+
     std::unique_ptr<KVFileHandle, KVFileHandleDeleter> makeFileHandle(
             Vbid vbid) override;
 
@@ -559,8 +585,16 @@ protected:
                                 kvstats_ctx& kvctx);
 
     void commitCallback(PendingRequestQueue& committedReqs,
-                        kvstats_ctx& kvctx,
+                        TransactionContext& txCtx,
+                        std::unordered_map<DiskDocKey, bool>& keyStats,
                         couchstore_error_t errCode);
+
+    /**
+     * Create the GroupSync of a commit group (virtual so tests can observe
+     * or fail the sync of the group).
+     * @return the GroupSync, or null if not supported
+     */
+    virtual std::unique_ptr<GroupSync> createGroupSync();
     couchstore_error_t saveVBState(Db *db, const vbucket_state &vbState);
 
     /**
@@ -791,6 +825,19 @@ protected:
     bool intransaction;
     std::unique_ptr<TransactionContext> transactionCtx;
 
+    /// A commit whose callbacks wait for the commit group to be synced
+    struct GroupedCommit {
+        PendingRequestQueue reqs;
+        std::unordered_map<DiskDocKey, bool> keyStats;
+        std::unique_ptr<TransactionContext> txCtx;
+    };
+
+    /// The files of the open commit group, null if no group is open
+    std::unique_ptr<GroupSync> groupSync;
+
+    /// The commits of the open commit group, in order
+    std::vector<GroupedCommit> groupedCommits;
+
     /**
      * FileOpsInterface implementation for couchstore which tracks
      * all bytes read/written by couchstore *except* compaction.
@@ -807,6 +854,21 @@ protected:
      */
     std::unique_ptr<FileOpsInterface> statCollectingFileOpsCompaction;
 
+    /**
+     * Keeps the reads of bgfetches and scans in flight asynchronously, if
+     * configured (and supported); wrapped by statCollectingFileOpsRead.
+     */
+    std::unique_ptr<AsyncReadOps> asyncReadOps;
+
+    /**
+     * FileOpsInterface implementation for couchstore used by getMulti and
+     * scans (backfill, warmup), which reads ahead of the documents being
+     * read (if configured), through asyncReadOps if enabled.
+     *
+     * Backed by this->st.fsStats
+     */
+    std::unique_ptr<FileOpsInterface> statCollectingFileOpsRead;
+
     /* deleted docs in each file, indexed by vBucket. RelaxedAtomic
        to allow stats access witout lock */
     std::vector<cb::RelaxedAtomic<size_t>> cachedDeleteCount;
@@ -19,8 +19,10 @@
 
 #include "checkpoint.h"
 #include "checkpoint_manager.h"
+#include "dcp/item_cache.h"
 #include "dcp/producer.h"
 #include "dcp/response.h"
+#include "dcp/zstd_compression.h"
 #include "ep_time.h"
 #include "kv_bucket.h"
 #include "statwriter.h"
@@ -80,9 +82,12 @@ ActiveStream::ActiveStream(EventuallyPersistentEngine* e,
       forceValueCompression(p->isForceValueCompressionEnabled()
                                     ? ForceValueCompression::Yes
                                     : ForceValueCompression::No),
+      zstdCompressionLevel(p->getZstdCompressionLevel()),
+      zstdDictionaries(p->isZstdDictionariesEnabled()),
       syncReplication(p->getSyncReplSupport()),
       filter(std::move(f)),
-      sid(filter.getStreamId()) {
+      sid(filter.getStreamId()),
+      itemCache(vbucket.getDcpItemCache()) {
     const char* type = "";
     if (flags_ & DCP_ADD_STREAM_FLAG_TAKEOVER) {
         type = "takeover ";
@@ -121,6 +126,8 @@ ActiveStream::ActiveStream(EventuallyPersistentEngine* e,
     backfillItems.disk = 0;
     backfillItems.sent = 0;
 
+    itemCache->addStream();
+
     bufferedBackfill.bytes = 0;
     bufferedBackfill.items = 0;
 
@@ -141,6 +148,8 @@ ActiveStream::~ActiveStream() {
     if (state_ != StreamState::Dead) {
         removeCheckpointCursor();
     }
+    // The last stream of the vBucket releases the items cached for streams
+    itemCache->removeStream();
 }
 
 std::unique_ptr<DcpResponse> ActiveStream::next() {
@@ -200,6 +209,21 @@ bool ActiveStream::isTakeoverWait() const {
     return state_.load() == StreamState::TakeoverWait;
 }
 
+DcpStreamClass ActiveStream::getStreamClass() const {
+    // Moving a vbucket is scheduled ahead of everything but acked replication
+    // for the whole stream, backfill included, so the takeover completes
+    if (flags_ & DCP_ADD_STREAM_FLAG_TAKEOVER) {
+        return DcpStreamClass::Takeover;
+    }
+    if (isBackfilling()) {
+        return DcpStreamClass::Backfill;
+    }
+    if (supportSyncReplication()) {
+        return DcpStreamClass::Replication;
+    }
+    return DcpStreamClass::Bulk;
+}
+
 void ActiveStream::registerCursor(CheckpointManager& chkptmgr,
                                   uint64_t lastProcessedSeqno) {
     try {
@@ -954,7 +978,8 @@ static bool shouldModifyItem(const queued_item& item,
                              IncludeValue includeValue,
                              IncludeXattrs includeXattrs,
                              bool isForceValueCompressionEnabled,
-                             bool isSnappyEnabled) {
+                             bool isSnappyEnabled,
+                             int zstdCompressionLevel) {
     // If there is no value, no modification needs to be done
     if (item->getValue()) {
         /**
@@ -965,6 +990,13 @@ static bool shouldModifyItem(const queued_item& item,
             return true;
         }
 
+        /**
+         * Values are always re-compressed with zstd if it's enabled
+         */
+        if (zstdCompressionLevel > 0) {
+            return true;
+        }
+
         /**
          * Check if value needs to be compressed or decompressed
          * If yes, then then value definitely needs modification
@@ -995,6 +1027,54 @@ static bool shouldModifyItem(const queued_item& item,
     return false;
 }
 
+std::unique_ptr<Item> ActiveStream::modifyItem(const Item& item) const {
+    auto finalItem = std::make_unique<Item>(item);
+    finalItem->pruneValueAndOrXattrs(includeValue, includeXattributes);
+
+    if (isSnappyEnabled()) {
+        if (isForceValueCompressionEnabled()) {
+            if (!mcbp::datatype::is_snappy(finalItem->getDataType())) {
+                if (!finalItem->compressValue()) {
+                    log(spdlog::level::level_enum::warn,
+                        "{} Failed to snappy compress an uncompressed value",
+                        logPrefix);
+                }
+            }
+        }
+    } else {
+        if (mcbp::datatype::is_snappy(finalItem->getDataType())) {
+            if (!finalItem->decompressValue()) {
+                log(spdlog::level::level_enum::warn,
+                    "{} Failed to snappy uncompress a compressed value",
+                    logPrefix);
+            }
+        }
+    }
+
+    if (zstdCompressionLevel > 0 && finalItem->getNBytes() > 0) {
+        // zstd replaces snappy on this stream
+        if (!finalItem->decompressValue()) {
+            log(spdlog::level::level_enum::warn,
+                "{} Failed to snappy uncompress a value to zstd compress it",
+                logPrefix);
+            return finalItem;
+        }
+        std::string compressed;
+        if (engine->getDcpZstdCompression().compress(
+                    finalItem->getKey().getCollectionID(),
+                    {finalItem->getData(), finalItem->getNBytes()},
+                    zstdCompressionLevel,
+                    zstdDictionaries,
+                    compressed)) {
+            finalItem->replaceValue(
+                    Blob::New(compressed.data(), compressed.size()));
+            finalItem->setDataType(finalItem->getDataType() |
+                                   PROTOCOL_BINARY_DATATYPE_ZSTD);
+        }
+    }
+    return finalItem;
+}
+
 std::unique_ptr<DcpResponse> ActiveStream::makeResponseFromItem(
         const queued_item& item, SendCommitSyncWriteAs sendCommitSyncWriteAs) {
     // Note: This function is hot - it is called for every item to be
@@ -1033,31 +1113,20 @@ std::unique_ptr<DcpResponse> ActiveStream::makeResponseFromItem(
                              includeValue,
                              includeXattributes,
                              isForceValueCompressionEnabled(),
-                             isSnappyEnabled())) {
-            auto finalItem = std::make_unique<Item>(*item);
-            finalItem->pruneValueAndOrXattrs(includeValue, includeXattributes);
-
-            if (isSnappyEnabled()) {
-                if (isForceValueCompressionEnabled()) {
-                    if (!mcbp::datatype::is_snappy(finalItem->getDataType())) {
-                        if (!finalItem->compressValue()) {
-                            log(spdlog::level::level_enum::warn,
-                                "{} Failed to snappy compress an uncompressed "
-                                "value",
-                                logPrefix);
-                        }
-                    }
-                }
-            } else {
-                if (mcbp::datatype::is_snappy(finalItem->getDataType())) {
-                    if (!finalItem->decompressValue()) {
-                        log(spdlog::level::level_enum::warn,
-
-                            "{} Failed to snappy uncompress a compressed "
-                            "value",
-                            logPrefix);
-                    }
-                }
+                             isSnappyEnabled(),
+                             zstdCompressionLevel)) {
+            // Another stream with the same features may already have
+            // modified this item
+            const DcpItemCache::Features features{includeValue,
+                                                  includeXattributes,
+                                                  snappyEnabled,
+                                                  forceValueCompression,
+                                                  zstdCompressionLevel,
+                                                  zstdDictionaries};
+            queued_item finalItem = itemCache->find(*item, features);
+            if (!finalItem) {
+                finalItem = modifyItem(*item);
+                itemCache->insert(*item, features, finalItem);
             }
 
             /**
@@ -1875,7 +1944,7 @@ void ActiveStream::notifyStreamReady(bool force) {
         if (!producer) {
             return;
         }
-        producer->notifyStreamReady(vb_);
+        producer->notifyStreamReady(vb_, getStreamClass());
     }
 }
 
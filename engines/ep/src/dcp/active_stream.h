@@ -24,6 +24,7 @@
 #include <spdlog/common.h>
 
 class CheckpointManager;
+class DcpItemCache;
 class VBucket;
 
 /**
@@ -133,6 +134,8 @@ public:
     /// @Returns true if state_ is TakeoverWait
     bool isTakeoverWait() const;
 
+    DcpStreamClass getStreamClass() const override;
+
     uint32_t setDead(end_stream_status_t status) override;
 
     /**
@@ -352,6 +355,12 @@ protected:
             const queued_item& item,
             SendCommitSyncWriteAs sendCommitSyncWriteAs);
 
+    /**
+     * Copy the given item, pruning the value and/or xattrs and compressing
+     * or decompressing the value as required by the features of this stream.
+     */
+    std::unique_ptr<Item> modifyItem(const Item& item) const;
+
     /* The transitionState function is protected (as opposed to private) for
      * testing purposes.
      */
@@ -598,6 +607,12 @@ private:
     /// Should items be forcefully compressed on this stream?
     const ForceValueCompression forceValueCompression;
 
+    /// zstd level values are compressed at on this stream, 0 if not enabled
+    const int zstdCompressionLevel;
+
+    /// Should zstd compression use the per-collection dictionaries?
+    const bool zstdDictionaries;
+
     /// Does this stream support synchronous replication (i.e. acking Prepares)?
     /**
      * What level of SyncReplication does this stream Support:
@@ -619,6 +634,9 @@ protected:
      */
     const cb::mcbp::DcpStreamId sid;
 
+    /// The vBucket's cache of items modified for sending, shared by streams
+    const std::shared_ptr<DcpItemCache> itemCache;
+
 private:
     /**
      * A prefix to use in all stream log messages
@@ -17,10 +17,14 @@
 
 #include "dcp/active_stream_impl.h"
 #include "dcp/backfill_disk.h"
+#include "dcp/backfill_disk_range.h"
 #include "ep_engine.h"
+#include "executorpool.h"
 #include "kv_bucket.h"
 #include "vbucket.h"
 
+#include <algorithm>
+
 static std::string backfillStateToString(backfill_state_t state) {
     switch (state) {
     case backfill_state_init:
@@ -62,6 +66,12 @@ GetValue CacheCallback::get(VBucket& vb,
 }
 
 void CacheCallback::callback(CacheLookup& lookup) {
+    if (uint64_t(lookup.getBySeqno()) > endSeqno) {
+        endReached = true;
+        setStatus(ENGINE_ENOMEM); // Pause the backfill
+        return;
+    }
+
     auto stream_ = streamPtr.lock();
     if (!stream_) {
         setStatus(ENGINE_SUCCESS);
@@ -123,6 +133,12 @@ void DiskCallback::callback(GetValue& val) {
         throw std::invalid_argument("DiskCallback::callback: val is NULL");
     }
 
+    if (uint64_t(val.item->getBySeqno()) > endSeqno) {
+        endReached = true;
+        setStatus(ENGINE_ENOMEM); // Pause the backfill
+        return;
+    }
+
     // MB-26705: Make the backfilled item cold so ideally the consumer would
     // evict this before any cached item if they get into memory pressure.
     val.item->setNRUValue(MAX_NRU_VALUE);
@@ -137,6 +153,42 @@ void DiskCallback::callback(GetValue& val) {
     }
 }
 
+/**
+ * Collects copies of the resident items of a vBucket with a seqno in the
+ * given range, for a backfill to serve from memory.
+ */
+class BackfillMemoryVisitor : public HashTableVisitor {
+public:
+    BackfillMemoryVisitor(Vbid vbid, uint64_t start, uint64_t end)
+        : vbid(vbid), start(start), end(end) {
+    }
+
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override {
+        if (v.isTempItem() || !v.isResident()) {
+            return true;
+        }
+        const auto seqno = uint64_t(v.getBySeqno());
+        if (seqno < start || seqno > end) {
+            return true;
+        }
+        // Prepares and commits of SyncWrites need their durability
+        // requirements / prepare seqno which are only on disk (as for the
+        // CacheCallback)
+        if (v.getCommitted() != CommittedState::CommittedViaMutation) {
+            return true;
+        }
+        items.push_back(v.toItem(vbid));
+        return true;
+    }
+
+    std::vector<std::unique_ptr<Item>> items;
+
+private:
+    const Vbid vbid;
+    const uint64_t start;
+    const uint64_t end;
+};
+
 DCPBackfillDisk::DCPBackfillDisk(EventuallyPersistentEngine& e,
                                  std::shared_ptr<ActiveStream> s,
                                  uint64_t startSeqno,
@@ -147,6 +199,8 @@ DCPBackfillDisk::DCPBackfillDisk(EventuallyPersistentEngine& e,
       state(backfill_state_init) {
 }
 
+DCPBackfillDisk::~DCPBackfillDisk() = default;
+
 backfill_status_t DCPBackfillDisk::run() {
     LockHolder lh(lock);
     switch (state) {
@@ -209,10 +263,14 @@ backfill_status_t DCPBackfillDisk::create() {
         }
     }
 
-    auto cb = std::make_shared<DiskCallback>(stream);
-    auto cl = std::make_shared<CacheCallback>(engine, stream);
-    scanCtx = kvstore->initScanContext(
-            cb, cl, vbid, startSeqno, DocumentFilter::ALL_ITEMS, valFilter);
+    diskCallback = std::make_shared<DiskCallback>(stream);
+    cacheCallback = std::make_shared<CacheCallback>(engine, stream);
+    scanCtx = kvstore->initScanContext(diskCallback,
+                                       cacheCallback,
+                                       vbid,
+                                       startSeqno,
+                                       DocumentFilter::ALL_ITEMS,
+                                       valFilter);
 
     // Check startSeqno against the purge-seqno of the opened datafile.
     // 1) A normal stream request would of checked inside streamRequest, but
@@ -256,6 +314,9 @@ backfill_status_t DCPBackfillDisk::create() {
             // This value may be an overestimate - it includes prepares/aborts
             // which will not be sent if the stream is not sync write aware
             stream->setBackfillRemaining(scanCtx->documentCount);
+            if (!planMemoryScan(*kvstore)) {
+                splitScan(*kvstore, valFilter);
+            }
             transitionState(backfill_state_scanning);
         } else {
             transitionState(backfill_state_completing);
@@ -265,6 +326,183 @@ backfill_status_t DCPBackfillDisk::create() {
     return backfill_success;
 }
 
+bool DCPBackfillDisk::planMemoryScan(KVStore& kvstore) {
+    // The number of splits of the backfill while looking for the seqno
+    // ranges which can be served from memory; each split counts the
+    // documents of a range on disk (a read of the by-seqno index only)
+    static const int maxSplitDepth = 8;
+    // Finding the resident items visits the whole HashTable, which is only
+    // cheaper than reading the range from disk if the range holds a good
+    // part of the vBucket's items
+    static const uint64_t minRangeFractionOfHashTable = 4;
+
+    const uint64_t maxItems =
+            engine.getConfiguration().getDcpBackfillFromMemoryMaxItems();
+    if (scanCtx->documentCount == 0 || scanCtx->documentCount > maxItems) {
+        return false;
+    }
+
+    auto vb = engine.getVBucket(getVBucketId());
+    if (!vb || scanCtx->documentCount * minRangeFractionOfHashTable <
+                       vb->ht.getNumItems()) {
+        return false;
+    }
+
+    const uint64_t last = scanCtx->maxSeqno;
+    BackfillMemoryVisitor visitor(getVBucketId(), startSeqno, last);
+    vb->ht.visit(visitor);
+    memoryItems = std::move(visitor.items);
+
+    // Items of dropped collections may have been purged from disk already
+    {
+        auto collections = vb->lockCollections();
+        memoryItems.erase(
+                std::remove_if(memoryItems.begin(),
+                               memoryItems.end(),
+                               [&collections](const std::unique_ptr<Item>& i) {
+                                   return collections.isLogicallyDeleted(
+                                           i->getKey(), i->getBySeqno());
+                               }),
+                memoryItems.end());
+    }
+    if (memoryItems.empty()) {
+        return false;
+    }
+    std::sort(memoryItems.begin(),
+              memoryItems.end(),
+              [](const std::unique_ptr<Item>& a,
+                 const std::unique_ptr<Item>& b) {
+                  return a->getBySeqno() < b->getBySeqno();
+              });
+
+    // The resident items are always a subset of the documents the scan
+    // reads: any item in the range was persisted before the scan was opened
+    // and is still resident, so was not superseded. A range is therefore
+    // complete in memory when the counts are equal.
+    planSegments(kvstore,
+                 startSeqno,
+                 last,
+                 memoryItems.begin(),
+                 memoryItems.end(),
+                 scanCtx->documentCount,
+                 maxSplitDepth);
+
+    uint64_t fromMemory = 0;
+    for (const auto& segment : segments) {
+        if (segment.fromMemory) {
+            fromMemory += segment.end - segment.start + 1;
+        }
+    }
+    if (fromMemory == 0) {
+        segments.clear();
+        memoryItems.clear();
+        return false;
+    }
+
+    EP_LOG_INFO(
+            "DCPBackfillDisk::planMemoryScan(): ({}) backfill of seqno {} to "
+            "{} serving {} seqnos from memory, in {} segments",
+            getVBucketId(),
+            startSeqno,
+            last,
+            fromMemory,
+            segments.size());
+    return true;
+}
+
+void DCPBackfillDisk::planSegments(KVStore& kvstore,
+                                   uint64_t start,
+                                   uint64_t end,
+                                   MemoryItems::iterator first,
+                                   MemoryItems::iterator last,
+                                   uint64_t diskCount,
+                                   int depth) {
+    const uint64_t inMemory = std::distance(first, last);
+    if (inMemory == diskCount) {
+        addSegment(start, end, true);
+        return;
+    }
+    if (inMemory == 0 || depth == 0 || start == end) {
+        addSegment(start, end, false);
+        return;
+    }
+
+    const uint64_t mid = start + (end - start) / 2;
+    uint64_t lowerCount;
+    if (!kvstore.getScanItemCount(scanCtx, start, mid, lowerCount) ||
+        lowerCount > diskCount) {
+        addSegment(start, end, false);
+        return;
+    }
+    auto split = std::upper_bound(
+            first,
+            last,
+            mid,
+            [](uint64_t seqno, const std::unique_ptr<Item>& item) {
+                return seqno < uint64_t(item->getBySeqno());
+            });
+    planSegments(kvstore, start, mid, first, split, lowerCount, depth - 1);
+    planSegments(kvstore,
+                 mid + 1,
+                 end,
+                 split,
+                 last,
+                 diskCount - lowerCount,
+                 depth - 1);
+}
+
+void DCPBackfillDisk::addSegment(uint64_t start, uint64_t end, bool fromMemory) {
+    if (!segments.empty() && segments.back().fromMemory == fromMemory) {
+        segments.back().end = end;
+        return;
+    }
+    segments.push_back({start, end, fromMemory});
+}
+
+void DCPBackfillDisk::splitScan(KVStore& kvstore, ValueFilter valFilter) {
+    const auto& config = engine.getConfiguration();
+    const uint64_t parallelism = config.getDcpBackfillScanParallelism();
+    const uint64_t first = startSeqno;
+    const uint64_t last = scanCtx->maxSeqno;
+    if (parallelism < 2 ||
+        scanCtx->documentCount < config.getDcpBackfillParallelScanMinItems() ||
+        last < first + parallelism) {
+        return;
+    }
+
+    const uint64_t step = (last - first + 1) / parallelism;
+    std::vector<std::shared_ptr<DiskBackfillRange>> newRanges;
+    for (uint64_t ii = 1; ii < parallelism; ++ii) {
+        const uint64_t start = first + ii * step;
+        const uint64_t end = (ii == parallelism - 1) ? last : start + step - 1;
+        auto range = std::make_shared<DiskBackfillRange>(
+                kvstore, start, end, config.getDcpScanByteLimit());
+        if (!range->open(getVBucketId(),
+                         valFilter,
+                         scanCtx->purgeSeqno,
+                         scanCtx->maxSeqno)) {
+            // Most likely the file was compacted since scanCtx was created;
+            // just scan the whole backfill sequentially
+            EP_LOG_INFO(
+                    "DCPBackfillDisk::splitScan(): ({}) cannot open a scan "
+                    "of seqno {} to {}, not splitting the backfill",
+                    getVBucketId(),
+                    start,
+                    end);
+            return;
+        }
+        newRanges.push_back(std::move(range));
+    }
+
+    cacheCallback->setEndSeqno(first + step - 1);
+    diskCallback->setEndSeqno(first + step - 1);
+    ranges = std::move(newRanges);
+    for (const auto& range : ranges) {
+        ExecutorPool::get()->schedule(
+                std::make_shared<BackfillRangePrefetchTask>(engine, range));
+    }
+}
+
 backfill_status_t DCPBackfillDisk::scan() {
     auto stream = streamPtr.lock();
     if (!stream) {
@@ -277,15 +515,109 @@ backfill_status_t DCPBackfillDisk::scan() {
         return complete(true);
     }
 
+    if (currentRange > 0) {
+        return scanRange(*stream);
+    }
+
+    if (!segments.empty()) {
+        return scanSegment(*stream);
+    }
+
     KVStore* kvstore = engine.getKVBucket()->getROUnderlying(vbid);
     scan_error_t error = kvstore->scan(scanCtx);
 
-    if (error == scan_again) {
+    if (error == scan_again && !diskCallback->isEndReached() &&
+        !cacheCallback->isEndReached()) {
         return backfill_success;
     }
 
-    transitionState(backfill_state_completing);
+    if (error == scan_failed || ranges.empty()) {
+        transitionState(backfill_state_completing);
+    } else {
+        // The first range is done, continue with the prefetched ones
+        currentRange = 1;
+        ranges.front()->takeOver();
+    }
+
+    return backfill_success;
+}
+
+backfill_status_t DCPBackfillDisk::scanRange(ActiveStream& stream) {
+    auto& range = *ranges[currentRange - 1];
+    while (auto* item = range.peek()) {
+        // The stream takes ownership of the item even if it cannot accept
+        // it, so pass a copy (sharing the value) and only drop the buffered
+        // item once it has been accepted
+        if (!stream.backfillReceived(std::make_unique<Item>(*item),
+                                     BACKFILL_FROM_DISK,
+                                     /*force*/ false)) {
+            return backfill_success; // Pause the backfill
+        }
+        range.pop();
+    }
+
+    if (range.hasFailed() || currentRange == ranges.size()) {
+        transitionState(backfill_state_completing);
+    } else {
+        ranges[currentRange]->takeOver();
+        ++currentRange;
+    }
+
+    return backfill_success;
+}
+
+backfill_status_t DCPBackfillDisk::scanSegment(ActiveStream& stream) {
+    const auto& segment = segments[currentSegment];
+    if (segment.fromMemory) {
+        while (nextMemoryItem < memoryItems.size() &&
+               uint64_t(memoryItems[nextMemoryItem]->getBySeqno()) <=
+                       segment.end) {
+            // As for scanRange, pass a copy as the stream takes ownership
+            // of the item even if it cannot accept it
+            if (!stream.backfillReceived(
+                        std::make_unique<Item>(*memoryItems[nextMemoryItem]),
+                        BACKFILL_FROM_MEMORY,
+                        /*force*/ false)) {
+                return backfill_success; // Pause the backfill
+            }
+            memoryItems[nextMemoryItem].reset();
+            ++nextMemoryItem;
+        }
+    } else {
+        if (!segmentStarted) {
+            // Resume the scan at the start of the segment, pausing it at
+            // the first item beyond the segment
+            scanCtx->lastReadSeqno = segment.start - 1;
+            cacheCallback->setEndSeqno(segment.end);
+            diskCallback->setEndSeqno(segment.end);
+            segmentStarted = true;
+        }
+
+        KVStore* kvstore =
+                engine.getKVBucket()->getROUnderlying(getVBucketId());
+        scan_error_t error = kvstore->scan(scanCtx);
+        if (error == scan_failed) {
+            transitionState(backfill_state_completing);
+            return backfill_success;
+        }
+        if (error == scan_again && !diskCallback->isEndReached() &&
+            !cacheCallback->isEndReached()) {
+            return backfill_success;
+        }
 
+        // The resident items of the segment were read from disk instead
+        while (nextMemoryItem < memoryItems.size() &&
+               uint64_t(memoryItems[nextMemoryItem]->getBySeqno()) <=
+                       segment.end) {
+            memoryItems[nextMemoryItem].reset();
+            ++nextMemoryItem;
+        }
+        segmentStarted = false;
+    }
+
+    if (++currentSegment == segments.size()) {
+        transitionState(backfill_state_completing);
+    }
     return backfill_success;
 }
 
@@ -294,6 +626,12 @@ backfill_status_t DCPBackfillDisk::complete(bool cancelled) {
        or not */
     KVStore* kvstore = engine.getKVBucket()->getROUnderlying(getVBucketId());
     kvstore->destroyScanContext(scanCtx);
+    for (const auto& range : ranges) {
+        // A prefetch task may still hold a reference; ensure it stops reading
+        range->takeOver();
+    }
+    ranges.clear();
+    memoryItems.clear();
 
     auto stream = streamPtr.lock();
     if (!stream) {
@@ -20,11 +20,18 @@
 #include "callbacks.h"
 #include "dcp/backfill.h"
 
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <vector>
 
+class DiskBackfillRange;
 class EventuallyPersistentEngine;
+class Item;
+class KVStore;
 class ScanContext;
 class VBucket;
+enum class ValueFilter;
 
 /* The possible states of the DCPBackfillDisk */
 enum backfill_state_t {
@@ -42,6 +49,20 @@ public:
 
     void callback(CacheLookup& lookup);
 
+    /**
+     * Pause the scan at the first item beyond the given seqno; used when the
+     * rest of the backfill is read by DiskBackfillRanges or from memory.
+     */
+    void setEndSeqno(uint64_t seqno) {
+        endSeqno = seqno;
+        endReached = false;
+    }
+
+    /// @return true if the scan was paused by reaching the end seqno
+    bool isEndReached() const {
+        return endReached;
+    }
+
 private:
     /**
      * Attempt to perform the get of lookup
@@ -52,6 +73,8 @@ private:
 
     EventuallyPersistentEngine& engine_;
     std::weak_ptr<ActiveStream> streamPtr;
+    uint64_t endSeqno = std::numeric_limits<uint64_t>::max();
+    bool endReached = false;
 };
 
 /* Callback to get the items that are found to be in the disk */
@@ -61,8 +84,24 @@ public:
 
     void callback(GetValue& val);
 
+    /**
+     * Pause the scan at the first item beyond the given seqno; used when the
+     * rest of the backfill is read by DiskBackfillRanges or from memory.
+     */
+    void setEndSeqno(uint64_t seqno) {
+        endSeqno = seqno;
+        endReached = false;
+    }
+
+    /// @return true if the scan was paused by reaching the end seqno
+    bool isEndReached() const {
+        return endReached;
+    }
+
 private:
     std::weak_ptr<ActiveStream> streamPtr;
+    uint64_t endSeqno = std::numeric_limits<uint64_t>::max();
+    bool endReached = false;
 };
 
 /**
@@ -71,6 +110,19 @@ private:
  * This class calls asynchronous kvstore apis and manages a state machine to
  * read items in the sequential order from the disk and to call the DCP stream
  * for disk snapshot, backfill items and backfill completion.
+ *
+ * A large backfill may be split into several seqno ranges (see
+ * dcp_backfill_scan_parallelism); the first range is scanned as above while
+ * the others are read ahead concurrently by DiskBackfillRanges. The ranges
+ * are passed to the stream one after the other so items are still received
+ * in seqno order.
+ *
+ * If enabled (see dcp_backfill_from_memory_max_items), a small backfill
+ * covering a good part of the vBucket is instead served as much as possible
+ * from the HashTable, typically when a stream reconnects shortly after its
+ * cursor was dropped: the seqno ranges where the resident items account for
+ * every document on disk are sent from memory, and only the remaining ranges
+ * are read from disk.
  */
 class DCPBackfillDisk : public DCPBackfill {
 public:
@@ -79,6 +131,8 @@ public:
                     uint64_t startSeqno,
                     uint64_t endSeqno);
 
+    ~DCPBackfillDisk() override;
+
     backfill_status_t run() override;
 
     void cancel() override;
@@ -90,6 +144,43 @@ private:
      */
     backfill_status_t create();
 
+    /**
+     * Split the backfill into seqno ranges which are read concurrently, if
+     * the backfill is large enough and parallel scans are enabled.
+     */
+    void splitScan(KVStore& kvstore, ValueFilter valFilter);
+
+    /**
+     * Find the seqno ranges of the backfill which can be served from the
+     * HashTable, and set up the backfill segments.
+     *
+     * @return true if at least some of the backfill will be served from
+     *         memory
+     */
+    bool planMemoryScan(KVStore& kvstore);
+
+    using MemoryItems = std::vector<std::unique_ptr<Item>>;
+
+    /**
+     * Add the segments for the seqno range [start, end], splitting the range
+     * until the resident items of each part either account for all of its
+     * documents on disk (a memory segment) or depth is exhausted (a disk
+     * segment).
+     *
+     * @param first, last The resident items in the range
+     * @param diskCount The number of documents on disk in the range
+     */
+    void planSegments(KVStore& kvstore,
+                      uint64_t start,
+                      uint64_t end,
+                      MemoryItems::iterator first,
+                      MemoryItems::iterator last,
+                      uint64_t diskCount,
+                      int depth);
+
+    /// Append a segment, merging it with the previous one if possible
+    void addSegment(uint64_t start, uint64_t end, bool fromMemory);
+
     /**
      * Scan the disk (by calling KVStore apis) for the items in the backfill
      * snapshot range created in the create scan context. This is an
@@ -98,6 +189,19 @@ private:
      */
     backfill_status_t scan();
 
+    /**
+     * Pass the items of the current DiskBackfillRange to the stream, moving
+     * on to the next range once it is complete.
+     */
+    backfill_status_t scanRange(ActiveStream& stream);
+
+    /**
+     * Pass the items of the current segment to the stream, either from
+     * memory or by scanning the segment's seqno range on disk, moving on to
+     * the next segment once it is complete.
+     */
+    backfill_status_t scanSegment(ActiveStream& stream);
+
     /**
      * Handles the completion of the backfill.
      * Destroys the scan context, indicates the completion to the stream.
@@ -121,6 +225,37 @@ private:
     EventuallyPersistentEngine& engine;
 
     ScanContext* scanCtx;
+    std::shared_ptr<CacheCallback> cacheCallback;
+    std::shared_ptr<DiskCallback> diskCallback;
+
+    /// The ranges following the first one, if the backfill was split
+    std::vector<std::shared_ptr<DiskBackfillRange>> ranges;
+
+    /// The range being scanned; 0 is the range read through scanCtx
+    size_t currentRange = 0;
+
+    /// A seqno range of a backfill partly served from memory
+    struct Segment {
+        uint64_t start;
+        uint64_t end;
+        bool fromMemory;
+    };
+
+    /// The segments of the backfill, if some of it is served from memory
+    std::vector<Segment> segments;
+
+    /// The segment being scanned
+    size_t currentSegment = 0;
+
+    /// True once the scan has been positioned at the current disk segment
+    bool segmentStarted = false;
+
+    /// Copies of the resident items of the backfill, in seqno order
+    MemoryItems memoryItems;
+
+    /// The next memory item to send
+    size_t nextMemoryItem = 0;
+
     backfill_state_t state;
     std::mutex lock;
 };
@@ -0,0 +1,220 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "dcp/backfill_disk_range.h"
+#include "callbacks.h"
+#include "ep_engine.h"
+#include "item.h"
+
+#include <phosphor/phosphor.h>
+
+/**
+ * Cache lookups are not used for a prefetched range - the item in memory may
+ * be replaced by the time the range is passed to the stream - so the lookup
+ * only checks for the end of the range.
+ */
+class DiskBackfillRange::LookupCallback
+    : public StatusCallback<CacheLookup> {
+public:
+    explicit LookupCallback(DiskBackfillRange& range) : range(range) {
+    }
+
+    void callback(CacheLookup& lookup) override {
+        setStatus(range.isBeyondEnd(lookup.getBySeqno()) ? ENGINE_ENOMEM
+                                                         : ENGINE_SUCCESS);
+    }
+
+private:
+    DiskBackfillRange& range;
+};
+
+class DiskBackfillRange::ValueCallback : public StatusCallback<GetValue> {
+public:
+    explicit ValueCallback(DiskBackfillRange& range) : range(range) {
+    }
+
+    void callback(GetValue& val) override {
+        if (!val.item) {
+            throw std::invalid_argument(
+                    "DiskBackfillRange::ValueCallback::callback: val is NULL");
+        }
+        setStatus(range.push(std::move(val.item)) ? ENGINE_SUCCESS
+                                                  : ENGINE_ENOMEM);
+    }
+
+private:
+    DiskBackfillRange& range;
+};
+
+DiskBackfillRange::DiskBackfillRange(KVStore& kvstore,
+                                     uint64_t start,
+                                     uint64_t end,
+                                     size_t maxBytes)
+    : kvstore(kvstore), start(start), end(end), maxBytes(maxBytes) {
+}
+
+DiskBackfillRange::~DiskBackfillRange() {
+    if (scanCtx) {
+        kvstore.destroyScanContext(scanCtx);
+    }
+}
+
+bool DiskBackfillRange::open(Vbid vbid,
+                             ValueFilter valFilter,
+                             uint64_t purgeSeqno,
+                             uint64_t maxSeqno) {
+    // Called before the prefetch task is scheduled, so no need for the mutex
+    scanCtx = kvstore.initScanContext(std::make_shared<ValueCallback>(*this),
+                                      std::make_shared<LookupCallback>(*this),
+                                      vbid,
+                                      start,
+                                      DocumentFilter::ALL_ITEMS,
+                                      valFilter);
+    // Any difference means the file was written to (or compacted) since the
+    // first range was opened, and the ranges would see different data
+    return scanCtx && scanCtx->purgeSeqno == purgeSeqno &&
+           uint64_t(scanCtx->maxSeqno) == maxSeqno;
+}
+
+void DiskBackfillRange::prefetch() {
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        if (takenOver) {
+            return;
+        }
+        prefetching = true;
+    }
+
+    bool more = true;
+    while (more) {
+        scanChunk();
+        std::lock_guard<std::mutex> lh(mutex);
+        more = !takenOver && !complete && (items.empty() || bytes < maxBytes);
+        if (!more) {
+            prefetching = false;
+        }
+    }
+    prefetchDone.notify_all();
+}
+
+void DiskBackfillRange::takeOver() {
+    std::unique_lock<std::mutex> lh(mutex);
+    takenOver = true;
+    prefetchDone.wait(lh, [this] { return !prefetching; });
+}
+
+Item* DiskBackfillRange::peek() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lh(mutex);
+            if (!items.empty()) {
+                return items.front().get();
+            }
+            if (complete) {
+                return nullptr;
+            }
+        }
+        scanChunk();
+    }
+}
+
+void DiskBackfillRange::pop() {
+    std::lock_guard<std::mutex> lh(mutex);
+    bytes -= items.front()->getNBytes();
+    items.pop_front();
+}
+
+bool DiskBackfillRange::hasFailed() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return failed;
+}
+
+void DiskBackfillRange::scanChunk() {
+    const auto status = kvstore.scan(scanCtx);
+    std::lock_guard<std::mutex> lh(mutex);
+    switch (status) {
+    case scan_success:
+        complete = true;
+        return;
+    case scan_again:
+        // Paused because the buffer is full, the range was taken over from
+        // the prefetch task or the end of the range was reached (in which
+        // case isBeyondEnd has marked the range complete)
+        return;
+    case scan_failed:
+        complete = true;
+        failed = true;
+        return;
+    }
+}
+
+bool DiskBackfillRange::push(std::unique_ptr<Item> item) {
+    if (isBeyondEnd(item->getBySeqno())) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lh(mutex);
+    // Pause the prefetch as soon as it's taken over, so takeOver() only
+    // waits for the item being read
+    if (takenOver && prefetching) {
+        return false;
+    }
+    // Always accept one item so the range makes progress
+    if (!items.empty() && bytes >= maxBytes) {
+        return false;
+    }
+
+    // MB-26705: Make the backfilled item cold so ideally the consumer would
+    // evict this before any cached item if they get into memory pressure.
+    item->setNRUValue(MAX_NRU_VALUE);
+    item->setFreqCounterValue(0);
+
+    bytes += item->getNBytes();
+    items.push_back(std::move(item));
+    return true;
+}
+
+bool DiskBackfillRange::isBeyondEnd(int64_t seqno) {
+    if (uint64_t(seqno) > end) {
+        std::lock_guard<std::mutex> lh(mutex);
+        complete = true;
+        return true;
+    }
+    return false;
+}
+
+BackfillRangePrefetchTask::BackfillRangePrefetchTask(
+        EventuallyPersistentEngine& e, std::shared_ptr<DiskBackfillRange> range)
+    : GlobalTask(&e, TaskId::BackfillRangePrefetchTask, 0, false),
+      range(std::move(range)) {
+}
+
+bool BackfillRangePrefetchTask::run() {
+    TRACE_EVENT0("ep-engine/task", "BackfillRangePrefetchTask");
+    range->prefetch();
+    return false;
+}
+
+std::string BackfillRangePrefetchTask::getDescription() {
+    return "Prefetching DCP backfill of seqno " +
+           std::to_string(range->getStartSeqno()) + " to " +
+           std::to_string(range->getEndSeqno());
+}
+
+std::chrono::microseconds BackfillRangePrefetchTask::maxExpectedDuration() {
+    // Reads up to dcp_scan_byte_limit, similar to a BackfillManagerTask run
+    return std::chrono::milliseconds(300);
+}
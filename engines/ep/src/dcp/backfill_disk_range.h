@@ -0,0 +1,165 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "globaltask.h"
+#include "kvstore.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+class EventuallyPersistentEngine;
+class Item;
+
+/**
+ * A seqno sub-range of a disk backfill which is read ahead of the stream.
+ *
+ * When a large backfill is split (see DCPBackfillDisk) the first range is
+ * scanned by the backfill itself as normal, while every other range gets its
+ * own ScanContext and a BackfillRangePrefetchTask which reads the range into
+ * a bounded in-memory buffer concurrently with the earlier ranges.
+ *
+ * Once the backfill has finished the preceding ranges it takes over the
+ * range: the prefetch task stops, the buffered items are passed to the stream
+ * in seqno order and the remainder of the range (if the buffer filled up) is
+ * scanned by the backfill itself.
+ */
+class DiskBackfillRange {
+public:
+    /**
+     * @param kvstore The KVStore to scan
+     * @param start First seqno of the range
+     * @param end Last seqno of the range
+     * @param maxBytes Size of the prefetch buffer
+     */
+    DiskBackfillRange(KVStore& kvstore,
+                      uint64_t start,
+                      uint64_t end,
+                      size_t maxBytes);
+
+    ~DiskBackfillRange();
+
+    /**
+     * Create the scan context for the range.
+     *
+     * The context opens the data file afresh, so it is only usable if it is
+     * the same snapshot as the one the first range was opened on: nothing
+     * was persisted (same max seqno) and no tombstones were purged since.
+     *
+     * @param purgeSeqno The purge seqno seen by the first range
+     * @param maxSeqno The max seqno seen by the first range
+     * @return true if the range can be scanned
+     */
+    bool open(Vbid vbid,
+              ValueFilter valFilter,
+              uint64_t purgeSeqno,
+              uint64_t maxSeqno);
+
+    /**
+     * Read the range into the buffer until the buffer is full, the range is
+     * complete or the range has been taken over. Called by the prefetch task.
+     *
+     * The mutex is only held to check the state between chunks, so
+     * takeOver() doesn't wait for the whole prefetch.
+     */
+    void prefetch();
+
+    /**
+     * Stop any further prefetching; from now on the range is only read by
+     * the caller. Interrupts a running prefetch and waits for the scan it
+     * is in the middle of to pause.
+     */
+    void takeOver();
+
+    /**
+     * @return the next item of the range, scanning more of it if the buffer
+     *         is empty, or nullptr if there are no more items. Only valid
+     *         after takeOver(); the item remains owned by the range until
+     *         pop() is called.
+     */
+    Item* peek();
+
+    /// Discard the item returned by peek()
+    void pop();
+
+    /// @return true if the scan of the range failed
+    bool hasFailed() const;
+
+    uint64_t getStartSeqno() const {
+        return start;
+    }
+
+    uint64_t getEndSeqno() const {
+        return end;
+    }
+
+private:
+    class LookupCallback;
+    class ValueCallback;
+
+    /**
+     * Scan the next chunk of the range into the buffer. Must be called
+     * without the mutex held, by the only thread scanning the range (the
+     * prefetch task while prefetching is set, the caller after takeOver()).
+     */
+    void scanChunk();
+
+    /// Add an item read from disk, @return false if the scan must pause
+    bool push(std::unique_ptr<Item> item);
+
+    /// @return true (and marks the range complete) if seqno is past the end
+    bool isBeyondEnd(int64_t seqno);
+
+    KVStore& kvstore;
+    const uint64_t start;
+    const uint64_t end;
+    const size_t maxBytes;
+
+    ScanContext* scanCtx = nullptr;
+
+    mutable std::mutex mutex;
+    /// Notified when the prefetch task stops scanning
+    std::condition_variable prefetchDone;
+    std::deque<std::unique_ptr<Item>> items;
+    size_t bytes = 0;
+    bool complete = false;
+    bool failed = false;
+    bool takenOver = false;
+    /// True while the prefetch task is scanning the range
+    bool prefetching = false;
+};
+
+/**
+ * Reads a DiskBackfillRange ahead of the backfill on an AuxIO thread.
+ */
+class BackfillRangePrefetchTask : public GlobalTask {
+public:
+    BackfillRangePrefetchTask(EventuallyPersistentEngine& e,
+                              std::shared_ptr<DiskBackfillRange> range);
+
+    bool run() override;
+
+    std::string getDescription() override;
+
+    std::chrono::microseconds maxExpectedDuration() override;
+
+private:
+    const std::shared_ptr<DiskBackfillRange> range;
+};
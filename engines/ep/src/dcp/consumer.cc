@@ -53,6 +53,7 @@ class DcpConsumerTask : public GlobalTask {
 public:
     DcpConsumerTask(EventuallyPersistentEngine* e,
                     std::shared_ptr<DcpConsumer> c,
+                    size_t processor,
                     double sleeptime = 1,
                     bool completeBeforeShutdown = true)
         : GlobalTask(e,
@@ -60,14 +61,19 @@ public:
                      sleeptime,
                      completeBeforeShutdown),
           consumerPtr(c),
+          processor(processor),
           description("DcpConsumerTask, processing buffered items for " +
-                      c->getName()) {
+                      c->getName() +
+                      (c->getNumProcessors() > 1
+                               ? " (processor " + std::to_string(processor) +
+                                         ")"
+                               : "")) {
     }
 
     ~DcpConsumerTask() {
         auto consumer = consumerPtr.lock();
         if (consumer) {
-            consumer->taskCancelled();
+            consumer->taskCancelled(processor);
         }
     }
 
@@ -83,7 +89,8 @@ public:
         }
 
         double sleepFor = 0.0;
-        enum process_items_error_t state = consumer->processBufferedItems();
+        enum process_items_error_t state =
+                consumer->processBufferedItems(processor);
         switch (state) {
             case all_processed:
                 sleepFor = INT_MAX;
@@ -111,20 +118,20 @@ public:
         // between the second `if(consumer->notifiedProcessor)` and us calling
         // `wakeUp()`; but that's essentially a benign race as it will just
         // result in wakeUp() being called twice which is benign.
-        if (consumer->notifiedProcessor(false)) {
+        if (consumer->notifiedProcessor(processor, false)) {
             wakeUp();
             state = more_to_process;
         } else {
             snooze(sleepFor);
             // Check if the processor was notified again,
             // in which case the task should wake immediately.
-            if (consumer->notifiedProcessor(false)) {
+            if (consumer->notifiedProcessor(processor, false)) {
                 wakeUp();
                 state = more_to_process;
             }
         }
 
-        consumer->setProcessorTaskState(state);
+        consumer->setProcessorTaskState(processor, state);
 
         return true;
     }
@@ -143,6 +150,8 @@ private:
     /* we have one task per consumer. the task only needs a reference to the
        consumer object and does not own it. Hence std::weak_ptr should be used*/
     const std::weak_ptr<DcpConsumer> consumerPtr;
+    /* the Processor of the consumer this task applies messages for */
+    const size_t processor;
     const std::string description;
 };
 
@@ -154,15 +163,13 @@ DcpConsumer::DcpConsumer(EventuallyPersistentEngine& engine,
       lastMessageTime(ep_current_time()),
       engine(engine),
       opaqueCounter(0),
-      processorTaskId(0),
-      processorTaskState(all_processed),
-      processorNotification(false),
+      processors(engine.getConfiguration()
+                         .getDcpConsumerProcessBufferedMessagesParallelism()),
       backoffs(0),
       dcpNoopTxInterval(engine.getConfiguration().getDcpNoopTxInterval()),
       pendingSendStreamEndOnClientStreamClose(true),
       consumerName(consumerName_),
       producerIsVersion5orHigher(false),
-      processorTaskRunning(false),
       flowControl(engine, this),
       processBufferedMessagesYieldThreshold(
               engine.getConfiguration()
@@ -204,14 +211,16 @@ DcpConsumer::~DcpConsumer() {
 
 
 void DcpConsumer::cancelTask() {
-    bool exp = true;
-    if (processorTaskRunning.compare_exchange_strong(exp, false)) {
-        ExecutorPool::get()->cancel(processorTaskId);
+    for (auto& processor : processors) {
+        bool exp = true;
+        if (processor.taskRunning.compare_exchange_strong(exp, false)) {
+            ExecutorPool::get()->cancel(processor.taskId);
+        }
     }
 }
 
-void DcpConsumer::taskCancelled() {
-    processorTaskRunning.store(false);
+void DcpConsumer::taskCancelled(size_t processor) {
+    processors[processor].taskRunning.store(false);
 }
 
 std::shared_ptr<PassiveStream> DcpConsumer::makePassiveStream(
@@ -298,13 +307,15 @@ ENGINE_ERROR_CODE DcpConsumer::addStream(uint32_t opaque,
         }
     }
 
-    /* We need 'Processor' task only when we have a stream. Hence create it
-     only once when the first stream is added */
-    bool exp = false;
-    if (processorTaskRunning.compare_exchange_strong(exp, true)) {
-        ExTask task = std::make_shared<DcpConsumerTask>(
-                &engine, shared_from_this(), 1);
-        processorTaskId = ExecutorPool::get()->schedule(task);
+    /* We need 'Processor' tasks only when we have a stream. Hence create
+     them only once when the first stream is added */
+    for (size_t i = 0; i < processors.size(); ++i) {
+        bool exp = false;
+        if (processors[i].taskRunning.compare_exchange_strong(exp, true)) {
+            ExTask task = std::make_shared<DcpConsumerTask>(
+                    &engine, shared_from_this(), i, 1);
+            processors[i].taskId = ExecutorPool::get()->schedule(task);
+        }
     }
 
     stream = makePassiveStream(engine_,
@@ -1104,11 +1115,33 @@ void DcpConsumer::addStats(const AddStatFn& add_stat, const void* c) {
     addStat("processor_task_state", getProcessorTaskStatusStr(), add_stat, c);
     flowControl.addStats(add_stat, c);
 
-    vbReady.addStats(getName() + ":dcp_buffered_ready_queue_", add_stat, c);
+    processors[0].vbReady.addStats(
+            getName() + ":dcp_buffered_ready_queue_", add_stat, c);
     addStat("processor_notification",
-            processorNotification.load(),
+            processors[0].notification.load(),
             add_stat,
             c);
+    // The first processor's stats keep their names from before there could
+    // be more than one
+    for (size_t i = 1; i < processors.size(); ++i) {
+        const auto suffix = "_" + std::to_string(i);
+        addStat(("processor_task_state" + suffix).c_str(),
+                getProcessorTaskStatusStr(i),
+                add_stat,
+                c);
+        processors[i].vbReady.addStats(
+                getName() + ":dcp_buffered_ready_queue" + suffix + "_",
+                add_stat,
+                c);
+        addStat(("processor_notification" + suffix).c_str(),
+                processors[i].notification.load(),
+                add_stat,
+                c);
+    }
+    addStat("processors", processors.size(), add_stat, c);
+    addStat("apply_bytes", applyBytes, add_stat, c);
+    addStat("apply_batches", applyBatches, add_stat, c);
+    addStat("apply_time_ns", applyTimeNs, add_stat, c);
 
     addStat("synchronous_replication", isSyncReplicationEnabled(), add_stat, c);
 }
@@ -1122,6 +1155,7 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
     process_items_error_t rval = all_processed;
     uint32_t bytesProcessed = 0;
     size_t iterations = 0;
+    auto& vbReady = getProcessor(stream->getVBucket()).vbReady;
     do {
         switch (engine_.getReplicationThrottle().getStatus()) {
         case ReplicationThrottle::Status::Pause:
@@ -1138,10 +1172,19 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
                     stream->getVBucket());
             return stop_processing;
 
-        case ReplicationThrottle::Status::Process:
+        case ReplicationThrottle::Status::Process: {
             bytesProcessed = 0;
+            const auto start = std::chrono::steady_clock::now();
             rval = stream->processBufferedMessages(
                     bytesProcessed, processBufferedMessagesBatchSize);
+            if (bytesProcessed > 0) {
+                applyBytes += bytesProcessed;
+                applyBatches++;
+                const auto elapsed = std::chrono::steady_clock::now() - start;
+                applyTimeNs += std::chrono::duration_cast<
+                                       std::chrono::nanoseconds>(elapsed)
+                                       .count();
+            }
             if ((rval == cannot_process) || (rval == stop_processing)) {
                 backoffs++;
             }
@@ -1153,6 +1196,7 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
             iterations++;
             break;
         }
+        }
     } while (bytesProcessed > 0 &&
              rval == all_processed &&
              iterations <= yieldThreshold);
@@ -1169,9 +1213,10 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
     return rval;
 }
 
-process_items_error_t DcpConsumer::processBufferedItems() {
+process_items_error_t DcpConsumer::processBufferedItems(size_t processor) {
     process_items_error_t process_ret = all_processed;
     Vbid vbucket = Vbid(0);
+    auto& vbReady = processors[processor].vbReady;
     while (vbReady.popFront(vbucket)) {
         auto stream = findStream(vbucket);
 
@@ -1205,23 +1250,26 @@ process_items_error_t DcpConsumer::processBufferedItems() {
 }
 
 void DcpConsumer::notifyVbucketReady(Vbid vbucket) {
-    if (vbReady.pushUnique(vbucket) &&
-        notifiedProcessor(true)) {
-        ExecutorPool::get()->wake(processorTaskId);
+    const auto processor = getProcessorIndex(vbucket);
+    if (processors[processor].vbReady.pushUnique(vbucket) &&
+        notifiedProcessor(processor, true)) {
+        ExecutorPool::get()->wake(processors[processor].taskId);
     }
 }
 
-bool DcpConsumer::notifiedProcessor(bool to) {
+bool DcpConsumer::notifiedProcessor(size_t processor, bool to) {
     bool inverse = !to;
-    return processorNotification.compare_exchange_strong(inverse, to);
+    return processors[processor].notification.compare_exchange_strong(inverse,
+                                                                      to);
 }
 
-void DcpConsumer::setProcessorTaskState(enum process_items_error_t to) {
-    processorTaskState = to;
+void DcpConsumer::setProcessorTaskState(size_t processor,
+                                        enum process_items_error_t to) {
+    processors[processor].taskState = to;
 }
 
-std::string DcpConsumer::getProcessorTaskStatusStr() {
-    switch (processorTaskState.load()) {
+std::string DcpConsumer::getProcessorTaskStatusStr(size_t processor) {
+    switch (processors[processor].taskState.load()) {
         case all_processed:
             return "ALL_PROCESSED";
         case more_to_process:
@@ -31,6 +31,7 @@
 
 #include <list>
 #include <map>
+#include <vector>
 #include <engines/ep/src/collections/collections_types.h>
 
 class DcpResponse;
@@ -265,7 +266,11 @@ public:
 
     void closeStreamDueToVbStateChange(Vbid vbucket, vbucket_state_t state);
 
-    process_items_error_t processBufferedItems();
+    /**
+     * Apply the buffered messages of the vBuckets assigned to the given
+     * processor (see Processor).
+     */
+    process_items_error_t processBufferedItems(size_t processor = 0);
 
     uint64_t incrOpaqueCounter();
 
@@ -279,13 +284,19 @@ public:
 
     void cancelTask();
 
-    void taskCancelled();
+    void taskCancelled(size_t processor);
 
-    bool notifiedProcessor(bool to);
+    bool notifiedProcessor(size_t processor, bool to);
 
-    void setProcessorTaskState(enum process_items_error_t to);
+    void setProcessorTaskState(size_t processor,
+                               enum process_items_error_t to);
 
-    std::string getProcessorTaskStatusStr();
+    std::string getProcessorTaskStatusStr(size_t processor = 0);
+
+    /// @return the number of processors applying buffered messages
+    size_t getNumProcessors() const {
+        return processors.size();
+    }
 
     /**
      * Check if the enough bytes have been removed from the flow control
@@ -499,6 +510,7 @@ protected:
             if (bytes == 0) {
                 throw std::invalid_argument("UpdateFlowControl given 0 bytes");
             }
+            consumer.flowControl.incrReceivedBytes(bytes);
         }
 
         ~UpdateFlowControl() {
@@ -531,14 +543,41 @@ protected:
             uint32_t opaque,
             std::unique_ptr<DcpResponse> msg);
 
+    /**
+     * The buffered messages of the consumer's streams are applied by one
+     * DcpConsumerTask per Processor (dcp_consumer_process_buffered_messages_
+     * parallelism). A vBucket is always applied by the same processor
+     * (vbid % number of processors) so its messages are applied in order,
+     * while different vBuckets can be applied concurrently.
+     */
+    struct Processor {
+        size_t taskId = 0;
+        /* Indicates if the 'Processor' task is running */
+        std::atomic<bool> taskRunning{false};
+        std::atomic<enum process_items_error_t> taskState{all_processed};
+        VBReadyQueue vbReady;
+        std::atomic<bool> notification{false};
+    };
+
+    size_t getProcessorIndex(Vbid vbucket) const {
+        return vbucket.get() % processors.size();
+    }
+
+    Processor& getProcessor(Vbid vbucket) {
+        return processors[getProcessorIndex(vbucket)];
+    }
+
     /* Reference to the ep engine; need to create the 'Processor' task */
     EventuallyPersistentEngine& engine;
     uint64_t opaqueCounter;
-    size_t processorTaskId;
-    std::atomic<enum process_items_error_t> processorTaskState;
 
-    VBReadyQueue vbReady;
-    std::atomic<bool> processorNotification;
+    std::vector<Processor> processors;
+
+    /* Bytes of buffered messages applied, how many processBufferedMessages
+       calls they took and the time spent applying them */
+    cb::RelaxedAtomic<uint64_t> applyBytes{0};
+    cb::RelaxedAtomic<uint64_t> applyBatches{0};
+    cb::RelaxedAtomic<uint64_t> applyTimeNs{0};
 
     std::mutex readyMutex;
     std::list<Vbid> ready;
@@ -598,9 +637,6 @@ protected:
     } getErrorMapState;
     bool producerIsVersion5orHigher;
 
-    /* Indicates if the 'Processor' task is running */
-    std::atomic<bool> processorTaskRunning;
-
     FlowControl flowControl;
 
        /**
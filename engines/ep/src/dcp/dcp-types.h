@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 template <class S, class Pointer, class Deleter> class SingleThreadedRCPtr;
@@ -160,3 +161,23 @@ enum class MultipleStreamRequests : bool {
  * without acking).
  */
 enum class SyncReplication : char { No, SyncWrites, SyncReplication };
+
+/**
+ * The scheduling class of a producer's stream. Streams which are ready are
+ * served in weighted round robin between the classes (see
+ * WeightedReadyQueue), so that latency-sensitive traffic isn't stuck behind
+ * bulk traffic on the same connection.
+ */
+enum class DcpStreamClass : uint8_t {
+    /// Streams to replicas acking SyncWrites - durable write latency
+    Replication,
+    /// Streams moving a vbucket during rebalance
+    Takeover,
+    /// Other in-memory streams (indexer, XDCR, non-durable replication)
+    Bulk,
+    /// Streams reading a backfill
+    Backfill
+};
+
+/// Number of DcpStreamClass values
+const size_t DcpStreamClassCount = 4;
@@ -34,6 +34,13 @@ size_t DcpFlowControlManager::newConsumerConn(DcpConsumer *) {
 
 void DcpFlowControlManager::handleDisconnect(DcpConsumer *) {}
 
+void DcpFlowControlManager::handleBufferAck(
+        DcpConsumer*,
+        double,
+        std::chrono::microseconds,
+        std::chrono::steady_clock::time_point) {
+}
+
 bool DcpFlowControlManager::isEnabled() const
 {
     return false;
@@ -223,3 +230,120 @@ void DcpFlowControlManagerAggressive::resizeBuffers_UNLOCKED(size_t bufferSize)
         iter.second->setFlowControlBufSize(bufferSize);
     }
 }
+
+DcpFlowControlManagerAdaptive::DcpFlowControlManagerAdaptive(
+        EventuallyPersistentEngine& engine)
+    : DcpFlowControlManager(engine), allocatedBytes(0) {
+}
+
+DcpFlowControlManagerAdaptive::~DcpFlowControlManagerAdaptive() {}
+
+size_t DcpFlowControlManagerAdaptive::newConsumerConn(
+        DcpConsumer* consumerConn) {
+    if (consumerConn == nullptr) {
+        throw std::invalid_argument(
+                "DcpFlowControlManagerAdaptive::newConsumerConn: resp is NULL");
+    }
+
+    /* Start at the minimum; the buffer grows once the consumer has shown
+       how fast it drains */
+    size_t bufferSize = engine_.getConfiguration().getDcpConnBufferSize();
+
+    std::lock_guard<std::mutex> lh(consumersMutex);
+    consumers[consumerConn->getCookie()] = {
+            consumerConn, bufferSize, std::chrono::steady_clock::now()};
+    allocatedBytes += bufferSize;
+    EP_LOG_DEBUG("{} Conn flow control buffer is {}",
+                 consumerConn->logHeader(),
+                 bufferSize);
+    return bufferSize;
+}
+
+void DcpFlowControlManagerAdaptive::handleDisconnect(
+        DcpConsumer* consumerConn) {
+    std::lock_guard<std::mutex> lh(consumersMutex);
+    auto iter = consumers.find(consumerConn->getCookie());
+    if (iter != consumers.end()) {
+        allocatedBytes -= iter->second.bufferSize;
+        consumers.erase(iter);
+    }
+}
+
+void DcpFlowControlManagerAdaptive::handleBufferAck(
+        DcpConsumer* consumerConn,
+        double drainRate,
+        std::chrono::microseconds rtt,
+        std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lh(consumersMutex);
+    auto iter = consumers.find(consumerConn->getCookie());
+    if (iter == consumers.end()) {
+        return;
+    }
+    auto& state = iter->second;
+    state.lastAck = now;
+
+    reclaimIdleBuffers_UNLOCKED(now);
+
+    if (rtt.count() == 0 || drainRate <= 0) {
+        /* Nothing to base the size on yet */
+        return;
+    }
+
+    /* Twice the bandwidth-delay product, as acks are only sent once a part
+       of the buffer has been drained */
+    size_t bufferSize = 2 * drainRate *
+                        std::chrono::duration<double>(rtt).count();
+    setBufSizeWithinBounds(consumerConn, bufferSize);
+
+    /* Only grow into what is left of the aggregate limit */
+    if (bufferSize > state.bufferSize) {
+        Configuration& config = engine_.getConfiguration();
+        const size_t limit =
+                (static_cast<double>(
+                         config.getDcpConnBufferSizeAggrMemThreshold()) /
+                 100) *
+                engine_.getEpStats().getMaxDataSize();
+        const size_t available =
+                limit > allocatedBytes ? limit - allocatedBytes : 0;
+        bufferSize = std::min(bufferSize, state.bufferSize + available);
+    }
+
+    /* Avoid sending a control message to the producer for small changes */
+    const size_t delta = bufferSize > state.bufferSize
+                                 ? bufferSize - state.bufferSize
+                                 : state.bufferSize - bufferSize;
+    if (delta < state.bufferSize / 8) {
+        return;
+    }
+
+    allocatedBytes = allocatedBytes - state.bufferSize + bufferSize;
+    state.bufferSize = bufferSize;
+    EP_LOG_DEBUG(
+            "{} Conn flow control buffer is {} (drain rate:{} bytes/s, "
+            "rtt:{}us)",
+            consumerConn->logHeader(),
+            bufferSize,
+            drainRate,
+            rtt.count());
+    consumerConn->setFlowControlBufSize(bufferSize);
+}
+
+bool DcpFlowControlManagerAdaptive::isEnabled() const {
+    return true;
+}
+
+void DcpFlowControlManagerAdaptive::reclaimIdleBuffers_UNLOCKED(
+        std::chrono::steady_clock::time_point now) {
+    Configuration& config = engine_.getConfiguration();
+    const size_t minSize = config.getDcpConnBufferSize();
+    const auto idleTime =
+            std::chrono::seconds(config.getDcpFlowControlIdleTime());
+    for (auto& iter : consumers) {
+        auto& state = iter.second;
+        if (state.bufferSize > minSize && (now - state.lastAck) > idleTime) {
+            allocatedBytes -= state.bufferSize - minSize;
+            state.bufferSize = minSize;
+            state.consumer->setFlowControlBufSize(minSize);
+        }
+    }
+}
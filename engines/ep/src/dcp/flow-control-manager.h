@@ -19,6 +19,7 @@
 #include "memcached/types.h"
 
 #include <atomic>
+#include <chrono>
 #include <map>
 #include <mutex>
 
@@ -48,6 +49,18 @@ public:
     /* To be called when a consumer connection is deleted */
     virtual void handleDisconnect(DcpConsumer *);
 
+    /**
+     * To be called when a consumer connection has sent a buffer ack.
+     *
+     * @param drainRate estimated bytes per second the consumer processes
+     * @param rtt estimated round trip time to the producer (zero if unknown)
+     * @param now when the ack was sent
+     */
+    virtual void handleBufferAck(DcpConsumer* consumerConn,
+                                 double drainRate,
+                                 std::chrono::microseconds rtt,
+                                 std::chrono::steady_clock::time_point now);
+
     /* Will indicate if flow control is enabled */
     virtual bool isEnabled(void) const;
 
@@ -130,3 +143,52 @@ private:
     /* Fraction of memQuota for all dcp consumer connection buffers */
     std::atomic<double> dcpConnBufferSizeAggrFrac;
 };
+
+/**
+ * In this policy flow control buffer sizes follow how fast each consumer
+ * actually drains its buffer. Every buffer ack updates the consumer's drain
+ * rate and round trip time estimates (see FlowControl) and the buffer is
+ * resized to twice the bandwidth-delay product - enough for the producer to
+ * keep sending while the acks are in flight - within min (10MB) and max
+ * (50MB). The sum of all buffers is limited to the same percentage of the
+ * bucket quota as the dynamic policy (10%); connections which have not
+ * acked for dcp_flow_control_idle_time seconds are shrunk back to the min
+ * so the space can be used by the busy connections.
+ */
+class DcpFlowControlManagerAdaptive : public DcpFlowControlManager {
+public:
+    DcpFlowControlManagerAdaptive(EventuallyPersistentEngine& engine);
+
+    ~DcpFlowControlManagerAdaptive();
+
+    size_t newConsumerConn(DcpConsumer* consumerConn);
+
+    void handleDisconnect(DcpConsumer* consumerConn);
+
+    void handleBufferAck(DcpConsumer* consumerConn,
+                         double drainRate,
+                         std::chrono::microseconds rtt,
+                         std::chrono::steady_clock::time_point now);
+
+    bool isEnabled(void) const;
+
+private:
+    struct ConsumerState {
+        DcpConsumer* consumer;
+        size_t bufferSize;
+        std::chrono::steady_clock::time_point lastAck;
+    };
+
+    /**
+     * Shrink the buffers of connections which have been idle for too long.
+     * It assumes the consumersMutex is already taken.
+     */
+    void reclaimIdleBuffers_UNLOCKED(std::chrono::steady_clock::time_point now);
+
+    /* Mutex to ensure consumers and allocatedBytes are thread safe */
+    std::mutex consumersMutex;
+    /* All DCP Consumers with flow control buffer */
+    std::map<const void*, ConsumerState> consumers;
+    /* Sum of the buffer sizes of all consumers */
+    size_t allocatedBytes;
+};
@@ -30,7 +30,14 @@ FlowControl::FlowControl(EventuallyPersistentEngine &engine,
     pendingControl(true),
     lastBufferAck(ep_current_time()),
     ackedBytes(0),
-    freedBytes(0)
+    freedBytes(0),
+    receivedBytes(0),
+    lastAckTime(std::chrono::steady_clock::now()),
+    drainIdle(true),
+    drainRestarted(false),
+    rttProbe(false),
+    drainRate(0),
+    rttUsec(0)
 {
     enabled = engine.getDcpFlowControlManager().isEnabled();
     if (enabled) {
@@ -63,24 +70,12 @@ ENGINE_ERROR_CODE FlowControl::handleFlowCtl(
         } else if (isBufferSufficientlyDrained_UNLOCKED(ackable_bytes)) {
             lh.unlock();
             /* Send a buffer ack when at least 20% of the buffer is drained */
-            uint64_t opaque = consumerConn->incrOpaqueCounter();
-            ret = producers->buffer_acknowledgement(
-                    opaque, Vbid(0), ackable_bytes);
-            lastBufferAck = ep_current_time();
-            ackedBytes.fetch_add(ackable_bytes);
-            freedBytes.fetch_sub(ackable_bytes);
-            return ret;
+            return sendBufferAck(producers, ackable_bytes);
         } else if (ackable_bytes > 0 &&
                    (ep_current_time() - lastBufferAck) > 5) {
             lh.unlock();
             /* Ack at least every 5 seconds */
-            uint64_t opaque = consumerConn->incrOpaqueCounter();
-            ret = producers->buffer_acknowledgement(
-                    opaque, Vbid(0), ackable_bytes);
-            lastBufferAck = ep_current_time();
-            ackedBytes.fetch_add(ackable_bytes);
-            freedBytes.fetch_sub(ackable_bytes);
-            return ret;
+            return sendBufferAck(producers, ackable_bytes);
         } else {
             lh.unlock();
         }
@@ -88,11 +83,77 @@ ENGINE_ERROR_CODE FlowControl::handleFlowCtl(
     return ENGINE_FAILED;
 }
 
+ENGINE_ERROR_CODE FlowControl::sendBufferAck(
+        struct dcp_message_producers* producers, uint32_t ackable_bytes) {
+    uint64_t opaque = consumerConn->incrOpaqueCounter();
+    ENGINE_ERROR_CODE ret =
+            producers->buffer_acknowledgement(opaque, Vbid(0), ackable_bytes);
+    lastBufferAck = ep_current_time();
+    const auto now = std::chrono::steady_clock::now();
+    updateEstimates(ackable_bytes, now);
+    freedBytes.fetch_sub(ackable_bytes);
+
+    engine_.getDcpFlowControlManager().handleBufferAck(
+            consumerConn, getDrainRate(), getRtt(), now);
+    return ret;
+}
+
+void FlowControl::updateEstimates(uint32_t ackable_bytes,
+                                  std::chrono::steady_clock::time_point now) {
+    // Only count the time the consumer had something to drain; a gap where
+    // the producer had nothing to send would otherwise drag the rate down
+    auto drainStart = lastAckTime;
+    if (drainRestarted.exchange(false, std::memory_order_acquire)) {
+        drainStart = drainRestart;
+    }
+    const auto interval =
+            std::chrono::duration<double>(now - drainStart).count();
+    lastAckTime = now;
+    if (interval > 0) {
+        // Exponentially weighted, so a single slow interval (e.g. the
+        // consumer pausing for memory) doesn't collapse the estimate
+        const double sample = ackable_bytes / interval;
+        drainRate = drainRate == 0 ? sample : (drainRate * 3 + sample) / 4;
+    }
+
+    // If the producer has (nearly) filled the buffer it is blocked until it
+    // receives this ack, so time how long it takes for the next message
+    const uint64_t received = receivedBytes;
+    const uint64_t acked = ackedBytes;
+    const uint64_t outstanding = received > acked ? received - acked : 0;
+    if (!rttProbe && outstanding >= bufferSize * .8) {
+        rttProbeStart = now;
+        rttProbe.store(true, std::memory_order_release);
+    }
+    if (outstanding <= ackable_bytes) {
+        drainIdle.store(true, std::memory_order_release);
+    }
+    ackedBytes.fetch_add(ackable_bytes);
+}
+
 void FlowControl::incrFreedBytes(uint32_t bytes)
 {
     freedBytes.fetch_add(bytes);
 }
 
+void FlowControl::incrReceivedBytes(uint32_t bytes,
+                                    std::chrono::steady_clock::time_point now) {
+    receivedBytes.fetch_add(bytes);
+    if (drainIdle.exchange(false, std::memory_order_acquire)) {
+        drainRestart = now;
+        drainRestarted.store(true, std::memory_order_release);
+    }
+    if (rttProbe.load(std::memory_order_acquire)) {
+        const auto sample =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        now - rttProbeStart)
+                        .count();
+        // Smoothed as per the TCP SRTT (RFC 6298)
+        rttUsec = rttUsec == 0 ? sample : (rttUsec * 7 + sample) / 8;
+        rttProbe.store(false, std::memory_order_release);
+    }
+}
+
 uint32_t FlowControl::getFlowControlBufSize(void)
 {
     return bufferSize;
@@ -120,4 +181,7 @@ void FlowControl::addStats(const AddStatFn& add_stat, const void* c) {
     consumerConn->addStat("total_acked_bytes", ackedBytes, add_stat, c);
     consumerConn->addStat("max_buffer_bytes", bufferSize, add_stat, c);
     consumerConn->addStat("unacked_bytes", freedBytes, add_stat, c);
+    consumerConn->addStat(
+            "drain_rate", uint64_t(getDrainRate()), add_stat, c);
+    consumerConn->addStat("rtt_us", rttUsec.load(), add_stat, c);
 }
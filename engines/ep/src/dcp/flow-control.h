@@ -21,6 +21,8 @@
 
 #include <relaxed_atomic.h>
 
+#include <chrono>
+
 class DcpConsumer;
 class EventuallyPersistentEngine;
 
@@ -29,7 +31,11 @@ class EventuallyPersistentEngine;
  * It is always associated with a DCP consumer.
  * Flow control buffer size is set when the class obj is initialized.
  * The class obj subsequently handles sending control messages and
- * sending bytes processed acks to the DCP producer
+ * sending bytes processed acks to the DCP producer.
+ *
+ * The timing of the acks is used to estimate how fast the consumer drains
+ * its buffer and the round trip time to the producer, which the
+ * DcpFlowControlManager may use to size the buffer.
  */
 class FlowControl {
 public:
@@ -41,6 +47,18 @@ public:
 
     void incrFreedBytes(uint32_t bytes);
 
+    /* To be called for each message received from the producer */
+    void incrReceivedBytes(uint32_t bytes,
+                           std::chrono::steady_clock::time_point now =
+                                   std::chrono::steady_clock::now());
+
+    /*
+     * Account a buffer ack of the given bytes sent at now, updating the
+     * drain rate and round trip time estimates. Called by sendBufferAck().
+     */
+    void updateEstimates(uint32_t ackable_bytes,
+                         std::chrono::steady_clock::time_point now);
+
     uint32_t getFlowControlBufSize(void);
 
     void setFlowControlBufSize(uint32_t newSize);
@@ -53,9 +71,22 @@ public:
         return freedBytes.load();
     }
 
+    /* Estimated rate (bytes per second) at which the buffer is drained */
+    double getDrainRate() const {
+        return drainRate;
+    }
+
+    /* Smoothed round trip time to the producer, zero if not yet known */
+    std::chrono::microseconds getRtt() const {
+        return std::chrono::microseconds(rttUsec);
+    }
+
 private:
     void setBufSizeWithinBounds(size_t &bufSize);
 
+    ENGINE_ERROR_CODE sendBufferAck(struct dcp_message_producers* producers,
+                                    uint32_t ackable_bytes);
+
     bool isBufferSufficientlyDrained_UNLOCKED(uint32_t ackable_bytes);
 
     /* Associated consumer connection handler */
@@ -85,4 +116,30 @@ private:
 
     /* Bytes processed from the flow control buffer */
     std::atomic<uint64_t> freedBytes;
+
+    /* Total bytes received from the producer */
+    std::atomic<uint64_t> receivedBytes;
+
+    /* When the last buffer ack was sent, for the drain rate estimate */
+    std::chrono::steady_clock::time_point lastAckTime;
+
+    /*
+     * Set when an ack leaves nothing outstanding: the consumer is then idle
+     * until the producer sends more, so the drain interval restarts at the
+     * next message received (drainRestart) instead of at lastAckTime.
+     */
+    std::atomic<bool> drainIdle;
+    std::atomic<bool> drainRestarted;
+    std::chrono::steady_clock::time_point drainRestart;
+
+    /*
+     * Set when an ack is sent while the producer is likely to be blocked on
+     * a full buffer; the next message received then arrives roughly one
+     * round trip after rttProbeStart.
+     */
+    std::atomic<bool> rttProbe;
+    std::chrono::steady_clock::time_point rttProbeStart;
+
+    cb::RelaxedAtomic<double> drainRate;
+    cb::RelaxedAtomic<int64_t> rttUsec;
 };
@@ -0,0 +1,133 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "dcp/item_cache.h"
+
+#include "stats.h"
+
+uint32_t DcpItemCache::Features::encode() const {
+    // IncludeValue takes two bits, each of the flags one bit and the zstd
+    // level the second byte
+    return uint32_t(includeValue) |
+           (includeXattrs == IncludeXattrs::Yes ? 0x4 : 0) |
+           (snappyEnabled == SnappyEnabled::Yes ? 0x8 : 0) |
+           (forceValueCompression == ForceValueCompression::Yes ? 0x10 : 0) |
+           (zstdDictionaries ? 0x20 : 0) |
+           (uint32_t(zstdCompressionLevel & 0xff) << 8);
+}
+
+DcpItemCache::DcpItemCache(EPStats& stats, size_t maxBytes)
+    : stats(stats), maxBytes(maxBytes), slots(maxBytes ? slotCount : 0) {
+}
+
+DcpItemCache::~DcpItemCache() {
+    clear();
+}
+
+queued_item DcpItemCache::find(const Item& source, Features features) {
+    // Items which haven't been assigned a seqno can't be identified
+    if (slots.empty() || source.getBySeqno() <= 0) {
+        return {};
+    }
+
+    const auto encoded = features.encode();
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        const auto& slot = getSlot(source.getBySeqno(), encoded);
+        // A seqno may be reused after a rollback, so also check the cas and
+        // revision of the item are the same
+        if (slot.item && slot.bySeqno == source.getBySeqno() &&
+            slot.features == encoded && slot.cas == source.getCas() &&
+            slot.revSeqno == source.getRevSeqno()) {
+            ++hits;
+            return slot.item;
+        }
+    }
+    ++misses;
+    return {};
+}
+
+void DcpItemCache::insert(const Item& source,
+                          Features features,
+                          queued_item item) {
+    if (slots.empty() || source.getBySeqno() <= 0) {
+        return;
+    }
+
+    const auto encoded = features.encode();
+    const auto size = item->size();
+    queued_item evicted;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        auto& slot = getSlot(source.getBySeqno(), encoded);
+        const size_t evictedSize = slot.item ? slot.item->size() : 0;
+        if (bytes - evictedSize + size > maxBytes) {
+            // Doesn't fit; keep what's cached
+            return;
+        }
+        slot.bySeqno = source.getBySeqno();
+        slot.cas = source.getCas();
+        slot.revSeqno = source.getRevSeqno();
+        slot.features = encoded;
+        // Release the previous item outside of the lock
+        evicted = std::move(slot.item);
+        slot.item = std::move(item);
+        adjustBytes(int64_t(size) - int64_t(evictedSize));
+    }
+}
+
+void DcpItemCache::addStream() {
+    ++streams;
+}
+
+void DcpItemCache::removeStream() {
+    if (--streams == 0) {
+        clear();
+    }
+}
+
+void DcpItemCache::clear() {
+    std::vector<queued_item> evicted;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        for (auto& slot : slots) {
+            if (slot.item) {
+                adjustBytes(-int64_t(slot.item->size()));
+                // Release the items outside of the lock
+                evicted.push_back(std::move(slot.item));
+            }
+        }
+    }
+}
+
+DcpItemCache::Slot& DcpItemCache::getSlot(int64_t bySeqno,
+                                          uint32_t features) {
+    // Consecutive seqnos map to consecutive slots; streams with different
+    // features are spread out so they don't evict each other
+    const uint64_t hash = uint64_t(bySeqno) + uint64_t(features) * 0x9e3779b1;
+    return slots[hash % slots.size()];
+}
+
+void DcpItemCache::adjustBytes(int64_t delta) {
+    if (delta > 0) {
+        bytes.fetch_add(size_t(delta));
+        stats.dcpItemCacheSize.fetch_add(size_t(delta));
+    } else {
+        bytes.fetch_sub(size_t(-delta));
+        stats.dcpItemCacheSize.fetch_sub(size_t(-delta));
+    }
+}
@@ -0,0 +1,147 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "dcp/dcp-types.h"
+#include "item.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+class EPStats;
+
+/**
+ * A per-vBucket cache of the Items which ActiveStreams send over DCP.
+ *
+ * When a stream's negotiated features require the value of an item to be
+ * modified before it is sent (value and/or xattrs pruned, the value snappy
+ * compressed or decompressed) the stream has to copy the Item and transform
+ * it. With many streams on the same vBucket (replicas, indexer, FTS, XDCR...)
+ * the same transformation would otherwise be repeated for every stream.
+ *
+ * The cache is keyed on the seqno of the item and the set of features which
+ * determine the transformation, so streams which negotiated the same features
+ * share a single (reference counted) copy of the item.
+ *
+ * The cache is direct-mapped with a fixed number of slots; an insert simply
+ * replaces whatever occupied the slot. Streams which run close to each other
+ * (the common case for replication) will find the items the first stream
+ * built, while a lagging stream just falls back to building its own.
+ *
+ * The memory of the items held is bounded by the byte budget of the cache
+ * (an item which doesn't fit isn't cached), and is reported by the
+ * ep_dcp_item_cache_mem_used stat. As the items are only of use to streams,
+ * the cache is emptied when the last stream of the vBucket goes away.
+ */
+class DcpItemCache {
+public:
+    /**
+     * The features of a stream which affect how an item is transformed.
+     * Note that the collection-ID encoding of the key is not included as that
+     * is applied when the message is written to the connection.
+     */
+    struct Features {
+        IncludeValue includeValue;
+        IncludeXattrs includeXattrs;
+        SnappyEnabled snappyEnabled;
+        ForceValueCompression forceValueCompression;
+        int zstdCompressionLevel;
+        bool zstdDictionaries;
+
+        uint32_t encode() const;
+    };
+
+    /// The number of slots of a cache
+    static const size_t slotCount = 64;
+
+    /**
+     * @param stats The stats to account the memory of the items in
+     * @param maxBytes The maximum number of bytes of items held (0 disables
+     *                 the cache)
+     */
+    DcpItemCache(EPStats& stats, size_t maxBytes);
+
+    ~DcpItemCache();
+
+    /**
+     * Look for the transformed copy of the given item.
+     *
+     * @param source The item as read from the checkpoint or disk
+     * @param features The features of the requesting stream
+     * @return the cached copy, or an empty queued_item if not cached
+     */
+    queued_item find(const Item& source, Features features);
+
+    /**
+     * Record the transformed copy of the given item so other streams with
+     * the same features may use it. The item must not be modified after
+     * it is inserted.
+     */
+    void insert(const Item& source, Features features, queued_item item);
+
+    /// Called when a stream which may use the cache is created
+    void addStream();
+
+    /// Called when a stream goes away; the last one empties the cache
+    void removeStream();
+
+    /// Release all of the items held
+    void clear();
+
+    size_t getMaxBytes() const {
+        return maxBytes;
+    }
+
+    /// @return the number of bytes of the items held
+    size_t getBytes() const {
+        return bytes;
+    }
+
+    size_t getHits() const {
+        return hits;
+    }
+
+    size_t getMisses() const {
+        return misses;
+    }
+
+private:
+    struct Slot {
+        int64_t bySeqno = 0;
+        uint64_t cas = 0;
+        uint64_t revSeqno = 0;
+        uint32_t features = 0;
+        queued_item item;
+    };
+
+    Slot& getSlot(int64_t bySeqno, uint32_t features);
+
+    /// Update the bytes held (here and in EPStats) by delta
+    void adjustBytes(int64_t delta);
+
+    EPStats& stats;
+    const size_t maxBytes;
+
+    std::mutex mutex;
+    std::vector<Slot> slots;
+    std::atomic<size_t> bytes{0};
+    std::atomic<size_t> streams{0};
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+};
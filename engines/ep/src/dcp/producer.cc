@@ -30,6 +30,7 @@
 #include "dcp/dcpconnmap.h"
 #include "dcp/notifier_stream.h"
 #include "dcp/response.h"
+#include "dcp/zstd_compression.h"
 #include "executorpool.h"
 #include "failover-table.h"
 #include "item_eviction.h"
@@ -39,6 +40,8 @@
 
 #include <memcached/server_cookie_iface.h>
 
+#include <chrono>
+
 const std::chrono::seconds DcpProducer::defaultDcpNoopTxInterval(20);
 
 DcpProducer::BufferLog::State DcpProducer::BufferLog::getState_UNLOCKED() {
@@ -157,6 +160,19 @@ static IncludeValue toIncludeValue(uint32_t flags) {
     return IncludeValue::Yes;
 }
 
+static WeightedReadyQueue::Weights getReadyQueueWeights(
+        Configuration& config) {
+    WeightedReadyQueue::Weights weights;
+    weights[size_t(DcpStreamClass::Replication)] =
+            config.getDcpProducerReplicationWeight();
+    weights[size_t(DcpStreamClass::Takeover)] =
+            config.getDcpProducerTakeoverWeight();
+    weights[size_t(DcpStreamClass::Bulk)] = config.getDcpProducerBulkWeight();
+    weights[size_t(DcpStreamClass::Backfill)] =
+            config.getDcpProducerBackfillWeight();
+    return weights;
+}
+
 DcpProducer::DcpProducer(EventuallyPersistentEngine& e,
                          const void* cookie,
                          const std::string& name,
@@ -169,10 +185,13 @@ DcpProducer::DcpProducer(EventuallyPersistentEngine& e,
       lastSendTime(ep_current_time()),
       log(*this),
       backfillMgr(std::make_shared<BackfillManager>(engine_)),
+      ready(getReadyQueueWeights(e.getConfiguration())),
       streams(streamsMapSize),
       itemsSent(0),
       totalBytesSent(0),
       totalUncompressedDataSize(0),
+      stepBatchSize(e.getConfiguration().getDcpProducerStepBatchSize()),
+      stepBatchBytes(e.getConfiguration().getDcpProducerStepBatchBytes()),
       includeValue(toIncludeValue(flags)),
       includeXattrs(
               ((flags & cb::mcbp::request::DcpOpenPayload::IncludeXattrs) != 0)
@@ -241,6 +260,10 @@ DcpProducer::DcpProducer(EventuallyPersistentEngine& e,
 
     enableExtMetaData = false;
     forceValueCompression = false;
+    enableZstdCompression = false;
+    zstdCompressionLevel =
+            engine_.getConfiguration().getDcpZstdCompressionLevel();
+    zstdDictionaries = false;
     enableExpiryOpcode = false;
 
     // Cursor dropping is disabled for replication connections by default,
@@ -539,7 +562,7 @@ ENGINE_ERROR_CODE DcpProducer::streamRequest(
                 rv);
     }
 
-    notifyStreamReady(vbucket);
+    notifyStreamReady(vbucket, s->getStreamClass());
 
     if (add_vb_conn_map) {
         engine_.getDcpConnMap().addVBConnByVBId(shared_from_this(), vbucket);
@@ -581,6 +604,36 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
         return ret;
     }
 
+    // Send as many messages as the batch limits allow, so the front end
+    // doesn't have to call back into the engine for every message
+    const auto start = std::chrono::steady_clock::now();
+    size_t messages = 0;
+    size_t bytes = 0;
+    while ((ret = sendNextMessage(producers, bytes)) == ENGINE_SUCCESS) {
+        if (++messages >= stepBatchSize || bytes >= stepBatchBytes) {
+            break;
+        }
+    }
+
+    if (messages > 0) {
+        stepCount.fetch_add(1);
+        stepMessages.fetch_add(messages);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        stepTime.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                        .count());
+        // Something was sent, so report success; the next call finds there's
+        // nothing left (or retries the message which didn't fit)
+        if (ret == ENGINE_EWOULDBLOCK || ret == ENGINE_E2BIG) {
+            ret = ENGINE_SUCCESS;
+        }
+    }
+    return ret;
+}
+
+ENGINE_ERROR_CODE DcpProducer::sendNextMessage(
+        struct dcp_message_producers* producers, size_t& bytes) {
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
     std::unique_ptr<DcpResponse> resp;
     if (rejectResp) {
         resp = std::move(rejectResp);
@@ -822,6 +875,7 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
         }
 
         totalBytesSent.fetch_add(resp->getMessageSize());
+        bytes += resp->getMessageSize();
     }
 
     lastSendTime = ep_current_time();
@@ -912,6 +966,32 @@ ENGINE_ERROR_CODE DcpProducer::control(uint32_t opaque,
             forceValueCompression = false;
         }
         return ENGINE_SUCCESS;
+    } else if (keyStr == "enable_zstd_compression") {
+        // The zstd settings are picked up by streams when they are created
+        if (!DcpZstdCompression::isSupported()) {
+            engine_.setErrorContext(getCookie(),
+                                    "zstd compression is not supported");
+            return ENGINE_EINVAL;
+        }
+        enableZstdCompression = (valueStr == "true");
+        return ENGINE_SUCCESS;
+    } else if (keyStr == "zstd_compression_level") {
+        int level;
+        try {
+            level = std::stoi(valueStr);
+        } catch (const std::exception&) {
+            return ENGINE_EINVAL;
+        }
+        if (!DcpZstdCompression::isValidLevel(level)) {
+            engine_.setErrorContext(getCookie(),
+                                    "Invalid zstd compression level");
+            return ENGINE_EINVAL;
+        }
+        zstdCompressionLevel = level;
+        return ENGINE_SUCCESS;
+    } else if (keyStr == "zstd_dictionaries") {
+        zstdDictionaries = (valueStr == "true");
+        return ENGINE_SUCCESS;
         // vulcan onwards we accept two cursor_dropping control keys.
     } else if (keyStr == "supports_cursor_dropping_vulcan" ||
                keyStr == "supports_cursor_dropping") {
@@ -1280,6 +1360,9 @@ void DcpProducer::addStats(const AddStatFn& add_stat, const void* c) {
     addStat("items_sent", getItemsSent(), add_stat, c);
     addStat("items_remaining", getItemsRemaining(), add_stat, c);
     addStat("total_bytes_sent", getTotalBytesSent(), add_stat, c);
+    addStat("step_count", stepCount.load(), add_stat, c);
+    addStat("step_messages", stepMessages.load(), add_stat, c);
+    addStat("step_time_ns", stepTime.load(), add_stat, c);
     if (isCompressionEnabled()) {
         addStat("total_uncompressed_data_size", getTotalUncompressedDataSize(),
                 add_stat, c);
@@ -1290,6 +1373,8 @@ void DcpProducer::addStats(const AddStatFn& add_stat, const void* c) {
     addStat("noop_wait", noopCtx.pendingRecv, add_stat, c);
     addStat("enable_ext_metadata", enableExtMetaData, add_stat, c);
     addStat("force_value_compression", forceValueCompression, add_stat, c);
+    addStat("zstd_compression_level", getZstdCompressionLevel(), add_stat, c);
+    addStat("zstd_dictionaries", zstdDictionaries, add_stat, c);
     addStat("cursor_dropping", supportsCursorDropping, add_stat, c);
     addStat("send_stream_end_on_client_close_stream",
             sendStreamEndOnClientStreamClose,
@@ -1556,9 +1641,10 @@ std::unique_ptr<DcpResponse> DcpProducer::getNextItem() {
         unPause();
 
         Vbid vbucket = Vbid(0);
-        while (ready.popFront(vbucket)) {
+        DcpStreamClass streamClass;
+        while (ready.popFront(vbucket, streamClass)) {
             if (log.pauseIfFull()) {
-                ready.pushUnique(vbucket);
+                ready.pushUnique(vbucket, streamClass);
                 return NULL;
             }
 
@@ -1606,7 +1692,9 @@ std::unique_ptr<DcpResponse> DcpProducer::getNextItem() {
                                     response->to_string());
                         }
 
-                        ready.pushUnique(vbucket);
+                        // Requeue in the class the stream is in now, e.g. a
+                        // backfill may have completed
+                        ready.pushUnique(vbucket, stream->getStreamClass());
                         return response;
                     } // else next stream for vb
                 }
@@ -1641,8 +1729,9 @@ void DcpProducer::setDisconnect() {
             });
 }
 
-void DcpProducer::notifyStreamReady(Vbid vbucket) {
-    if (ready.pushUnique(vbucket)) {
+void DcpProducer::notifyStreamReady(Vbid vbucket,
+                                    DcpStreamClass streamClass) {
+    if (ready.pushUnique(vbucket, streamClass)) {
         // Transitioned from empty to non-empty readyQ - unpause the Producer.
         log.unpauseIfSpaceAvailable();
     }
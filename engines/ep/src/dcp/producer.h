@@ -21,9 +21,9 @@
 #include "connhandler.h"
 #include "dcp/dcp-types.h"
 #include "dcp/stream_container.h"
+#include "dcp/weighted_ready_queue.h"
 #include "ep_engine.h"
 #include "monotonic.h"
-#include "vb_ready_queue.h"
 
 #include <folly/AtomicHashMap.h>
 #include <folly/CachelinePadded.h>
@@ -172,7 +172,14 @@ public:
                                   Vbid vbucket,
                                   cb::mcbp::DcpStreamId sid = {}) override;
 
-    void notifyStreamReady(Vbid vbucket);
+    /**
+     * Queue the vbucket for the front end to send from its streams.
+     *
+     * @param streamClass The class to schedule the vbucket in, see
+     *        WeightedReadyQueue
+     */
+    void notifyStreamReady(Vbid vbucket,
+                           DcpStreamClass streamClass = DcpStreamClass::Bulk);
 
     void notifyBackfillManager();
     bool recordBackfillManagerBytesRead(size_t bytes, bool force);
@@ -204,6 +211,18 @@ public:
                                            PROTOCOL_BINARY_DATATYPE_SNAPPY);
     }
 
+    /**
+     * @return the zstd level values should be compressed at, or 0 if the
+     *         client didn't enable zstd compression
+     */
+    int getZstdCompressionLevel() const {
+        return enableZstdCompression ? zstdCompressionLevel.load() : 0;
+    }
+
+    bool isZstdDictionariesEnabled() const {
+        return zstdDictionaries;
+    }
+
     bool isCursorDroppingEnabled() const {
         return supportsCursorDropping.load();
     }
@@ -369,6 +388,18 @@ protected:
      */
     ENGINE_ERROR_CODE maybeSendNoop(struct dcp_message_producers* producers);
 
+    /**
+     * Send the next message from the ready streams (or the message which was
+     * previously rejected with E2BIG).
+     *
+     * @param producers The callbacks used to send the message
+     * @param bytes Incremented by the size of the message if it was sent
+     * @return ENGINE_SUCCESS if a message was sent, ENGINE_EWOULDBLOCK if
+     *         there was nothing to send, or the error returned by producers
+     */
+    ENGINE_ERROR_CODE sendNextMessage(struct dcp_message_producers* producers,
+                                      size_t& bytes);
+
     /**
      * Create the ActiveStreamCheckpointProcessorTask and assign to
      * checkpointCreatorTask
@@ -540,6 +571,9 @@ protected:
 
     cb::RelaxedAtomic<bool> enableExtMetaData;
     cb::RelaxedAtomic<bool> forceValueCompression;
+    cb::RelaxedAtomic<bool> enableZstdCompression;
+    cb::RelaxedAtomic<int> zstdCompressionLevel;
+    cb::RelaxedAtomic<bool> zstdDictionaries;
     cb::RelaxedAtomic<bool> supportsCursorDropping;
     cb::RelaxedAtomic<bool> sendStreamEndOnClientStreamClose;
     cb::RelaxedAtomic<bool> consumerSupportsHifiMfu;
@@ -564,7 +598,7 @@ protected:
     //   a connection is disconnected.
     cb::AtomicSharedPtr<BackfillManager> backfillMgr;
 
-    VBReadyQueue ready;
+    WeightedReadyQueue ready;
 
     /**
      * Folly's AtomicHashMap offers great performance if you know the maximum
@@ -591,6 +625,17 @@ protected:
     std::atomic<size_t> totalBytesSent;
     std::atomic<size_t> totalUncompressedDataSize;
 
+    /// The maximum number of messages, and the number of bytes after which
+    /// no more messages are sent, in a single call to step()
+    const size_t stepBatchSize;
+    const size_t stepBatchBytes;
+
+    /// Number of calls to step() which sent at least one message, the total
+    /// number of messages sent by them and the time (ns) spent in them
+    cb::RelaxedAtomic<uint64_t> stepCount{0};
+    cb::RelaxedAtomic<uint64_t> stepMessages{0};
+    cb::RelaxedAtomic<uint64_t> stepTime{0};
+
     /// Guards access to checkpointCreatorTask, so multiple threads can
     /// safely access  checkpointCreatorTask shared ptr.
     struct CheckpointCreator {
@@ -111,6 +111,11 @@ public:
     /// @returns true if state_ is not in the Dead state.
     virtual bool isActive() const = 0;
 
+    /// @returns the class the producer schedules the stream in
+    virtual DcpStreamClass getStreamClass() const {
+        return DcpStreamClass::Bulk;
+    }
+
     void clear();
 
     virtual bool compareStreamId(cb::mcbp::DcpStreamId id) const {
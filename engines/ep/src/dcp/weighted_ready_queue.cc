@@ -0,0 +1,181 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "dcp/weighted_ready_queue.h"
+
+#include "locks.h"
+#include "statwriter.h"
+
+#include <stdexcept>
+
+WeightedReadyQueue::WeightedReadyQueue(const Weights& weights) {
+    for (size_t ii = 0; ii < DcpStreamClassCount; ++ii) {
+        if (weights[ii] == 0) {
+            throw std::invalid_argument(
+                    "WeightedReadyQueue: weight of class " +
+                    std::string(to_string(DcpStreamClass(ii))) +
+                    " must be non-zero");
+        }
+        classes[ii].weight = int64_t(weights[ii]);
+    }
+}
+
+bool WeightedReadyQueue::exists(Vbid vbucket) {
+    LockHolder lh(lock);
+    return (queuedValues.count(vbucket) != 0);
+}
+
+bool WeightedReadyQueue::popFront(Vbid& frontValue,
+                                  DcpStreamClass& streamClass) {
+    LockHolder lh(lock);
+    // Smooth weighted round robin: every class with something queued gains
+    // its weight in credit, the class with the most credit is served and
+    // pays back the total weight of the contending classes.
+    Class* next = nullptr;
+    int64_t total = 0;
+    for (auto& cls : classes) {
+        if (cls.queue.empty()) {
+            continue;
+        }
+        cls.current += cls.weight;
+        total += cls.weight;
+        if (!next || cls.current > next->current) {
+            next = &cls;
+        }
+    }
+    if (!next) {
+        return false;
+    }
+    next->current -= total;
+
+    const auto entry = next->queue.front();
+    next->queue.pop_front();
+    queuedValues.erase(entry.vbucket);
+    if (next->queue.empty()) {
+        // Don't carry credit (or debt) into the next time the class is busy
+        next->current = 0;
+    }
+
+    next->waitHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - entry.enqueued));
+    ++next->served;
+
+    frontValue = entry.vbucket;
+    streamClass = DcpStreamClass(next - classes.data());
+    return true;
+}
+
+bool WeightedReadyQueue::pushUnique(Vbid vbucket, DcpStreamClass streamClass) {
+    bool wasEmpty;
+    {
+        LockHolder lh(lock);
+        wasEmpty = queuedValues.empty();
+        const bool inserted = queuedValues.emplace(vbucket).second;
+        if (inserted) {
+            classes[size_t(streamClass)].queue.push_back(
+                    {vbucket, std::chrono::steady_clock::now()});
+        }
+    }
+    return wasEmpty;
+}
+
+size_t WeightedReadyQueue::size() {
+    LockHolder lh(lock);
+    return queuedValues.size();
+}
+
+bool WeightedReadyQueue::empty() {
+    LockHolder lh(lock);
+    return queuedValues.empty();
+}
+
+void WeightedReadyQueue::clear() {
+    LockHolder lh(lock);
+    for (auto& cls : classes) {
+        cls.queue.clear();
+        cls.current = 0;
+    }
+    queuedValues.clear();
+}
+
+void WeightedReadyQueue::addStats(const std::string& prefix,
+                                  const AddStatFn& add_stat,
+                                  const void* c) const {
+    // Take a copy of the queue data under lock; then format it to stats.
+    std::array<std::deque<Entry>, DcpStreamClassCount> qCopy;
+    size_t mapSize;
+    {
+        LockHolder lh(lock);
+        for (size_t ii = 0; ii < DcpStreamClassCount; ++ii) {
+            qCopy[ii] = classes[ii].queue;
+        }
+        mapSize = queuedValues.size();
+    }
+
+    size_t size = 0;
+    // Form a comma-separated string of the queue's contents, in the order of
+    // the classes' priority.
+    std::string contents;
+    for (size_t ii = 0; ii < DcpStreamClassCount; ++ii) {
+        const auto& cls = classes[ii];
+        const std::string classPrefix =
+                prefix + to_string(DcpStreamClass(ii)) + "_";
+        size += qCopy[ii].size();
+        for (const auto& entry : qCopy[ii]) {
+            contents += std::to_string(entry.vbucket.get()) + ",";
+        }
+
+        add_casted_stat((classPrefix + "size").c_str(),
+                        qCopy[ii].size(),
+                        add_stat,
+                        c);
+        add_casted_stat(
+                (classPrefix + "weight").c_str(), cls.weight, add_stat, c);
+        add_casted_stat((classPrefix + "served").c_str(),
+                        cls.served.load(),
+                        add_stat,
+                        c);
+        if (cls.waitHisto.getValueCount() > 0) {
+            add_casted_stat((classPrefix + "wait").c_str(),
+                            cls.waitHisto,
+                            add_stat,
+                            c);
+        }
+    }
+    if (!contents.empty()) {
+        contents.pop_back();
+    }
+
+    add_casted_stat((prefix + "size").c_str(), size, add_stat, c);
+    add_casted_stat((prefix + "map_size").c_str(), mapSize, add_stat, c);
+    add_casted_stat(
+            (prefix + "contents").c_str(), contents.c_str(), add_stat, c);
+}
+
+const char* WeightedReadyQueue::to_string(DcpStreamClass streamClass) {
+    switch (streamClass) {
+    case DcpStreamClass::Replication:
+        return "replication";
+    case DcpStreamClass::Takeover:
+        return "takeover";
+    case DcpStreamClass::Bulk:
+        return "bulk";
+    case DcpStreamClass::Backfill:
+        return "backfill";
+    }
+    return "<unknown>";
+}
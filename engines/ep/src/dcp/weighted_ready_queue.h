@@ -0,0 +1,120 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "dcp/dcp-types.h"
+
+#include <memcached/engine_common.h>
+#include <memcached/vbucket.h>
+#include <utilities/hdrhistogram.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <unordered_set>
+
+/**
+ * The queue of vbuckets with streams ready to send, used by a DcpProducer in
+ * place of a VBReadyQueue.
+ *
+ * Each vbucket is queued in the DcpStreamClass of the stream which made it
+ * ready, and the classes are served in smooth weighted round robin: when
+ * several classes have vbuckets queued, each is picked in proportion to its
+ * weight and the picks are interleaved (weights 2:1 pick A, B, A rather than
+ * A, A, B). A class with nothing queued doesn't accumulate credit, and
+ * every class with a weight is served eventually, so backfills can't starve.
+ *
+ * As with VBReadyQueue a vbucket is queued at most once, in the class it was
+ * first pushed with.
+ */
+class WeightedReadyQueue {
+public:
+    using Weights = std::array<size_t, DcpStreamClassCount>;
+
+    /// @param weights The weight of each DcpStreamClass (minimum 1)
+    explicit WeightedReadyQueue(const Weights& weights);
+
+    bool exists(Vbid vbucket);
+
+    /**
+     * Return true and set the ref-params if the queue is not empty.
+     * frontValue is set to the vbucket of the class to be served next.
+     */
+    bool popFront(Vbid& frontValue, DcpStreamClass& streamClass);
+
+    /**
+     * Push the vbucket into the queue of the given class, only if it's not
+     * already queued.
+     * @return true if the queue was previously empty (i.e. we have
+     * transitioned from zero -> one elements in the queue).
+     */
+    bool pushUnique(Vbid vbucket, DcpStreamClass streamClass);
+
+    /**
+     * Size of the queue (all classes).
+     */
+    size_t size();
+
+    /**
+     * @return true if empty
+     */
+    bool empty();
+
+    /**
+     * Clears the queue
+     */
+    void clear();
+
+    void addStats(const std::string& prefix,
+                  const AddStatFn& add_stat,
+                  const void* c) const;
+
+    /// @return the name of the class, as used in stats
+    static const char* to_string(DcpStreamClass streamClass);
+
+private:
+    struct Entry {
+        Vbid vbucket;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    struct Class {
+        /// Set by the constructor, read-only afterwards
+        int64_t weight = 1;
+        /// Smooth weighted round robin credit
+        int64_t current = 0;
+        std::deque<Entry> queue;
+
+        /// Time vbuckets spent queued before being served
+        Hdr1sfMicroSecHistogram waitHisto;
+        std::atomic<uint64_t> served{0};
+    };
+
+    // Mutable so that we can lock in addStats (const) to copy the queues
+    mutable std::mutex lock;
+
+    std::array<Class, DcpStreamClassCount> classes;
+
+    /**
+     * All the vbuckets in the queues, enabling a fast exists method which is
+     * used by front-end threads.
+     */
+    std::unordered_set<Vbid> queuedValues;
+};
@@ -0,0 +1,381 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "dcp/zstd_compression.h"
+#include "bucket_logger.h"
+#include "executorpool.h"
+#include "statwriter.h"
+
+#include <phosphor/phosphor.h>
+#include <platform/base64.h>
+
+#ifdef EP_USE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+// Larger values compress well enough on their own and would dominate the
+// training data
+static const size_t maxSampleSize = 4096;
+
+struct DcpZstdCompression::Dictionary {
+    Dictionary(CollectionID cid, std::string data, uint32_t id)
+        : cid(cid), data(std::move(data)), id(id) {
+    }
+
+    const CollectionID cid;
+    const std::string data;
+    const uint32_t id;
+
+#ifdef EP_USE_ZSTD
+    ~Dictionary() {
+        for (auto& cdict : cdicts) {
+            ZSTD_freeCDict(cdict.second);
+        }
+        ZSTD_freeDDict(ddict);
+    }
+
+    /// @return the dictionary digested for compression at the given level
+    const ZSTD_CDict* getCDict(int level) {
+        std::lock_guard<std::mutex> lh(mutex);
+        auto& cdict = cdicts[level];
+        if (!cdict) {
+            cdict = ZSTD_createCDict(data.data(), data.size(), level);
+        }
+        return cdict;
+    }
+
+    const ZSTD_DDict* getDDict() {
+        std::lock_guard<std::mutex> lh(mutex);
+        if (!ddict) {
+            ddict = ZSTD_createDDict(data.data(), data.size());
+        }
+        return ddict;
+    }
+
+    std::mutex mutex;
+    std::map<int, ZSTD_CDict*> cdicts;
+    ZSTD_DDict* ddict = nullptr;
+#endif
+};
+
+/**
+ * A zstd compression context holds a few hundred KB (more at higher levels),
+ * so rather than creating one per value they are pooled.
+ */
+struct DcpZstdCompression::CompressionContexts {
+#ifdef EP_USE_ZSTD
+    ~CompressionContexts() {
+        for (auto* cctx : available) {
+            ZSTD_freeCCtx(cctx);
+        }
+    }
+
+    ZSTD_CCtx* acquire() {
+        std::lock_guard<std::mutex> lh(mutex);
+        if (available.empty()) {
+            return ZSTD_createCCtx();
+        }
+        auto* cctx = available.back();
+        available.pop_back();
+        return cctx;
+    }
+
+    void release(ZSTD_CCtx* cctx) {
+        std::lock_guard<std::mutex> lh(mutex);
+        available.push_back(cctx);
+    }
+
+    std::mutex mutex;
+    std::vector<ZSTD_CCtx*> available;
+#endif
+};
+
+DcpZstdCompression::DcpZstdCompression(EventuallyPersistentEngine& engine,
+                                       size_t sampleCount,
+                                       size_t dictionarySize)
+    : engine(engine),
+      sampleCount(sampleCount),
+      dictionarySize(dictionarySize),
+      contexts(std::make_unique<CompressionContexts>()) {
+}
+
+DcpZstdCompression::~DcpZstdCompression() = default;
+
+bool DcpZstdCompression::isSupported() {
+#ifdef EP_USE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool DcpZstdCompression::isValidLevel(int level) {
+#ifdef EP_USE_ZSTD
+    return level >= 1 && level <= ZSTD_maxCLevel();
+#else
+    return false;
+#endif
+}
+
+bool DcpZstdCompression::compress(CollectionID cid,
+                                  cb::const_char_buffer value,
+                                  int level,
+                                  bool useDictionary,
+                                  std::string& output) {
+#ifdef EP_USE_ZSTD
+    std::shared_ptr<Dictionary> dictionary;
+    if (useDictionary) {
+        dictionary = sample(cid, value);
+    }
+
+    output.resize(ZSTD_compressBound(value.size()));
+    auto* cctx = contexts->acquire();
+    if (cctx == nullptr) {
+        return false;
+    }
+    size_t size;
+    const ZSTD_CDict* cdict =
+            dictionary ? dictionary->getCDict(level) : nullptr;
+    if (cdict) {
+        size = ZSTD_compress_usingCDict(cctx,
+                                        &output[0],
+                                        output.size(),
+                                        value.data(),
+                                        value.size(),
+                                        cdict);
+    } else {
+        size = ZSTD_compressCCtx(cctx,
+                                 &output[0],
+                                 output.size(),
+                                 value.data(),
+                                 value.size(),
+                                 level);
+    }
+    contexts->release(cctx);
+
+    if (ZSTD_isError(size) || size >= value.size()) {
+        return false;
+    }
+    output.resize(size);
+    bytesIn += value.size();
+    bytesOut += size;
+    return true;
+#else
+    (void)cid;
+    (void)value;
+    (void)level;
+    (void)useDictionary;
+    (void)output;
+    return false;
+#endif
+}
+
+bool DcpZstdCompression::decompress(cb::const_char_buffer value,
+                                    std::string& output) const {
+#ifdef EP_USE_ZSTD
+    const auto contentSize =
+            ZSTD_getFrameContentSize(value.data(), value.size());
+    if (contentSize == ZSTD_CONTENTSIZE_ERROR ||
+        contentSize == ZSTD_CONTENTSIZE_UNKNOWN) {
+        return false;
+    }
+    output.resize(contentSize);
+
+    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(
+            ZSTD_createDCtx(), ZSTD_freeDCtx);
+    size_t size;
+    const auto dictId = ZSTD_getDictID_fromFrame(value.data(), value.size());
+    if (dictId != 0) {
+        std::shared_ptr<Dictionary> dictionary;
+        {
+            std::lock_guard<std::mutex> lh(mutex);
+            auto it = dictionariesById.find(dictId);
+            if (it == dictionariesById.end()) {
+                return false;
+            }
+            dictionary = it->second;
+        }
+        size = ZSTD_decompress_usingDDict(dctx.get(),
+                                          &output[0],
+                                          output.size(),
+                                          value.data(),
+                                          value.size(),
+                                          dictionary->getDDict());
+    } else {
+        size = ZSTD_decompressDCtx(dctx.get(),
+                                   &output[0],
+                                   output.size(),
+                                   value.data(),
+                                   value.size());
+    }
+    if (ZSTD_isError(size)) {
+        return false;
+    }
+    output.resize(size);
+    return true;
+#else
+    (void)value;
+    (void)output;
+    return false;
+#endif
+}
+
+size_t DcpZstdCompression::getNumDictionaries() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return dictionariesById.size();
+}
+
+void DcpZstdCompression::addStats(const AddStatFn& add_stat,
+                                  const void* cookie) const {
+    add_casted_stat("supported", isSupported(), add_stat, cookie);
+    add_casted_stat("bytes_in", bytesIn, add_stat, cookie);
+    add_casted_stat("bytes_out", bytesOut, add_stat, cookie);
+
+    std::lock_guard<std::mutex> lh(mutex);
+    add_casted_stat("dictionaries", dictionariesById.size(), add_stat, cookie);
+    for (const auto& entry : dictionariesById) {
+        const std::string prefix =
+                "dictionary:" + std::to_string(entry.first) + ":";
+        add_casted_stat((prefix + "cid").c_str(),
+                        entry.second->cid.to_string(),
+                        add_stat,
+                        cookie);
+        add_casted_stat((prefix + "data").c_str(),
+                        cb::base64::encode(entry.second->data, false),
+                        add_stat,
+                        cookie);
+    }
+}
+
+std::shared_ptr<DcpZstdCompression::Dictionary> DcpZstdCompression::sample(
+        CollectionID cid, cb::const_char_buffer value) {
+    std::unique_lock<std::mutex> lh(mutex);
+    auto& collection = collections[cid];
+    if (collection.dictionary || collection.training ||
+        collection.trainingFailed) {
+        return collection.dictionary;
+    }
+
+    if (value.size() <= maxSampleSize) {
+        collection.samples.emplace_back(value.data(), value.size());
+    }
+    if (collection.samples.size() < sampleCount) {
+        return {};
+    }
+
+    // Enough samples - train the dictionary in the background; values are
+    // compressed without one until it's ready
+    collection.training = true;
+    auto samples = std::move(collection.samples);
+    collection.samples.clear();
+    lh.unlock();
+
+    ExecutorPool::get()->schedule(
+            std::make_shared<DcpZstdDictionaryTrainerTask>(
+                    engine, *this, cid, std::move(samples)));
+    return {};
+}
+
+void DcpZstdCompression::trainDictionary(
+        CollectionID cid, const std::vector<std::string>& samples) {
+    auto dictionary = train(cid, samples);
+
+    std::lock_guard<std::mutex> lh(mutex);
+    auto& trained = collections[cid];
+    trained.training = false;
+    if (!dictionary || dictionariesById.count(dictionary->id)) {
+        trained.trainingFailed = true;
+        return;
+    }
+    trained.dictionary = dictionary;
+    dictionariesById[dictionary->id] = dictionary;
+}
+
+std::shared_ptr<DcpZstdCompression::Dictionary> DcpZstdCompression::train(
+        CollectionID cid, const std::vector<std::string>& samples) {
+#ifdef EP_USE_ZSTD
+    std::string buffer;
+    std::vector<size_t> sizes;
+    sizes.reserve(samples.size());
+    for (const auto& sample : samples) {
+        buffer.append(sample);
+        sizes.push_back(sample.size());
+    }
+
+    std::string data(dictionarySize, '\0');
+    const auto size = ZDICT_trainFromBuffer(&data[0],
+                                            data.size(),
+                                            buffer.data(),
+                                            sizes.data(),
+                                            unsigned(sizes.size()));
+    if (ZDICT_isError(size)) {
+        EP_LOG_INFO(
+                "DcpZstdCompression::train: failed to train a dictionary "
+                "for collection {} from {} samples: {}",
+                cid.to_string(),
+                samples.size(),
+                ZDICT_getErrorName(size));
+        return {};
+    }
+    data.resize(size);
+
+    const auto id = ZDICT_getDictID(data.data(), data.size());
+    if (id == 0) {
+        return {};
+    }
+    EP_LOG_INFO(
+            "DcpZstdCompression::train: trained dictionary {} ({} bytes) for "
+            "collection {}",
+            id,
+            size,
+            cid.to_string());
+    return std::make_shared<Dictionary>(cid, std::move(data), id);
+#else
+    (void)cid;
+    (void)samples;
+    return {};
+#endif
+}
+
+DcpZstdDictionaryTrainerTask::DcpZstdDictionaryTrainerTask(
+        EventuallyPersistentEngine& e,
+        DcpZstdCompression& compression,
+        CollectionID cid,
+        std::vector<std::string> samples)
+    : GlobalTask(&e, TaskId::DcpZstdDictionaryTrainerTask, 0, false),
+      compression(compression),
+      cid(cid),
+      samples(std::move(samples)) {
+}
+
+bool DcpZstdDictionaryTrainerTask::run() {
+    TRACE_EVENT0("ep-engine/task", "DcpZstdDictionaryTrainerTask");
+    compression.trainDictionary(cid, samples);
+    return false;
+}
+
+std::string DcpZstdDictionaryTrainerTask::getDescription() {
+    return "Training zstd dictionary for DCP values of collection " +
+           cid.to_string();
+}
+
+std::chrono::microseconds DcpZstdDictionaryTrainerTask::maxExpectedDuration() {
+    // Training from the default 1000 samples of up to 4KB takes a few
+    // hundred ms
+    return std::chrono::seconds(1);
+}
@@ -0,0 +1,169 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "globaltask.h"
+
+#include <memcached/dockey.h>
+#include <memcached/engine_common.h>
+#include <platform/sized_buffer.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class EventuallyPersistentEngine;
+
+/**
+ * zstd compression of the values sent over DCP, shared by all the producers
+ * of a bucket.
+ *
+ * Small documents (typically JSON of a few hundred bytes) compress poorly on
+ * their own as there is little repetition within a single value. When
+ * dictionaries are requested the first values sent for each collection are
+ * sampled and, once enough samples are collected, a zstd dictionary is
+ * trained from them by a DcpZstdDictionaryTrainerTask (training takes a
+ * while, so isn't done by the stream); later values of the collection are
+ * compressed with it.
+ *
+ * The ID of the dictionary used is stored in the zstd frame header. Clients
+ * fetch the dictionaries they don't know yet with the "dcp-zstd" stat group.
+ *
+ * Only available if ep-engine was built with zstd (EP_USE_ZSTD).
+ */
+class DcpZstdCompression {
+public:
+    /**
+     * @param engine The engine to schedule the dictionary training tasks of
+     * @param sampleCount Number of values to sample per collection before
+     *        training its dictionary
+     * @param dictionarySize Max size of a dictionary
+     */
+    DcpZstdCompression(EventuallyPersistentEngine& engine,
+                       size_t sampleCount,
+                       size_t dictionarySize);
+
+    ~DcpZstdCompression();
+
+    /// @return true if ep-engine was built with zstd support
+    static bool isSupported();
+
+    /// @return true if level is a valid zstd compression level
+    static bool isValidLevel(int level);
+
+    /**
+     * Compress the given value.
+     *
+     * @param cid The collection of the document (selects the dictionary)
+     * @param value The uncompressed value
+     * @param level zstd compression level
+     * @param useDictionary Sample the value and use the collection's
+     *        dictionary if one has been trained
+     * @param output The compressed value
+     * @return true if the value was compressed to fewer bytes
+     */
+    bool compress(CollectionID cid,
+                  cb::const_char_buffer value,
+                  int level,
+                  bool useDictionary,
+                  std::string& output);
+
+    /**
+     * Decompress a value compressed by compress(); used by tests and
+     * clients built on top of ep-engine.
+     *
+     * @return true on success
+     */
+    bool decompress(cb::const_char_buffer value, std::string& output) const;
+
+    /// @return the number of dictionaries trained
+    size_t getNumDictionaries() const;
+
+    void addStats(const AddStatFn& add_stat, const void* cookie) const;
+
+    /**
+     * Train the dictionary of the collection from the samples and start
+     * using it. Called by the DcpZstdDictionaryTrainerTask.
+     */
+    void trainDictionary(CollectionID cid,
+                         const std::vector<std::string>& samples);
+
+private:
+    struct Dictionary;
+    struct CompressionContexts;
+
+    struct CollectionSamples {
+        std::vector<std::string> samples;
+        std::shared_ptr<Dictionary> dictionary;
+        bool training = false;
+        bool trainingFailed = false;
+    };
+
+    /**
+     * Record a sample of the collection's values, scheduling the training of
+     * its dictionary once there are enough.
+     *
+     * @return the collection's dictionary, if already trained
+     */
+    std::shared_ptr<Dictionary> sample(CollectionID cid,
+                                       cb::const_char_buffer value);
+
+    /// Train a dictionary from the samples; called without the mutex held
+    std::shared_ptr<Dictionary> train(CollectionID cid,
+                                      const std::vector<std::string>& samples);
+
+    EventuallyPersistentEngine& engine;
+    const size_t sampleCount;
+    const size_t dictionarySize;
+
+    mutable std::mutex mutex;
+    std::unordered_map<CollectionID, CollectionSamples> collections;
+    std::map<uint32_t, std::shared_ptr<Dictionary>> dictionariesById;
+
+    std::unique_ptr<CompressionContexts> contexts;
+
+    std::atomic<uint64_t> bytesIn{0};
+    std::atomic<uint64_t> bytesOut{0};
+};
+
+/**
+ * Trains the zstd dictionary of a collection from the samples collected by
+ * DcpZstdCompression.
+ */
+class DcpZstdDictionaryTrainerTask : public GlobalTask {
+public:
+    DcpZstdDictionaryTrainerTask(EventuallyPersistentEngine& e,
+                                 DcpZstdCompression& compression,
+                                 CollectionID cid,
+                                 std::vector<std::string> samples);
+
+    bool run() override;
+
+    std::string getDescription() override;
+
+    std::chrono::microseconds maxExpectedDuration() override;
+
+private:
+    DcpZstdCompression& compression;
+    const CollectionID cid;
+    const std::vector<std::string> samples;
+};
@@ -21,12 +21,14 @@
 #include "bucket_logger.h"
 #include "checkpoint_manager.h"
 #include "collections/manager.h"
+#include "crc32.h"
 #include "dcp/dcpconnmap.h"
 #include "ep_engine.h"
 #include "ep_time.h"
 #include "ep_vb.h"
 #include "executorpool.h"
 #include "failover-table.h"
+#include "flush_batch_prefetch.h"
 #include "flusher.h"
 #include "item.h"
 #include "persistence_callback.h"
@@ -39,6 +41,9 @@
 #include "warmup.h"
 
 
+#include <phosphor/phosphor.h>
+#include <platform/dirutils.h>
+#include <platform/socket.h>
 #include <platform/timeutils.h>
 #include <utilities/hdrhistogram.h>
 #include <utilities/logtags.h>
@@ -220,6 +225,8 @@ public:
                                   size_t value) override {
         if (key == "flusher_batch_split_trigger") {
             bucket.setFlusherBatchSplitTrigger(value);
+        } else if (key == "flusher_group_commit_max_vbuckets") {
+            bucket.setFlusherGroupCommitMax(value);
         } else if (key == "alog_sleep_time") {
             bucket.setAccessScannerSleeptime(value, false);
         } else if (key == "alog_task_time") {
@@ -239,6 +246,8 @@ public:
             }
         } else if (key == "retain_erroneous_tombstones") {
             bucket.setRetainErroneousTombstones(value);
+        } else if (key == "flusher_pipelined") {
+            bucket.setFlusherPipelined(value);
         } else  {
             EP_LOG_WARN("Failed to change value for unknown variable, {}", key);
         }
@@ -267,6 +276,16 @@ EPBucket::EPBucket(EventuallyPersistentEngine& theEngine)
             "flusher_batch_split_trigger",
             std::make_unique<ValueChangedListener>(*this));
 
+    flusherGroupCommitMax = config.getFlusherGroupCommitMaxVbuckets();
+    config.addValueChangedListener(
+            "flusher_group_commit_max_vbuckets",
+            std::make_unique<ValueChangedListener>(*this));
+
+    flusherPipelined = config.isFlusherPipelined();
+    config.addValueChangedListener(
+            "flusher_pipelined",
+            std::make_unique<ValueChangedListener>(*this));
+
     retainErroneousTombstones = config.isRetainErroneousTombstones();
     config.addValueChangedListener(
            "retain_erroneous_tombstones",
@@ -298,11 +317,164 @@ bool EPBucket::initialize() {
 
 std::vector<ExTask> EPBucket::deinitialize() {
     stopFlusher();
+    if (!stats.forceShutdown) {
+        saveBloomFilters();
+    }
     stopBgFetcher();
     stopWarmup();
     return KVBucket::deinitialize();
 }
 
+/**
+ * Header of a saved bloom filter file, followed by the serialised filter.
+ * All of the fields are in network byte order; crc is the crc32 of the
+ * serialised filter.
+ */
+struct BloomFilterFileHeader {
+    static constexpr uint32_t Magic = 0x56424632; // "VBF2"
+    uint32_t magic;
+    uint32_t vbid;
+    uint64_t persistedSeqno;
+    uint32_t crc;
+    uint32_t reserved;
+};
+static_assert(sizeof(BloomFilterFileHeader) == 24,
+              "BloomFilterFileHeader should have no padding");
+
+static uint32_t crc32(const std::string& data) {
+    return crc32buf(reinterpret_cast<uint8_t*>(const_cast<char*>(data.data())),
+                    data.size());
+}
+
+/**
+ * Adds the keys of all the items in a HashTable to the vbucket's bloom filter.
+ * Under full eviction resident keys are only added by compaction when the
+ * resident ratio is low, but they aren't necessarily resident again after
+ * warmup.
+ */
+class AddKeysToFilterVisitor : public HashTableVisitor {
+public:
+    explicit AddKeysToFilterVisitor(VBucket& vb) : vb(vb) {
+    }
+
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override {
+        if (!v.isTempItem()) {
+            vb.addToFilter(v.getKey());
+        }
+        return true;
+    }
+
+private:
+    VBucket& vb;
+};
+
+void EPBucket::saveBloomFilters() {
+    if (!engine.getConfiguration().isBfilterEnabled() ||
+        getItemEvictionPolicy() != EvictionPolicy::Full) {
+        return;
+    }
+
+    for (auto vbid : vbMap.getBuckets()) {
+        auto vb = getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+        AddKeysToFilterVisitor visitor(*vb);
+        vb->ht.visit(visitor);
+        const auto filter = vb->serialiseFilter();
+        if (filter.empty()) {
+            continue;
+        }
+
+        BloomFilterFileHeader header;
+        header.magic = htonl(BloomFilterFileHeader::Magic);
+        header.vbid = htonl(vbid.get());
+        header.persistedSeqno = htonll(vb->getPersistenceSeqno());
+        header.crc = htonl(crc32(filter));
+        header.reserved = 0;
+
+        const auto fname = getBloomFilterFileName(vbid);
+        const auto next_fname = fname + ".new";
+        FILE* file = fopen(next_fname.c_str(), "wb");
+        if (file == nullptr) {
+            EP_LOG_WARN("EPBucket::saveBloomFilters: Failed to open '{}': {}",
+                        next_fname,
+                        strerror(errno));
+            continue;
+        }
+        bool rv = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(filter.data(), filter.size(), 1, file) == 1;
+        if (fclose(file) != 0) {
+            rv = false;
+        }
+        if (!rv || rename(next_fname.c_str(), fname.c_str()) != 0) {
+            EP_LOG_WARN("EPBucket::saveBloomFilters: Failed to write '{}': {}",
+                        fname,
+                        strerror(errno));
+            remove(next_fname.c_str());
+        }
+    }
+}
+
+bool EPBucket::loadBloomFilter(VBucket& vb,
+                               uint64_t persistedSeqno,
+                               bool cleanShutdown) {
+    const auto fname = getBloomFilterFileName(vb.getId());
+    if (!cb::io::isFile(fname)) {
+        return false;
+    }
+
+    std::string buffer;
+    try {
+        buffer = cb::io::loadFile(fname);
+    } catch (const std::exception& exception) {
+        EP_LOG_WARN("EPBucket::loadBloomFilter: Failed to load '{}': {}",
+                    fname,
+                    exception.what());
+    }
+    remove(fname.c_str());
+
+    if (!cleanShutdown) {
+        // The data files may have been written to after the filter was saved
+        EP_LOG_INFO(
+                "EPBucket::loadBloomFilter: Ignoring bloom filter of {} "
+                "saved before an unclean shutdown",
+                vb.getId());
+        return false;
+    }
+
+    BloomFilterFileHeader header;
+    if (buffer.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    if (ntohl(header.magic) != BloomFilterFileHeader::Magic ||
+        ntohl(header.vbid) != vb.getId().get() ||
+        ntohll(header.persistedSeqno) != persistedSeqno) {
+        EP_LOG_INFO(
+                "EPBucket::loadBloomFilter: Ignoring stale bloom filter of {}",
+                vb.getId());
+        return false;
+    }
+
+    const auto filter = buffer.substr(sizeof(header));
+    if (ntohl(header.crc) != crc32(filter)) {
+        EP_LOG_WARN(
+                "EPBucket::loadBloomFilter: Ignoring corrupt bloom filter of "
+                "{}",
+                vb.getId());
+        return false;
+    }
+    return vb.restoreFilter({filter.data(), filter.size()});
+}
+
+std::string EPBucket::getBloomFilterFileName(Vbid vbid) const {
+    std::string fname = engine.getConfiguration().getDbname() + "/" +
+                        std::to_string(vbid.get()) + ".bloomfilter";
+    cb::io::sanitizePath(fname);
+    return fname;
+}
+
 /**
  * @returns true if the item `candidate` can be de-duplicated (skipped) because
  * `lastFlushed` already supercedes it.
@@ -328,418 +500,582 @@ static bool canDeDuplicate(Item* lastFlushed, Item& candidate) {
     return true;
 }
 
-std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
-    int items_flushed = 0;
-    bool moreAvailable = false;
-    const auto flush_start = std::chrono::steady_clock::now();
+/**
+ * A batch written to the KVStore by writeFlushBatch(), with what's needed to
+ * complete its flush once the commit is durable.
+ */
+struct EPBucket::FlushCompletion {
+    FlushCompletion(LockedVBucketPtr& vb,
+                    KVStore& rwUnderlying,
+                    bool moreAvailable)
+        : vb(vb), rwUnderlying(rwUnderlying), moreAvailable(moreAvailable) {
+    }
+
+    struct Batch {
+        Collections::VB::Flush collectionFlush;
+        boost::optional<snapshot_range_t> range;
+        /// The state to restore if the batch fails to persist
+        vbucket_state vbstateRollback;
+        int itemsFlushed;
+        std::chrono::steady_clock::time_point flushStart;
+    };
+
+    LockedVBucketPtr& vb;
+    KVStore& rwUnderlying;
+    /// True if the vBucket had more items than fitted in the batch
+    const bool moreAvailable;
+    /// The batch, unless there were no items to flush
+    boost::optional<Batch> batch;
+};
 
+std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
     auto vb = getLockedVBucket(vbid, std::try_to_lock);
     if (!vb.owns_lock()) {
         // Try another bucket if this one is locked to avoid blocking flusher.
         return {true, 0};
     }
-    if (vb) {
-        // Obtain the set of items to flush, up to the maximum allowed for
-        // a single flush.
-        auto toFlush = vb->getItemsToPersist(flusherBatchSplitTrigger);
-        auto& items = toFlush.items;
-        // The range becomes initialised only when an item is flushed
-        boost::optional<snapshot_range_t> range;
-        moreAvailable = toFlush.moreAvailable;
-
-        KVStore* rwUnderlying = getRWUnderlying(vb->getId());
-        vbucket_state vbstate, vbstateRollback;
-        if (!items.empty()) {
-            while (!rwUnderlying->begin(
-                    std::make_unique<EPTransactionContext>(stats, *vb))) {
-                ++stats.beginFailed;
-                EP_LOG_WARN(
-                        "Failed to start a transaction!!! "
-                        "Retry in 1 sec ...");
-                std::this_thread::sleep_for(std::chrono::seconds(1));
-            }
-            rwUnderlying->optimizeWrites(items);
+    return flushVBucket(vb, {}, {});
+}
 
-            Item *prev = NULL;
-
-            // Read the vbucket_state from disk as many values from the
-            // in-memory vbucket_state may be ahead of what we are flushing.
-            const auto* persistedVbState =
-                    rwUnderlying->getVBucketState(vb->getId());
-
-            // The first flush we do populates the cachedVBStates of the KVStore
-            // so we may not (if this is the first flush) have a state returned
-            // from the KVStore.
-            if (persistedVbState) {
-                // Take two copies.
-                // First will be mutated as the new state
-                // Second remains unchanged and will be used on failure
-                vbstateRollback = vbstate = *persistedVbState;
-            }
-            // We need to set a few values from the in-memory state.
-            uint64_t maxSeqno = 0;
-            uint64_t maxVbStateOpCas = 0;
-
-            auto minSeqno = std::numeric_limits<uint64_t>::max();
-
-            bool mustCheckpointVBState = false;
-
-            Collections::VB::Flush collectionFlush(vb->getManifest());
-
-            // HCS is optional because we have to update it on disk only if some
-            // Commit/Abort SyncWrite is found in the flush-batch. If we're
-            // flushing Disk checkpoints then the toFlush value may be
-            // supplied. In this case, this should be the HCS received from the
-            // Active node and should be greater than or equal to the HCS for
-            // any other item in this flush batch. This is required because we
-            // send mutations instead of a commits and would not otherwise
-            // update the HCS on disk.
-            boost::optional<uint64_t> hcs =
-                    boost::make_optional(false, uint64_t());
-
-            // HPS is optional because we have to update it on disk only if a
-            // prepare is found in the flush-batch
-            // This value is read at warmup to determine what seqno to stop
-            // loading prepares at (there will not be any prepares after this
-            // point) but cannot be used to initialise a PassiveDM after warmup
-            // as this value will advance into snapshots immediately, without
-            // the entire snapshot needing to be persisted.
-            boost::optional<uint64_t> hps =
-                    boost::make_optional(false, uint64_t());
-
-            // We always maintain the maxVisibleSeqno at the current value
-            // and only change it to a higher-seqno when a flush of a visible
-            // item is seen. This value must be tracked to provide a correct
-            // snapshot range for non-sync write aware consumers during backfill
-            // (the snapshot should not end on a prepare or an abort, as these
-            // items will not be sent). This value is also used at warmup so
-            // that vbuckets can resume with the same visible seqno as before
-            // the restart.
-            Monotonic<uint64_t> maxVisibleSeqno{vbstate.maxVisibleSeqno};
-
-            if (toFlush.maxDeletedRevSeqno) {
-                vbstate.maxDeletedSeqno = toFlush.maxDeletedRevSeqno.get();
-            }
+std::pair<bool, bool> EPBucket::flushVBucketPipelined(Vbid vbid,
+                                                      Vbid nextVbid) {
+    if (vbid == nextVbid) {
+        const auto more = flushVBucket(vbid).first;
+        return {more, more};
+    }
+    auto vb = getLockedVBucket(vbid, std::try_to_lock);
+    if (!vb.owns_lock()) {
+        return {true, flushVBucket(nextVbid).first};
+    }
+
+    // Once the batch of vbid is in the KVStore, lock nextVbid and drain its
+    // batch while vbid commits. nextVbid stays locked (by this thread) until
+    // its batch has been flushed, so nothing can happen to its checkpoints
+    // in between.
+    LockedVBucketPtr next;
+    std::shared_ptr<FlushBatchPrefetch> prefetch;
+    auto beforeCommit = [this, nextVbid, &next, &prefetch]() {
+        next = getLockedVBucket(nextVbid, std::try_to_lock);
+        if (!next.owns_lock() || !next) {
+            return;
+        }
+        prefetch = std::make_shared<FlushBatchPrefetch>(
+                next.getVB(),
+                *getRWUnderlying(nextVbid),
+                flusherBatchSplitTrigger);
+        ExecutorPool::get()->schedule(
+                std::make_shared<FlushBatchPrefetchTask>(engine, prefetch));
+    };
 
-            // Iterate through items, checking if we (a) can skip persisting,
-            // (b) can de-duplicate as the previous key was the same, or (c)
-            // actually need to persist.
-            // Note: This assumes items have been sorted by key and then by
-            // seqno (see optimizeWrites() above) such that duplicate keys are
-            // adjacent but with the highest seqno first.
-            // Note(2): The de-duplication here is an optimization to save
-            // creating and enqueuing multiple set() operations on the
-            // underlying KVStore - however the KVStore itself only stores a
-            // single value per key, and so even if we don't de-dupe here the
-            // KVStore will eventually - just potentialy after unnecessary work.
-            for (const auto& item : items) {
-                if (!item->shouldPersist()) {
-                    continue;
-                }
+    const auto first = flushVBucket(vb, {}, beforeCommit);
+    // vbid is completely flushed (and its persistence callbacks have run),
+    // release it before flushing nextVbid.
+    vb = {};
 
-                const auto op = item->getOperation();
-                if ((op == queue_op::commit_sync_write ||
-                     op == queue_op::abort_sync_write) &&
-                    toFlush.checkpointType != CheckpointType::Disk) {
-                    // If we are receiving a disk snapshot then we want to skip
-                    // the HCS update as we will persist a correct one when we
-                    // flush the last item. If we were to persist an incorrect
-                    // HCS then we would have to backtrack the start seqno of
-                    // our warmup to ensure that we do warmup prepares that may
-                    // not have been completed if they were completed out of
-                    // order.
-                    hcs = std::max(hcs.value_or(0), item->getPrepareSeqno());
-                }
+    if (!prefetch) {
+        // vbid had nothing to commit, or nextVbid was busy
+        next = {};
+        return {first.first, flushVBucket(nextVbid).first};
+    }
+    return {first.first, flushVBucket(next, prefetch->takeOver(), {}).first};
+}
 
-                if (item->isVisible() &&
-                    static_cast<uint64_t>(item->getBySeqno()) >
-                            maxVisibleSeqno) {
-                    maxVisibleSeqno = static_cast<uint64_t>(item->getBySeqno());
-                }
+std::pair<bool, size_t> EPBucket::flushVBucket(
+        LockedVBucketPtr& vb,
+        boost::optional<VBucket::ItemsToFlush> prefetched,
+        const std::function<void()>& beforeCommit) {
+    if (!vb) {
+        return {false, 0};
+    }
+    auto flush = writeFlushBatch(vb, std::move(prefetched), beforeCommit);
+    if (!flush) {
+        return {true, 0};
+    }
+    return completeFlush(*flush);
+}
 
-                if (op == queue_op::pending_sync_write) {
-                    Expects(item->getBySeqno() > 0);
-                    hps = std::max(hps.value_or(0),
-                                   static_cast<uint64_t>(item->getBySeqno()));
-                }
+std::vector<Vbid> EPBucket::flushVBucketGroup(const std::vector<Vbid>& vbids) {
+    std::vector<Vbid> more;
+    // The completions reference the locks, so neither vector may reallocate
+    std::vector<LockedVBucketPtr> locks;
+    locks.reserve(vbids.size());
+    std::vector<FlushCompletion> completions;
+    completions.reserve(vbids.size());
+
+    KVStore* group = nullptr;
+    for (const auto vbid : vbids) {
+        locks.push_back(getLockedVBucket(vbid, std::try_to_lock));
+        auto& vb = locks.back();
+        if (!vb.owns_lock()) {
+            more.push_back(vbid);
+            continue;
+        }
+        if (!vb) {
+            continue;
+        }
 
-                if (op == queue_op::set_vbucket_state) {
-                    // Only process vbstate if it's sequenced higher (by cas).
-                    // We use the cas instead of the seqno here because a
-                    // set_vbucket_state does not increment the lastBySeqno in
-                    // the CheckpointManager when it is created. This means that
-                    // it is possible to have two set_vbucket_state items that
-                    // follow one another with the same seqno. The cas will be
-                    // bumped for every item so it can be used to distinguish
-                    // which item is the latest and should be flushed.
-                    if (item->getCas() > maxVbStateOpCas) {
-                        // Should only bump the stat once for the latest state
-                        // change that we want to flush
-                        if (maxVbStateOpCas == 0) {
-                            // There is at least a commit to be done, so
-                            // increase todo
-                            ++stats.flusher_todo;
-                        }
-
-                        maxVbStateOpCas = item->getCas();
-
-                        // It could be the case that the set_vbucket_state is
-                        // alone, i.e. no mutations are being flushed, we must
-                        // trigger an update of the vbstate, which will always
-                        // happen when we set this.
-                        mustCheckpointVBState = true;
-
-                        // Process the Item's value into the transition struct
-                        vbstate.transition.fromItem(*item);
-                    }
-                    // Update queuing stats now this item has logically been
-                    // processed.
-                    --stats.diskQueueSize;
-                    vb->doStatsForFlushing(*item, item->size());
-
-                } else if (!canDeDuplicate(prev, *item)) {
-                    // This is an item we must persist.
-                    prev = item.get();
-                    ++items_flushed;
-
-                    if (mcbp::datatype::is_xattr(item->getDataType())) {
-                        vbstate.mightContainXattrs = true;
-                    }
+        auto* rwUnderlying = getRWUnderlying(vbid);
+        if (!group && rwUnderlying->openCommitGroup()) {
+            group = rwUnderlying;
+        }
+        auto flush = writeFlushBatch(vb, {}, {});
+        if (!flush) {
+            more.push_back(vbid);
+        } else if (rwUnderlying == group) {
+            // Not durable until the group is closed
+            completions.push_back(std::move(*flush));
+        } else if (completeFlush(*flush).first) {
+            more.push_back(vbid);
+        }
+    }
 
-                    flushOneDelOrSet(item, vb.getVB());
+    if (group) {
+        // Make every batch of the group durable, and run their persistence
+        // callbacks; only then can the vBuckets' persisted seqnos move on.
+        group->closeCommitGroup();
+    }
+    for (auto& flush : completions) {
+        if (completeFlush(flush).first) {
+            more.push_back(flush.vb->getId());
+        }
+    }
+    return more;
+}
 
-                    maxSeqno = std::max(maxSeqno, (uint64_t)item->getBySeqno());
+boost::optional<EPBucket::FlushCompletion> EPBucket::writeFlushBatch(
+        LockedVBucketPtr& vb,
+        boost::optional<VBucket::ItemsToFlush> prefetched,
+        const std::function<void()>& beforeCommit) {
+    const auto flush_start = std::chrono::steady_clock::now();
+    const auto vbid = vb->getId();
+    // Obtain the set of items to flush, up to the maximum allowed for
+    // a single flush.
+    auto toFlush = prefetched
+                           ? std::move(*prefetched)
+                           : vb->getItemsToPersist(flusherBatchSplitTrigger);
+    auto& items = toFlush.items;
+    // The range becomes initialised only when an item is flushed
+    boost::optional<snapshot_range_t> range;
+
+    KVStore* rwUnderlying = getRWUnderlying(vb->getId());
+    FlushCompletion flush(vb, *rwUnderlying, toFlush.moreAvailable);
+    vbucket_state vbstate, vbstateRollback;
+    if (!items.empty()) {
+        int items_flushed = 0;
+        while (!rwUnderlying->begin(
+                std::make_unique<EPTransactionContext>(stats, *vb))) {
+            ++stats.beginFailed;
+            EP_LOG_WARN(
+                    "Failed to start a transaction!!! "
+                    "Retry in 1 sec ...");
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+        if (!prefetched) {
+            rwUnderlying->optimizeWrites(items);
+        }
 
-                    // Track the lowest seqno, so we can set the HLC epoch
-                    minSeqno = std::min(minSeqno, (uint64_t)item->getBySeqno());
-                    vbstate.maxCas = std::max(vbstate.maxCas, item->getCas());
-                    ++stats.flusher_todo;
+        Item *prev = NULL;
+
+        // Read the vbucket_state from disk as many values from the
+        // in-memory vbucket_state may be ahead of what we are flushing.
+        const auto* persistedVbState =
+                rwUnderlying->getVBucketState(vb->getId());
+
+        // The first flush we do populates the cachedVBStates of the KVStore
+        // so we may not (if this is the first flush) have a state returned
+        // from the KVStore.
+        if (persistedVbState) {
+            // Take two copies.
+            // First will be mutated as the new state
+            // Second remains unchanged and will be used on failure
+            vbstateRollback = vbstate = *persistedVbState;
+        }
+        // We need to set a few values from the in-memory state.
+        uint64_t maxSeqno = 0;
+        uint64_t maxVbStateOpCas = 0;
+
+        auto minSeqno = std::numeric_limits<uint64_t>::max();
+
+        bool mustCheckpointVBState = false;
+
+        Collections::VB::Flush collectionFlush(vb->getManifest());
+
+        // HCS is optional because we have to update it on disk only if some
+        // Commit/Abort SyncWrite is found in the flush-batch. If we're
+        // flushing Disk checkpoints then the toFlush value may be
+        // supplied. In this case, this should be the HCS received from the
+        // Active node and should be greater than or equal to the HCS for
+        // any other item in this flush batch. This is required because we
+        // send mutations instead of a commits and would not otherwise
+        // update the HCS on disk.
+        boost::optional<uint64_t> hcs =
+                boost::make_optional(false, uint64_t());
+
+        // HPS is optional because we have to update it on disk only if a
+        // prepare is found in the flush-batch
+        // This value is read at warmup to determine what seqno to stop
+        // loading prepares at (there will not be any prepares after this
+        // point) but cannot be used to initialise a PassiveDM after warmup
+        // as this value will advance into snapshots immediately, without
+        // the entire snapshot needing to be persisted.
+        boost::optional<uint64_t> hps =
+                boost::make_optional(false, uint64_t());
+
+        // We always maintain the maxVisibleSeqno at the current value
+        // and only change it to a higher-seqno when a flush of a visible
+        // item is seen. This value must be tracked to provide a correct
+        // snapshot range for non-sync write aware consumers during backfill
+        // (the snapshot should not end on a prepare or an abort, as these
+        // items will not be sent). This value is also used at warmup so
+        // that vbuckets can resume with the same visible seqno as before
+        // the restart.
+        Monotonic<uint64_t> maxVisibleSeqno{vbstate.maxVisibleSeqno};
+
+        if (toFlush.maxDeletedRevSeqno) {
+            vbstate.maxDeletedSeqno = toFlush.maxDeletedRevSeqno.get();
+        }
 
-                    if (!range.is_initialized()) {
-                        range = snapshot_range_t{
-                                vbstate.lastSnapStart,
-                                toFlush.ranges.empty()
-                                        ? vbstate.lastSnapEnd
-                                        : toFlush.ranges.back().getEnd()};
-                    }
+        // Iterate through items, checking if we (a) can skip persisting,
+        // (b) can de-duplicate as the previous key was the same, or (c)
+        // actually need to persist.
+        // Note: This assumes items have been sorted by key and then by
+        // seqno (see optimizeWrites() above) such that duplicate keys are
+        // adjacent but with the highest seqno first.
+        // Note(2): The de-duplication here is an optimization to save
+        // creating and enqueuing multiple set() operations on the
+        // underlying KVStore - however the KVStore itself only stores a
+        // single value per key, and so even if we don't de-dupe here the
+        // KVStore will eventually - just potentialy after unnecessary work.
+        for (const auto& item : items) {
+            if (!item->shouldPersist()) {
+                continue;
+            }
 
-                    // Is the item the end item of one of the ranges we're
-                    // flushing? Note all the work here only affects replica VBs
-                    auto itr = std::find_if(
-                            toFlush.ranges.begin(),
-                            toFlush.ranges.end(),
-                            [&item](auto& range) {
-                                return uint64_t(item->getBySeqno()) ==
-                                       range.getEnd();
-                            });
-
-                    // If this is the end item, we can adjust the start of our
-                    // flushed range, which would be used for failure purposes.
-                    // Primarily by bringing the start to be a consistent point
-                    // allows for promotion to active to set the fail-over table
-                    // to a consistent point.
-                    if (itr != toFlush.ranges.end()) {
-                        // Use std::max as the flusher is not visiting in seqno
-                        // order.
-                        range->setStart(std::max(range->getStart(),
-                                                 itr->range.getEnd()));
-                        // HCS may be weakly monotonic when received via a disk
-                        // snapshot so we special case this for the disk
-                        // snapshot instead of relaxing the general constraint.
-                        if (toFlush.checkpointType == CheckpointType::Disk &&
-                            itr->highCompletedSeqno !=
-                                    vbstate.persistedCompletedSeqno) {
-                            hcs = itr->highCompletedSeqno;
-                        }
-
-                        // Now that the end of a snapshot has been reached,
-                        // store the hps tracked by the checkpoint to disk
-                        if (itr->highPreparedSeqno) {
-                            auto newHps = toFlush.checkpointType ==
-                                                          CheckpointType::Memory
-                                                  ? *(itr->highPreparedSeqno)
-                                                  : itr->getEnd();
-                            vbstate.highPreparedSeqno =
-                                    std::max(vbstate.highPreparedSeqno, newHps);
-                        }
-                    }
-                } else {
-                    // Item is the same key as the previous[1] one - don't need
-                    // to flush to disk.
-                    // [1] Previous here really means 'next' - optimizeWrites()
-                    //     above has actually re-ordered items such that items
-                    //     with the same key are ordered from high->low seqno.
-                    //     This means we only write the highest (i.e. newest)
-                    //     item for a given key, and discard any duplicate,
-                    //     older items.
-                    --stats.diskQueueSize;
-                    vb->doStatsForFlushing(*item, item->size());
-                }
+            const auto op = item->getOperation();
+            if ((op == queue_op::commit_sync_write ||
+                 op == queue_op::abort_sync_write) &&
+                toFlush.checkpointType != CheckpointType::Disk) {
+                // If we are receiving a disk snapshot then we want to skip
+                // the HCS update as we will persist a correct one when we
+                // flush the last item. If we were to persist an incorrect
+                // HCS then we would have to backtrack the start seqno of
+                // our warmup to ensure that we do warmup prepares that may
+                // not have been completed if they were completed out of
+                // order.
+                hcs = std::max(hcs.value_or(0), item->getPrepareSeqno());
             }
 
-            {
-                folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
-                if (vb->getState() == vbucket_state_active) {
-                    if (maxSeqno) {
-                        range = snapshot_range_t(maxSeqno, maxSeqno);
+            if (item->isVisible() &&
+                static_cast<uint64_t>(item->getBySeqno()) >
+                        maxVisibleSeqno) {
+                maxVisibleSeqno = static_cast<uint64_t>(item->getBySeqno());
+            }
+
+            if (op == queue_op::pending_sync_write) {
+                Expects(item->getBySeqno() > 0);
+                hps = std::max(hps.value_or(0),
+                               static_cast<uint64_t>(item->getBySeqno()));
+            }
+
+            if (op == queue_op::set_vbucket_state) {
+                // Only process vbstate if it's sequenced higher (by cas).
+                // We use the cas instead of the seqno here because a
+                // set_vbucket_state does not increment the lastBySeqno in
+                // the CheckpointManager when it is created. This means that
+                // it is possible to have two set_vbucket_state items that
+                // follow one another with the same seqno. The cas will be
+                // bumped for every item so it can be used to distinguish
+                // which item is the latest and should be flushed.
+                if (item->getCas() > maxVbStateOpCas) {
+                    // Should only bump the stat once for the latest state
+                    // change that we want to flush
+                    if (maxVbStateOpCas == 0) {
+                        // There is at least a commit to be done, so
+                        // increase todo
+                        ++stats.flusher_todo;
                     }
-                }
 
-                // Update VBstate based on the changes we have just made,
-                // then tell the rwUnderlying the 'new' state
-                // (which will persisted as part of the commit() below).
-
-                // only update the snapshot range if items were flushed, i.e.
-                // don't appear to be in a snapshot when you have no data for it
-                // We also update the checkpointType here as this should only
-                // change with snapshots.
-                if (range) {
-                    vbstate.lastSnapStart = range->getStart();
-                    vbstate.lastSnapEnd = range->getEnd();
-                    vbstate.checkpointType = toFlush.checkpointType;
+                    maxVbStateOpCas = item->getCas();
+
+                    // It could be the case that the set_vbucket_state is
+                    // alone, i.e. no mutations are being flushed, we must
+                    // trigger an update of the vbstate, which will always
+                    // happen when we set this.
+                    mustCheckpointVBState = true;
+
+                    // Process the Item's value into the transition struct
+                    vbstate.transition.fromItem(*item);
                 }
-                // Track the lowest seqno written in spock and record it as
-                // the HLC epoch, a seqno which we can be sure the value has a
-                // HLC CAS.
-                vbstate.hlcCasEpochSeqno = vb->getHLCEpochSeqno();
-                if (vbstate.hlcCasEpochSeqno == HlcCasSeqnoUninitialised &&
-                    minSeqno != std::numeric_limits<uint64_t>::max()) {
-                    vbstate.hlcCasEpochSeqno = minSeqno;
-                    vb->setHLCEpochSeqno(vbstate.hlcCasEpochSeqno);
+                // Update queuing stats now this item has logically been
+                // processed.
+                --stats.diskQueueSize;
+                vb->doStatsForFlushing(*item, item->size());
+
+            } else if (!canDeDuplicate(prev, *item)) {
+                // This is an item we must persist.
+                prev = item.get();
+                ++items_flushed;
+
+                if (mcbp::datatype::is_xattr(item->getDataType())) {
+                    vbstate.mightContainXattrs = true;
                 }
 
-                // Do we need to trigger a persist of the state?
-                // If there are no "real" items to flush, and we encountered
-                // a set_vbucket_state meta-item.
-                auto options = VBStatePersist::VBSTATE_CACHE_UPDATE_ONLY;
-                if ((items_flushed == 0) && mustCheckpointVBState) {
-                    options = VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT;
-                }
+                flushOneDelOrSet(item, vb.getVB());
 
-                if (hcs) {
-                    Expects(hcs > vbstate.persistedCompletedSeqno);
-                    vbstate.persistedCompletedSeqno = *hcs;
-                }
+                maxSeqno = std::max(maxSeqno, (uint64_t)item->getBySeqno());
 
-                if (hps) {
-                    Expects(hps > vbstate.persistedPreparedSeqno);
-                    vbstate.persistedPreparedSeqno = *hps;
+                // Track the lowest seqno, so we can set the HLC epoch
+                minSeqno = std::min(minSeqno, (uint64_t)item->getBySeqno());
+                vbstate.maxCas = std::max(vbstate.maxCas, item->getCas());
+                ++stats.flusher_todo;
+
+                if (!range.is_initialized()) {
+                    range = snapshot_range_t{
+                            vbstate.lastSnapStart,
+                            toFlush.ranges.empty()
+                                    ? vbstate.lastSnapEnd
+                                    : toFlush.ranges.back().getEnd()};
                 }
 
-                vbstate.maxVisibleSeqno = maxVisibleSeqno;
+                // Is the item the end item of one of the ranges we're
+                // flushing? Note all the work here only affects replica VBs
+                auto itr = std::find_if(
+                        toFlush.ranges.begin(),
+                        toFlush.ranges.end(),
+                        [&item](auto& range) {
+                            return uint64_t(item->getBySeqno()) ==
+                                   range.getEnd();
+                        });
+
+                // If this is the end item, we can adjust the start of our
+                // flushed range, which would be used for failure purposes.
+                // Primarily by bringing the start to be a consistent point
+                // allows for promotion to active to set the fail-over table
+                // to a consistent point.
+                if (itr != toFlush.ranges.end()) {
+                    // Use std::max as the flusher is not visiting in seqno
+                    // order.
+                    range->setStart(std::max(range->getStart(),
+                                             itr->range.getEnd()));
+                    // HCS may be weakly monotonic when received via a disk
+                    // snapshot so we special case this for the disk
+                    // snapshot instead of relaxing the general constraint.
+                    if (toFlush.checkpointType == CheckpointType::Disk &&
+                        itr->highCompletedSeqno !=
+                                vbstate.persistedCompletedSeqno) {
+                        hcs = itr->highCompletedSeqno;
+                    }
 
-                if (rwUnderlying->snapshotVBucket(vb->getId(), vbstate,
-                                                  options) != true) {
-                    return {true, 0};
+                    // Now that the end of a snapshot has been reached,
+                    // store the hps tracked by the checkpoint to disk
+                    if (itr->highPreparedSeqno) {
+                        auto newHps = toFlush.checkpointType ==
+                                                      CheckpointType::Memory
+                                              ? *(itr->highPreparedSeqno)
+                                              : itr->getEnd();
+                        vbstate.highPreparedSeqno =
+                                std::max(vbstate.highPreparedSeqno, newHps);
+                    }
                 }
+            } else {
+                // Item is the same key as the previous[1] one - don't need
+                // to flush to disk.
+                // [1] Previous here really means 'next' - optimizeWrites()
+                //     above has actually re-ordered items such that items
+                //     with the same key are ordered from high->low seqno.
+                //     This means we only write the highest (i.e. newest)
+                //     item for a given key, and discard any duplicate,
+                //     older items.
+                --stats.diskQueueSize;
+                vb->doStatsForFlushing(*item, item->size());
+            }
+        }
 
-                if (vb->setBucketCreation(false)) {
-                    EP_LOG_DEBUG("{} created", vbid);
+        {
+            folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+            if (vb->getState() == vbucket_state_active) {
+                if (maxSeqno) {
+                    range = snapshot_range_t(maxSeqno, maxSeqno);
                 }
             }
 
-            /* Perform an explicit commit to disk if the commit
-             * interval reaches zero and if there is a non-zero number
-             * of items to flush.
-             */
-            if (items_flushed > 0) {
-                commit(vb->getId(), *rwUnderlying, collectionFlush);
+            // Update VBstate based on the changes we have just made,
+            // then tell the rwUnderlying the 'new' state
+            // (which will persisted as part of the commit() below).
+
+            // only update the snapshot range if items were flushed, i.e.
+            // don't appear to be in a snapshot when you have no data for it
+            // We also update the checkpointType here as this should only
+            // change with snapshots.
+            if (range) {
+                vbstate.lastSnapStart = range->getStart();
+                vbstate.lastSnapEnd = range->getEnd();
+                vbstate.checkpointType = toFlush.checkpointType;
+            }
+            // Track the lowest seqno written in spock and record it as
+            // the HLC epoch, a seqno which we can be sure the value has a
+            // HLC CAS.
+            vbstate.hlcCasEpochSeqno = vb->getHLCEpochSeqno();
+            if (vbstate.hlcCasEpochSeqno == HlcCasSeqnoUninitialised &&
+                minSeqno != std::numeric_limits<uint64_t>::max()) {
+                vbstate.hlcCasEpochSeqno = minSeqno;
+                vb->setHLCEpochSeqno(vbstate.hlcCasEpochSeqno);
+            }
 
-                // Now the commit is complete, vBucket file must exist.
-                if (vb->setBucketCreation(false)) {
-                    EP_LOG_DEBUG("{} created", vbid);
-                }
+            // Do we need to trigger a persist of the state?
+            // If there are no "real" items to flush, and we encountered
+            // a set_vbucket_state meta-item.
+            auto options = VBStatePersist::VBSTATE_CACHE_UPDATE_ONLY;
+            if ((items_flushed == 0) && mustCheckpointVBState) {
+                options = VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT;
             }
 
-            if (vb->rejectQueue.empty()) {
-                // only update the snapshot range if items were flushed, i.e.
-                // don't appear to be in a snapshot when you have no data for it
-                if (range) {
-                    vb->setPersistedSnapshot(*range);
-                }
-                uint64_t highSeqno = rwUnderlying->getLastPersistedSeqno(vbid);
-                if (highSeqno > 0 && highSeqno != vb->getPersistenceSeqno()) {
-                    vb->setPersistenceSeqno(highSeqno);
-                }
+            if (hcs) {
+                Expects(hcs > vbstate.persistedCompletedSeqno);
+                vbstate.persistedCompletedSeqno = *hcs;
+            }
 
-                // Notify the local DM that the Flusher has run. Persistence
-                // could unblock some pending Prepares in the DM.
-                // If it is the case, this call updates the High Prepared Seqno
-                // for this node.
-                // In the case of a Replica node, that could trigger a SeqnoAck
-                // to the Active.
-                //
-                // Note: This is a NOP if the there's no Prepare queued in DM.
-                //     We could notify the DM only if strictly required (i.e.,
-                //     only when the Flusher has persisted up to the snap-end
-                //     mutation of an in-memory snapshot, see HPS comments in
-                //     PassiveDM for details), but that requires further work.
-                //     The main problem is that in general a flush-batch does
-                //     not coincide with in-memory snapshots (ie, we don't
-                //     persist at snapshot boundaries). So, the Flusher could
-                //     split a single in-memory snapshot into multiple
-                //     flush-batches. That may happen at Replica, e.g.:
-                //
-                //     1) received snap-marker [1, 2]
-                //     2) received 1:PRE
-                //     3) flush-batch {1:PRE}
-                //     4) received 2:mutation
-                //     5) flush-batch {2:mutation}
-                //
-                //     In theory we need to notify the DM only at step (5) and
-                //     only if the the snapshot contains at least 1 Prepare
-                //     (which is the case in our example), but the problem is
-                //     that the Flusher doesn't know about 1:PRE at step (5).
-                //
-                //     So, given that here we are executing in a slow bg-thread
-                //     (write+sync to disk), then we can just afford to calling
-                //     back to the DM unconditionally.
-                vb->notifyPersistenceToDurabilityMonitor();
-            } else {
-                // Flusher failed to commit the batch, rollback vbstate
-                items_flushed = 0;
-                if (rwUnderlying->getVBucketState(vbid)) {
-                    *rwUnderlying->getVBucketState(vbid) = vbstateRollback;
-                }
+            if (hps) {
+                Expects(hps > vbstate.persistedPreparedSeqno);
+                vbstate.persistedPreparedSeqno = *hps;
             }
 
-            auto flush_end = std::chrono::steady_clock::now();
-            uint64_t trans_time =
-                    std::chrono::duration_cast<std::chrono::milliseconds>(
-                            flush_end - flush_start)
-                            .count();
+            vbstate.maxVisibleSeqno = maxVisibleSeqno;
 
-            lastTransTimePerItem.store((items_flushed == 0) ? 0 :
-                                       static_cast<double>(trans_time) /
-                                       static_cast<double>(items_flushed));
-            stats.cumulativeFlushTime.fetch_add(trans_time);
-            stats.flusher_todo.store(0);
-            stats.totalPersistVBState++;
+            if (rwUnderlying->snapshotVBucket(vb->getId(), vbstate,
+                                              options) != true) {
+                return {};
+            }
 
-            collectionFlush.checkAndTriggerPurge(vb->getId(), *this);
+            if (vb->setBucketCreation(false)) {
+                EP_LOG_DEBUG("{} created", vbid);
+            }
         }
 
-        rwUnderlying->pendingTasks();
+        /* Perform an explicit commit to disk if the commit
+         * interval reaches zero and if there is a non-zero number
+         * of items to flush.
+         */
+        if (items_flushed > 0) {
+            if (beforeCommit) {
+                beforeCommit();
+            }
+            commit(vb->getId(), *rwUnderlying, collectionFlush);
 
-        if (vb->checkpointManager->hasClosedCheckpointWhichCanBeRemoved()) {
-            wakeUpCheckpointRemover();
+            // Now the commit is complete, vBucket file must exist.
+            if (vb->setBucketCreation(false)) {
+                EP_LOG_DEBUG("{} created", vbid);
+            }
         }
 
+        flush.batch = FlushCompletion::Batch{std::move(collectionFlush),
+                                             range,
+                                             vbstateRollback,
+                                             items_flushed,
+                                             flush_start};
+    }
+
+    return std::move(flush);
+}
+
+std::pair<bool, size_t> EPBucket::completeFlush(FlushCompletion& flush) {
+    auto& vb = flush.vb;
+    const auto vbid = vb->getId();
+    KVStore* rwUnderlying = &flush.rwUnderlying;
+    int items_flushed = 0;
+
+    if (flush.batch) {
+        auto& batch = *flush.batch;
+        items_flushed = batch.itemsFlushed;
+
         if (vb->rejectQueue.empty()) {
-            vb->checkpointManager->itemsPersisted();
-            uint64_t seqno = vb->getPersistenceSeqno();
-            uint64_t chkid =
-                    vb->checkpointManager->getPersistenceCursorPreChkId();
-            vb->notifyHighPriorityRequests(
-                    engine, seqno, HighPriorityVBNotify::Seqno);
-            vb->notifyHighPriorityRequests(
-                    engine, chkid, HighPriorityVBNotify::ChkPersistence);
+            // only update the snapshot range if items were flushed, i.e.
+            // don't appear to be in a snapshot when you have no data for it
+            if (batch.range) {
+                vb->setPersistedSnapshot(*batch.range);
+            }
+            uint64_t highSeqno = rwUnderlying->getLastPersistedSeqno(vbid);
+            if (highSeqno > 0 && highSeqno != vb->getPersistenceSeqno()) {
+                vb->setPersistenceSeqno(highSeqno);
+            }
+
+            // Notify the local DM that the Flusher has run. Persistence
+            // could unblock some pending Prepares in the DM.
+            // If it is the case, this call updates the High Prepared Seqno
+            // for this node.
+            // In the case of a Replica node, that could trigger a SeqnoAck
+            // to the Active.
+            //
+            // Note: This is a NOP if the there's no Prepare queued in DM.
+            //     We could notify the DM only if strictly required (i.e.,
+            //     only when the Flusher has persisted up to the snap-end
+            //     mutation of an in-memory snapshot, see HPS comments in
+            //     PassiveDM for details), but that requires further work.
+            //     The main problem is that in general a flush-batch does
+            //     not coincide with in-memory snapshots (ie, we don't
+            //     persist at snapshot boundaries). So, the Flusher could
+            //     split a single in-memory snapshot into multiple
+            //     flush-batches. That may happen at Replica, e.g.:
+            //
+            //     1) received snap-marker [1, 2]
+            //     2) received 1:PRE
+            //     3) flush-batch {1:PRE}
+            //     4) received 2:mutation
+            //     5) flush-batch {2:mutation}
+            //
+            //     In theory we need to notify the DM only at step (5) and
+            //     only if the the snapshot contains at least 1 Prepare
+            //     (which is the case in our example), but the problem is
+            //     that the Flusher doesn't know about 1:PRE at step (5).
+            //
+            //     So, given that here we are executing in a slow bg-thread
+            //     (write+sync to disk), then we can just afford to calling
+            //     back to the DM unconditionally.
+            vb->notifyPersistenceToDurabilityMonitor();
         } else {
-            return {true, items_flushed};
+            // Flusher failed to commit the batch, rollback vbstate
+            items_flushed = 0;
+            if (rwUnderlying->getVBucketState(vbid)) {
+                *rwUnderlying->getVBucketState(vbid) = batch.vbstateRollback;
+            }
         }
+
+        auto flush_end = std::chrono::steady_clock::now();
+        uint64_t trans_time =
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                        flush_end - batch.flushStart)
+                        .count();
+
+        lastTransTimePerItem.store((items_flushed == 0) ? 0 :
+                                   static_cast<double>(trans_time) /
+                                   static_cast<double>(items_flushed));
+        stats.cumulativeFlushTime.fetch_add(trans_time);
+        stats.flusher_todo.store(0);
+        stats.totalPersistVBState++;
+
+        batch.collectionFlush.checkAndTriggerPurge(vb->getId(), *this);
+    }
+
+    rwUnderlying->pendingTasks();
+
+    if (vb->checkpointManager->hasClosedCheckpointWhichCanBeRemoved()) {
+        wakeUpCheckpointRemover();
+    }
+
+    if (vb->rejectQueue.empty()) {
+        vb->checkpointManager->itemsPersisted();
+        uint64_t seqno = vb->getPersistenceSeqno();
+        uint64_t chkid =
+                vb->checkpointManager->getPersistenceCursorPreChkId();
+        vb->notifyHighPriorityRequests(
+                engine, seqno, HighPriorityVBNotify::Seqno);
+        vb->notifyHighPriorityRequests(
+                engine, chkid, HighPriorityVBNotify::ChkPersistence);
+    } else {
+        return {true, items_flushed};
     }
 
-    return {moreAvailable, items_flushed};
+    return {flush.moreAvailable, items_flushed};
 }
 
 void EPBucket::setFlusherBatchSplitTrigger(size_t limit) {
@@ -48,6 +48,50 @@ public:
      */
     std::pair<bool, size_t> flushVBucket(Vbid vbid);
 
+    /**
+     * Flushes vbid as flushVBucket(), but while its batch is being committed
+     * the batch of nextVbid is drained from its checkpoints (on a NonIO
+     * thread), and is then flushed. Persistence of each vBucket happens in
+     * the same order, and with the same callbacks, as flushing one after the
+     * other; only the preparation of the second batch is overlapped with the
+     * write and sync of the first.
+     * @return A pair of {moreToFlush(vbid), moreToFlush(nextVbid)}
+     */
+    std::pair<bool, bool> flushVBucketPipelined(Vbid vbid, Vbid nextVbid);
+
+    /**
+     * Flushes each of the given vBuckets (which must all belong to the same
+     * shard), as a group commit if the KVStore supports it: the batches of
+     * all the vBuckets are written, then made durable together (e.g. by one
+     * sync of a shared WAL, or by a batch of fdatasyncs), and only then are
+     * the flushes completed - persistence callbacks, persisted seqnos and
+     * snapshots, notifications of the DurabilityMonitor and of high priority
+     * requests - in the order the vBuckets were written.
+     *
+     * The vBuckets stay locked until the group is complete.
+     *
+     * @return the vBuckets with items remaining to flush
+     */
+    std::vector<Vbid> flushVBucketGroup(const std::vector<Vbid>& vbids);
+
+    /// @return max number of vBuckets in a group commit, see flushVBucketGroup
+    size_t getFlusherGroupCommitMax() const {
+        return flusherGroupCommitMax;
+    }
+
+    void setFlusherGroupCommitMax(size_t max) {
+        flusherGroupCommitMax = max;
+    }
+
+    /// @return true if the Flusher should use flushVBucketPipelined()
+    bool isFlusherPipelined() const {
+        return flusherPipelined;
+    }
+
+    void setFlusherPipelined(bool enabled) {
+        flusherPipelined = enabled;
+    }
+
     /**
      * Set the number of flusher items which can be included in a
      * single flusher commit - more than this number of items will split
@@ -192,6 +236,22 @@ public:
 
     void warmupCompleted();
 
+    /**
+     * Restore the bloom filter of a vbucket being warmed up from the file
+     * saved at the previous clean shutdown, if it was saved at the seqno the
+     * vbucket is being warmed up to and its checksum matches. The file is
+     * removed either way, as it would be stale once the vbucket is modified.
+     *
+     * @param vb The vbucket being warmed up
+     * @param persistedSeqno The high seqno of the vbucket on disk
+     * @param cleanShutdown Whether the previous shutdown was clean; the
+     *        filter is never restored after an unclean one
+     * @return true if the filter was restored
+     */
+    bool loadBloomFilter(VBucket& vb,
+                         uint64_t persistedSeqno,
+                         bool cleanShutdown);
+
 protected:
     // During the warmup phase we might want to enable external traffic
     // at a given point in time.. The LoadStorageKvPairCallback will be
@@ -218,6 +278,49 @@ protected:
 
     void stopWarmup();
 
+    /**
+     * Save the bloom filter of each vbucket next to its data file, so the
+     * next warmup doesn't need to wait for a compaction to rebuild them.
+     * Only valid once the flusher has persisted everything.
+     */
+    void saveBloomFilters();
+
+    /// @return the path of the file the bloom filter of vbid is saved to
+    std::string getBloomFilterFileName(Vbid vbid) const;
+
+    struct FlushCompletion;
+
+    /**
+     * Flush a batch of the given (locked) vBucket.
+     * @param vb The vBucket, which must own its lock
+     * @param prefetched The batch if already drained from the checkpoints
+     *        (and ordered by optimizeWrites), otherwise it's drained here
+     * @param beforeCommit If set, called once the batch has been passed to
+     *        the KVStore, just before it's committed
+     */
+    std::pair<bool, size_t> flushVBucket(
+            LockedVBucketPtr& vb,
+            boost::optional<VBucket::ItemsToFlush> prefetched,
+            const std::function<void()>& beforeCommit);
+
+    /**
+     * First half of flushVBucket(): write the batch to the KVStore and
+     * commit it.
+     * @return the flush to complete once the commit is durable, or none if
+     *         the batch couldn't be written (and should be retried)
+     */
+    boost::optional<FlushCompletion> writeFlushBatch(
+            LockedVBucketPtr& vb,
+            boost::optional<VBucket::ItemsToFlush> prefetched,
+            const std::function<void()>& beforeCommit);
+
+    /**
+     * Second half of flushVBucket(): update the vBucket now that its batch
+     * is persisted (or roll back its state if the batch failed to persist).
+     * @return A pair of {moreToFlush, flushCount}
+     */
+    std::pair<bool, size_t> completeFlush(FlushCompletion& flush);
+
     /// function which is passed down to compactor for dropping keys
     void dropKey(Vbid vbid, const DiskDocKey& key, int64_t bySeqno);
 
@@ -229,6 +332,12 @@ protected:
      */
     std::atomic<size_t> flusherBatchSplitTrigger;
 
+    /// See flusher_pipelined
+    std::atomic<bool> flusherPipelined;
+
+    /// See flusher_group_commit_max_vbuckets
+    std::atomic<size_t> flusherGroupCommitMax;
+
     /**
      * Indicates whether erroneous tombstones need to retained or not during
      * compaction
@@ -30,6 +30,7 @@
 #include "dcp/flow-control-manager.h"
 #include "dcp/msg_producers_border_guard.h"
 #include "dcp/producer.h"
+#include "dcp/zstd_compression.h"
 #include "ep_bucket.h"
 #include "ep_engine_public.h"
 #include "ep_vb.h"
@@ -301,6 +302,13 @@ cb::EngineErrorItemPair EventuallyPersistentEngine::get(
     return cb::makeEngineErrorItemPair(cb::engine_errc(ret), itm, this);
 }
 
+void EventuallyPersistentEngine::get_multi(
+        gsl::not_null<const void*> cookie,
+        const std::vector<cb::GetMultiKey>& keys,
+        std::vector<cb::EngineErrorItemPair>& results) {
+    acquireEngine(this)->getMultiInner(cookie, keys, results);
+}
+
 cb::EngineErrorItemPair EventuallyPersistentEngine::get_if(
         gsl::not_null<const void*> cookie,
         const DocKey& key,
@@ -576,6 +584,11 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setExpPagerInitialRunTime(std::stoll(val));
         } else if (key == "flusher_batch_split_trigger") {
             getConfiguration().setFlusherBatchSplitTrigger(std::stoll(val));
+        } else if (key == "flusher_group_commit_max_vbuckets") {
+            getConfiguration().setFlusherGroupCommitMaxVbuckets(
+                    std::stoull(val));
+        } else if (key == "flusher_pipelined") {
+            getConfiguration().setFlusherPipelined(cb_stob(val));
         } else if (key == "getl_default_timeout") {
             getConfiguration().setGetlDefaultTimeout(std::stoull(val));
         } else if (key == "getl_max_timeout") {
@@ -2126,11 +2139,19 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
     } else if (!flowCtlPolicy.compare("aggressive")) {
         dcpFlowControlManager_ =
                 std::make_unique<DcpFlowControlManagerAggressive>(*this);
+    } else if (!flowCtlPolicy.compare("adaptive")) {
+        dcpFlowControlManager_ =
+                std::make_unique<DcpFlowControlManagerAdaptive>(*this);
     } else {
         /* Flow control is not enabled */
         dcpFlowControlManager_ = std::make_unique<DcpFlowControlManager>(*this);
     }
 
+    dcpZstdCompression_ = std::make_unique<DcpZstdCompression>(
+            *this,
+            configuration.getDcpZstdDictionarySamples(),
+            configuration.getDcpZstdDictionarySize());
+
     checkpointConfig = new CheckpointConfig(*this);
     CheckpointConfig::addConfigChangeListener(*this);
 
@@ -2334,6 +2355,35 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::get(const void* cookie,
     return ret;
 }
 
+void EventuallyPersistentEngine::getMultiInner(
+        const void* cookie,
+        const std::vector<cb::GetMultiKey>& keys,
+        std::vector<cb::EngineErrorItemPair>& results) {
+    const auto options = static_cast<get_options_t>(
+            QUEUE_BG_FETCH | HONOR_STATES | TRACK_REFERENCE | DELETE_TEMP |
+            HIDE_LOCKED_CAS | TRACK_STATISTICS);
+
+    ScopeTimer2<HdrMicroSecStopwatch, TracerStopwatch> timer(
+            HdrMicroSecStopwatch(stats.getCmdHisto),
+            TracerStopwatch(cookie, cb::tracing::Code::Get));
+
+    auto values = kvBucket->getMulti(keys, cookie, options);
+    results.clear();
+    results.reserve(values.size());
+    for (auto& gv : values) {
+        auto ret = gv.getStatus();
+        if (ret == ENGINE_SUCCESS) {
+            ++stats.numOpsGet;
+        } else if ((ret == ENGINE_KEY_ENOENT ||
+                    ret == ENGINE_NOT_MY_VBUCKET) &&
+                   isDegradedMode()) {
+            ret = ENGINE_TMPFAIL;
+        }
+        results.emplace_back(cb::makeEngineErrorItemPair(
+                cb::engine_errc(ret), gv.item.release(), this));
+    }
+}
+
 cb::EngineErrorItemPair EventuallyPersistentEngine::getAndTouchInner(
         const void* cookie, const DocKey& key, Vbid vbucket, uint32_t exptime) {
     auto* handle = reinterpret_cast<EngineIface*>(this);
@@ -3027,6 +3077,17 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
         add_casted_stat("ep_io_compaction_write_bytes",  value, add_stat, cookie);
     }
 
+    if (kvBucket->getKVStoreStat("io_async_reads_submitted",
+                                 value,
+                                 KVBucketIface::KVSOption::BOTH)) {
+        add_casted_stat("ep_io_async_reads_submitted", value, add_stat, cookie);
+    }
+    if (kvBucket->getKVStoreStat("io_async_reads_served",
+                                 value,
+                                 KVBucketIface::KVSOption::BOTH)) {
+        add_casted_stat("ep_io_async_reads_served", value, add_stat, cookie);
+    }
+
     if (kvBucket->getKVStoreStat("io_bg_fetch_read_count",
                                  value,
                                  KVBucketIface::KVSOption::BOTH)) {
@@ -3178,6 +3239,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doMemoryStats(
     add_casted_stat(
             "ep_value_size", stats.getTotalValueSize(), add_stat, cookie);
     add_casted_stat("ep_overhead", stats.getMemOverhead(), add_stat, cookie);
+    add_casted_stat("ep_dcp_item_cache_mem_used",
+                    stats.dcpItemCacheSize,
+                    add_stat,
+                    cookie);
     add_casted_stat("ep_max_size", stats.getMaxDataSize(), add_stat, cookie);
     add_casted_stat("ep_mem_low_wat", stats.mem_low_wat, add_stat, cookie);
     add_casted_stat("ep_mem_low_wat_percent",
@@ -4534,6 +4599,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getStats(
     if (key == "dcp"_ccb) {
         return doDcpStats(cookie, add_stat, value);
     }
+    if (key == "dcp-zstd"_ccb) {
+        dcpZstdCompression_->addStats(add_stat, cookie);
+        return ENGINE_SUCCESS;
+    }
     if (key == "eviction"_ccb) {
         return doEvictionStats(cookie, add_stat);
     }
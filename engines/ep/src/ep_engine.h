@@ -44,6 +44,7 @@ class CheckpointConfig;
 struct CompactionConfig;
 class DcpConnMap;
 class DcpFlowControlManager;
+class DcpZstdCompression;
 class ItemMetaData;
 class KVBucket;
 class StoredValue;
@@ -128,6 +129,9 @@ public:
                                 const DocKey& key,
                                 Vbid vbucket,
                                 DocStateFilter documentStateFilter) override;
+    void get_multi(gsl::not_null<const void*> cookie,
+                   const std::vector<cb::GetMultiKey>& keys,
+                   std::vector<cb::EngineErrorItemPair>& results) override;
     cb::EngineErrorItemPair get_if(
             gsl::not_null<const void*> cookie,
             const DocKey& key,
@@ -430,6 +434,10 @@ public:
                           Vbid vbucket,
                           get_options_t options);
 
+    void getMultiInner(const void* cookie,
+                       const std::vector<cb::GetMultiKey>& keys,
+                       std::vector<cb::EngineErrorItemPair>& results);
+
     /**
      * Fetch an item only if the specified filter predicate returns true.
      *
@@ -642,6 +650,10 @@ public:
         return *dcpFlowControlManager_;
     }
 
+    DcpZstdCompression& getDcpZstdCompression() {
+        return *dcpZstdCompression_;
+    }
+
     /**
      * Returns the replication throttle instance
      *
@@ -1153,6 +1165,7 @@ protected:
     GET_SERVER_API getServerApiFunc;
 
     std::unique_ptr<DcpFlowControlManager> dcpFlowControlManager_;
+    std::unique_ptr<DcpZstdCompression> dcpZstdCompression_;
     std::unique_ptr<DcpConnMap> dcpConnMap_;
     CheckpointConfig *checkpointConfig;
     std::string name;
@@ -0,0 +1,64 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "flush_batch_prefetch.h"
+#include "kvstore.h"
+
+#include <phosphor/phosphor.h>
+
+FlushBatchPrefetch::FlushBatchPrefetch(VBucketPtr vb,
+                                       KVStore& kvstore,
+                                       size_t approxLimit)
+    : vbid(vb->getId()),
+      kvstore(kvstore),
+      approxLimit(approxLimit),
+      vb(std::move(vb)) {
+}
+
+void FlushBatchPrefetch::prefetch() {
+    std::lock_guard<std::mutex> lh(mutex);
+    drain();
+}
+
+VBucket::ItemsToFlush FlushBatchPrefetch::takeOver() {
+    std::lock_guard<std::mutex> lh(mutex);
+    drain();
+    return std::move(batch);
+}
+
+void FlushBatchPrefetch::drain() {
+    if (drained) {
+        return;
+    }
+    batch = vb->getItemsToPersist(approxLimit);
+    kvstore.optimizeWrites(batch.items);
+    drained = true;
+    vb.reset();
+}
+
+FlushBatchPrefetchTask::FlushBatchPrefetchTask(
+        EventuallyPersistentEngine& e,
+        std::shared_ptr<FlushBatchPrefetch> prefetch)
+    : GlobalTask(&e, TaskId::FlushBatchPrefetchTask, 0, false),
+      prefetch(std::move(prefetch)) {
+}
+
+bool FlushBatchPrefetchTask::run() {
+    TRACE_EVENT0("ep-engine/task", "FlushBatchPrefetchTask");
+    prefetch->prefetch();
+    return false;
+}
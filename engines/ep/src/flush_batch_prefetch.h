@@ -0,0 +1,84 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "globaltask.h"
+#include "vbucket.h"
+
+#include <mutex>
+
+class KVStore;
+
+/**
+ * The batch of a vBucket drained from its checkpoints ahead of the flush,
+ * while the flusher commits the batch of another vBucket.
+ *
+ * The flusher holds the vBucket's lock throughout; the drain runs on a
+ * FlushBatchPrefetchTask, or on the flusher itself if it takes the batch
+ * over before the task has started (so the flusher never waits for a NonIO
+ * thread to become free). The vBucket is only referenced until the batch
+ * has been drained; the task may run after the vBucket has been deleted.
+ */
+class FlushBatchPrefetch {
+public:
+    FlushBatchPrefetch(VBucketPtr vb, KVStore& kvstore, size_t approxLimit);
+
+    /// Drain the batch, unless already drained. Called by the prefetch task.
+    void prefetch();
+
+    /// @return the batch, draining it first if the task hasn't
+    VBucket::ItemsToFlush takeOver();
+
+    Vbid getVBucketId() const {
+        return vbid;
+    }
+
+private:
+    void drain();
+
+    const Vbid vbid;
+    KVStore& kvstore;
+    const size_t approxLimit;
+
+    std::mutex mutex;
+    /// Reset once the batch has been drained
+    VBucketPtr vb;
+    VBucket::ItemsToFlush batch;
+    bool drained = false;
+};
+
+/// Drains the batch of a FlushBatchPrefetch on a NonIO thread
+class FlushBatchPrefetchTask : public GlobalTask {
+public:
+    FlushBatchPrefetchTask(EventuallyPersistentEngine& e,
+                           std::shared_ptr<FlushBatchPrefetch> prefetch);
+
+    bool run() override;
+
+    std::string getDescription() override {
+        return "Preparing flush batch of " +
+               prefetch->getVBucketId().to_string();
+    }
+
+    std::chrono::microseconds maxExpectedDuration() override {
+        // Drains up to flusher_batch_split_trigger items from memory
+        return std::chrono::milliseconds(100);
+    }
+
+private:
+    const std::shared_ptr<FlushBatchPrefetch> prefetch;
+};
@@ -303,6 +303,33 @@ bool Flusher::flushVB() {
         return false;
     }
 
+    // With group commit, flush up to that many vBuckets with one sync
+    const auto groupMax = store->getFlusherGroupCommitMax();
+    if (groupMax > 1) {
+        std::vector<Vbid> group{vbid};
+        while (group.size() < groupMax && lpVbs.popFront(vbid)) {
+            group.push_back(vbid);
+        }
+        for (const auto more : store->flushVBucketGroup(group)) {
+            lpVbs.pushUnique(more);
+        }
+        return true;
+    }
+
+    // In pipelined mode prepare the batch of the next vBucket while the
+    // batch of this one commits.
+    Vbid nextVbid;
+    if (store->isFlusherPipelined() && lpVbs.popFront(nextVbid)) {
+        const auto more = store->flushVBucketPipelined(vbid, nextVbid);
+        if (more.first) {
+            lpVbs.pushUnique(vbid);
+        }
+        if (more.second) {
+            lpVbs.pushUnique(nextVbid);
+        }
+        return true;
+    }
+
     if (store->flushVBucket(vbid).first) {
         // More items still available, add vbid back to pending set.
         lpVbs.pushUnique(vbid);
@@ -28,8 +28,14 @@
 
 #include <logtags.h>
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <cstring>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HT_FINGERPRINT_SSE2 1
+#endif
+
 static const ssize_t prime_size_table[] = {
     3, 7, 13, 23, 47, 97, 193, 383, 769, 1531, 3079, 6143, 12289, 24571, 49157,
     98299, 196613, 393209, 786433, 1572869, 3145721, 6291449, 12582917,
@@ -82,6 +88,99 @@ std::string to_string(MutationStatus status) {
     return "<invalid>(" + std::to_string(int(status)) + ")";
 }
 
+std::string to_string(HashTableIndexMode mode) {
+    switch (mode) {
+    case HashTableIndexMode::Chained:
+        return "chained";
+    case HashTableIndexMode::Fingerprint:
+        return "fingerprint";
+    }
+    return "<invalid>(" + std::to_string(int(mode)) + ")";
+}
+
+HashTableIndexMode parseHashTableIndexMode(const std::string& mode) {
+    if (mode == "chained") {
+        return HashTableIndexMode::Chained;
+    }
+    if (mode == "fingerprint") {
+        return HashTableIndexMode::Fingerprint;
+    }
+    throw std::invalid_argument(
+            "parseHashTableIndexMode: unknown mode '" + mode + "'");
+}
+
+bool HashTable::FingerprintBlock::mayContain(uint8_t fingerprint) const {
+    if (count == Overflowed) {
+        return true;
+    }
+#ifdef HT_FINGERPRINT_SSE2
+    // Compare all 16 bytes at once; the last byte is the count which is
+    // masked out along with the unused tags.
+    const auto block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(this));
+    const auto matches = _mm_cmpeq_epi8(
+            block, _mm_set1_epi8(static_cast<char>(fingerprint)));
+    const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(matches));
+    return (mask & ((1u << count) - 1)) != 0;
+#else
+    for (uint8_t ii = 0; ii < count; ++ii) {
+        if (tags[ii] == fingerprint) {
+            return true;
+        }
+    }
+    return false;
+#endif
+}
+
+void HashTable::FingerprintBlock::insert(uint8_t fingerprint) {
+    if (count == Overflowed) {
+        return;
+    }
+    if (count == Capacity) {
+        count = Overflowed;
+        return;
+    }
+    tags[count++] = fingerprint;
+}
+
+bool HashTable::FingerprintBlock::remove(uint8_t fingerprint) {
+    if (count == Overflowed) {
+        return false;
+    }
+    for (uint8_t ii = 0; ii < count; ++ii) {
+        if (tags[ii] == fingerprint) {
+            // Order doesn't matter; move the last tag into the hole
+            tags[ii] = tags[--count];
+            tags[count] = 0;
+            return true;
+        }
+    }
+    throw std::logic_error(
+            "HashTable::FingerprintBlock::remove: fingerprint not present");
+}
+
+void HashTable::fingerprintInsert(size_t bucket, uint32_t hash) {
+    if (indexMode == HashTableIndexMode::Fingerprint) {
+        fingerprints[bucket].insert(getFingerprint(hash));
+    }
+}
+
+void HashTable::fingerprintRemove(size_t bucket, const StoredValue& removed) {
+    if (indexMode == HashTableIndexMode::Fingerprint &&
+        !fingerprints[bucket].remove(getFingerprint(removed.getKey().hash()))) {
+        rebuildFingerprints(bucket);
+    }
+}
+
+void HashTable::rebuildFingerprints(size_t bucket) {
+    FingerprintBlock block;
+    for (StoredValue* v = values[bucket].get().get(); v;
+         v = v->getNext().get().get()) {
+        block.insert(getFingerprint(v->getKey().hash()));
+    }
+    fingerprints[bucket] = block;
+}
+
 std::ostream& operator<<(std::ostream& os, const HashTable::Position& pos) {
     os << "{lock:" << pos.lock << " bucket:" << pos.hash_bucket << "/" << pos.ht_size << "}";
     return os;
@@ -136,8 +235,10 @@ StoredValue* HashTable::FindUpdateResult::selectSVToModify(const Item& itm) {
 HashTable::HashTable(EPStats& st,
                      std::unique_ptr<AbstractStoredValueFactory> svFactory,
                      size_t initialSize,
-                     size_t locks)
+                     size_t locks,
+                     HashTableIndexMode indexMode)
     : initialSize(initialSize),
+      indexMode(indexMode),
       size(initialSize),
       mutexes(locks),
       stats(st),
@@ -149,6 +250,9 @@ HashTable::HashTable(EPStats& st,
       maxDeletedRevSeqno(0),
       probabilisticCounter(freqCounterIncFactor) {
     values.resize(size);
+    if (indexMode == HashTableIndexMode::Fingerprint) {
+        fingerprints.resize(size);
+    }
     activeState = true;
 }
 
@@ -197,6 +301,7 @@ void HashTable::clear_UNLOCKED(bool deactivate) {
             values[i] = std::move(v->getNext());
         }
     }
+    std::fill(fingerprints.begin(), fingerprints.end(), FingerprintBlock{});
 
     stats.coreLocal.get()->currentSize.fetch_sub(clearedMemSize -
                                                  clearedValSize);
@@ -279,6 +384,8 @@ void HashTable::resize(size_t newSize) {
 
     // Get a place for the new items.
     table_type newValues(newSize);
+    std::vector<FingerprintBlock> newFingerprints(
+            indexMode == HashTableIndexMode::Fingerprint ? newSize : 0);
 
     stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
     ++numResizes;
@@ -295,14 +402,19 @@ void HashTable::resize(size_t newSize) {
             values[i] = std::move(v->getNext());
 
             // And re-link it into the correct place in newValues.
-            int newBucket = getBucketForHash(v->getKey().hash());
+            const auto hash = v->getKey().hash();
+            int newBucket = getBucketForHash(hash);
             v->setNext(std::move(newValues[newBucket]));
             newValues[newBucket] = std::move(v);
+            if (indexMode == HashTableIndexMode::Fingerprint) {
+                newFingerprints[newBucket].insert(getFingerprint(hash));
+            }
         }
     }
 
     // Finally assign the new table to values.
     values = std::move(newValues);
+    fingerprints = std::move(newFingerprints);
 
     stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
 }
@@ -313,7 +425,14 @@ HashTable::FindInnerResult HashTable::findInner(const DocKey& key) {
                 "HashTable::find: Cannot call on a "
                 "non-active object");
     }
-    HashBucketLock hbl = getLockedBucket(key);
+    const auto hash = key.hash();
+    HashBucketLock hbl = getLockedBucketForHash(hash);
+    if (indexMode == HashTableIndexMode::Fingerprint &&
+        !fingerprints[hbl.getBucketNum()].mayContain(getFingerprint(hash))) {
+        // No key in the chain has a matching fingerprint; no need to walk it.
+        return {std::move(hbl), nullptr, nullptr};
+    }
+
     // Scan through all elements in the hash bucket chain looking for Committed
     // and Pending items with the same key.
     StoredValue* foundCmt = nullptr;
@@ -421,6 +540,7 @@ StoredValue* HashTable::unlocked_addNewStoredValue(const HashBucketLock& hbl,
     valueStats.epilogue(emptyProperties, v.get().get());
 
     values[hbl.getBucketNum()] = std::move(v);
+    fingerprintInsert(hbl.getBucketNum(), itm.getKey().hash());
     return values[hbl.getBucketNum()].get().get();
 }
 
@@ -563,6 +683,7 @@ HashTable::unlocked_replaceByCopy(const HashBucketLock& hbl,
     valueStats.epilogue(emptyProperties, newSv.get().get());
 
     values[hbl.getBucketNum()] = std::move(newSv);
+    fingerprintInsert(hbl.getBucketNum(), vToCopy.getKey().hash());
     return {values[hbl.getBucketNum()].get().get(), std::move(releasedSv)};
 }
 
@@ -814,6 +935,7 @@ StoredValue::UniquePtr HashTable::unlocked_release(
                 "HashTable::unlocked_release_base: StoredValue to be released "
                 "not found in HashTable; possibly HashTable leak");
     }
+    fingerprintRemove(hbl.getBucketNum(), *released.get().get());
 
     // Update statistics for the item which is now gone.
     const auto preProps = valueStats.prologue(released.get().get());
@@ -1088,6 +1210,7 @@ bool HashTable::unlocked_ejectItem(const HashTable::HashBucketLock&,
         auto removed = hashChainRemoveFirst(
                 values[bucket_num],
                 [vptr](const StoredValue* v) { return v == vptr; });
+        fingerprintRemove(bucket_num, *removed.get().get());
 
         if (removed->isResident()) {
             ++stats.numValueEjects;
@@ -25,6 +25,7 @@
 
 #include <array>
 #include <functional>
+#include <string>
 
 class AbstractStoredValueFactory;
 class HashTableVisitor;
@@ -72,6 +73,31 @@ enum class DeletionStatus : uint8_t {
 };
 
 enum class DeletionDurability : uint8_t {};
+
+/**
+ * How the HashTable locates a key within a hash bucket.
+ */
+enum class HashTableIndexMode : uint8_t {
+    /// Walk the bucket's chain of StoredValues, comparing each key.
+    Chained,
+    /**
+     * Keep a block of one-byte key fingerprints per hash bucket in front of
+     * the chains. A lookup compares the key's fingerprint against the whole
+     * block at once (using SIMD where available), and only walks the chain
+     * if a fingerprint matches - most misses are resolved by reading a
+     * single cache line instead of every StoredValue in the chain.
+     */
+    Fingerprint
+};
+
+std::string to_string(HashTableIndexMode mode);
+
+/**
+ * Parse the "ht_index_mode" configuration value.
+ * @throws std::invalid_argument if the mode isn't known
+ */
+HashTableIndexMode parseHashTableIndexMode(const std::string& mode);
+
 /**
  * A container of StoredValue instances.
  *
@@ -431,20 +457,30 @@ public:
      * @param svFactory Factory to use for constructing stored values
      * @param initialSize the number of hash table buckets to initially create.
      * @param locks the number of locks in the hash table
+     * @param indexMode how keys are located within a hash bucket
      */
     HashTable(EPStats& st,
               std::unique_ptr<AbstractStoredValueFactory> svFactory,
               size_t initialSize,
-              size_t locks);
+              size_t locks,
+              HashTableIndexMode indexMode = HashTableIndexMode::Chained);
 
     ~HashTable();
 
     size_t memorySize() {
         return sizeof(HashTable)
             + (size * sizeof(StoredValue*))
+            + (fingerprints.size() * sizeof(FingerprintBlock))
             + (mutexes.size() * sizeof(std::mutex));
     }
 
+    /**
+     * Get the mode used to locate keys within a hash bucket.
+     */
+    HashTableIndexMode getIndexMode() const {
+        return indexMode;
+    }
+
     /**
      * Get the number of hash table buckets this hash table has.
      */
@@ -455,6 +491,15 @@ public:
      */
     size_t getNumLocks(void) { return mutexes.size(); }
 
+    /**
+     * Get the index of the lock which currently protects the given key.
+     * The table may be resized at any time so this should only be used
+     * as a hint (for instance to order a batch of lookups).
+     */
+    size_t getLockIndexHint(const DocKey& key) {
+        return getBucketForHash(key.hash()) % mutexes.size();
+    }
+
     /**
      * Get the number of in-memory non-resident and resident items within
      * this hash table.
@@ -1272,6 +1317,57 @@ private:
     // The container for actually holding the StoredValues.
     using table_type = std::vector<StoredValue::UniquePtr>;
 
+    /**
+     * The fingerprints of the keys in a single hash bucket's chain (in no
+     * particular order) - used by HashTableIndexMode::Fingerprint.
+     *
+     * A block is 16 bytes so the whole block can be compared against a
+     * fingerprint with a single SIMD compare, and four blocks share a
+     * cache line.
+     */
+    struct alignas(16) FingerprintBlock {
+        /// Maximum number of fingerprints a block can hold
+        static constexpr uint8_t Capacity = 15;
+        /// Value of count once the chain holds more than Capacity items;
+        /// the block can then no longer rule out any key.
+        static constexpr uint8_t Overflowed = 0xff;
+
+        /// @return true if the chain may hold a key with the fingerprint
+        bool mayContain(uint8_t fingerprint) const;
+
+        /// Record a key with the given fingerprint being added to the chain
+        void insert(uint8_t fingerprint);
+
+        /**
+         * Record a key with the given fingerprint being removed from the
+         * chain.
+         * @return false if the block has overflowed and must be rebuilt
+         */
+        bool remove(uint8_t fingerprint);
+
+        std::array<uint8_t, Capacity> tags{};
+        uint8_t count = 0;
+    };
+    static_assert(sizeof(FingerprintBlock) == 16,
+                  "FingerprintBlock should fit in a SIMD register");
+
+    /// Fingerprint for a key hash. Uses different bits of the hash to the
+    /// ones used to select the hash bucket.
+    static uint8_t getFingerprint(uint32_t hash) {
+        return static_cast<uint8_t>((hash * 0x9e3779b1u) >> 24);
+    }
+
+    /// Record that a StoredValue with the given key hash was linked into the
+    /// chain of the given bucket.
+    void fingerprintInsert(size_t bucket, uint32_t hash);
+
+    /// Record that the given StoredValue was unlinked from the chain of the
+    /// given bucket.
+    void fingerprintRemove(size_t bucket, const StoredValue& removed);
+
+    /// Recalculate the fingerprint block for a bucket from its chain.
+    void rebuildFingerprints(size_t bucket);
+
     friend class StoredValue;
     friend std::ostream& operator<<(std::ostream& os, const HashTable& ht);
 
@@ -1352,10 +1448,16 @@ private:
     // The initial (and minimum) size of the HashTable.
     const size_t initialSize;
 
+    // How keys are located within a hash bucket
+    const HashTableIndexMode indexMode;
+
     // The size of the hash table (number of buckets) - i.e. number of elements
     // in `values`
     std::atomic<size_t> size;
     table_type values;
+    // One FingerprintBlock per element in `values` when using
+    // HashTableIndexMode::Fingerprint, otherwise empty.
+    std::vector<FingerprintBlock> fingerprints;
     // Mutable so that we can make dumpStoredValuesAsJson const
     mutable std::vector<std::mutex> mutexes;
     EPStats&             stats;
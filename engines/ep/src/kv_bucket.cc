@@ -18,9 +18,11 @@
 #include <string.h>
 #include <time.h>
 
+#include <algorithm>
 #include <functional>
 #include <map>
 #include <memory>
+#include <numeric>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -31,6 +33,7 @@
 #include <utilities/logtags.h>
 
 #include "access_scanner.h"
+#include "bgfetcher.h"
 #include "bucket_logger.h"
 #include "checkpoint_manager.h"
 #include "checkpoint_remover.h"
@@ -1440,15 +1443,23 @@ GetValue KVBucket::getInternal(const DocKey& key,
         return GetValue(nullptr, ENGINE_NOT_MY_VBUCKET);
     }
 
+    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    return getInternalLocked(*vb, key, cookie, getReplicaItem, options);
+}
+
+GetValue KVBucket::getInternalLocked(VBucket& vb,
+                                     const DocKey& key,
+                                     const void* cookie,
+                                     const ForGetReplicaOp getReplicaItem,
+                                     get_options_t options) {
     const bool honorStates = (options & HONOR_STATES);
 
-    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
     if (honorStates) {
         vbucket_state_t disallowedState =
                 (getReplicaItem == ForGetReplicaOp::Yes)
                         ? vbucket_state_active
                         : vbucket_state_replica;
-        vbucket_state_t vbState = vb->getState();
+        vbucket_state_t vbState = vb.getState();
         if (vbState == vbucket_state_dead) {
             ++stats.numNotMyVBuckets;
             return GetValue(nullptr, ENGINE_NOT_MY_VBUCKET);
@@ -1465,9 +1476,9 @@ GetValue KVBucket::getInternal(const DocKey& key,
                 ++stats.numNotMyVBuckets;
                 return GetValue(nullptr, ENGINE_NOT_MY_VBUCKET);
             }
-            if (vb->addPendingOp(cookie)) {
+            if (vb.addPendingOp(cookie)) {
                 if (options & TRACK_STATISTICS) {
-                    vb->opsGet++;
+                    vb.opsGet++;
                 }
                 return GetValue(nullptr, ENGINE_EWOULDBLOCK);
             }
@@ -1475,7 +1486,7 @@ GetValue KVBucket::getInternal(const DocKey& key,
     }
 
     { // hold collections read handle for duration of get
-        auto cHandle = vb->lockCollections(key);
+        auto cHandle = vb.lockCollections(key);
         if (!cHandle.valid()) {
             engine.setErrorJsonExtras(
                     cookie,
@@ -1484,13 +1495,66 @@ GetValue KVBucket::getInternal(const DocKey& key,
             return GetValue(nullptr, ENGINE_UNKNOWN_COLLECTION);
         }
 
-        return vb->getInternal(cookie,
-                               engine,
-                               options,
-                               VBucket::GetKeyOnly::No,
-                               cHandle,
-                               getReplicaItem);
+        return vb.getInternal(cookie,
+                              engine,
+                              options,
+                              VBucket::GetKeyOnly::No,
+                              cHandle,
+                              getReplicaItem);
+    }
+}
+
+std::vector<GetValue> KVBucket::getMulti(
+        const std::vector<cb::GetMultiKey>& keys,
+        const void* cookie,
+        get_options_t options) {
+    std::vector<GetValue> results(keys.size());
+
+    // Visit the keys grouped by vbucket so that each vbucket is only looked
+    // up (and its state lock acquired) once, and within a vbucket in hash
+    // table lock order to improve the locality of the lookups.
+    std::vector<size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) {
+        return keys[a].vbucket < keys[b].vbucket;
+    });
+
+    auto begin = order.begin();
+    while (begin != order.end()) {
+        const auto vbid = keys[*begin].vbucket;
+        const auto end =
+                std::find_if(begin, order.end(), [&keys, vbid](size_t idx) {
+                    return keys[idx].vbucket != vbid;
+                });
+
+        VBucketPtr vb = getVBucket(vbid);
+        if (!vb) {
+            for (auto it = begin; it != end; ++it) {
+                ++stats.numNotMyVBuckets;
+                results[*it] = GetValue(nullptr, ENGINE_NOT_MY_VBUCKET);
+            }
+            begin = end;
+            continue;
+        }
+
+        std::sort(begin, end, [&keys, &vb](size_t a, size_t b) {
+            return vb->ht.getLockIndexHint(keys[a].key) <
+                   vb->ht.getLockIndexHint(keys[b].key);
+        });
+
+        // Hold back the BgFetcher while we queue the fetches for this
+        // vbucket so that all of the misses are read in the same batch
+        BgFetcher::BatchGuard batch(
+                vbMap.getShardByVbId(vbid)->getBgFetcher());
+        folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+        for (auto it = begin; it != end; ++it) {
+            results[*it] = getInternalLocked(
+                    *vb, keys[*it].key, cookie, ForGetReplicaOp::No, options);
+        }
+        begin = end;
     }
+
+    return results;
 }
 
 GetValue KVBucket::getRandomKey() {
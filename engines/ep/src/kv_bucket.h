@@ -127,6 +127,10 @@ public:
         return getInternal(key, vbucket, cookie, ForGetReplicaOp::No, options);
     }
 
+    std::vector<GetValue> getMulti(const std::vector<cb::GetMultiKey>& keys,
+                                   const void* cookie,
+                                   get_options_t options) override;
+
     GetValue getRandomKey() override;
 
     GetValue getReplica(const DocKey& key,
@@ -686,6 +690,16 @@ protected:
                          ForGetReplicaOp getReplicaItem,
                          get_options_t options) override;
 
+    /**
+     * The part of getInternal() performed once the vbucket has been found
+     * and its state lock acquired
+     */
+    GetValue getInternalLocked(VBucket& vb,
+                               const DocKey& key,
+                               const void* cookie,
+                               ForGetReplicaOp getReplicaItem,
+                               get_options_t options);
+
     bool resetVBucket_UNLOCKED(LockedVBucketPtr& vb,
                                std::unique_lock<std::mutex>& vbset);
 
@@ -141,6 +141,24 @@ public:
                          const void* cookie,
                          get_options_t options) = 0;
 
+    /**
+     * Retrieve a batch of values.
+     *
+     * The keys are grouped per vbucket (and hash table lock within each
+     * vbucket), and all of the non-resident items in a vbucket are queued
+     * for a single background fetch.
+     *
+     * @param keys    the keys (and vbuckets) to fetch
+     * @param cookie  the connection cookie
+     * @param options options specified for retrieval
+     *
+     * @return one GetValue for each element in keys (in the same order)
+     */
+    virtual std::vector<GetValue> getMulti(
+            const std::vector<cb::GetMultiKey>& keys,
+            const void* cookie,
+            get_options_t options) = 0;
+
     /**
      * Retrieve a value randomly from the store.
      *
@@ -598,6 +598,29 @@ public:
      */
     virtual bool commit(Collections::VB::Flush& collectionsFlush) = 0;
 
+    /**
+     * Open a commit group (group commit). Until closeCommitGroup() a commit()
+     * writes its batch but needn't make it durable: its persistence
+     * callbacks are held back, and every batch of the group is then made
+     * durable at once by closeCommitGroup() - for example by one sync of a
+     * write-ahead log shared by the vBuckets, instead of one per commit.
+     *
+     * @return false if the KVStore doesn't support group commit, in which
+     *         case every commit() remains durable on return (and no group
+     *         is opened)
+     */
+    virtual bool openCommitGroup() {
+        return false;
+    }
+
+    /**
+     * Make the batches committed since openCommitGroup() durable and run
+     * their persistence callbacks, in the order they were committed. If the
+     * sync fails the callbacks of every batch of the group report failure.
+     */
+    virtual void closeCommitGroup() {
+    }
+
     /**
      * Rollback the current transaction.
      */
@@ -862,6 +885,23 @@ public:
 
     virtual void destroyScanContext(ScanContext* ctx) = 0;
 
+    /**
+     * Count the documents (including deletes and prepares) with a seqno in
+     * the given range, as of the snapshot read by the scan.
+     *
+     * @param sctx The scan
+     * @param startSeqno First seqno of the range
+     * @param endSeqno Last seqno of the range
+     * @param[out] count The number of documents
+     * @return false if the count failed or is not supported by the KVStore
+     */
+    virtual bool getScanItemCount(ScanContext* sctx,
+                                  uint64_t startSeqno,
+                                  uint64_t endSeqno,
+                                  uint64_t& count) {
+        return false;
+    }
+
     /**
      * Obtain a KVFileHandle which holds the KVStore implementation's handle
      * and provides RAII management of the resource.
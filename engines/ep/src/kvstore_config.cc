@@ -60,6 +60,8 @@ KVStoreConfig::KVStoreConfig(Configuration& config,
     config.addValueChangedListener(
             "fsync_after_every_n_bytes_written",
             std::make_unique<ConfigChangeListener>(*this));
+    setReadAheadMax(config.getCouchstoreReadaheadMax());
+    setAsyncReadQueueDepth(config.getCouchstoreAsyncReadQueueDepth());
     setCouchstoreTracingEnabled(config.isCouchstoreTracing());
     config.addValueChangedListener(
             "couchstore_tracing",
@@ -86,6 +88,8 @@ KVStoreConfig::KVStoreConfig(uint16_t _maxVBuckets,
       shardId(_shardId),
       logger(globalBucketLogger.get()),
       buffered(true),
+      readAheadMax(0),
+      asyncReadQueueDepth(0),
       couchstoreTracingEnabled(false),
       couchstoreWriteValidationEnabled(false),
       couchstoreMprotectEnabled(false) {
@@ -91,6 +91,34 @@ public:
      */
     KVStoreConfig& setBuffered(bool _buffered);
 
+    /**
+     * Max number of bytes to read ahead of the documents read by bgfetches
+     * and scans which are adjacent on disk; zero disables read-ahead.
+     *
+     * Only recognised by CouchKVStore
+     */
+    size_t getReadAheadMax() const {
+        return readAheadMax;
+    }
+
+    void setReadAheadMax(size_t bytes) {
+        readAheadMax = bytes;
+    }
+
+    /**
+     * Max number of reads in flight per file read by bgfetches and scans;
+     * zero disables async reads.
+     *
+     * Only recognised by CouchKVStore
+     */
+    size_t getAsyncReadQueueDepth() const {
+        return asyncReadQueueDepth;
+    }
+
+    void setAsyncReadQueueDepth(size_t depth) {
+        asyncReadQueueDepth = depth;
+    }
+
     uint64_t getPeriodicSyncBytes() const {
         return periodicSyncBytes;
     }
@@ -131,6 +159,8 @@ private:
     uint16_t shardId;
     BucketLogger* logger;
     bool buffered;
+    size_t readAheadMax;
+    size_t asyncReadQueueDepth;
 
     // Following config variables are atomic as can be changed (via
     // ConfigChangeListener) at runtime by front-end threads while read by
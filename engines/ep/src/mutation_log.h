@@ -36,6 +36,9 @@
  * during warmup there's no guarantee that the keys listed still exist - the
  * contents of the Access log is essentially just a hint / suggestion.
  *
+ * The AccessScanner now writes the access.log in the sorted format (see
+ * sorted_access_log.h); warmup still reads access logs in this format, as
+ * written by earlier versions.
  */
 
 #include "mutation_log_entry.h"
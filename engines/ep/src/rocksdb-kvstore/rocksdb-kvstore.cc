@@ -586,10 +586,18 @@ bool RocksDBKVStore::commit(Collections::VB::Flush& collectionsFlush) {
         success = false;
     }
 
-    commitCallback(status, commitBatch);
-
     // This behaviour is to replicate the one in Couchstore.
     // Set `in_transanction = false` only if `commit` is successful.
+    if (success && commitGroupOpen) {
+        // Only complete once the WAL of the group is synced
+        groupedCommits.emplace_back(std::move(commitBatch),
+                                    std::move(transactionCtx));
+        in_transaction = false;
+        return success;
+    }
+
+    commitCallback(status, commitBatch, *transactionCtx);
+
     if (success) {
         in_transaction = false;
         transactionCtx.reset();
@@ -598,6 +606,46 @@ bool RocksDBKVStore::commit(Collections::VB::Flush& collectionsFlush) {
     return success;
 }
 
+bool RocksDBKVStore::openCommitGroup() {
+    if (commitGroupOpen) {
+        throw std::logic_error(
+                "RocksDBKVStore::openCommitGroup: A group is already open");
+    }
+    commitGroupOpen = true;
+    return true;
+}
+
+void RocksDBKVStore::closeCommitGroup() {
+    if (!commitGroupOpen) {
+        return;
+    }
+    commitGroupOpen = false;
+
+    auto status = rocksdb::Status::OK();
+    if (!groupedCommits.empty()) {
+        auto begin = std::chrono::steady_clock::now();
+        status = rdb->SyncWAL();
+        st.fsStats.syncTimeHisto.add(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - begin));
+        if (!status.ok()) {
+            logger.warn(
+                    "RocksDBKVStore::closeCommitGroup: SyncWAL error:{}, "
+                    "commits:{}",
+                    status.code(),
+                    groupedCommits.size());
+            // The writes may not be durable; have the flusher retry them
+            status = rocksdb::Status::Busy();
+        }
+    }
+
+    auto commits = std::move(groupedCommits);
+    groupedCommits.clear();
+    for (auto& commit : commits) {
+        commitCallback(status, commit.first, *commit.second);
+    }
+}
+
 static KVStore::MutationStatus getMutationStatus(rocksdb::Status status) {
     switch (status.code()) {
     case rocksdb::Status::Code::kOk:
@@ -617,7 +665,8 @@ static KVStore::MutationStatus getMutationStatus(rocksdb::Status status) {
 }
 
 void RocksDBKVStore::commitCallback(rocksdb::Status status,
-                                    const PendingRequestQueue& commitBatch) {
+                                    const PendingRequestQueue& commitBatch,
+                                    TransactionContext& txCtx) {
     for (const auto& request : commitBatch) {
         auto dataSize = request.getDocMetaSlice().size() +
                         request.getDocBodySlice().size();
@@ -642,7 +691,7 @@ void RocksDBKVStore::commitCallback(rocksdb::Status status,
                 // did not exist.
                 mutationStatus = MutationStatus::DocNotFound;
             }
-            request.getDelCallback()(*transactionCtx, mutationStatus);
+            request.getDelCallback()(txCtx, mutationStatus);
         } else {
             if (status.code()) {
                 ++st.numSetFailure;
@@ -656,8 +705,7 @@ void RocksDBKVStore::commitCallback(rocksdb::Status status,
             // However, to achieve this we would need to perform a Get to
             // RocksDB which is costly. For now just assume that the item did
             // not exist.
-            request.getSetCallback()(*transactionCtx,
-                                     MutationSetResultState::Insert);
+            request.getSetCallback()(txCtx, MutationSetResultState::Insert);
         }
     }
 }
@@ -1257,8 +1305,13 @@ void RocksDBKVStore::applyUserCFOptions(rocksdb::ColumnFamilyOptions& cfOptions,
 }
 
 rocksdb::Status RocksDBKVStore::writeAndTimeBatch(rocksdb::WriteBatch batch) {
+    auto options = writeOptions;
+    if (commitGroupOpen) {
+        // The WAL is synced by closeCommitGroup
+        options.sync = false;
+    }
     auto begin = std::chrono::steady_clock::now();
-    auto status = rdb->Write(writeOptions, &batch);
+    auto status = rdb->Write(options, &batch);
     st.commitHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(
             std::chrono::steady_clock::now() - begin));
     return status;
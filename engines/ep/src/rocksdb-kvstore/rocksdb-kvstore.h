@@ -148,6 +148,15 @@ public:
      */
     bool commit(Collections::VB::Flush& collectionsFlush) override;
 
+    /**
+     * Open a commit group: the batches of the commits are written without
+     * syncing the WAL, which is synced once by closeCommitGroup before the
+     * callbacks of the commits are invoked.
+     */
+    bool openCommitGroup() override;
+
+    void closeCommitGroup() override;
+
     /**
      * Rollback a transaction (unless not currently in one).
      */
@@ -463,7 +472,8 @@ private:
                                            const RocksRequest& request);
 
     void commitCallback(rocksdb::Status status,
-                        const PendingRequestQueue& commitBatch);
+                        const PendingRequestQueue& commitBatch,
+                        TransactionContext& txCtx);
 
     int64_t readHighSeqnoFromDisk(const VBHandle& db);
 
@@ -517,6 +527,13 @@ private:
 
     std::unique_ptr<TransactionContext> transactionCtx;
 
+    // Set while a commit group is open; the commits of the group wait in
+    // groupedCommits for the WAL to be synced.
+    bool commitGroupOpen = false;
+    std::vector<std::pair<PendingRequestQueue,
+                          std::unique_ptr<TransactionContext>>>
+            groupedCommits;
+
     std::atomic<size_t> scanCounter; // atomic counter for generating scan id
 
     // The number of total hits in the SeqnoCF when executing 'scan()'.
@@ -0,0 +1,310 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "sorted_access_log.h"
+
+extern "C" {
+#include "crc32.h"
+}
+
+#include <platform/memorymap.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+const char SortedAccessLog::Magic[8] = {
+        'c', 'b', 'a', 'l', 'o', 'g', 's', '1'};
+
+static void appendUint16(std::vector<uint8_t>& buf, uint16_t val) {
+    buf.push_back(uint8_t(val >> 8));
+    buf.push_back(uint8_t(val));
+}
+
+static void appendUint32(std::vector<uint8_t>& buf, uint32_t val) {
+    appendUint16(buf, uint16_t(val >> 16));
+    appendUint16(buf, uint16_t(val));
+}
+
+static void appendUint64(std::vector<uint8_t>& buf, uint64_t val) {
+    appendUint32(buf, uint32_t(val >> 32));
+    appendUint32(buf, uint32_t(val));
+}
+
+static uint16_t readUint16(const uint8_t* ptr) {
+    return uint16_t((ptr[0] << 8) | ptr[1]);
+}
+
+static uint32_t readUint32(const uint8_t* ptr) {
+    return (uint32_t(readUint16(ptr)) << 16) | readUint16(ptr + 2);
+}
+
+static uint64_t readUint64(const uint8_t* ptr) {
+    return (uint64_t(readUint32(ptr)) << 32) | readUint32(ptr + 4);
+}
+
+static uint32_t crc32(const uint8_t* data, size_t size) {
+    return crc32buf(const_cast<uint8_t*>(data), size);
+}
+
+bool SortedAccessLog::isSortedAccessLog(const std::string& path) {
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        return false;
+    }
+    char magic[sizeof(Magic)];
+    const bool ret = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+                     memcmp(magic, Magic, sizeof(Magic)) == 0;
+    fclose(fp);
+    return ret;
+}
+
+SortedAccessLogWriter::SortedAccessLogWriter(std::string path_)
+    : path(std::move(path_)) {
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::system_error(errno,
+                                std::system_category(),
+                                "SortedAccessLogWriter: failed to create '" +
+                                        path + "'");
+    }
+
+    // The index offset is left as zero until commit()
+    std::vector<uint8_t> header(Magic, Magic + sizeof(Magic));
+    appendUint64(header, 0);
+    write(header.data(), header.size());
+}
+
+SortedAccessLogWriter::~SortedAccessLogWriter() {
+    if (file != nullptr) {
+        fclose(file);
+    }
+}
+
+void SortedAccessLogWriter::addVBucket(Vbid vbid,
+                                       std::vector<StoredDocKey> keys) {
+    // The keys of a committed item are stored on disk as-is (see
+    // DiskDocKey), so sorting the StoredDocKeys gives the on-disk order
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    size_t bytes = 0;
+    for (const auto& key : keys) {
+        bytes += sizeof(uint16_t) + key.size();
+    }
+    std::vector<uint8_t> section;
+    section.reserve(bytes);
+    for (const auto& key : keys) {
+        if (key.size() > std::numeric_limits<uint16_t>::max()) {
+            throw std::invalid_argument(
+                    "SortedAccessLogWriter::addVBucket: key is too long");
+        }
+        appendUint16(section, uint16_t(key.size()));
+        section.insert(section.end(), key.data(), key.data() + key.size());
+    }
+
+    IndexEntry entry;
+    entry.vbid = vbid;
+    entry.crc = crc32(section.data(), section.size());
+    entry.length = section.size();
+    entry.keys = keys.size();
+
+    std::lock_guard<std::mutex> guard(mutex);
+    if (committed) {
+        throw std::logic_error(
+                "SortedAccessLogWriter::addVBucket: log is already committed");
+    }
+    for (const auto& existing : index) {
+        if (existing.vbid == vbid) {
+            throw std::logic_error("SortedAccessLogWriter::addVBucket: " +
+                                   vbid.to_string() + " is already added");
+        }
+    }
+    entry.offset = offset;
+    write(section.data(), section.size());
+    index.push_back(entry);
+    numKeys += keys.size();
+}
+
+void SortedAccessLogWriter::commit() {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (committed) {
+        return;
+    }
+
+    std::vector<uint8_t> entries;
+    entries.reserve(index.size() * IndexEntrySize);
+    for (const auto& entry : index) {
+        appendUint16(entries, entry.vbid.get());
+        appendUint16(entries, 0);
+        appendUint32(entries, entry.crc);
+        appendUint64(entries, entry.offset);
+        appendUint64(entries, entry.length);
+        appendUint64(entries, entry.keys);
+    }
+
+    std::vector<uint8_t> indexHeader;
+    appendUint32(indexHeader, uint32_t(index.size()));
+    appendUint32(indexHeader, crc32(entries.data(), entries.size()));
+
+    const auto indexOffset = offset;
+    write(indexHeader.data(), indexHeader.size());
+    write(entries.data(), entries.size());
+
+    // Everything is in place; point the header at the index
+    std::vector<uint8_t> encodedOffset;
+    appendUint64(encodedOffset, indexOffset);
+    if (fflush(file) != 0 || fseek(file, sizeof(Magic), SEEK_SET) != 0) {
+        throw std::system_error(errno,
+                                std::system_category(),
+                                "SortedAccessLogWriter::commit: failed to "
+                                "seek in '" + path + "'");
+    }
+    write(encodedOffset.data(), encodedOffset.size());
+
+    const auto ret = fclose(file);
+    file = nullptr;
+    if (ret != 0) {
+        throw std::system_error(errno,
+                                std::system_category(),
+                                "SortedAccessLogWriter::commit: failed to "
+                                "close '" + path + "'");
+    }
+    committed = true;
+}
+
+size_t SortedAccessLogWriter::getNumKeys() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return numKeys;
+}
+
+void SortedAccessLogWriter::write(const void* data, size_t size) {
+    if (size != 0 && fwrite(data, 1, size, file) != size) {
+        throw std::system_error(errno,
+                                std::system_category(),
+                                "SortedAccessLogWriter: failed to write to '" +
+                                        path + "'");
+    }
+    offset += size;
+}
+
+DocKey SortedAccessLogReader::KeyStream::next() {
+    if (end - pos < ptrdiff_t(sizeof(uint16_t))) {
+        throw std::runtime_error(
+                "SortedAccessLogReader::KeyStream::next: truncated section");
+    }
+    const auto len = readUint16(pos);
+    pos += sizeof(uint16_t);
+    if (end - pos < ptrdiff_t(len)) {
+        throw std::runtime_error(
+                "SortedAccessLogReader::KeyStream::next: truncated key");
+    }
+    DocKey key(pos, len, DocKeyEncodesCollectionId::Yes);
+    pos += len;
+    return key;
+}
+
+SortedAccessLogReader::SortedAccessLogReader(const std::string& path) {
+    map = std::make_unique<cb::io::MemoryMappedFile>(
+            path.c_str(), cb::io::MemoryMappedFile::Mode::RDONLY);
+    auto content = map->content();
+    data = reinterpret_cast<const uint8_t*>(content.data());
+    size = content.size();
+
+    if (size < HeaderSize || memcmp(data, Magic, sizeof(Magic)) != 0) {
+        throw std::runtime_error("SortedAccessLogReader: '" + path +
+                                 "' is not a sorted access log");
+    }
+    const auto indexOffset = readUint64(data + sizeof(Magic));
+    if (indexOffset == 0) {
+        throw std::runtime_error("SortedAccessLogReader: '" + path +
+                                 "' is incomplete");
+    }
+    if (indexOffset < HeaderSize || indexOffset > size - IndexHeaderSize) {
+        throw std::runtime_error("SortedAccessLogReader: '" + path +
+                                 "' has an invalid index offset");
+    }
+
+    const auto* ptr = data + indexOffset;
+    const auto count = readUint32(ptr);
+    const auto crc = readUint32(ptr + sizeof(uint32_t));
+    ptr += IndexHeaderSize;
+    if ((size - indexOffset - IndexHeaderSize) / IndexEntrySize < count) {
+        throw std::runtime_error("SortedAccessLogReader: '" + path +
+                                 "' has a truncated index");
+    }
+    if (crc32(ptr, count * IndexEntrySize) != crc) {
+        throw std::runtime_error("SortedAccessLogReader: '" + path +
+                                 "' has a CRC mismatch in the index");
+    }
+
+    index.reserve(count);
+    for (uint32_t ii = 0; ii < count; ++ii, ptr += IndexEntrySize) {
+        IndexEntry entry;
+        entry.vbid = Vbid(readUint16(ptr));
+        entry.crc = readUint32(ptr + 4);
+        entry.offset = readUint64(ptr + 8);
+        entry.length = readUint64(ptr + 16);
+        entry.keys = readUint64(ptr + 24);
+        if (entry.offset < HeaderSize || entry.offset > indexOffset ||
+            entry.length > indexOffset - entry.offset) {
+            throw std::runtime_error("SortedAccessLogReader: '" + path +
+                                     "' has an invalid section for " +
+                                     entry.vbid.to_string());
+        }
+        index.push_back(entry);
+    }
+
+#ifndef WIN32
+    // The sections are consumed front to back; let the kernel read ahead
+    posix_madvise(const_cast<uint8_t*>(data), size, POSIX_MADV_SEQUENTIAL);
+#endif
+}
+
+SortedAccessLogReader::~SortedAccessLogReader() = default;
+
+size_t SortedAccessLogReader::getNumKeys() const {
+    size_t ret = 0;
+    for (const auto& entry : index) {
+        ret += entry.keys;
+    }
+    return ret;
+}
+
+SortedAccessLogReader::KeyStream SortedAccessLogReader::getKeys(
+        Vbid vbid) const {
+    for (const auto& entry : index) {
+        if (entry.vbid != vbid) {
+            continue;
+        }
+        const auto* begin = data + entry.offset;
+        if (crc32(begin, entry.length) != entry.crc) {
+            throw std::runtime_error(
+                    "SortedAccessLogReader::getKeys: CRC mismatch for " +
+                    vbid.to_string());
+        }
+        return {begin, begin + entry.length, entry.keys};
+    }
+    return {nullptr, nullptr, 0};
+}
@@ -0,0 +1,214 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Sorted access log
+ *
+ * An alternative on-disk format for the access.log (see mutation_log.h for
+ * the original one). The AccessScanner records which keys were resident in
+ * each vBucket, and warmup uses that as a hint of which values to load.
+ *
+ * Replaying a MutationLog requires the MutationLogHarvester to build a set of
+ * keys per vBucket in memory before it can issue any bgfetches. In the sorted
+ * format the keys of each vBucket are already de-duplicated and sorted in the
+ * order they are stored on disk, so warmup can map the file into memory and
+ * stream the keys straight into batches for KVStore::getMulti.
+ *
+ * File layout (all integers are stored in network byte order):
+ *
+ *     Header:  magic (8 bytes) | index offset (8)
+ *     Section: for each vBucket; [key length (2) | key]... in key order
+ *     Index:   number of sections (4) | crc32 of the entries (4) |
+ *              for each section:
+ *                  vbid (2) | reserved (2) | crc32 of the section (4) |
+ *                  offset (8) | length (8) | number of keys (8)
+ *
+ * The index offset in the header is only filled in once everything else is
+ * written, so the reader rejects a file which was never completed.
+ */
+
+#include "storeddockey.h"
+
+#include <memcached/dockey.h>
+#include <memcached/vbucket.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cb {
+namespace io {
+class MemoryMappedFile;
+}
+} // namespace cb
+
+class SortedAccessLog {
+public:
+    /// The magic bytes at the start of the file
+    static const char Magic[8];
+
+    /**
+     * @return true if the given file starts with the magic of the sorted
+     *         access log (false if it doesn't, or it couldn't be read)
+     */
+    static bool isSortedAccessLog(const std::string& path);
+
+protected:
+    struct IndexEntry {
+        Vbid vbid;
+        uint32_t crc = 0;
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        uint64_t keys = 0;
+    };
+
+    static constexpr size_t HeaderSize = sizeof(Magic) + sizeof(uint64_t);
+    static constexpr size_t IndexHeaderSize = 2 * sizeof(uint32_t);
+    static constexpr size_t IndexEntrySize = 32;
+};
+
+/**
+ * Writes a sorted access log.
+ *
+ * The sections for the different vBuckets are independent of each other, so
+ * they may be built and added concurrently by multiple threads (only the
+ * write of the sorted section to the file is serialised).
+ */
+class SortedAccessLogWriter : public SortedAccessLog {
+public:
+    /**
+     * Create (or truncate) the file at the given path
+     *
+     * @throws std::system_error if the file can't be created
+     */
+    explicit SortedAccessLogWriter(std::string path);
+
+    ~SortedAccessLogWriter();
+
+    SortedAccessLogWriter(const SortedAccessLogWriter&) = delete;
+    SortedAccessLogWriter& operator=(const SortedAccessLogWriter&) = delete;
+
+    /**
+     * Sort the keys into on-disk order (removing any duplicates) and append
+     * them as the section for the given vBucket.
+     *
+     * @throws std::logic_error if the vBucket was already added, or the log
+     *         is committed
+     * @throws std::system_error if the write fails
+     */
+    void addVBucket(Vbid vbid, std::vector<StoredDocKey> keys);
+
+    /**
+     * Write the index and complete the header. No more vBuckets may be
+     * added.
+     *
+     * @throws std::system_error if the write fails
+     */
+    void commit();
+
+    /// @return the number of keys added to the log so far
+    size_t getNumKeys() const;
+
+    const std::string& getPath() const {
+        return path;
+    }
+
+private:
+    void write(const void* data, size_t size);
+
+    const std::string path;
+    FILE* file = nullptr;
+
+    mutable std::mutex mutex;
+    std::vector<IndexEntry> index;
+    uint64_t offset = 0;
+    size_t numKeys = 0;
+    bool committed = false;
+};
+
+/**
+ * Reads a sorted access log by mapping it into memory. The file is expected
+ * to be read sequentially, one vBucket section at a time.
+ */
+class SortedAccessLogReader : public SortedAccessLog {
+public:
+    /**
+     * A stream of the keys of a single vBucket, in the order they are stored
+     * on disk. The keys reference the memory map, so the stream must not be
+     * used after the reader is destroyed.
+     */
+    class KeyStream {
+    public:
+        bool done() const {
+            return pos == end;
+        }
+
+        /**
+         * @return the next key in the stream
+         * @throws std::runtime_error if the section is truncated
+         */
+        DocKey next();
+
+        /// @return the number of keys in the section
+        size_t size() const {
+            return keys;
+        }
+
+    private:
+        friend class SortedAccessLogReader;
+
+        KeyStream(const uint8_t* begin, const uint8_t* end, size_t keys)
+            : pos(begin), end(end), keys(keys) {
+        }
+
+        const uint8_t* pos;
+        const uint8_t* end;
+        size_t keys;
+    };
+
+    /**
+     * Map the file at the given path into memory and read the index.
+     *
+     * @throws std::runtime_error if the file isn't a complete sorted access
+     *         log, or std::system_error if it can't be mapped
+     */
+    explicit SortedAccessLogReader(const std::string& path);
+
+    ~SortedAccessLogReader();
+
+    /// @return the total number of keys in the log
+    size_t getNumKeys() const;
+
+    /**
+     * Get the keys logged for the given vBucket (an empty stream if there
+     * are none).
+     *
+     * @throws std::runtime_error if the checksum of the section is wrong
+     */
+    KeyStream getKeys(Vbid vbid) const;
+
+private:
+    std::unique_ptr<cb::io::MemoryMappedFile> map;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::vector<IndexEntry> index;
+};
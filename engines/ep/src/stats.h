@@ -293,6 +293,10 @@ public:
     //! Number of pending vbucket compaction requests
     Counter pendingCompactions;
 
+    //! Bytes of the items held by the DCP item caches of the vbuckets (the
+    //! items themselves are already part of the memory overhead)
+    Counter dcpItemCacheSize;
+
     //! Number of times background fetches occurred.
     Counter bg_fetched;
     //! Number of times meta background fetches occurred.
@@ -51,6 +51,7 @@ TASK(AccessScanner, AUXIO_TASK_IDX, 3)
 TASK(AccessScannerVisitor, AUXIO_TASK_IDX, 3)
 TASK(ActiveStreamCheckpointProcessorTask, AUXIO_TASK_IDX, 5)
 TASK(BackfillManagerTask, AUXIO_TASK_IDX, 8)
+TASK(BackfillRangePrefetchTask, AUXIO_TASK_IDX, 8)
 
 
 // Read/Write IO tasks
@@ -63,6 +64,7 @@ TASK(StatSnap, WRITER_TASK_IDX, 9)
 TASK(PendingOpsNotification, NONIO_TASK_IDX, 0)
 TASK(RespondAmbiguousNotification, NONIO_TASK_IDX, 0)
 TASK(NotifyHighPriorityReqTask, NONIO_TASK_IDX, 0)
+TASK(FlushBatchPrefetchTask, NONIO_TASK_IDX, 0)
 TASK(ItemPager, NONIO_TASK_IDX, 1)
 TASK(ExpiredItemPager, NONIO_TASK_IDX, 1)
 TASK(ItemPagerVisitor, NONIO_TASK_IDX, 1)
@@ -78,6 +80,7 @@ TASK(VBucketMemoryDeletionTask, NONIO_TASK_IDX, 6)
 TASK(StatCheckpointTask, NONIO_TASK_IDX, 7)
 TASK(DefragmenterTask, NONIO_TASK_IDX, 7)
 TASK(ItemCompressorTask, NONIO_TASK_IDX, 7)
+TASK(DcpZstdDictionaryTrainerTask, NONIO_TASK_IDX, 7)
 TASK(EphTombstoneHTCleaner, NONIO_TASK_IDX, 7)
 TASK(EphTombstoneStaleItemDeleter, NONIO_TASK_IDX, 7)
 TASK(ItemFreqDecayerTask, NONIO_TASK_IDX, 7)
@@ -24,6 +24,7 @@
 #include "collections/collection_persisted_stats.h"
 #include "conflict_resolution.h"
 #include "dcp/dcpconnmap.h"
+#include "dcp/item_cache.h"
 #include "durability/active_durability_monitor.h"
 #include "durability/passive_durability_monitor.h"
 #include "ep_engine.h"
@@ -179,7 +180,11 @@ VBucket::VBucket(Vbid i,
                  bool mightContainXattrs,
                  const nlohmann::json& replTopology,
                  uint64_t maxVisibleSeqno)
-    : ht(st, std::move(valFact), config.getHtSize(), config.getHtLocks()),
+    : ht(st,
+         std::move(valFact),
+         config.getHtSize(),
+         config.getHtLocks(),
+         parseHashTableIndexMode(config.getHtIndexMode())),
       checkpointManager(std::make_unique<CheckpointManager>(st,
                                                             i,
                                                             chkConfig,
@@ -228,7 +233,9 @@ VBucket::VBucket(Vbid i,
       syncWriteCompleteCb(syncWriteCb),
       seqnoAckCb(seqnoAckCb),
       manifest(std::move(manifest)),
-      mayContainXattrs(mightContainXattrs) {
+      mayContainXattrs(mightContainXattrs),
+      dcpItemCache(std::make_shared<DcpItemCache>(
+              st, config.getDcpItemCacheSize())) {
     if (config.getConflictResolutionType().compare("lww") == 0) {
         conflictResolver.reset(new LastWriteWinsResolution());
     } else {
@@ -1222,6 +1229,27 @@ size_t VBucket::getNumOfKeysInFilter() {
     }
 }
 
+std::string VBucket::serialiseFilter() {
+    LockHolder lh(bfMutex);
+    if (bFilter && bFilter->getStatus() == BFILTER_ENABLED) {
+        return bFilter->serialise();
+    }
+    return {};
+}
+
+bool VBucket::restoreFilter(cb::const_char_buffer data) {
+    auto filter = BloomFilter::deserialise(data, BFILTER_ENABLED);
+    if (!filter) {
+        return false;
+    }
+    LockHolder lh(bfMutex);
+    if (tempFilter) {
+        return false;
+    }
+    bFilter = std::move(filter);
+    return true;
+}
+
 VBNotifyCtx VBucket::queueItem(queued_item& item, const VBQueueItemCtx& ctx) {
     // Ensure that durable writes are queued with the same seqno-order in both
     // Backfill/CheckpointManager Queues and DurabilityMonitor. Note that
@@ -3095,6 +3123,15 @@ void VBucket::_addStats(VBucketStatsDetailLevel detail,
                 checkpointManager->getMaxVisibleSeqno(),
                 add_stat,
                 c);
+        addStat("dcp_item_cache_hits", dcpItemCache->getHits(), add_stat, c);
+        addStat("dcp_item_cache_misses",
+                dcpItemCache->getMisses(),
+                add_stat,
+                c);
+        addStat("dcp_item_cache_bytes",
+                dcpItemCache->getBytes(),
+                add_stat,
+                c);
 
         hlc.addStats(statPrefix, add_stat, c);
     }
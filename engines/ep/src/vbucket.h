@@ -42,6 +42,7 @@ class CheckpointConfig;
 class ConflictResolution;
 class Configuration;
 class DCPBackfill;
+class DcpItemCache;
 class DiskDocKey;
 class DurabilityMonitor;
 class EPStats;
@@ -650,6 +651,20 @@ public:
     size_t getFilterSize();
     size_t getNumOfKeysInFilter();
 
+    /**
+     * @return the main bloom filter serialised (see BloomFilter::serialise),
+     *         or an empty string if it doesn't exist or isn't enabled
+     */
+    std::string serialiseFilter();
+
+    /**
+     * Replace the main bloom filter with one serialised by serialiseFilter(),
+     * unless a compaction is building a new one.
+     *
+     * @return true if the filter was restored
+     */
+    bool restoreFilter(cb::const_char_buffer data);
+
     uint64_t nextHLCCas() {
         return hlc.nextHLC();
     }
@@ -854,6 +869,14 @@ public:
     /// Manager of this vBucket's checkpoints. unique_ptr for pimpl.
     std::unique_ptr<CheckpointManager> checkpointManager;
 
+    /**
+     * Cache of the items transformed for the DCP streams of this vBucket,
+     * shared by all of them. shared_ptr as a stream may outlive the vBucket.
+     */
+    std::shared_ptr<DcpItemCache> getDcpItemCache() const {
+        return dcpItemCache;
+    }
+
     /**
      * Searches for a 'valid' StoredValue in the VBucket.
      *
@@ -2489,6 +2512,8 @@ private:
      */
     std::atomic<bool> mayContainXattrs;
 
+    std::shared_ptr<DcpItemCache> dcpItemCache;
+
     // Durable writes are enqueued also into the DurabilityMonitor.
     // The seqno-order of items tracked by the DM must be the same as in the
     // Backfill/CheckpointManager Queues (seqno is strictly monotonic).
@@ -2522,6 +2547,8 @@ private:
  */
 class LockedVBucketPtr {
 public:
+    LockedVBucketPtr() = default;
+
     LockedVBucketPtr(VBucketPtr vb, std::unique_lock<std::mutex>&& lock)
         : vb(std::move(vb)), lock(std::move(lock)) {
     }
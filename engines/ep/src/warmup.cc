@@ -30,6 +30,7 @@
 #include "failover-table.h"
 #include "item.h"
 #include "mutation_log.h"
+#include "sorted_access_log.h"
 #include "statwriter.h"
 #include "vb_visitors.h"
 #include "vbucket_bgfetch_item.h"
@@ -40,10 +41,12 @@
 #include <platform/timeutils.h>
 #include <utilities/logtags.h>
 
+#include <algorithm>
 #include <array>
 #include <limits>
 #include <memory>
 #include <random>
+#include <set>
 #include <string>
 #include <utility>
 
@@ -127,6 +130,16 @@ private:
 
 // Warmup Tasks ///////////////////////////////////////////////////////////////
 
+/// @return the description of a task warming up a subset of a shard's
+///         vBuckets, e.g. "Warmup - key dump: shard 0 (128 vBuckets)"
+static std::string getTaskDescription(const char* phase,
+                                      uint16_t shardId,
+                                      const std::vector<Vbid>& vbuckets) {
+    return std::string("Warmup - ") + phase + ": shard " +
+           std::to_string(shardId) + " (" + std::to_string(vbuckets.size()) +
+           " vBuckets)";
+}
+
 class WarmupInitialize : public GlobalTask {
 public:
     WarmupInitialize(EPBucket& st, Warmup* w)
@@ -225,15 +238,19 @@ private:
 
 class WarmupEstimateDatabaseItemCount : public GlobalTask {
 public:
-    WarmupEstimateDatabaseItemCount(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupEstimateDatabaseItemCount(EPBucket& st,
+                                    uint16_t sh,
+                                    std::vector<Vbid> vbs,
+                                    Warmup* w)
         : GlobalTask(&st.getEPEngine(),
                      TaskId::WarmupEstimateDatabaseItemCount,
                      0,
                      false),
           _shardId(sh),
+          _vbuckets(std::move(vbs)),
           _warmup(w),
-          _description("Warmup - estimate item count: shard " +
-                       std::to_string(_shardId)) {
+          _description(getTaskDescription(
+                  "estimate item count", _shardId, _vbuckets)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -249,13 +266,14 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarpupEstimateDatabaseItemCount");
-        _warmup->estimateDatabaseItemCount(_shardId);
+        _warmup->estimateDatabaseItemCount(_shardId, _vbuckets);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    const std::vector<Vbid> _vbuckets;
     Warmup* _warmup;
     const std::string _description;
 };
@@ -268,12 +286,14 @@ class WarmupLoadPreparedSyncWrites : public GlobalTask {
 public:
     WarmupLoadPreparedSyncWrites(EventuallyPersistentEngine* engine,
                                  uint16_t shard,
+                                 std::vector<Vbid> vbs,
                                  Warmup& warmup)
         : GlobalTask(engine, TaskId::WarmupLoadPreparedSyncWrites, 0, false),
           shardId(shard),
+          vbuckets(std::move(vbs)),
           warmup(warmup),
-          description("Warmup - loading prepared SyncWrites: shard " +
-                      std::to_string(shardId)){};
+          description(getTaskDescription(
+                  "loading prepared SyncWrites", shardId, vbuckets)){};
 
     std::string getDescription() override {
         return description;
@@ -292,13 +312,14 @@ public:
                      "WarmupLoadPreparedSyncWrites",
                      "shard",
                      shardId);
-        warmup.loadPreparedSyncWrites(shardId);
+        warmup.loadPreparedSyncWrites(shardId, vbuckets);
         warmup.removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t shardId;
+    const std::vector<Vbid> vbuckets;
     Warmup& warmup;
     const std::string description;
 };
@@ -344,11 +365,13 @@ private:
 
 class WarmupKeyDump : public GlobalTask {
 public:
-    WarmupKeyDump(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupKeyDump(EPBucket& st, uint16_t sh, std::vector<Vbid> vbs, Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupKeyDump, 0, false),
           _shardId(sh),
+          _vbuckets(std::move(vbs)),
           _warmup(w),
-          _description("Warmup - key dump: shard " + std::to_string(_shardId)) {
+          _description(getTaskDescription(
+                  "key dump", _shardId, _vbuckets)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -366,13 +389,14 @@ public:
 
     bool run() override {
         TRACE_EVENT1("ep-engine/task", "WarmupKeyDump", "shard", _shardId);
-        _warmup->keyDumpforShard(_shardId);
+        _warmup->keyDumpforShard(_shardId, _vbuckets);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    const std::vector<Vbid> _vbuckets;
     Warmup* _warmup;
     const std::string _description;
 };
@@ -408,14 +432,41 @@ private:
     Warmup* _warmup;
 };
 
+/**
+ * The access log of a shard, opened once by the shard's first
+ * WarmupLoadAccessLog task and shared with the tasks which then apply the
+ * keys of their own vBuckets.
+ */
+struct WarmupAccessLog {
+    /// The log, if it's in the sorted format (the keys of each vBucket are
+    /// streamed straight from the mapped file)
+    std::unique_ptr<SortedAccessLogReader> sorted;
+
+    /// The file of the log, if it's in the MutationLog format. Each task
+    /// harvests the keys of its own vBuckets from it a batch at a time.
+    std::string path;
+};
+
 class WarmupLoadAccessLog : public GlobalTask {
 public:
-    WarmupLoadAccessLog(EPBucket& st, uint16_t sh, Warmup* w)
+    /**
+     * @param log The access log of the shard, or nullptr to read it (and
+     *            split the shard's vBuckets between tasks applying it)
+     */
+    WarmupLoadAccessLog(EPBucket& st,
+                        uint16_t sh,
+                        std::vector<Vbid> vbs,
+                        std::shared_ptr<WarmupAccessLog> log,
+                        Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadAccessLog, 0, false),
           _shardId(sh),
+          _vbuckets(std::move(vbs)),
+          _log(std::move(log)),
           _warmup(w),
-          _description("Warmup - loading access log: shard " +
-                       std::to_string(_shardId)) {
+          _description(getTaskDescription(
+                  _log ? "loading access log" : "opening access log",
+                  _shardId,
+                  _vbuckets)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -433,25 +484,31 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadAccessLog");
-        _warmup->loadingAccessLog(_shardId);
+        _warmup->loadingAccessLog(_shardId, _vbuckets, _log);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    const std::vector<Vbid> _vbuckets;
+    const std::shared_ptr<WarmupAccessLog> _log;
     Warmup* _warmup;
     const std::string _description;
 };
 
 class WarmupLoadingKVPairs : public GlobalTask {
 public:
-    WarmupLoadingKVPairs(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupLoadingKVPairs(EPBucket& st,
+                         uint16_t sh,
+                         std::vector<Vbid> vbs,
+                         Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadingKVPairs, 0, false),
           _shardId(sh),
+          _vbuckets(std::move(vbs)),
           _warmup(w),
-          _description("Warmup - loading KV Pairs: shard " +
-                       std::to_string(_shardId)) {
+          _description(getTaskDescription(
+                  "loading KV Pairs", _shardId, _vbuckets)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -470,25 +527,30 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadingKVPairs");
-        _warmup->loadKVPairsforShard(_shardId);
+        _warmup->loadKVPairsforShard(_shardId, _vbuckets);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    const std::vector<Vbid> _vbuckets;
     Warmup* _warmup;
     const std::string _description;
 };
 
 class WarmupLoadingData : public GlobalTask {
 public:
-    WarmupLoadingData(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupLoadingData(EPBucket& st,
+                      uint16_t sh,
+                      std::vector<Vbid> vbs,
+                      Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadingData, 0, false),
           _shardId(sh),
+          _vbuckets(std::move(vbs)),
           _warmup(w),
-          _description("Warmup - loading data: shard " +
-                       std::to_string(_shardId)) {
+          _description(getTaskDescription(
+                  "loading data", _shardId, _vbuckets)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -507,13 +569,14 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadingData");
-        _warmup->loadDataforShard(_shardId);
+        _warmup->loadDataforShard(_shardId, _vbuckets);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    const std::vector<Vbid> _vbuckets;
     Warmup* _warmup;
     const std::string _description;
 };
@@ -546,6 +609,68 @@ private:
     Warmup* _warmup;
 };
 
+/**
+ * Add a fetch of the given key (from the access log) to the queue of items
+ * to fetch from disk.
+ */
+static void addWarmupBGFetch(vb_bgfetch_queue_t& items2fetch,
+                             const DocKey& key) {
+    // Access log only records Committed keys, therefore construct
+    // DiskDocKey with pending == false.
+    DiskDocKey diskKey{key, /*prepared*/ false};
+    // Deleted via a unique_ptr in fetchWarmupBatch()
+    vb_bgfetch_item_ctx_t& bg_itm_ctx = items2fetch[diskKey];
+    bg_itm_ctx.isMetaOnly = GetMetaOnly::No;
+    bg_itm_ctx.bgfetched_list.emplace_back(
+            std::make_unique<VBucketBGFetchItem>(nullptr, false));
+    bg_itm_ctx.bgfetched_list.back()->value = &bg_itm_ctx.value;
+}
+
+/**
+ * Fetch the queued items from disk and insert them into the HashTable
+ */
+static void fetchWarmupBatch(WarmupCookie& c,
+                             Vbid vbId,
+                             vb_bgfetch_queue_t& items2fetch) {
+    c.epstore->getROUnderlying(vbId)->getMulti(vbId, items2fetch);
+
+    // applyItem controls the  mode this loop operates in.
+    // true we will attempt the callback (attempt a HashTable insert)
+    // false we don't attempt the callback
+    // in both cases the loop must delete the VBucketBGFetchItem we
+    // allocated in addWarmupBGFetch().
+    bool applyItem = true;
+    for (auto& items : items2fetch) {
+        vb_bgfetch_item_ctx_t& bg_itm_ctx = items.second;
+        std::unique_ptr<VBucketBGFetchItem> fetchedItem(
+                std::move(bg_itm_ctx.bgfetched_list.back()));
+        if (applyItem) {
+            GetValue& val = *fetchedItem->value;
+            if (val.getStatus() == ENGINE_SUCCESS) {
+                // NB: callback will delete the GetValue's Item
+                c.cb.callback(val);
+            } else {
+                EP_LOG_WARN(
+                        "Warmup failed to load data for {}"
+                        " key{{{}}} error = {}",
+                        vbId,
+                        cb::UserData{items.first.to_string()},
+                        val.getStatus());
+                c.error++;
+            }
+
+            if (c.cb.getStatus() == ENGINE_SUCCESS) {
+                c.loaded++;
+            } else {
+                // Failed to apply an Item, so fail the rest
+                applyItem = false;
+            }
+        } else {
+            c.skipped++;
+        }
+    }
+}
+
 static bool batchWarmupCallback(Vbid vbId,
                                 const std::set<StoredDocKey>& fetches,
                                 void* arg) {
@@ -554,55 +679,9 @@ static bool batchWarmupCallback(Vbid vbId,
     if (!c->epstore->maybeEnableTraffic()) {
         vb_bgfetch_queue_t items2fetch;
         for (auto& key : fetches) {
-            // Access log only records Committed keys, therefore construct
-            // DiskDocKey with pending == false.
-            DiskDocKey diskKey{key, /*prepared*/ false};
-            // Deleted below via a unique_ptr in the next loop
-            vb_bgfetch_item_ctx_t& bg_itm_ctx = items2fetch[diskKey];
-            bg_itm_ctx.isMetaOnly = GetMetaOnly::No;
-            bg_itm_ctx.bgfetched_list.emplace_back(
-                    std::make_unique<VBucketBGFetchItem>(nullptr, false));
-            bg_itm_ctx.bgfetched_list.back()->value = &bg_itm_ctx.value;
-        }
-
-        c->epstore->getROUnderlying(vbId)->getMulti(vbId, items2fetch);
-
-        // applyItem controls the  mode this loop operates in.
-        // true we will attempt the callback (attempt a HashTable insert)
-        // false we don't attempt the callback
-        // in both cases the loop must delete the VBucketBGFetchItem we
-        // allocated above.
-        bool applyItem = true;
-        for (auto& items : items2fetch) {
-            vb_bgfetch_item_ctx_t& bg_itm_ctx = items.second;
-            std::unique_ptr<VBucketBGFetchItem> fetchedItem(
-                    std::move(bg_itm_ctx.bgfetched_list.back()));
-            if (applyItem) {
-                GetValue& val = *fetchedItem->value;
-                if (val.getStatus() == ENGINE_SUCCESS) {
-                    // NB: callback will delete the GetValue's Item
-                    c->cb.callback(val);
-                } else {
-                    EP_LOG_WARN(
-                            "Warmup failed to load data for {}"
-                            " key{{{}}} error = {}",
-                            vbId,
-                            cb::UserData{items.first.to_string()},
-                            val.getStatus());
-                    c->error++;
-                }
-
-                if (c->cb.getStatus() == ENGINE_SUCCESS) {
-                    c->loaded++;
-                } else {
-                    // Failed to apply an Item, so fail the rest
-                    applyItem = false;
-                }
-            } else {
-                c->skipped++;
-            }
+            addWarmupBGFetch(items2fetch, key);
         }
-
+        fetchWarmupBatch(*c, vbId, items2fetch);
         return true;
     } else {
         c->skipped++;
@@ -920,6 +999,7 @@ Warmup::Warmup(EPBucket& st, Configuration& config_)
       config(config_),
       shardVbStates(store.vbMap.getNumShards()),
       shardVbIds(store.vbMap.getNumShards()),
+      shardTasksRemaining(store.vbMap.getNumShards()),
       warmedUpVbuckets(config.getMaxVbuckets()) {
 }
 
@@ -940,6 +1020,36 @@ void Warmup::setEstimatedWarmupCount(size_t to)
     estimatedWarmupCount.store(to);
 }
 
+void Warmup::addEstimatedWarmupCount(size_t num) {
+    estimatedWarmupCount.fetch_add(num);
+}
+
+std::vector<std::vector<Vbid>> Warmup::splitShardVbIds(uint16_t shardId) {
+    const auto& vbuckets = shardVbIds[shardId];
+    size_t numTasks = config.getWarmupTasksPerShard();
+    if (numTasks == 0) {
+        // Enough tasks to give every reader thread a share of the shards
+        const auto numShards = store.vbMap.getNumShards();
+        numTasks = (ExecutorPool::get()->getNumReaders() + numShards - 1) /
+                   numShards;
+    }
+    numTasks = std::max(size_t(1), std::min(numTasks, vbuckets.size()));
+
+    std::vector<std::vector<Vbid>> ret(numTasks);
+    for (size_t ii = 0; ii < vbuckets.size(); ++ii) {
+        ret[ii % numTasks].push_back(vbuckets[ii]);
+    }
+    shardTasksRemaining[shardId] = numTasks;
+    return ret;
+}
+
+bool Warmup::completeShardTask(uint16_t shardId) {
+    if (--shardTasksRemaining[shardId] != 0) {
+        return false;
+    }
+    return ++threadtask_count == store.vbMap.getNumShards();
+}
+
 size_t Warmup::getEstimatedItemCount() const {
     return estimatedItemCount.load();
 }
@@ -1071,6 +1181,19 @@ void Warmup::createVBuckets(uint16_t shardId) {
                         entry.vb_uuid,
                         entry.by_seqno);
             }
+            // A bloom filter saved at a clean shutdown avoids waiting for the
+            // next compaction to rebuild it (one left by an unclean shutdown
+            // is just removed)
+            if (config.isBfilterEnabled() &&
+                store.getItemEvictionPolicy() == EvictionPolicy::Full &&
+                store.loadBloomFilter(*vb, vbs.highSeqno, cleanShutdown)) {
+                EP_LOG_INFO(
+                        "Warmup::createVBuckets: {} restored bloom filter "
+                        "with {} keys",
+                        vbid,
+                        vb->getNumOfKeysInFilter());
+            }
+
             EPBucket* bucket = &this->store;
             vb->setFreqSaturatedCallback(
                     [bucket]() { bucket->wakeItemFreqDecayerTask(); });
@@ -1172,18 +1295,20 @@ void Warmup::scheduleEstimateDatabaseItemCount()
     estimateTime.store(std::chrono::steady_clock::duration::zero());
     estimatedItemCount = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupEstimateDatabaseItemCount>(
-                store, i, this);
-        ExecutorPool::get()->schedule(task);
+        for (auto& vbuckets : splitShardVbIds(i)) {
+            ExTask task = std::make_shared<WarmupEstimateDatabaseItemCount>(
+                    store, i, std::move(vbuckets), this);
+            ExecutorPool::get()->schedule(task);
+        }
     }
 }
 
-void Warmup::estimateDatabaseItemCount(uint16_t shardId)
-{
+void Warmup::estimateDatabaseItemCount(uint16_t shardId,
+                                       const std::vector<Vbid>& vbuckets) {
     auto st = std::chrono::steady_clock::now();
     size_t item_count = 0;
 
-    for (const auto vbid : shardVbIds[shardId]) {
+    for (const auto vbid : vbuckets) {
         size_t vbItemCount = store.getROUnderlyingByShard(shardId)->
                                                         getItemCount(vbid);
         const auto* vbState =
@@ -1205,7 +1330,7 @@ void Warmup::estimateDatabaseItemCount(uint16_t shardId)
     estimatedItemCount.fetch_add(item_count);
     estimateTime.fetch_add(std::chrono::steady_clock::now() - st);
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (completeShardTask(shardId)) {
         transition(WarmupState::State::LoadPreparedSyncWrites);
     }
 }
@@ -1213,14 +1338,17 @@ void Warmup::estimateDatabaseItemCount(uint16_t shardId)
 void Warmup::scheduleLoadPreparedSyncWrites() {
     threadtask_count = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupLoadPreparedSyncWrites>(
-                &store.getEPEngine(), i, *this);
-        ExecutorPool::get()->schedule(task);
+        for (auto& vbuckets : splitShardVbIds(i)) {
+            ExTask task = std::make_shared<WarmupLoadPreparedSyncWrites>(
+                    &store.getEPEngine(), i, std::move(vbuckets), *this);
+            ExecutorPool::get()->schedule(task);
+        }
     }
 }
 
-void Warmup::loadPreparedSyncWrites(uint16_t shardId) {
-    for (const auto vbid : shardVbIds[shardId]) {
+void Warmup::loadPreparedSyncWrites(uint16_t shardId,
+                                    const std::vector<Vbid>& vbuckets) {
+    for (const auto vbid : vbuckets) {
         auto itr = warmedUpVbuckets.find(vbid.get());
         if (itr == warmedUpVbuckets.end()) {
             continue;
@@ -1239,7 +1367,7 @@ void Warmup::loadPreparedSyncWrites(uint16_t shardId) {
                 result.preparesLoaded;
     }
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (completeShardTask(shardId)) {
         transition(WarmupState::State::PopulateVBucketMap);
     }
 }
@@ -1277,20 +1405,23 @@ void Warmup::scheduleKeyDump()
 {
     threadtask_count = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupKeyDump>(store, i, this);
-        ExecutorPool::get()->schedule(task);
+        for (auto& vbuckets : splitShardVbIds(i)) {
+            ExTask task = std::make_shared<WarmupKeyDump>(
+                    store, i, std::move(vbuckets), this);
+            ExecutorPool::get()->schedule(task);
+        }
     }
 
 }
 
-void Warmup::keyDumpforShard(uint16_t shardId)
-{
+void Warmup::keyDumpforShard(uint16_t shardId,
+                             const std::vector<Vbid>& vbuckets) {
     KVStore* kvstore = store.getROUnderlyingByShard(shardId);
     auto cb = std::make_shared<LoadStorageKVPairCallback>(
             store, false, state.getState());
     auto cl = std::make_shared<NoLookupCallback>();
 
-    for (const auto vbid : shardVbIds[shardId]) {
+    for (const auto vbid : vbuckets) {
         ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
                                                     DocumentFilter::NO_DELETES,
                                                     ValueFilter::KEYS_ONLY);
@@ -1304,7 +1435,7 @@ void Warmup::keyDumpforShard(uint16_t shardId)
         }
     }
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (completeShardTask(shardId)) {
         transition(WarmupState::State::CheckForAccessLog);
     }
 }
@@ -1351,51 +1482,62 @@ void Warmup::checkForAccessLog()
 
 void Warmup::scheduleLoadingAccessLog()
 {
+    // Every task adds the number of keys in its vBuckets
+    setEstimatedWarmupCount(0);
+
+    // Each shard's log is read by a single task first, which then hands
+    // out the vBuckets to the tasks applying it (see loadingAccessLog)
     threadtask_count = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupLoadAccessLog>(store, i, this);
+        shardTasksRemaining[i] = 1;
+        ExTask task = std::make_shared<WarmupLoadAccessLog>(
+                store, i, shardVbIds[i], nullptr, this);
         ExecutorPool::get()->schedule(task);
     }
 }
 
-void Warmup::loadingAccessLog(uint16_t shardId)
-{
-    LoadStorageKVPairCallback load_cb(store, true, state.getState());
-    bool success = false;
+void Warmup::loadingAccessLog(uint16_t shardId,
+                              const std::vector<Vbid>& vbuckets,
+                              std::shared_ptr<WarmupAccessLog> log) {
     auto stTime = std::chrono::steady_clock::now();
-    if (store.accessLog[shardId].exists()) {
-        try {
-            store.accessLog[shardId].open();
-            if (doWarmup(store.accessLog[shardId],
-                         shardVbStates[shardId],
-                         load_cb) != (size_t)-1) {
-                success = true;
-            }
-        } catch (MutationLog::ReadException &e) {
-            corruptAccessLog = true;
-            EP_LOG_WARN("Error reading warmup access log:  {}", e.what());
+    bool success = true;
+    if (!log) {
+        log = std::make_shared<WarmupAccessLog>();
+        std::string nm = store.accessLog[shardId].getLogFile();
+        success = openAccessLogFile(nm, *log);
+        if (!success) {
+            // Do we have the previous file?
+            nm.append(".old");
+            success = openAccessLogFile(nm, *log);
         }
-    }
 
-    if (!success) {
-        // Do we have the previous file?
-        std::string nm = store.accessLog[shardId].getLogFile();
-        nm.append(".old");
-        MutationLog old(nm);
-        if (old.exists()) {
-            try {
-                old.open();
-                if (doWarmup(old, shardVbStates[shardId], load_cb) !=
-                    (size_t)-1) {
-                    success = true;
+        if (success) {
+            auto sets = splitShardVbIds(shardId);
+            if (sets.size() > 1) {
+                for (auto& set : sets) {
+                    ExTask task = std::make_shared<WarmupLoadAccessLog>(
+                            store, shardId, std::move(set), log, this);
+                    ExecutorPool::get()->schedule(task);
                 }
-            } catch (MutationLog::ReadException &e) {
-                corruptAccessLog = true;
-                EP_LOG_WARN("Error reading old access log:  {}", e.what());
+                return;
             }
         }
     }
 
+    if (success) {
+        LoadStorageKVPairCallback load_cb(store, true, state.getState());
+        try {
+            success = doWarmup(*log, vbuckets, load_cb) != (size_t)-1;
+        } catch (const std::runtime_error& e) {
+            // A section of a sorted log failed its checksum
+            corruptAccessLog = true;
+            success = false;
+            EP_LOG_WARN("Error loading access log for shard {}: {}",
+                        shardId,
+                        e.what());
+        }
+    }
+
     size_t numItems = store.getEPEngine().getEpStats().warmedUpValues;
     if (success && numItems) {
         EP_LOG_INFO("{} items loaded from access log, completed in {}",
@@ -1406,7 +1548,7 @@ void Warmup::loadingAccessLog(uint16_t shardId)
         setEstimatedWarmupCount(estimatedCount);
     }
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (completeShardTask(shardId)) {
         if (!store.maybeEnableTraffic()) {
             transition(WarmupState::State::LoadingData);
         } else {
@@ -1416,13 +1558,45 @@ void Warmup::loadingAccessLog(uint16_t shardId)
     }
 }
 
-size_t Warmup::doWarmup(MutationLog& lf,
-                        const std::map<Vbid, vbucket_state>& vbmap,
+bool Warmup::openAccessLogFile(const std::string& path,
+                               WarmupAccessLog& log) {
+    if (!cb::io::isFile(path)) {
+        return false;
+    }
+
+    try {
+        // The AccessScanner writes the sorted format, but the log may have
+        // been written by an earlier version
+        if (SortedAccessLog::isSortedAccessLog(path)) {
+            log.sorted = std::make_unique<SortedAccessLogReader>(path);
+            return true;
+        }
+
+        // Check the header; the entries are read by the tasks applying the
+        // log (see doWarmup)
+        MutationLog mlog(path, config.getAlogBlockSize());
+        mlog.open();
+        log.path = path;
+        return true;
+    } catch (const std::runtime_error& e) {
+        corruptAccessLog = true;
+        EP_LOG_WARN("Error reading access log '{}': {}", path, e.what());
+    }
+    return false;
+}
+
+size_t Warmup::doWarmup(WarmupAccessLog& log,
+                        const std::vector<Vbid>& vbuckets,
                         StatusCallback<GetValue>& cb) {
-    MutationLogHarvester harvester(lf, &store.getEPEngine());
-    std::map<Vbid, vbucket_state>::const_iterator it;
-    for (it = vbmap.begin(); it != vbmap.end(); ++it) {
-        harvester.setVBucket(it->first);
+    if (log.sorted) {
+        return doWarmup(*log.sorted, vbuckets, cb);
+    }
+
+    MutationLog mlog(log.path, config.getAlogBlockSize());
+    mlog.open();
+    MutationLogHarvester harvester(mlog, &store.getEPEngine());
+    for (const auto vbid : vbuckets) {
+        harvester.setVBucket(vbid);
     }
 
     // To constrain the number of elements from the access log we have to keep
@@ -1432,7 +1606,7 @@ size_t Warmup::doWarmup(MutationLog& lf,
     std::chrono::nanoseconds log_apply_duration{};
     WarmupCookie cookie(&store, cb);
 
-    auto alog_iter = lf.begin();
+    auto alog_iter = mlog.begin();
     do {
         // Load a chunk of the access log file
         auto start = std::chrono::steady_clock::now();
@@ -1443,10 +1617,10 @@ size_t Warmup::doWarmup(MutationLog& lf,
         auto apply_start = std::chrono::steady_clock::now();
         harvester.apply(&cookie, &batchWarmupCallback);
         log_apply_duration += (std::chrono::steady_clock::now() - apply_start);
-    } while (alog_iter != lf.end());
+    } while (alog_iter != mlog.end());
 
     size_t total = harvester.total();
-    setEstimatedWarmupCount(total);
+    addEstimatedWarmupCount(total);
     EP_LOG_DEBUG("Completed log read in {} with {} entries",
                  cb::time2text(log_load_duration),
                  total);
@@ -1460,6 +1634,68 @@ size_t Warmup::doWarmup(MutationLog& lf,
     return cookie.loaded;
 }
 
+size_t Warmup::doWarmup(const SortedAccessLogReader& log,
+                        const std::vector<Vbid>& vbuckets,
+                        StatusCallback<GetValue>& cb) {
+    // The keys of each vBucket are already sorted into on-disk order, so they
+    // are streamed straight from the mapped file into batches for getMulti
+    // (instead of being collected by a MutationLogHarvester first).
+    const size_t batchSize = config.getWarmupBatchSize();
+    WarmupCookie cookie(&store, cb);
+    vb_bgfetch_queue_t items2fetch;
+    size_t total = 0;
+
+    // @return false if traffic was enabled (and loading should stop)
+    auto fetchBatch = [this, &cookie, &items2fetch](Vbid vbid) {
+        const bool enabled = store.maybeEnableTraffic();
+        if (enabled) {
+            cookie.skipped++;
+        } else {
+            fetchWarmupBatch(cookie, vbid, items2fetch);
+        }
+        items2fetch.clear();
+        return !enabled;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    bool loading = true;
+    for (auto it = vbuckets.begin(); loading && it != vbuckets.end(); ++it) {
+        auto vb = store.getVBucket(*it);
+        if (!vb) {
+            continue;
+        }
+
+        auto keys = log.getKeys(*it);
+        total += keys.size();
+        while (loading && !keys.done()) {
+            const auto key = keys.next();
+            // Skip any items which are no longer valid in the VBucket
+            if (vb->ht.findForRead(key, TrackReference::No, WantsDeleted::No)
+                        .storedValue == nullptr) {
+                continue;
+            }
+            addWarmupBGFetch(items2fetch, key);
+            if (items2fetch.size() == batchSize) {
+                loading = fetchBatch(*it);
+            }
+        }
+        if (loading && !items2fetch.empty()) {
+            loading = fetchBatch(*it);
+        }
+    }
+
+    addEstimatedWarmupCount(total);
+    EP_LOG_DEBUG("Populated sorted log in {} with {} entries (l: {}, s: {}, "
+                 "e: {})",
+                 cb::time2text(std::chrono::steady_clock::now() - start),
+                 total,
+                 cookie.loaded,
+                 cookie.skipped,
+                 cookie.error);
+
+    return cookie.loaded;
+}
+
 void Warmup::scheduleLoadingKVPairs()
 {
     // We reach here only if keyDump didn't return SUCCESS or if
@@ -1470,14 +1706,17 @@ void Warmup::scheduleLoadingKVPairs()
 
     threadtask_count = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupLoadingKVPairs>(store, i, this);
-        ExecutorPool::get()->schedule(task);
+        for (auto& vbuckets : splitShardVbIds(i)) {
+            ExTask task = std::make_shared<WarmupLoadingKVPairs>(
+                    store, i, std::move(vbuckets), this);
+            ExecutorPool::get()->schedule(task);
+        }
     }
 
 }
 
-void Warmup::loadKVPairsforShard(uint16_t shardId)
-{
+void Warmup::loadKVPairsforShard(uint16_t shardId,
+                                 const std::vector<Vbid>& vbuckets) {
     bool maybe_enable_traffic = false;
     scan_error_t errorCode = scan_success;
 
@@ -1493,7 +1732,7 @@ void Warmup::loadKVPairsforShard(uint16_t shardId)
 
     ValueFilter valFilter = store.getValueFilterForCompressionMode();
 
-    for (const auto vbid : shardVbIds[shardId]) {
+    for (const auto vbid : vbuckets) {
         ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
                                                     DocumentFilter::NO_DELETES,
                                                     valFilter);
@@ -1506,7 +1745,7 @@ void Warmup::loadKVPairsforShard(uint16_t shardId)
             }
         }
     }
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (completeShardTask(shardId)) {
         transition(WarmupState::State::Done);
     }
 }
@@ -1518,13 +1757,16 @@ void Warmup::scheduleLoadingData()
 
     threadtask_count = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupLoadingData>(store, i, this);
-        ExecutorPool::get()->schedule(task);
+        for (auto& vbuckets : splitShardVbIds(i)) {
+            ExTask task = std::make_shared<WarmupLoadingData>(
+                    store, i, std::move(vbuckets), this);
+            ExecutorPool::get()->schedule(task);
+        }
     }
 }
 
-void Warmup::loadDataforShard(uint16_t shardId)
-{
+void Warmup::loadDataforShard(uint16_t shardId,
+                              const std::vector<Vbid>& vbuckets) {
     scan_error_t errorCode = scan_success;
 
     KVStore* kvstore = store.getROUnderlyingByShard(shardId);
@@ -1535,7 +1777,7 @@ void Warmup::loadDataforShard(uint16_t shardId)
 
     ValueFilter valFilter = store.getValueFilterForCompressionMode();
 
-    for (const auto vbid : shardVbIds[shardId]) {
+    for (const auto vbid : vbuckets) {
         ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
                                                     DocumentFilter::NO_DELETES,
                                                     valFilter);
@@ -1549,7 +1791,7 @@ void Warmup::loadDataforShard(uint16_t shardId)
         }
     }
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (completeShardTask(shardId)) {
         transition(WarmupState::State::Done);
     }
 }
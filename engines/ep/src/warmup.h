@@ -29,6 +29,7 @@
 #include <deque>
 #include <iosfwd>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_set>
@@ -38,9 +39,10 @@ class Configuration;
 class EPStats;
 class EPBucket;
 class GetValue;
-class MutationLog;
+class SortedAccessLogReader;
 class VBucketMap;
 class Vbid;
+struct WarmupAccessLog;
 
 struct vbucket_state;
 
@@ -168,6 +170,15 @@ private:
  *                           V
  *                        [Done]
  *
+ * Most of the stages run one task per shard. The stages which do the bulk of
+ * the disk reads (EstimateDatabaseItemCount, LoadPreparedSyncWrites, KeyDump,
+ * LoadingAccessLog, LoadingKVPairs and LoadingData) instead run
+ * warmup_tasks_per_shard tasks per shard, each for a subset of the shard's
+ * vBuckets, so that all reader threads can be kept busy even when there are
+ * fewer shards than readers. A stage completes once all tasks of all shards
+ * have completed. (For LoadingAccessLog a single task first reads each
+ * shard's access log, and then hands it to the tasks for the shard.)
+ *
  * KV-engine has the following behaviour as warmup runs.
  *
  * Whilst the following phases are incomplete:
@@ -240,8 +251,12 @@ public:
                      std::chrono::steady_clock::duration(1));
     }
 
-    size_t doWarmup(MutationLog& lf,
-                    const std::map<Vbid, vbucket_state>& vbmap,
+    size_t doWarmup(WarmupAccessLog& log,
+                    const std::vector<Vbid>& vbuckets,
+                    StatusCallback<GetValue>& cb);
+
+    size_t doWarmup(const SortedAccessLogReader& log,
+                    const std::vector<Vbid>& vbuckets,
                     StatusCallback<GetValue>& cb);
 
     bool isComplete() const {
@@ -289,6 +304,30 @@ private:
 
     void setEstimatedWarmupCount(size_t num);
 
+    /// Add to the estimated warmup count (for phases split between tasks)
+    void addEstimatedWarmupCount(size_t num);
+
+    /**
+     * Splits the vBuckets of the given shard into the sets which are warmed
+     * up by separate tasks in the next phase (so that a shard with many
+     * vBuckets may use more than one reader thread), and resets the number
+     * of outstanding tasks for the shard accordingly.
+     *
+     * The vBuckets are dealt out in turn, so each set keeps the priority
+     * order from Warmup::shardVbIds. There is always at least one set (which
+     * may be empty) so every shard reports completion of the phase.
+     */
+    std::vector<std::vector<Vbid>> splitShardVbIds(uint16_t shardId);
+
+    /**
+     * Called by each of the tasks created from splitShardVbIds() when it is
+     * done with its set of vBuckets.
+     *
+     * @return true if this was the last outstanding task of the last shard,
+     *         i.e. the phase is complete.
+     */
+    bool completeShardTask(uint16_t shardId);
+
     /*
      * Methods called by the different tasks to perform the given warmup stage.
      *
@@ -318,19 +357,21 @@ private:
     void loadCollectionStatsForShard(uint16_t shardId);
 
     /**
-     * Loads the item count of each vBucket from disk for the given shardId:
+     * Loads the item count of the given vBuckets (of shardId) from disk:
      * - Reads the item count from disk and sets VBucket::numTotalItems
      * - Updates Warmup::estimatedItemCount with the estimated total items
      *   needed for warmup.
      */
-    void estimateDatabaseItemCount(uint16_t shardId);
+    void estimateDatabaseItemCount(uint16_t shardId,
+                                   const std::vector<Vbid>& vbuckets);
 
     /**
-     * Loads all prepared SyncWrites for each vBucket in the given shard
+     * Loads all prepared SyncWrites for the given vBuckets (of shardId)
      * - Performs a KVStore scan against the DurabilityPrepare namespace,
      *   loading all found documents into memory.
      */
-    void loadPreparedSyncWrites(uint16_t shardId);
+    void loadPreparedSyncWrites(uint16_t shardId,
+                                const std::vector<Vbid>& vbuckets);
 
     /**
      * Adds all warmed up vbuckets (for the shard) to the bucket's VBMap, once
@@ -343,9 +384,9 @@ private:
 
     /**
      * [Value-eviction only]
-     * Loads all keys into memory for each vBucket in the given shard.
+     * Loads all keys into memory for the given vBuckets (of shardId).
      */
-    void keyDumpforShard(uint16_t shardId);
+    void keyDumpforShard(uint16_t shardId, const std::vector<Vbid>& vbuckets);
 
     /**
      * Checks for the existance of an access log file for each shard:
@@ -357,25 +398,39 @@ private:
 
     /**
      * Loads the access log for the given shardId:
-     * - Reads a batch of keys from the access log
-     * - For each key read, attempt to fetch key+value from the underlying
-     *   KVStore.
+     * - If log is nullptr, opens the shard's access log, and splits the
+     *   vBuckets between tasks applying the log (see splitShardVbIds()),
+     *   unless there is only the one. Each task reads the keys of its own
+     *   vBuckets a batch at a time.
+     * - For each key logged for one of the given vBuckets, attempt to
+     *   fetch key+value from the underlying KVStore.
      * - If key exists (wasn't subsequently deleted), insert into the
      *   HashTable.
      */
-    void loadingAccessLog(uint16_t shardId);
+    void loadingAccessLog(uint16_t shardId,
+                          const std::vector<Vbid>& vbuckets,
+                          std::shared_ptr<WarmupAccessLog> log);
+
+    /**
+     * Opens the access log file at path, which may be either a sorted
+     * access log or a MutationLog.
+     *
+     * @return true if the log was opened successfully
+     */
+    bool openAccessLogFile(const std::string& path, WarmupAccessLog& log);
 
     /**
      * [Full-eviction only]
-     * Loads both keys and values into memory for each vBucket in the given
-     * shard.
+     * Loads both keys and values into memory for the given vBuckets (of
+     * shardId).
      */
-    void loadKVPairsforShard(uint16_t shardId);
+    void loadKVPairsforShard(uint16_t shardId,
+                             const std::vector<Vbid>& vbuckets);
 
     /**
-     * Loads values into memory for each vBucket in the given shard.
+     * Loads values into memory for the given vBuckets (of shardId).
      */
-    void loadDataforShard(uint16_t shardId);
+    void loadDataforShard(uint16_t shardId, const std::vector<Vbid>& vbuckets);
 
     /* Terminal state of warmup. Updates statistics and marks warmup as
      * completed
@@ -430,6 +485,10 @@ private:
     /// contains all vBucket IDs which are present for the given shard.
     std::vector<std::vector<Vbid>> shardVbIds;
 
+    /// The number of tasks (one per set from splitShardVbIds()) which are
+    /// yet to complete the current phase for each shard.
+    std::vector<std::atomic<size_t>> shardTasksRemaining;
+
     cb::AtomicDuration<> estimateTime;
     std::atomic<size_t> estimatedItemCount{std::numeric_limits<size_t>::max()};
     bool cleanShutdown{true};
@@ -6768,6 +6768,9 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "vb_0:bloom_filter",
               "vb_0:bloom_filter_key_count",
               "vb_0:bloom_filter_size",
+              "vb_0:dcp_item_cache_bytes",
+              "vb_0:dcp_item_cache_hits",
+              "vb_0:dcp_item_cache_misses",
               "vb_0:drift_ahead_threshold",
               "vb_0:drift_ahead_threshold_exceeded",
               "vb_0:drift_behind_threshold",
@@ -6903,23 +6906,38 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_data_traffic_enabled",
               "ep_dbname",
               "ep_dcp_backfill_byte_limit",
+              "ep_dcp_backfill_from_memory_max_items",
+              "ep_dcp_backfill_parallel_scan_min_items",
+              "ep_dcp_backfill_scan_parallelism",
               "ep_dcp_conn_buffer_size",
               "ep_dcp_conn_buffer_size_aggr_mem_threshold",
               "ep_dcp_conn_buffer_size_aggressive_perc",
               "ep_dcp_conn_buffer_size_max",
               "ep_dcp_conn_buffer_size_perc",
               "ep_dcp_enable_noop",
+              "ep_dcp_flow_control_idle_time",
               "ep_dcp_flow_control_policy",
               "ep_dcp_min_compression_ratio",
+              "ep_dcp_item_cache_size",
               "ep_dcp_idle_timeout",
               "ep_dcp_noop_mandatory_for_v5_features",
               "ep_dcp_noop_tx_interval",
+              "ep_dcp_producer_backfill_weight",
+              "ep_dcp_producer_bulk_weight",
+              "ep_dcp_producer_replication_weight",
               "ep_dcp_producer_snapshot_marker_yield_limit",
+              "ep_dcp_producer_step_batch_bytes",
+              "ep_dcp_producer_step_batch_size",
+              "ep_dcp_producer_takeover_weight",
               "ep_dcp_consumer_process_buffered_messages_yield_limit",
               "ep_dcp_consumer_process_buffered_messages_batch_size",
+              "ep_dcp_consumer_process_buffered_messages_parallelism",
               "ep_dcp_scan_byte_limit",
               "ep_dcp_scan_item_limit",
               "ep_dcp_takeover_max_time",
+              "ep_dcp_zstd_compression_level",
+              "ep_dcp_zstd_dictionary_samples",
+              "ep_dcp_zstd_dictionary_size",
               "ep_defragmenter_age_threshold",
               "ep_defragmenter_chunk_duration",
               "ep_defragmenter_enabled",
@@ -6931,7 +6949,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_exp_pager_stime",
               "ep_failpartialwarmup",
               "ep_flusher_batch_split_trigger",
+              "ep_flusher_group_commit_max_vbuckets",
+              "ep_flusher_pipelined",
               "ep_fsync_after_every_n_bytes_written",
+              "ep_couchstore_async_read_queue_depth",
+              "ep_couchstore_readahead_max",
               "ep_couchstore_tracing",
               "ep_couchstore_write_validation",
               "ep_couchstore_mprotect",
@@ -6939,6 +6961,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_getl_max_timeout",
               "ep_hlc_drift_ahead_threshold_us",
               "ep_hlc_drift_behind_threshold_us",
+              "ep_ht_index_mode",
               "ep_ht_locks",
               "ep_ht_resize_interval",
               "ep_ht_size",
@@ -7013,6 +7036,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_warmup_batch_size",
               "ep_warmup_min_items_threshold",
               "ep_warmup_min_memory_threshold",
+              "ep_warmup_tasks_per_shard",
               "ep_xattr_enabled"}},
             {"workload",
              {"ep_workload:num_readers",
@@ -7108,23 +7132,38 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_data_traffic_enabled",
               "ep_dbname",
               "ep_dcp_backfill_byte_limit",
+              "ep_dcp_backfill_from_memory_max_items",
+              "ep_dcp_backfill_parallel_scan_min_items",
+              "ep_dcp_backfill_scan_parallelism",
               "ep_dcp_conn_buffer_size",
               "ep_dcp_conn_buffer_size_aggr_mem_threshold",
               "ep_dcp_conn_buffer_size_aggressive_perc",
               "ep_dcp_conn_buffer_size_max",
               "ep_dcp_conn_buffer_size_perc",
               "ep_dcp_consumer_process_buffered_messages_batch_size",
+              "ep_dcp_consumer_process_buffered_messages_parallelism",
               "ep_dcp_consumer_process_buffered_messages_yield_limit",
               "ep_dcp_enable_noop",
+              "ep_dcp_flow_control_idle_time",
               "ep_dcp_flow_control_policy",
+              "ep_dcp_item_cache_size",
               "ep_dcp_idle_timeout",
               "ep_dcp_min_compression_ratio",
               "ep_dcp_noop_mandatory_for_v5_features",
               "ep_dcp_noop_tx_interval",
+              "ep_dcp_producer_backfill_weight",
+              "ep_dcp_producer_bulk_weight",
+              "ep_dcp_producer_replication_weight",
               "ep_dcp_producer_snapshot_marker_yield_limit",
+              "ep_dcp_producer_step_batch_bytes",
+              "ep_dcp_producer_step_batch_size",
+              "ep_dcp_producer_takeover_weight",
               "ep_dcp_scan_byte_limit",
               "ep_dcp_scan_item_limit",
               "ep_dcp_takeover_max_time",
+              "ep_dcp_zstd_compression_level",
+              "ep_dcp_zstd_dictionary_samples",
+              "ep_dcp_zstd_dictionary_size",
               "ep_defragmenter_age_threshold",
               "ep_defragmenter_chunk_duration",
               "ep_defragmenter_enabled",
@@ -7150,7 +7189,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_failpartialwarmup",
               "ep_flush_duration_total",
               "ep_flusher_batch_split_trigger",
+              "ep_flusher_group_commit_max_vbuckets",
+              "ep_flusher_pipelined",
               "ep_fsync_after_every_n_bytes_written",
+              "ep_couchstore_async_read_queue_depth",
+              "ep_couchstore_readahead_max",
               "ep_couchstore_tracing",
               "ep_couchstore_write_validation",
               "ep_couchstore_mprotect",
@@ -7158,6 +7201,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_getl_max_timeout",
               "ep_hlc_drift_ahead_threshold_us",
               "ep_hlc_drift_behind_threshold_us",
+              "ep_ht_index_mode",
               "ep_ht_locks",
               "ep_ht_resize_interval",
               "ep_ht_size",
@@ -7310,6 +7354,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_warmup_batch_size",
               "ep_warmup_min_items_threshold",
               "ep_warmup_min_memory_threshold",
+              "ep_warmup_tasks_per_shard",
               "ep_workload_pattern",
               "ep_xattr_enabled",
               "mem_used",
@@ -7657,6 +7702,7 @@ static enum test_result test_mb19687_variable(EngineIface* h) {
                      "bytes",
                      "ep_blob_num",
                      "ep_blob_overhead",
+                     "ep_dcp_item_cache_mem_used",
                      "ep_item_num",
                      "ep_kv_size",
                      "ep_max_size",
@@ -73,7 +73,7 @@ std::shared_ptr<MockActiveStream> MockDcpProducer::mockActiveStreamRequest(
                 "MockDcpProducer::mockActiveStreamRequest "
                 "failed to insert requested stream");
     }
-    notifyStreamReady(vb.getId());
+    notifyStreamReady(vb.getId(), stream->getStreamClass());
     return stream;
 }
 
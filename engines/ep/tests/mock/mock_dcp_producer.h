@@ -146,7 +146,7 @@ public:
         return log.acknowledge(bytes);
     }
 
-    VBReadyQueue& getReadyQueue() {
+    WeightedReadyQueue& getReadyQueue() {
         return ready;
     }
 
@@ -103,6 +103,10 @@ public:
         return backfillItems.memory + backfillItems.disk;
     }
 
+    int getNumBackfillItemsFromDisk() const {
+        return backfillItems.disk;
+    }
+
     int getLastReadSeqno() const {
         return lastReadSeqno;
     }
@@ -21,6 +21,7 @@
 #include "checkpoint_remover.h"
 #include "dcp/dcpconnmap.h"
 #include "dcp/flow-control-manager.h"
+#include "dcp/zstd_compression.h"
 #include "mock_dcp_conn_map.h"
 #include "mock_ep_bucket.h"
 #include "mock_ephemeral_bucket.h"
@@ -56,6 +57,10 @@ SynchronousEPEngine::SynchronousEPEngine(std::string extra_config)
     checkpointConfig = new CheckpointConfig(*this);
 
     dcpFlowControlManager_ = std::make_unique<DcpFlowControlManager>(*this);
+    dcpZstdCompression_ = std::make_unique<DcpZstdCompression>(
+            *this,
+            configuration.getDcpZstdDictionarySamples(),
+            configuration.getDcpZstdDictionarySize());
 
     enableTraffic(true);
 
@@ -80,6 +80,26 @@ TEST_P(BloomFilterDocKeyTest, check_maybeKeyExist) {
     }
 }
 
+TEST_P(BloomFilterDocKeyTest, check_serialise) {
+    auto key1 = StoredDocKey("key", std::get<0>(GetParam()));
+    auto key2 = StoredDocKey("key", std::get<1>(GetParam()));
+    addKey(key1);
+
+    const auto data = serialise();
+    auto restored = BloomFilter::deserialise({data.data(), data.size()},
+                                             BFILTER_ENABLED);
+    ASSERT_TRUE(restored);
+    EXPECT_EQ(BFILTER_ENABLED, restored->getStatus());
+    EXPECT_EQ(getFilterSize(), restored->getFilterSize());
+    EXPECT_EQ(getNumOfKeysInFilter(), restored->getNumOfKeysInFilter());
+    EXPECT_TRUE(restored->maybeKeyExists(key1));
+    EXPECT_EQ(maybeKeyExists(key2), restored->maybeKeyExists(key2));
+
+    // Truncated data is rejected
+    EXPECT_FALSE(BloomFilter::deserialise({data.data(), data.size() - 1},
+                                          BFILTER_ENABLED));
+}
+
 // Test params includes our labelled collections that have 'special meaning' and
 // one normal collection ID (100)
 static std::vector<CollectionID> allDocNamespaces = {
@@ -109,10 +109,18 @@ TEST_F(CheckpointRemoverEPTest, CheckpointManagerMemoryUsage) {
     // We should have one checkpoint which is for the state change
     ASSERT_EQ(1, checkpointManager->getNumCheckpoints());
 
-    // The queue (toWrite) is implemented as std:list, therefore
-    // when we add an item it results in the creation of 3 pointers -
-    // forward ptr, backward ptr and ptr to object.
-    const size_t perElementOverhead = 3 * sizeof(uintptr_t);
+    // The queue (toWrite) allocates memory in chunks holding multiple
+    // items, so the overhead of adding an item to the queue is whatever
+    // (if anything) the queue had to allocate.
+    const auto getQueueAllocatorBytes = [checkpointManager]() {
+        size_t bytes = 0;
+        for (auto& checkpoint :
+             CheckpointManagerTestIntrospector::public_getCheckpointList(
+                     *checkpointManager)) {
+            bytes += checkpoint->getWriteQueueAllocatorBytes();
+        }
+        return bytes;
+    };
 
     // Allocator used for tracking memory used by the CheckpointQueue
     checkpoint_index::allocator_type memoryTrackingAllocator;
@@ -136,17 +144,12 @@ TEST_F(CheckpointRemoverEPTest, CheckpointManagerMemoryUsage) {
                  *checkpointManager)) {
         // Add the overhead of the Checkpoint object
         expected_size += sizeof(Checkpoint);
-#ifdef WIN32
-        // On windows for an empty list we still allocate space for
-        // containing one element.
-        expected_size += perElementOverhead;
-#endif
+        // Add the memory allocated by the queue
+        expected_size += checkpoint->getWriteQueueAllocatorBytes();
 
         for (auto itr = checkpoint->begin(); itr != checkpoint->end(); ++itr) {
             // Add the size of the item
             expected_size += (*itr)->size();
-            // Add the size of adding to the queue
-            expected_size += perElementOverhead;
             // Add to the emulated metaKeyIndex
             metaKeyIndex.emplace((*itr)->getKey(), entry);
         }
@@ -159,12 +162,13 @@ TEST_F(CheckpointRemoverEPTest, CheckpointManagerMemoryUsage) {
 
     // Check that the new checkpoint memory usage is equal to the previous
     // amount plus the addition of the new item.
+    const auto queueBytes = getQueueAllocatorBytes();
     Item item = store_item(vbid, makeStoredDocKey("key0"), "value");
     size_t new_expected_size = expected_size;
     // Add the size of the item
     new_expected_size += item.size();
     // Add the size of adding to the queue
-    new_expected_size += perElementOverhead;
+    new_expected_size += getQueueAllocatorBytes() - queueBytes;
     // Add to the keyIndex
     keyIndex.emplace(
             CheckpointIndexKey(item.getKey(),
@@ -254,10 +258,15 @@ TEST_F(CheckpointRemoverEPTest, CursorDropMemoryFreed) {
 
     createDcpStream(*producer);
 
-    // The queue (toWrite) is implemented as std:list, therefore
-    // when we add an item it results in the creation of 3 pointers -
-    // forward ptr, backward ptr and ptr to object.
-    const size_t perElementOverhead = 3 * sizeof(uintptr_t);
+    // The queue (toWrite) allocates memory in chunks holding multiple
+    // items, so rather than accounting for each item we'll add the growth
+    // of the queue once we're done adding items.
+    auto& firstCheckpoint =
+            *CheckpointManagerTestIntrospector::public_getCheckpointList(
+                     *checkpointManager)
+                     .front();
+    const auto initialQueueBytes =
+            firstCheckpoint.getWriteQueueAllocatorBytes();
 
     // Allocator used for tracking memory used by the CheckpointQueue
     checkpoint_index::allocator_type memoryTrackingAllocator;
@@ -286,8 +295,6 @@ TEST_F(CheckpointRemoverEPTest, CursorDropMemoryFreed) {
         std::string doc_key = "key_" + std::to_string(i);
         Item item = store_item(vbid, makeStoredDocKey(doc_key), "value");
         expectedFreedMemoryFromItems += item.size();
-        // Add the size of adding to the queue
-        expectedFreedMemoryFromItems += perElementOverhead;
         // Add to the emulated keyIndex
         keyIndex.emplace(
                 CheckpointIndexKey(
@@ -326,8 +333,9 @@ TEST_F(CheckpointRemoverEPTest, CursorDropMemoryFreed) {
 
     // Add the size of the checkpoint end
     expectedFreedMemoryFromItems += chkptEnd->size();
-    // Add the size of adding to the queue
-    expectedFreedMemoryFromItems += perElementOverhead;
+    // Add the growth of the queue
+    expectedFreedMemoryFromItems +=
+            firstCheckpoint.getWriteQueueAllocatorBytes() - initialQueueBytes;
     // Add to the emulated keyIndex
     keyIndex.emplace(
             CheckpointIndexKey(chkptEnd->getKey(),
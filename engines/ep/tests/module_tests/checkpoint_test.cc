@@ -1597,6 +1597,15 @@ TEST_P(CheckpointTest, checkpointMemoryTest) {
     // Get the intial size of the checkpoint.
     auto initialSize = this->manager->getMemoryUsage();
 
+    // The queue (toWrite) allocates memory in chunks holding multiple
+    // items, so the overhead of adding an item to the queue is whatever
+    // (if anything) the queue had to allocate.
+    const auto& checkpoint =
+            *CheckpointManagerTestIntrospector::public_getCheckpointList(
+                     *(this->manager))
+                     .front();
+    const auto initialQueueSize = checkpoint.getWriteQueueAllocatorBytes();
+
     // Allocator used for tracking memory used by the CheckpointQueue
     checkpoint_index::allocator_type memoryTrackingAllocator;
     // Emulate the Checkpoint keyIndex so we can determine the number
@@ -1632,18 +1641,13 @@ TEST_P(CheckpointTest, checkpointMemoryTest) {
                               GenerateCas::Yes,
                               /*preLinkDocCtx*/ nullptr);
 
-    // The queue (toWrite) is implemented as std:list, therefore
-    // when we add an item it results in the creation of 3 pointers -
-    // forward ptr, backward ptr and ptr to object.
-    const size_t perElementOverhead = 3 * sizeof(uintptr_t);
-
     // Check that checkpoint size is the initial size plus the addition of
     // qiSmall.
     auto expectedSize = initialSize;
     // Add the size of the item
     expectedSize += qiSmall->size();
     // Add the size of adding to the queue
-    expectedSize += perElementOverhead;
+    expectedSize += checkpoint.getWriteQueueAllocatorBytes() - initialQueueSize;
     // Add to the emulated keyIndex
     keyIndex.emplace(
             CheckpointIndexKey(qiSmall->getKey(),
@@ -1682,7 +1686,7 @@ TEST_P(CheckpointTest, checkpointMemoryTest) {
     // Add the size of the item
     expectedSize += qiBig->size();
     // Add the size of adding to the queue
-    expectedSize += perElementOverhead;
+    expectedSize += checkpoint.getWriteQueueAllocatorBytes() - initialQueueSize;
     // Add to the keyIndex
     keyIndex.emplace(
             CheckpointIndexKey(qiBig->getKey(),
@@ -1731,6 +1735,11 @@ TEST_P(CheckpointTest, checkpointMemoryTest) {
 TEST_P(CheckpointTest, checkpointTrackingMemoryOverheadTest) {
     // Get the intial size of the checkpoint overhead.
     const auto initialOverhead = this->manager->getMemoryOverhead();
+    const auto& checkpoint =
+            *CheckpointManagerTestIntrospector::public_getCheckpointList(
+                     *(this->manager))
+                     .front();
+    const auto initialQueueSize = checkpoint.getWriteQueueAllocatorBytes();
 
     // Allocator used for tracking memory used by the CheckpointQueue
     checkpoint_index::allocator_type memoryTrackingAllocator;
@@ -1770,8 +1779,10 @@ TEST_P(CheckpointTest, checkpointTrackingMemoryOverheadTest) {
 
     // Re-measure the checkpoint overhead
     const auto updatedOverhead = this->manager->getMemoryOverhead();
-    // Three pointers - forward, backward and pointer to item
-    const auto perElementListOverhead = sizeof(uintptr_t) * 3;
+    // The queue allocates memory in chunks holding multiple items, so
+    // the overhead is whatever (if anything) the queue had to allocate
+    const auto queueOverhead =
+            checkpoint.getWriteQueueAllocatorBytes() - initialQueueSize;
     // Add entry into keyIndex
     keyIndex.emplace(
             CheckpointIndexKey(qiSmall->getKey(),
@@ -1781,7 +1792,7 @@ TEST_P(CheckpointTest, checkpointTrackingMemoryOverheadTest) {
             entry);
 
     const auto keyIndexSize = *(keyIndex.get_allocator().getBytesAllocated());
-    EXPECT_EQ(perElementListOverhead + (keyIndexSize - initialKeyIndexSize),
+    EXPECT_EQ(queueOverhead + (keyIndexSize - initialKeyIndexSize),
               updatedOverhead - initialOverhead);
 
     bool isLastMutationItem;
@@ -1886,6 +1897,46 @@ TEST_P(CheckpointTest, expelCheckpointItemsTest) {
     EXPECT_FALSE(regResult.tryBackfill);
 }
 
+// Test that registering a cursor in the middle of a large checkpoint (which
+// uses the checkpoint's seqno index) positions it correctly, including when
+// an indexed item has been de-duplicated.
+TEST_P(CheckpointTest, registerCursorBySeqnoLargeCheckpoint) {
+    const int itemCount{200};
+
+    for (auto ii = 0; ii < itemCount; ++ii) {
+        EXPECT_TRUE(this->queueNewItem("key" + std::to_string(ii)));
+    }
+    // De-duplicate key63 (seqno 1064), the first item in the index
+    EXPECT_FALSE(this->queueNewItem("key63"));
+
+    ASSERT_EQ(1, this->manager->getNumCheckpoints());
+    ASSERT_EQ(1000 + itemCount + 1, this->manager->getHighSeqno());
+
+    const std::vector<std::pair<uint64_t, uint64_t>> expected{
+            // start seqno, seqno of the next item
+            {1100, 1101},
+            {1128, 1129},
+            {1129, 1130},
+            {1063, 1065},
+            {1064, 1065},
+            {1001, 1002},
+            {1201, 1202}};
+    for (const auto& test : expected) {
+        const std::string name =
+                DCP_CURSOR_PREFIX + std::to_string(test.first);
+        auto regResult = this->manager->registerCursorBySeqno(name, test.first);
+        EXPECT_EQ(test.second, regResult.seqno);
+        EXPECT_FALSE(regResult.tryBackfill);
+
+        if (test.second <= this->manager->getHighSeqno()) {
+            bool isLastMutationItem;
+            auto item = this->manager->nextItem(regResult.cursor.lock().get(),
+                                                isLastMutationItem);
+            EXPECT_EQ(test.second, item->getBySeqno());
+        }
+    }
+}
+
 // Test that we correctly handle duplicates, where the initial version of the
 // document has been expelled.
 TEST_P(CheckpointTest, expelCheckpointItemsWithDuplicateTest) {
@@ -2177,6 +2228,11 @@ TEST_P(CheckpointTest, expelCheckpointItemsMemoryRecoveredTest) {
     // Get the memory usage before expelling
     const auto checkpointMemoryUsageBeforeExpel =
             this->manager->getMemoryUsage();
+    const auto& checkpoint =
+            *CheckpointManagerTestIntrospector::public_getCheckpointList(
+                     *(this->manager))
+                     .front();
+    const auto queueSizeBeforeExpel = checkpoint.getWriteQueueAllocatorBytes();
 
     CheckpointManager::ExpelResult expelResult =
             this->manager->expelUnreferencedCheckpointItems();
@@ -2197,20 +2253,11 @@ TEST_P(CheckpointTest, expelCheckpointItemsMemoryRecoveredTest) {
     // Get the memory usage after expelling
     auto checkpointMemoryUsageAfterExpel = this->manager->getMemoryUsage();
 
-    size_t extra = 0;
-    // A list is comprised of 3 pointers (forward, backwards and
-    // pointer to the element).
-    const size_t perElementOverhead = extra + (3 * sizeof(uintptr_t));
-#if WIN32
-    // On windows for an empty list we still allocate space for
-    // containing one element.
-    extra = perElementOverhead;
-#endif
-
     const size_t reductionInCheckpointMemoryUsage =
             checkpointMemoryUsageBeforeExpel - checkpointMemoryUsageAfterExpel;
+    // The queue only releases the chunks which no longer hold any items
     const size_t checkpointListSaving =
-            (perElementOverhead * expelResult.expelCount);
+            queueSizeBeforeExpel - checkpoint.getWriteQueueAllocatorBytes();
     const auto& checkpointStartItem =
             this->manager->public_createCheckpointItem(
                     0, Vbid(0), queue_op::checkpoint_start);
@@ -2220,8 +2267,7 @@ TEST_P(CheckpointTest, expelCheckpointItemsMemoryRecoveredTest) {
             checkpointListSaving + queuedItemSaving;
 
     EXPECT_EQ(3, expelResult.expelCount);
-    EXPECT_EQ(expectedMemoryRecovered,
-              expelResult.estimateOfFreeMemory - extra);
+    EXPECT_EQ(expectedMemoryRecovered, expelResult.estimateOfFreeMemory);
     EXPECT_EQ(expectedMemoryRecovered, reductionInCheckpointMemoryUsage);
     EXPECT_EQ(3, this->global_stats.itemsExpelledFromCheckpoints);
 }
@@ -0,0 +1,176 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "checkpoint_iterator.h"
+#include "chunked_queue.h"
+
+#include <folly/portability/GTest.h>
+#include <utilities/memory_tracking_allocator.h>
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+/*
+ * Unit tests for the ChunkedQueue
+ */
+
+using TestItem = std::shared_ptr<int>;
+using Queue = ChunkedQueue<TestItem, MemoryTrackingAllocator<TestItem>>;
+using QueueIterator = CheckpointIterator<Queue>;
+
+class ChunkedQueueTest : public ::testing::Test {
+protected:
+    /// Populate the queue with the values [0, n) and record an iterator
+    /// to each of them
+    void populate(int n) {
+        for (int ii = 0; ii < n; ++ii) {
+            queue.push_back(std::make_shared<int>(ii));
+            positions.push_back(std::prev(queue.end()));
+        }
+    }
+
+    /// @return the values visited by a CheckpointIterator (which skips
+    ///         the erased elements)
+    std::vector<int> values() {
+        std::vector<int> ret;
+        for (QueueIterator it(queue, QueueIterator::Position::begin);
+             it != QueueIterator(queue, QueueIterator::Position::end);
+             ++it) {
+            ret.push_back(**it);
+        }
+        return ret;
+    }
+
+    MemoryTrackingAllocator<TestItem> allocator;
+    Queue queue{allocator};
+    std::vector<Queue::iterator> positions;
+};
+
+TEST_F(ChunkedQueueTest, Empty) {
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(0, queue.size());
+    EXPECT_EQ(queue.begin(), queue.end());
+    EXPECT_EQ(0, *allocator.getBytesAllocated());
+
+    // Incrementing end wraps around to begin (which is end)
+    auto end = queue.end();
+    ++end;
+    EXPECT_EQ(queue.end(), end);
+}
+
+// Appending to the queue shouldn't invalidate any iterators (including end)
+TEST_F(ChunkedQueueTest, IteratorsStableOverPushBack) {
+    const auto end = queue.end();
+    populate(1000);
+    EXPECT_EQ(end, queue.end());
+    EXPECT_EQ(1000, queue.size());
+    for (int ii = 0; ii < 1000; ++ii) {
+        EXPECT_EQ(ii, **positions[ii]);
+    }
+
+    // And we should be able to walk backwards from the end
+    auto it = queue.end();
+    for (int ii = 999; ii >= 0; --ii) {
+        --it;
+        EXPECT_EQ(ii, **it);
+    }
+    EXPECT_EQ(queue.begin(), it);
+}
+
+// The queue should use far less memory than a list
+TEST_F(ChunkedQueueTest, MemoryOverhead) {
+    populate(10000);
+    EXPECT_LT(*allocator.getBytesAllocated(),
+              10000 * (sizeof(TestItem) + 2 * sizeof(void*)));
+    queue.clear();
+    EXPECT_EQ(0, *allocator.getBytesAllocated());
+}
+
+TEST_F(ChunkedQueueTest, EraseLeavesHole) {
+    populate(3);
+    queue.erase(positions[1]);
+    EXPECT_EQ(2, queue.size());
+    EXPECT_EQ(std::vector<int>({0, 2}), values());
+    // The other iterators are still valid
+    EXPECT_EQ(0, **positions[0]);
+    EXPECT_EQ(2, **positions[2]);
+
+    // Erasing it twice isn't allowed
+    EXPECT_THROW(queue.erase(positions[1]), std::logic_error);
+}
+
+// Erasing all of the elements in a chunk should release it
+TEST_F(ChunkedQueueTest, EraseReleasesChunk) {
+    populate(1000);
+    const size_t allocated = *allocator.getBytesAllocated();
+    for (int ii = 1; ii < 999; ++ii) {
+        queue.erase(positions[ii]);
+    }
+    EXPECT_EQ(2, queue.size());
+    EXPECT_LT(*allocator.getBytesAllocated(), allocated);
+    EXPECT_EQ(std::vector<int>({0, 999}), values());
+}
+
+TEST_F(ChunkedQueueTest, SpliceFront) {
+    populate(1000);
+    queue.erase(positions[10]);
+
+    Queue expelled;
+    queue.splice_front(expelled, positions[500]);
+
+    // The hole isn't moved
+    EXPECT_EQ(499, expelled.size());
+    EXPECT_EQ(500, queue.size());
+    EXPECT_EQ(500, **queue.begin());
+    EXPECT_EQ(999, **std::prev(queue.end()));
+    for (int ii = 500; ii < 1000; ++ii) {
+        EXPECT_EQ(ii, **positions[ii]);
+    }
+
+    int expected = 0;
+    for (const auto& item : expelled) {
+        if (expected == 10) {
+            ++expected;
+        }
+        EXPECT_EQ(expected, *item);
+        ++expected;
+    }
+
+    // Splicing to the end moves everything
+    queue.splice_front(expelled, queue.end());
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.begin(), queue.end());
+    EXPECT_EQ(999, expelled.size());
+    EXPECT_EQ(0, *allocator.getBytesAllocated());
+}
+
+TEST_F(ChunkedQueueTest, MoveAssignTakesAllocator) {
+    populate(100);
+    const size_t allocated = *allocator.getBytesAllocated();
+
+    Queue other;
+    other = std::move(queue);
+    EXPECT_EQ(100, other.size());
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(allocator.getBytesAllocated(),
+              other.get_allocator().getBytesAllocated());
+    EXPECT_EQ(allocated, *allocator.getBytesAllocated());
+
+    other.clear();
+    EXPECT_EQ(0, *allocator.getBytesAllocated());
+}
@@ -16,10 +16,14 @@
  */
 
 #include "tests/wrapped_fileops_test.h"
+#include "src/couch-kvstore/couch-fs-async.h"
 #include "src/couch-kvstore/couch-fs-stats.h"
 
 #include "kvstore.h"
 
+#include <fcntl.h>
+#include <cstring>
+
 class TestStatsOps : public StatsOps {
 public:
     TestStatsOps(FileOpsInterface* ops)
@@ -57,3 +61,90 @@ INSTANTIATE_TYPED_TEST_CASE_P(CouchstoreOpsTest,
 INSTANTIATE_TYPED_TEST_CASE_P(CouchstoreOpsTest,
                               BufferedWrappedOpsTest,
                               testing::Types<>);
+
+/**
+ * Reads announced with WILLNEED are served from the reads submitted ahead
+ * (if built with io_uring), and return the same data as the wrapped ops.
+ */
+TEST(AsyncReadOpsTest, ReadAhead) {
+    const std::string path = "AsyncReadOpsTest.data";
+    std::string data(256 * 1024, '\0');
+    for (size_t ii = 0; ii < data.size(); ++ii) {
+        data[ii] = char(ii * 31);
+    }
+
+    AsyncReadOps ops(*couchstore_get_default_file_ops(), 4);
+    couchstore_error_info_t errinfo;
+    auto handle = ops.constructor(&errinfo);
+    ASSERT_EQ(COUCHSTORE_SUCCESS,
+              ops.open(&errinfo, &handle, path.c_str(), O_CREAT | O_RDWR));
+    ASSERT_EQ(ssize_t(data.size()),
+              ops.pwrite(&errinfo, handle, data.data(), data.size(), 0));
+
+    EXPECT_EQ(COUCHSTORE_SUCCESS,
+              ops.advise(&errinfo,
+                         handle,
+                         4096,
+                         200 * 1024,
+                         COUCHSTORE_FILE_ADVICE_WILLNEED));
+    for (cs_off_t offset = 0; offset < cs_off_t(data.size()); offset += 4096) {
+        char buf[4096];
+        ASSERT_EQ(ssize_t(sizeof(buf)),
+                  ops.pread(&errinfo, handle, buf, sizeof(buf), offset));
+        EXPECT_EQ(0, std::memcmp(buf, data.data() + offset, sizeof(buf)));
+    }
+    // io_uring may be unavailable at runtime (old kernel, seccomp), in which
+    // case nothing is submitted and the wrapped ops serve every read
+    if (ops.getReadsSubmitted() != 0) {
+        EXPECT_NE(0, ops.getReadsServed());
+    }
+
+    EXPECT_EQ(COUCHSTORE_SUCCESS, ops.close(&errinfo, handle));
+    ops.destructor(handle);
+    remove(path.c_str());
+}
+
+/*
+ * Announcing more reads than the file may hold doesn't drop any of the reads
+ * not consumed yet; the reads over the limit are served synchronously.
+ */
+TEST(AsyncReadOpsTest, UnconsumedReadsKept) {
+    const std::string path = "AsyncReadOpsTest.data";
+    std::string data(64 * 1024, '\0');
+    for (size_t ii = 0; ii < data.size(); ++ii) {
+        data[ii] = char(ii * 31);
+    }
+
+    // At most 2 * queueDepth reads are held
+    AsyncReadOps ops(*couchstore_get_default_file_ops(), 2);
+    couchstore_error_info_t errinfo;
+    auto handle = ops.constructor(&errinfo);
+    ASSERT_EQ(COUCHSTORE_SUCCESS,
+              ops.open(&errinfo, &handle, path.c_str(), O_CREAT | O_RDWR));
+    ASSERT_EQ(ssize_t(data.size()),
+              ops.pwrite(&errinfo, handle, data.data(), data.size(), 0));
+
+    const int blocks = 8;
+    for (cs_off_t offset = 0; offset < blocks * 8192; offset += 8192) {
+        EXPECT_EQ(COUCHSTORE_SUCCESS,
+                  ops.advise(&errinfo,
+                             handle,
+                             offset,
+                             4096,
+                             COUCHSTORE_FILE_ADVICE_WILLNEED));
+    }
+    for (cs_off_t offset = 0; offset < blocks * 8192; offset += 8192) {
+        char buf[4096];
+        ASSERT_EQ(ssize_t(sizeof(buf)),
+                  ops.pread(&errinfo, handle, buf, sizeof(buf), offset));
+        EXPECT_EQ(0, std::memcmp(buf, data.data() + offset, sizeof(buf)));
+    }
+    if (ops.getReadsSubmitted() != 0) {
+        EXPECT_EQ(4, ops.getReadsSubmitted());
+        EXPECT_EQ(ops.getReadsSubmitted(), ops.getReadsServed());
+    }
+
+    EXPECT_EQ(COUCHSTORE_SUCCESS, ops.close(&errinfo, handle));
+    ops.destructor(handle);
+    remove(path.c_str());
+}
@@ -22,7 +22,9 @@
 #include "dcp/backfill_disk.h"
 #include "dcp/backfill_memory.h"
 #include "dcp/dcpconnmap.h"
+#include "dcp/item_cache.h"
 #include "dcp/response.h"
+#include "dcp/zstd_compression.h"
 #include "dcp_utils.h"
 #include "ep_engine.h"
 #include "ephemeral_vb.h"
@@ -371,6 +373,169 @@ TEST_P(StreamTest, test_keyOnlyMessageSize) {
     destroy_dcp_stream();
 }
 
+/*
+ * Test that streams with the same features share the item which was modified
+ * for sending, while a stream with different features makes its own.
+ */
+TEST_P(DcpItemCacheStreamTest, ModifiedItemSharedBetweenStreams) {
+    auto item = makeItemWithXattrs();
+    item->setBySeqno(1);
+    queued_item qi(std::move(item));
+
+    setup_dcp_stream(0, IncludeValue::No, IncludeXattrs::No);
+    auto makeStream = [this](IncludeValue includeValue) {
+        return std::make_shared<MockActiveStream>(engine,
+                                                  producer,
+                                                  /*flags*/ 0,
+                                                  /*opaque*/ 0,
+                                                  *vb0,
+                                                  /*st_seqno*/ 0,
+                                                  /*en_seqno*/ ~0,
+                                                  /*vb_uuid*/ 0xabcd,
+                                                  /*snap_start_seqno*/ 0,
+                                                  /*snap_end_seqno*/ ~0,
+                                                  includeValue,
+                                                  IncludeXattrs::No);
+    };
+    auto sameFeatures = makeStream(IncludeValue::No);
+    auto otherFeatures = makeStream(IncludeValue::NoWithUnderlyingDatatype);
+
+    auto getItem = [&qi](MockActiveStream& s) {
+        auto resp = s.public_makeResponseFromItem(
+                qi, SendCommitSyncWriteAs::Commit);
+        return dynamic_cast<MutationResponse&>(*resp).getItem();
+    };
+    auto modified = getItem(*stream);
+    ASSERT_NE(qi.get(), modified.get());
+    EXPECT_EQ(modified.get(), getItem(*sameFeatures).get());
+    EXPECT_NE(modified.get(), getItem(*otherFeatures).get());
+
+    auto cache = vb0->getDcpItemCache();
+    EXPECT_EQ(1, cache->getHits());
+    EXPECT_EQ(2, cache->getMisses());
+    destroy_dcp_stream();
+}
+
+/*
+ * Test that the items held by the item cache are accounted in the bucket's
+ * stats, and released once the last stream of the vBucket goes away.
+ */
+TEST_P(DcpItemCacheStreamTest, ReleasedWithLastStream) {
+    auto item = makeItemWithXattrs();
+    item->setBySeqno(1);
+    queued_item qi(std::move(item));
+
+    auto& stats = engine->getEpStats();
+    const size_t cached = stats.dcpItemCacheSize;
+    auto cache = vb0->getDcpItemCache();
+    {
+        setup_dcp_stream(0, IncludeValue::No, IncludeXattrs::No);
+        auto resp = stream->public_makeResponseFromItem(
+                qi, SendCommitSyncWriteAs::Commit);
+        const auto size = dynamic_cast<MutationResponse&>(*resp)
+                                  .getItem()
+                                  ->size();
+        EXPECT_EQ(size, cache->getBytes());
+        EXPECT_EQ(cached + size, stats.dcpItemCacheSize);
+        destroy_dcp_stream();
+        stream.reset();
+    }
+
+    EXPECT_EQ(0, cache->getBytes());
+    EXPECT_EQ(cached, stats.dcpItemCacheSize);
+}
+
+/*
+ * Test that the item cache doesn't hold more than its byte budget, and that
+ * it's disabled by default.
+ */
+TEST(DcpItemCacheTest, ByteBudget) {
+    EPStats stats;
+    const DcpItemCache::Features features{IncludeValue::No,
+                                          IncludeXattrs::No,
+                                          SnappyEnabled::No,
+                                          ForceValueCompression::No,
+                                          0,
+                                          false};
+    auto first = makeCommittedItem(makeStoredDocKey("first"), "value");
+    first->setBySeqno(1);
+    auto second = makeCommittedItem(makeStoredDocKey("second"), "value");
+    second->setBySeqno(2);
+
+    DcpItemCache disabled(stats, 0);
+    disabled.insert(*first, features, first);
+    EXPECT_FALSE(disabled.find(*first, features));
+
+    const size_t cached = stats.dcpItemCacheSize;
+    DcpItemCache cache(stats, first->size() + second->size() - 1);
+    cache.insert(*first, features, first);
+    cache.insert(*second, features, second);
+    EXPECT_EQ(first, cache.find(*first, features));
+    EXPECT_FALSE(cache.find(*second, features));
+    EXPECT_EQ(first->size(), cache.getBytes());
+    EXPECT_EQ(cached + first->size(), stats.dcpItemCacheSize);
+
+    cache.clear();
+    EXPECT_EQ(0, cache.getBytes());
+    EXPECT_EQ(cached, stats.dcpItemCacheSize);
+}
+
+/*
+ * Test that a stream created once zstd compression has been enabled sends
+ * values zstd compressed, and that they decompress to the original value.
+ */
+TEST_P(StreamTest, ZstdCompressedValue) {
+    setup_dcp_stream();
+    if (!DcpZstdCompression::isSupported()) {
+        EXPECT_EQ(ENGINE_EINVAL,
+                  producer->control(0, "enable_zstd_compression", "true"));
+        destroy_dcp_stream();
+        return;
+    }
+    ASSERT_EQ(ENGINE_SUCCESS,
+              producer->control(0, "enable_zstd_compression", "true"));
+    EXPECT_EQ(ENGINE_EINVAL,
+              producer->control(0, "zstd_compression_level", "0"));
+    ASSERT_EQ(ENGINE_SUCCESS,
+              producer->control(0, "zstd_compression_level", "5"));
+    EXPECT_EQ(5, producer->getZstdCompressionLevel());
+
+    std::string value;
+    for (int i = 0; i < 20; ++i) {
+        value += "{\"product\": \"car\",\"price\": \"100\"},";
+    }
+    auto item = makeCommittedItem(makeStoredDocKey("key"), value);
+    item->setBySeqno(1);
+
+    auto zstdStream = std::make_shared<MockActiveStream>(engine,
+                                                         producer,
+                                                         /*flags*/ 0,
+                                                         /*opaque*/ 0,
+                                                         *vb0,
+                                                         /*st_seqno*/ 0,
+                                                         /*en_seqno*/ ~0,
+                                                         /*vb_uuid*/ 0xabcd,
+                                                         /*snap_start*/ 0,
+                                                         /*snap_end*/ ~0);
+    auto resp = zstdStream->public_makeResponseFromItem(
+            item, SendCommitSyncWriteAs::Commit);
+    auto sent = dynamic_cast<MutationResponse&>(*resp).getItem();
+    ASSERT_TRUE(sent->getDataType() & PROTOCOL_BINARY_DATATYPE_ZSTD);
+    EXPECT_LT(sent->getNBytes(), value.size());
+
+    std::string decompressed;
+    ASSERT_TRUE(engine->getDcpZstdCompression().decompress(
+            {sent->getData(), sent->getNBytes()}, decompressed));
+    EXPECT_EQ(value, decompressed);
+
+    // The stream created before zstd was enabled is unaffected
+    resp = stream->public_makeResponseFromItem(item,
+                                               SendCommitSyncWriteAs::Commit);
+    EXPECT_EQ(item.get(),
+              dynamic_cast<MutationResponse&>(*resp).getItem().get());
+    destroy_dcp_stream();
+}
+
 /*
  * Test for a dcpResponse retrieved from a stream where
  * IncludeValue==NoWithUnderlyingDatatype and IncludeXattrs==No, that the
@@ -1455,6 +1620,13 @@ INSTANTIATE_TEST_CASE_P(PersistentAndEphemeral,
                         });
 
 // Ephemeral only
+INSTANTIATE_TEST_CASE_P(PersistentAndEphemeral,
+                        DcpItemCacheStreamTest,
+                        ::testing::Values("persistent", "ephemeral"),
+                        [](const ::testing::TestParamInfo<std::string>& info) {
+                            return info.param;
+                        });
+
 INSTANTIATE_TEST_CASE_P(Ephemeral,
                         EphemeralStreamTest,
                         ::testing::Values("ephemeral"),
@@ -1715,6 +1887,42 @@ TEST_P(SingleThreadedActiveStreamTest, DiskBackfillInitializingItemsRemaining) {
  * 8. call getNumItemsForCursor() using the cursor we removed and make sure
  * we don't access the deleted memory
  */
+/*
+ * Test that the zstd dictionary of a collection is trained by a NonIO task,
+ * not by the stream sending the value which completes the samples.
+ */
+TEST_P(SingleThreadedActiveStreamTest, ZstdDictionaryTrainedByTask) {
+    if (!DcpZstdCompression::isSupported()) {
+        return;
+    }
+    auto& zstd = engine->getDcpZstdCompression();
+    auto& nonIo = *task_executor->getLpTaskQ()[NONIO_TASK_IDX];
+    const auto queued = nonIo.getFutureQueueSize() + nonIo.getReadyQueueSize();
+
+    const auto samples =
+            engine->getConfiguration().getDcpZstdDictionarySamples();
+    std::string output;
+    for (size_t ii = 0; ii < samples; ++ii) {
+        const std::string value =
+                R"({"id": )" + std::to_string(ii) +
+                R"(, "product": "car", "colour": ")" +
+                (ii % 3 ? "red" : "blue") + R"(", "price": )" +
+                std::to_string((ii * 37) % 1000) +
+                R"(, "description": "a car with )" + std::to_string(ii % 5) +
+                R"( doors"})";
+        zstd.compress(CollectionID::Default, value, 3, true, output);
+    }
+
+    // The last sample only scheduled the training
+    EXPECT_EQ(0, zstd.getNumDictionaries());
+    EXPECT_EQ(queued + 1,
+              nonIo.getFutureQueueSize() + nonIo.getReadyQueueSize());
+
+    runNextTask(nonIo,
+                "Training zstd dictionary for DCP values of collection 0x0");
+    EXPECT_EQ(1, zstd.getNumDictionaries());
+}
+
 TEST_P(SingleThreadedActiveStreamTest, MB36146) {
     auto vb = engine->getVBucket(vbid);
     auto& ckptMgr = *vb->checkpointManager;
@@ -42,6 +42,18 @@ protected:
  */
 class EphemeralStreamTest : public StreamTest {};
 
+/**
+ * Fixture for DCP stream tests with the vBucket's DcpItemCache enabled (it's
+ * disabled by default).
+ */
+class DcpItemCacheStreamTest : public StreamTest {
+protected:
+    void SetUp() override {
+        config_string += "dcp_item_cache_size=1048576";
+        StreamTest::SetUp();
+    }
+};
+
 /*
  * Test fixture for single-threaded ActiveStream tests.
  *
@@ -36,6 +36,8 @@
 #include "dcp/active_stream_checkpoint_processor_task.h"
 #include "dcp/dcp-types.h"
 #include "dcp/dcpconnmap.h"
+#include "dcp/flow-control-manager.h"
+#include "dcp/flow-control.h"
 #include "dcp/producer.h"
 #include "dcp/response.h"
 #include "dcp/stream.h"
@@ -2728,6 +2730,116 @@ TEST_P(ConnectionTest, ReplicateJustBeforeThrottleThreshold) {
     sendConsumerMutationsNearThreshold(false);
 }
 
+/*
+ * Test that with more than one processor the buffered messages of each
+ * vBucket are applied by the processor the vBucket is assigned to.
+ */
+TEST_P(ConnectionTest, ConsumerParallelProcessors) {
+    engine->getConfiguration().setDcpConsumerProcessBufferedMessagesParallelism(
+            2);
+    const void* cookie = create_mock_cookie();
+    auto consumer =
+            std::make_shared<MockDcpConsumer>(*engine, cookie, "test_consumer");
+    ASSERT_EQ(2, consumer->getNumProcessors());
+
+    std::vector<MockPassiveStream*> streams;
+    for (const auto vb : {Vbid(0), Vbid(1)}) {
+        ASSERT_EQ(ENGINE_SUCCESS, set_vb_state(vb, vbucket_state_replica));
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  consumer->addStream(/*opaque*/ 0, vb, /*flags*/ 0));
+        streams.push_back(static_cast<MockPassiveStream*>(
+                consumer->getVbucketStream(vb).get()));
+        ASSERT_TRUE(streams.back()->isActive());
+        EXPECT_EQ(ENGINE_SUCCESS,
+                  consumer->snapshotMarker(streams.back()->getOpaque(),
+                                           vb,
+                                           1,
+                                           10,
+                                           /* in-memory snapshot */ 0x1,
+                                           /*HCS*/ {},
+                                           /*maxVisibleSeqno*/ {}));
+
+        // Have the mutation buffered
+        engine->getKVBucket()->getVBucket(vb)->setTakeoverBackedUpState(true);
+        const DocKey docKey{"mykey", DocKeyEncodesCollectionId::No};
+        EXPECT_EQ(ENGINE_SUCCESS,
+                  consumer->mutation(streams.back()->getOpaque(),
+                                     docKey,
+                                     {}, // value
+                                     0, // priv bytes
+                                     PROTOCOL_BINARY_RAW_BYTES,
+                                     0, // cas
+                                     vb,
+                                     0, // flags
+                                     1, // by seqno
+                                     0, // rev seqno
+                                     0, // exptime
+                                     0, // locktime
+                                     {}, // meta
+                                     0)); // nru
+        EXPECT_EQ(1, streams.back()->getNumBufferItems());
+        engine->getKVBucket()->getVBucket(vb)->setTakeoverBackedUpState(false);
+    }
+
+    // vb:1 is applied by the second processor, leaving vb:0 buffered
+    EXPECT_EQ(more_to_process, consumer->processBufferedItems(1));
+    EXPECT_EQ(0, streams[1]->getNumBufferItems());
+    EXPECT_EQ(1, streams[0]->getNumBufferItems());
+
+    EXPECT_EQ(more_to_process, consumer->processBufferedItems(0));
+    EXPECT_EQ(0, streams[0]->getNumBufferItems());
+    EXPECT_EQ(all_processed, consumer->processBufferedItems(0));
+    EXPECT_EQ(all_processed, consumer->processBufferedItems(1));
+
+    for (auto* stream : streams) {
+        EXPECT_EQ(ENGINE_SUCCESS,
+                  consumer->closeStream(stream->getOpaque(),
+                                        stream->getVBucket()));
+    }
+    destroy_mock_cookie(cookie);
+}
+
+/*
+ * Test that the producer's ready queue serves the stream classes in
+ * proportion to their weights, interleaving them.
+ */
+TEST(WeightedReadyQueueTest, ServesClassesByWeight) {
+    WeightedReadyQueue::Weights weights;
+    weights.fill(1);
+    weights[size_t(DcpStreamClass::Replication)] = 2;
+    WeightedReadyQueue queue(weights);
+
+    EXPECT_TRUE(queue.pushUnique(Vbid(10), DcpStreamClass::Backfill));
+    EXPECT_FALSE(queue.pushUnique(Vbid(11), DcpStreamClass::Backfill));
+    for (uint16_t vb = 0; vb < 4; ++vb) {
+        EXPECT_FALSE(queue.pushUnique(Vbid(vb), DcpStreamClass::Replication));
+    }
+    // Already queued - stays in its original class
+    EXPECT_FALSE(queue.pushUnique(Vbid(10), DcpStreamClass::Replication));
+    EXPECT_EQ(6, queue.size());
+    EXPECT_TRUE(queue.exists(Vbid(10)));
+
+    const std::vector<std::pair<uint16_t, DcpStreamClass>> expected{
+            {0, DcpStreamClass::Replication},
+            {10, DcpStreamClass::Backfill},
+            {1, DcpStreamClass::Replication},
+            {2, DcpStreamClass::Replication},
+            {11, DcpStreamClass::Backfill},
+            {3, DcpStreamClass::Replication}};
+    for (const auto& next : expected) {
+        Vbid vb;
+        DcpStreamClass streamClass;
+        ASSERT_TRUE(queue.popFront(vb, streamClass));
+        EXPECT_EQ(Vbid(next.first), vb);
+        EXPECT_EQ(next.second, streamClass);
+        EXPECT_FALSE(queue.exists(vb));
+    }
+    Vbid vb;
+    DcpStreamClass streamClass;
+    EXPECT_FALSE(queue.popFront(vb, streamClass));
+    EXPECT_TRUE(queue.empty());
+}
+
 void ConnectionTest::processConsumerMutationsNearThreshold(
         bool beyondThreshold) {
     const void* cookie = create_mock_cookie();
@@ -3071,6 +3183,147 @@ TEST_F(SingleThreadedKVBucketTest, ProducerIdleTimeoutUpdatedOnConfigChange) {
     connMap.removeConn(cookie);
 }
 
+class FlowControlAdaptiveTest : public DCPTest {
+protected:
+    void SetUp() override {
+        config_string += "dcp_flow_control_policy=adaptive";
+        DCPTest::SetUp();
+        // The buffers of all consumers are limited to 10% of the quota
+        engine->getEpStats().setMaxDataSize(1000 * MiB);
+    }
+
+    void ack(DcpConsumer& consumer,
+             double drainRate,
+             std::chrono::milliseconds rtt,
+             std::chrono::steady_clock::time_point now) {
+        engine->getDcpFlowControlManager().handleBufferAck(
+                &consumer, drainRate, rtt, now);
+    }
+
+    const size_t MiB = 1024 * 1024;
+    // dcp_conn_buffer_size and dcp_conn_buffer_size_max
+    const size_t minSize = 10 * MiB;
+    const size_t maxSize = 50 * MiB;
+};
+
+/*
+ * Test that the drain rate and round trip time are estimated from the acks
+ * and messages, and that the time the producer has nothing to send isn't
+ * counted as draining.
+ */
+TEST_F(FlowControlAdaptiveTest, EstimatesFromAcks) {
+    const void* cookie = create_mock_cookie();
+    MockDcpConsumer consumer(*engine, cookie, "test_consumer");
+    auto& flowControl = consumer.getFlowControl();
+    const uint32_t bufSize = flowControl.getFlowControlBufSize();
+    ASSERT_EQ(minSize, bufSize);
+    const auto start = std::chrono::steady_clock::now();
+    using std::chrono::milliseconds;
+
+    // The producer fills the buffer, which the consumer drains in 100ms.
+    // The producer is then blocked until it gets the ack, so the next
+    // message arrives one round trip (10ms) after the ack.
+    flowControl.incrReceivedBytes(bufSize, start);
+    flowControl.updateEstimates(bufSize, start + milliseconds(100));
+    flowControl.incrReceivedBytes(bufSize / 2, start + milliseconds(110));
+    EXPECT_NEAR(bufSize * 10.0, flowControl.getDrainRate(), 1);
+    EXPECT_EQ(std::chrono::microseconds(10000), flowControl.getRtt());
+
+    // The consumer drains at the same rate, then the producer has nothing
+    // to send for 10 seconds
+    flowControl.updateEstimates(bufSize / 2, start + milliseconds(160));
+    EXPECT_NEAR(bufSize * 10.0, flowControl.getDrainRate(), 1);
+    flowControl.incrReceivedBytes(bufSize / 2, start + milliseconds(10000));
+    flowControl.updateEstimates(bufSize / 2, start + milliseconds(10050));
+    EXPECT_NEAR(bufSize * 10.0, flowControl.getDrainRate(), 1);
+    // No ack was sent with the buffer (nearly) full, so no new round trip
+    EXPECT_EQ(std::chrono::microseconds(10000), flowControl.getRtt());
+
+    destroy_mock_cookie(cookie);
+}
+
+/*
+ * Test that the buffer is sized to twice the bandwidth-delay product, within
+ * the min and max buffer size.
+ */
+TEST_F(FlowControlAdaptiveTest, BufferFollowsBandwidthDelayProduct) {
+    const void* cookie = create_mock_cookie();
+    MockDcpConsumer consumer(*engine, cookie, "test_consumer");
+    EXPECT_EQ(minSize, consumer.getFlowControlBufSize());
+    const auto now = std::chrono::steady_clock::now();
+
+    // No estimate yet
+    ack(consumer, 0, std::chrono::milliseconds(0), now);
+    EXPECT_EQ(minSize, consumer.getFlowControlBufSize());
+
+    // 80MiB/s with a 125ms round trip
+    ack(consumer, 80.0 * MiB, std::chrono::milliseconds(125), now);
+    EXPECT_EQ(20 * MiB, consumer.getFlowControlBufSize());
+
+    ack(consumer, 1000.0 * MiB, std::chrono::milliseconds(100), now);
+    EXPECT_EQ(maxSize, consumer.getFlowControlBufSize());
+
+    ack(consumer, 1.0 * MiB, std::chrono::milliseconds(100), now);
+    EXPECT_EQ(minSize, consumer.getFlowControlBufSize());
+
+    destroy_mock_cookie(cookie);
+}
+
+/*
+ * Test that a buffer only grows into what is left of the aggregate limit of
+ * all consumers.
+ */
+TEST_F(FlowControlAdaptiveTest, AggregateLimit) {
+    // A limit of 25MiB, of which the two consumers start with 20MiB
+    engine->getEpStats().setMaxDataSize(250 * MiB);
+    const void* cookie1 = create_mock_cookie();
+    const void* cookie2 = create_mock_cookie();
+    MockDcpConsumer consumer1(*engine, cookie1, "test_consumer1");
+    MockDcpConsumer consumer2(*engine, cookie2, "test_consumer2");
+    const auto now = std::chrono::steady_clock::now();
+
+    // Both ask for 20MiB
+    ack(consumer1, 80.0 * MiB, std::chrono::milliseconds(125), now);
+    EXPECT_EQ(15 * MiB, consumer1.getFlowControlBufSize());
+    ack(consumer2, 80.0 * MiB, std::chrono::milliseconds(125), now);
+    EXPECT_EQ(minSize, consumer2.getFlowControlBufSize());
+
+    destroy_mock_cookie(cookie1);
+    destroy_mock_cookie(cookie2);
+}
+
+/*
+ * Test that the buffer of a consumer which hasn't acked for
+ * dcp_flow_control_idle_time is shrunk back to the min, so a busy consumer
+ * can use the space.
+ */
+TEST_F(FlowControlAdaptiveTest, IdleBufferReclaimed) {
+    // A limit of 30MiB
+    engine->getEpStats().setMaxDataSize(300 * MiB);
+    const void* cookie1 = create_mock_cookie();
+    const void* cookie2 = create_mock_cookie();
+    MockDcpConsumer consumer1(*engine, cookie1, "test_consumer1");
+    MockDcpConsumer consumer2(*engine, cookie2, "test_consumer2");
+    const auto now = std::chrono::steady_clock::now();
+
+    ack(consumer1, 80.0 * MiB, std::chrono::milliseconds(125), now);
+    EXPECT_EQ(20 * MiB, consumer1.getFlowControlBufSize());
+    ack(consumer2, 80.0 * MiB, std::chrono::milliseconds(125), now);
+    EXPECT_EQ(minSize, consumer2.getFlowControlBufSize());
+
+    const auto later =
+            now + std::chrono::seconds(
+                          engine->getConfiguration()
+                                  .getDcpFlowControlIdleTime() +
+                          1);
+    ack(consumer2, 80.0 * MiB, std::chrono::milliseconds(125), later);
+    EXPECT_EQ(minSize, consumer1.getFlowControlBufSize());
+    EXPECT_EQ(20 * MiB, consumer2.getFlowControlBufSize());
+
+    destroy_mock_cookie(cookie1);
+    destroy_mock_cookie(cookie2);
+}
+
 struct PrintToStringCombinedNameXattrOnOff {
     std::string operator()(
             const ::testing::TestParamInfo<::testing::tuple<std::string, bool>>&
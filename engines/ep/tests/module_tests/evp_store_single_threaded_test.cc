@@ -29,8 +29,10 @@
 #include "checkpoint.h"
 #include "checkpoint_manager.h"
 #include "checkpoint_utils.h"
+#include "couch-kvstore/couch-kvstore.h"
 #include "dcp/active_stream_checkpoint_processor_task.h"
 #include "dcp/backfill-manager.h"
+#include "dcp/backfill_disk_range.h"
 #include "dcp/dcpconnmap.h"
 #include "dcp/response.h"
 #include "ep_bucket.h"
@@ -39,6 +41,7 @@
 #include "evp_store_test.h"
 #include "failover-table.h"
 #include "fakes/fake_executorpool.h"
+#include "flush_batch_prefetch.h"
 #include "item_freq_decayer_visitor.h"
 #include "kv_bucket.h"
 #include "programs/engine_testapp/mock_cookie.h"
@@ -2591,6 +2594,50 @@ TEST_P(STParameterizedBucketTest, enable_expiry_output) {
     producer.reset();
 }
 
+// A producer configured to batch sends several messages from a single step,
+// up to the batch size
+TEST_P(STParameterizedBucketTest, ProducerStepBatch) {
+    shutdownAndPurgeTasks(engine.get());
+    reinitialise(config_string + ";dcp_producer_step_batch_size=3");
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+
+    auto cookie = create_mock_cookie();
+    auto producer = createDcpProducer(cookie, IncludeDeleteTime::No);
+    MockDcpMessageProducers producers(engine.get());
+    createDcpStream(*producer);
+
+    for (int ii = 0; ii < 4; ++ii) {
+        store_item(vbid,
+                   makeStoredDocKey("key" + std::to_string(ii)),
+                   "value");
+    }
+    flushVBucketToDiskIfPersistent(vbid, 4);
+
+    auto vb = store->getVBucket(vbid);
+    producer->notifySeqnoAvailable(
+            vbid, vb->getHighSeqno(), SyncWriteOperation::No);
+    runCheckpointProcessor(*producer, producers);
+
+    // The snapshot marker and the first two mutations
+    EXPECT_EQ(ENGINE_SUCCESS, producer->stepWithBorderGuard(producers));
+    EXPECT_EQ(cb::mcbp::ClientOpcode::DcpMutation, producers.last_op);
+    EXPECT_EQ("key1", producers.last_key);
+    EXPECT_EQ(2, producer->getItemsSent());
+
+    // The remaining two mutations; the step succeeds as it sent something
+    // even though it ran out of messages before filling the batch
+    EXPECT_EQ(ENGINE_SUCCESS, producer->stepWithBorderGuard(producers));
+    EXPECT_EQ("key3", producers.last_key);
+    EXPECT_EQ(4, producer->getItemsSent());
+
+    EXPECT_EQ(ENGINE_EWOULDBLOCK, producer->stepWithBorderGuard(producers));
+
+    destroy_mock_cookie(cookie);
+    producer->closeAllStreams();
+    producer->cancelCheckpointCreatorTask();
+    producer.reset();
+}
+
 TEST_P(XattrSystemUserTest, MB_29040) {
     auto& kvbucket = *engine->getKVBucket();
     setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
@@ -3093,6 +3140,155 @@ TEST_F(SingleThreadedEPBucketTest, MB_29480) {
     producer->cancelCheckpointCreatorTask();
 }
 
+// A large backfill is split into seqno ranges which are read concurrently,
+// but the stream must still receive the items in seqno order.
+TEST_F(SingleThreadedEPBucketTest, ParallelDiskBackfill) {
+    shutdownAndPurgeTasks(engine.get());
+    reinitialise(config_string +
+                 ";dcp_backfill_scan_parallelism=3;"
+                 "dcp_backfill_parallel_scan_min_items=1");
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+
+    const int numItems = 9;
+    for (int ii = 0; ii < numItems; ++ii) {
+        store_item(vbid, makeStoredDocKey("key" + std::to_string(ii)), "v");
+    }
+    flush_vbucket_to_disk(vbid, numItems);
+
+    // Remove the items from the checkpoint so the stream must backfill
+    auto vb = store->getVBucket(vbid);
+    auto& ckpt_mgr = *vb->checkpointManager;
+    ckpt_mgr.createNewCheckpoint();
+    bool newCkptCreated;
+    EXPECT_EQ(1, ckpt_mgr.removeClosedUnrefCheckpoints(*vb, newCkptCreated));
+
+    auto producer = createDcpProducer(cookie, IncludeDeleteTime::No);
+    MockDcpMessageProducers producers(engine.get());
+    createDcpStream(*producer);
+
+    // backfill:create() schedules a prefetch task for each of the last two
+    // ranges
+    auto& lpAuxioQ = *task_executor->getLpTaskQ()[AUXIO_TASK_IDX];
+    runNextTask(lpAuxioQ, "Backfilling items for a DCP Connection");
+    EXPECT_EQ(3,
+              lpAuxioQ.getFutureQueueSize() + lpAuxioQ.getReadyQueueSize());
+
+    // Run the backfill and prefetch tasks in whatever order they are
+    // scheduled, checking the mutations arrive in order
+    int received = 0;
+    for (int runs = 0; received < numItems && runs < 20;) {
+        auto ret = producer->stepWithBorderGuard(producers);
+        if (ret == ENGINE_EWOULDBLOCK) {
+            runNextTask(lpAuxioQ);
+            ++runs;
+            continue;
+        }
+        ASSERT_EQ(ENGINE_SUCCESS, ret);
+        if (producers.last_op == cb::mcbp::ClientOpcode::DcpSnapshotMarker) {
+            EXPECT_EQ(0, received);
+            EXPECT_EQ(numItems, producers.last_snap_end_seqno);
+            continue;
+        }
+        ASSERT_EQ(cb::mcbp::ClientOpcode::DcpMutation, producers.last_op);
+        EXPECT_EQ("key" + std::to_string(received), producers.last_key);
+        EXPECT_EQ(received + 1, producers.last_byseqno);
+        ++received;
+    }
+    EXPECT_EQ(numItems, received);
+
+    producer->closeAllStreams();
+    producer->cancelCheckpointCreatorTask();
+}
+
+// A range of a split backfill re-opens the data file, so it must only be
+// usable if the file is still the snapshot the first range was opened on.
+TEST_F(SingleThreadedEPBucketTest, DiskBackfillRangeRequiresSameSnapshot) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+
+    const int numItems = 4;
+    for (int ii = 0; ii < numItems; ++ii) {
+        store_item(vbid, makeStoredDocKey("key" + std::to_string(ii)), "v");
+    }
+    flush_vbucket_to_disk(vbid, numItems);
+
+    auto& kvstore = *store->getROUnderlying(vbid);
+    {
+        DiskBackfillRange range(kvstore, 3, 4, 1024);
+        EXPECT_TRUE(range.open(
+                vbid, ValueFilter::VALUES_DECOMPRESSED, 0, numItems));
+    }
+
+    // A mutation persisted after the first range was opened (which saw
+    // seqno 3 as the max) is a different snapshot, even though the file
+    // still covers the range
+    {
+        DiskBackfillRange range(kvstore, 2, 3, 1024);
+        EXPECT_FALSE(range.open(
+                vbid, ValueFilter::VALUES_DECOMPRESSED, 0, numItems - 1));
+    }
+}
+
+// Test that a backfill of mostly resident items is served from memory, with
+// the non-resident items read from disk, and everything arrives in order.
+TEST_F(SingleThreadedEPBucketTest, HybridMemoryDiskBackfill) {
+    shutdownAndPurgeTasks(engine.get());
+    reinitialise(config_string + ";dcp_backfill_from_memory_max_items=100");
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+
+    const int numItems = 9;
+    for (int ii = 0; ii < numItems; ++ii) {
+        store_item(vbid, makeStoredDocKey("key" + std::to_string(ii)), "v");
+    }
+    flush_vbucket_to_disk(vbid, numItems);
+    evict_key(vbid, makeStoredDocKey("key3"));
+    evict_key(vbid, makeStoredDocKey("key4"));
+
+    // Remove the items from the checkpoint so the stream must backfill
+    auto vb = store->getVBucket(vbid);
+    auto& ckpt_mgr = *vb->checkpointManager;
+    ckpt_mgr.createNewCheckpoint();
+    bool newCkptCreated;
+    EXPECT_EQ(1, ckpt_mgr.removeClosedUnrefCheckpoints(*vb, newCkptCreated));
+
+    auto producer = createDcpProducer(cookie, IncludeDeleteTime::No);
+    MockDcpMessageProducers producers(engine.get());
+    auto stream = producer->mockActiveStreamRequest(/*flags*/ 0,
+                                                    /*opaque*/ 0,
+                                                    *vb,
+                                                    /*st_seqno*/ 0,
+                                                    /*en_seqno*/ ~0,
+                                                    /*vb_uuid*/ 0xabcd,
+                                                    /*snap_start_seqno*/ 0,
+                                                    /*snap_end_seqno*/ ~0);
+
+    auto& lpAuxioQ = *task_executor->getLpTaskQ()[AUXIO_TASK_IDX];
+    int received = 0;
+    for (int runs = 0; received < numItems && runs < 20;) {
+        auto ret = producer->stepWithBorderGuard(producers);
+        if (ret == ENGINE_EWOULDBLOCK) {
+            runNextTask(lpAuxioQ);
+            ++runs;
+            continue;
+        }
+        ASSERT_EQ(ENGINE_SUCCESS, ret);
+        if (producers.last_op == cb::mcbp::ClientOpcode::DcpSnapshotMarker) {
+            EXPECT_EQ(0, received);
+            EXPECT_EQ(numItems, producers.last_snap_end_seqno);
+            continue;
+        }
+        ASSERT_EQ(cb::mcbp::ClientOpcode::DcpMutation, producers.last_op);
+        EXPECT_EQ("key" + std::to_string(received), producers.last_key);
+        EXPECT_EQ(received + 1, producers.last_byseqno);
+        ++received;
+    }
+    EXPECT_EQ(numItems, received);
+    EXPECT_EQ(2, stream->getNumBackfillItemsFromDisk());
+    EXPECT_EQ(numItems, stream->getNumBackfillItems());
+
+    producer->closeAllStreams();
+    producer->cancelCheckpointCreatorTask();
+}
+
 // MB-29512: Ensure if compaction ran in between stream-request and backfill
 // starting, we don't backfill from before the purge-seqno.
 TEST_F(SingleThreadedEPBucketTest, MB_29512) {
@@ -4178,6 +4374,245 @@ TEST_P(STParameterizedBucketTest, MB_34380) {
     EXPECT_NO_THROW(vb->getShard()->getRWUnderlying()->getDbFileInfo(vbid));
 }
 
+// Check that a pipelined flush persists both vBuckets, in order; the batch of
+// the second vBucket being drained while the first one commits.
+TEST_F(SingleThreadedEPBucketTest, FlushVBucketPipelined) {
+    const Vbid vbid2(1);
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    setVBucketStateAndRunPersistTask(vbid2, vbucket_state_active);
+
+    store_item(vbid, makeStoredDocKey("key1"), "value");
+    store_item(vbid, makeStoredDocKey("key2"), "value");
+    store_item(vbid2, makeStoredDocKey("key1"), "value");
+
+    EXPECT_EQ(std::make_pair(false, false),
+              getEPBucket().flushVBucketPipelined(vbid, vbid2));
+    EXPECT_EQ(2, store->getVBucket(vbid)->getPersistenceSeqno());
+    EXPECT_EQ(1, store->getVBucket(vbid2)->getPersistenceSeqno());
+
+    // The prefetch task didn't get to run before the flusher needed the
+    // batch, so the flusher drained it itself and the task has nothing to do.
+    auto& lpNonioQ = *task_executor->getLpTaskQ()[NONIO_TASK_IDX];
+    runNextTask(lpNonioQ, "Preparing flush batch of vb:1");
+    EXPECT_EQ(std::make_pair(false, size_t(0)),
+              getEPBucket().flushVBucket(vbid2));
+
+    // A vBucket with nothing to commit doesn't prefetch the next one
+    store_item(vbid2, makeStoredDocKey("key2"), "value");
+    EXPECT_EQ(std::make_pair(false, false),
+              getEPBucket().flushVBucketPipelined(vbid, vbid2));
+    EXPECT_EQ(2, store->getVBucket(vbid2)->getPersistenceSeqno());
+}
+
+// Check that a FlushBatchPrefetchTask drains the batch and takeOver() returns
+// it, and that the task can run after the vBucket has gone.
+TEST_F(SingleThreadedEPBucketTest, FlushBatchPrefetchTask) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    store_item(vbid, makeStoredDocKey("key2"), "value");
+    store_item(vbid, makeStoredDocKey("key1"), "value");
+
+    auto& lpNonioQ = *task_executor->getLpTaskQ()[NONIO_TASK_IDX];
+    auto prefetch = std::make_shared<FlushBatchPrefetch>(
+            store->getVBucket(vbid), *store->getRWUnderlying(vbid), 100);
+    ExecutorPool::get()->schedule(
+            std::make_shared<FlushBatchPrefetchTask>(*engine, prefetch));
+    runNextTask(lpNonioQ, "Preparing flush batch of vb:0");
+
+    // The task drained the checkpoints, and ordered the batch by key
+    EXPECT_TRUE(store->getVBucket(vbid)->getItemsToPersist(100).items.empty());
+    std::vector<StoredDocKey> keys;
+    for (const auto& item : prefetch->takeOver().items) {
+        if (!item->isCheckPointMetaItem()) {
+            keys.emplace_back(item->getKey());
+        }
+    }
+    EXPECT_EQ(std::vector<StoredDocKey>({makeStoredDocKey("key1"),
+                                         makeStoredDocKey("key2")}),
+              keys);
+
+    // The flusher took the batch over before the task ran; the vBucket is
+    // deleted by the time it does
+    prefetch = std::make_shared<FlushBatchPrefetch>(
+            store->getVBucket(vbid), *store->getRWUnderlying(vbid), 100);
+    ExecutorPool::get()->schedule(
+            std::make_shared<FlushBatchPrefetchTask>(*engine, prefetch));
+    EXPECT_TRUE(prefetch->takeOver().items.empty());
+    EXPECT_EQ(ENGINE_SUCCESS, store->deleteVBucket(vbid));
+    runNextTask(lpNonioQ, "Preparing flush batch of vb:0");
+}
+
+TEST_F(SingleThreadedEPBucketTest, FlushVBucketGroup) {
+    const Vbid vbid2(1);
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    setVBucketStateAndRunPersistTask(vbid2, vbucket_state_active);
+
+    store_item(vbid, makeStoredDocKey("key1"), "value");
+    store_item(vbid, makeStoredDocKey("key2"), "value");
+    store_item(vbid2, makeStoredDocKey("key1"), "value");
+
+    const auto flushedBefore = engine->getEpStats().totalPersisted.load();
+    EXPECT_TRUE(getEPBucket().flushVBucketGroup({vbid, vbid2}).empty());
+    EXPECT_EQ(2, store->getVBucket(vbid)->getPersistenceSeqno());
+    EXPECT_EQ(1, store->getVBucket(vbid2)->getPersistenceSeqno());
+    EXPECT_EQ(flushedBefore + 3, engine->getEpStats().totalPersisted);
+
+    // The items are clean (their persistence callbacks ran) and readable
+    // from disk once evicted.
+    evict_key(vbid, makeStoredDocKey("key1"));
+    auto gv = store->get(
+            makeStoredDocKey("key1"), vbid, cookie, QUEUE_BG_FETCH);
+    EXPECT_EQ(ENGINE_EWOULDBLOCK, gv.getStatus());
+    runBGFetcherTask();
+    gv = store->get(makeStoredDocKey("key1"), vbid, cookie, QUEUE_BG_FETCH);
+    EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+
+    // A vBucket with nothing to flush takes part without effect
+    store_item(vbid2, makeStoredDocKey("key2"), "value");
+    EXPECT_TRUE(getEPBucket().flushVBucketGroup({vbid, vbid2}).empty());
+    EXPECT_EQ(2, store->getVBucket(vbid2)->getPersistenceSeqno());
+}
+
+/// GroupSync which calls a hook (with the number of files of the group)
+/// before syncing the group, and fails the sync if the hook returns false
+class TestGroupSync : public GroupSync {
+public:
+    explicit TestGroupSync(std::function<bool(size_t)> hook)
+        : hook(std::move(hook)) {
+    }
+
+    bool sync() override {
+        const bool success = hook(size());
+        return GroupSync::sync() && success;
+    }
+
+private:
+    std::function<bool(size_t)> hook;
+};
+
+/// CouchKVStore whose commit groups are synced by a TestGroupSync (whether or
+/// not io_uring is available)
+class TestGroupSyncCouchKVStore : public CouchKVStore {
+public:
+    TestGroupSyncCouchKVStore(KVStoreConfig& config,
+                              std::function<bool(size_t)> hook)
+        : CouchKVStore(config), hook(std::move(hook)) {
+    }
+
+protected:
+    std::unique_ptr<GroupSync> createGroupSync() override {
+        return std::make_unique<TestGroupSync>(hook);
+    }
+
+    std::function<bool(size_t)> hook;
+};
+
+class GroupCommitTest : public SingleThreadedEPBucketTest {
+protected:
+    void SetUp() override {
+        SingleThreadedEPBucketTest::SetUp();
+        // In the same shard as vbid, so both are in the same commit group
+        vbid2 = Vbid(store->getVBuckets().getNumShards());
+        setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+        setVBucketStateAndRunPersistTask(vbid2, vbucket_state_active);
+
+        auto rwro = store->takeRWRO(0);
+        auto rw = std::make_unique<TestGroupSyncCouchKVStore>(
+                rwro.rw->getConfig(),
+                [this](size_t files) { return beforeGroupSync(files); });
+        store->setRWRO(0, std::move(rw), std::move(rwro.ro));
+    }
+
+    size_t getSyncCount() {
+        return store->getRWUnderlying(vbid)
+                ->getKVStoreStat()
+                .fsStats.syncTimeHisto.getValueCount();
+    }
+
+    Vbid vbid2;
+
+    /// Called with the number of files of the group before syncing it
+    std::function<bool(size_t)> beforeGroupSync = [](size_t) { return true; };
+};
+
+// The persistence callbacks and persisted seqnos of a group are only updated
+// once the group has been synced
+TEST_F(GroupCommitTest, CompletedAfterGroupSync) {
+    store_item(vbid, makeStoredDocKey("key1"), "value");
+    store_item(vbid2, makeStoredDocKey("key1"), "value");
+
+    auto vb = store->getVBucket(vbid);
+    auto vb2 = store->getVBucket(vbid2);
+    const auto persistedBefore = engine->getEpStats().totalPersisted.load();
+    bool synced = false;
+    beforeGroupSync = [&](size_t files) {
+        // Both batches are written, but nothing is complete
+        EXPECT_EQ(2, files);
+        EXPECT_EQ(persistedBefore, engine->getEpStats().totalPersisted);
+        EXPECT_EQ(0, vb->getPersistenceSeqno());
+        EXPECT_EQ(0, vb2->getPersistenceSeqno());
+        synced = true;
+        return true;
+    };
+    EXPECT_TRUE(getEPBucket().flushVBucketGroup({vbid, vbid2}).empty());
+    EXPECT_TRUE(synced);
+    EXPECT_EQ(persistedBefore + 2, engine->getEpStats().totalPersisted);
+    EXPECT_EQ(1, vb->getPersistenceSeqno());
+    EXPECT_EQ(1, vb2->getPersistenceSeqno());
+}
+
+// The final sync of each file of a group is deferred to the sync of the group
+TEST_F(GroupCommitTest, SyncsDeferred) {
+    store_item(vbid, makeStoredDocKey("key1"), "value");
+    store_item(vbid2, makeStoredDocKey("key1"), "value");
+    auto syncs = getSyncCount();
+    EXPECT_FALSE(getEPBucket().flushVBucket(vbid).first);
+    EXPECT_FALSE(getEPBucket().flushVBucket(vbid2).first);
+    const auto sequentialSyncs = getSyncCount() - syncs;
+
+    store_item(vbid, makeStoredDocKey("key2"), "value");
+    store_item(vbid2, makeStoredDocKey("key2"), "value");
+    syncs = getSyncCount();
+    EXPECT_TRUE(getEPBucket().flushVBucketGroup({vbid, vbid2}).empty());
+    const auto groupSyncs = getSyncCount() - syncs;
+
+    // The data of each commit is still synced before its header is written;
+    // the header syncs of both files are replaced by the sync of the group
+    EXPECT_EQ(sequentialSyncs - 2 + 1, groupSyncs);
+}
+
+// If the sync of the group fails, every batch of the group is retried, and
+// the vbucket states cached by the KVStore are rolled back
+TEST_F(GroupCommitTest, GroupSyncFailure) {
+    store_item(vbid, makeStoredDocKey("key1"), "value");
+    store_item(vbid2, makeStoredDocKey("key1"), "value");
+
+    auto* rwUnderlying = store->getRWUnderlying(vbid);
+    beforeGroupSync = [rwUnderlying, this](size_t) {
+        EXPECT_EQ(1, rwUnderlying->getVBucketState(vbid)->highSeqno);
+        EXPECT_EQ(1, rwUnderlying->getVBucketState(vbid2)->highSeqno);
+        return false;
+    };
+    auto more = getEPBucket().flushVBucketGroup({vbid, vbid2});
+    EXPECT_EQ(std::vector<Vbid>({vbid, vbid2}), more);
+
+    for (auto id : {vbid, vbid2}) {
+        auto vb = store->getVBucket(id);
+        EXPECT_EQ(1, vb->rejectQueue.size());
+        EXPECT_EQ(0, vb->getPersistenceSeqno());
+        EXPECT_EQ(0, rwUnderlying->getVBucketState(id)->highSeqno);
+    }
+
+    // The retry flushes the items from the rejectQueue
+    beforeGroupSync = [](size_t) { return true; };
+    EXPECT_TRUE(getEPBucket().flushVBucketGroup({vbid, vbid2}).empty());
+    for (auto id : {vbid, vbid2}) {
+        auto vb = store->getVBucket(id);
+        EXPECT_TRUE(vb->rejectQueue.empty());
+        EXPECT_EQ(1, vb->getPersistenceSeqno());
+        EXPECT_EQ(1, rwUnderlying->getVBucketState(id)->highSeqno);
+    }
+}
+
 INSTANTIATE_TEST_CASE_P(XattrSystemUserTest,
                         XattrSystemUserTest,
                         ::testing::Bool(), );
@@ -20,6 +20,7 @@
 #include "../mock/mock_ep_bucket.h"
 #include "../mock/mock_item_freq_decayer.h"
 #include "../mock/mock_synchronous_ep_engine.h"
+#include "access_scanner.h"
 #include "checkpoint_manager.h"
 #include "dcp/response.h"
 #include "durability/durability_monitor.h"
@@ -29,14 +30,37 @@
 #include "evp_store_single_threaded_test.h"
 #include "failover-table.h"
 #include "kvstore.h"
+#include "mutation_log.h"
 #include "programs/engine_testapp/mock_cookie.h"
+#include "sorted_access_log.h"
 #include "test_helpers.h"
 #include "vbucket_state.h"
 #include "warmup.h"
 
+#include <platform/dirutils.h>
+#include <platform/socket.h>
+
 class WarmupTest : public SingleThreadedKVBucketTest {
 public:
     void MB_31450(bool newCheckpoint);
+
+    /// @return the warmup stats (with their "ep_warmup_" prefix)
+    std::map<std::string, std::string> getWarmupStats() {
+        struct StatMap : cb::tracing::Traceable {
+            std::map<std::string, std::string> map;
+        } stats;
+        store->getWarmup()->addStats(
+                [](cb::const_char_buffer key,
+                   cb::const_char_buffer value,
+                   gsl::not_null<const void*> cookie) {
+                    auto* stats = reinterpret_cast<StatMap*>(
+                            const_cast<void*>(cookie.get()));
+                    stats->map[std::string(key.data(), key.size())] =
+                            std::string(value.data(), value.size());
+                },
+                &stats);
+        return stats.map;
+    }
 };
 
 // Test that the FreqSaturatedCallback of a vbucket is initialized and after
@@ -553,6 +577,152 @@ TEST_F(WarmupTest, SetVBState) {
     EXPECT_EQ(vbucket_state_replica, store->getVBucket(vbid)->getState());
 }
 
+// Check that warmup loads everything when the vBuckets of each shard are
+// split across multiple tasks (including shards with fewer vBuckets than
+// tasks).
+TEST_F(WarmupTest, MultipleTasksPerShard) {
+    const auto numShards = store->getVBuckets().getNumShards();
+    const auto numVbuckets = numShards * 2 + 1;
+    for (uint16_t ii = 0; ii < numVbuckets; ++ii) {
+        const Vbid id(ii);
+        setVBucketStateAndRunPersistTask(id, vbucket_state_active);
+        store_item(id, makeStoredDocKey("key" + std::to_string(ii)), "value");
+        flush_vbucket_to_disk(id);
+    }
+
+    resetEngineAndWarmup("warmup_tasks_per_shard=4");
+
+    EXPECT_EQ(numVbuckets, engine->getEpStats().warmedUpValues);
+    for (uint16_t ii = 0; ii < numVbuckets; ++ii) {
+        const Vbid id(ii);
+        auto vb = store->getVBucket(id);
+        ASSERT_TRUE(vb);
+        EXPECT_EQ(1, vb->getNumItems());
+
+        auto gv = store->get(
+                makeStoredDocKey("key" + std::to_string(ii)), id, cookie, {});
+        ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+        EXPECT_EQ(0, memcmp("value", gv.item->getData(), 5));
+    }
+}
+
+// Check that the access log of each shard is applied in full when the
+// shard's vBuckets are split across multiple tasks, and that the estimated
+// number of values to warm up is the total of all of the tasks.
+TEST_F(WarmupTest, AccessLogMultipleTasksPerShard) {
+    const auto numShards = store->getVBuckets().getNumShards();
+    const auto numVbuckets = numShards * 2 + 1;
+    const std::string alogPath = test_dbname + "/access.log";
+    std::vector<std::unique_ptr<MutationLog>> logs;
+    for (size_t shard = 0; shard < numShards; ++shard) {
+        logs.push_back(std::make_unique<MutationLog>(
+                alogPath + "." + std::to_string(shard)));
+        logs.back()->open();
+    }
+
+    for (uint16_t ii = 0; ii < numVbuckets; ++ii) {
+        const Vbid id(ii);
+        const auto key = makeStoredDocKey("key" + std::to_string(ii));
+        setVBucketStateAndRunPersistTask(id, vbucket_state_active);
+        store_item(id, key, "value");
+        flush_vbucket_to_disk(id);
+        const auto shard = store->getVBuckets().getShardByVbId(id)->getId();
+        logs[shard]->newItem(id, key);
+    }
+    for (auto& log : logs) {
+        log->commit1();
+        log->commit2();
+        log->flush();
+    }
+    logs.clear();
+
+    resetEngineAndWarmup("warmup_tasks_per_shard=4;alog_path=" + alogPath);
+
+    EXPECT_EQ(numVbuckets, engine->getEpStats().warmedUpValues);
+    EXPECT_EQ(std::to_string(numVbuckets),
+              getWarmupStats()["ep_warmup_estimated_value_count"]);
+}
+
+// Check that a MutationLog with more keys than warmup_batch_size is applied
+// in full, a batch at a time, by tasks which each harvest their own vBuckets
+TEST_F(WarmupTest, AccessLogAppliedInBatches) {
+    const auto numShards = store->getVBuckets().getNumShards();
+    const Vbid vbid2(numShards);
+    const std::string alogPath = test_dbname + "/access.log";
+    MutationLog log(alogPath + ".0");
+    log.open();
+
+    const int keysPerVbucket = 5;
+    for (const auto id : {vbid, vbid2}) {
+        setVBucketStateAndRunPersistTask(id, vbucket_state_active);
+        for (int ii = 0; ii < keysPerVbucket; ++ii) {
+            const auto key = makeStoredDocKey("key" + std::to_string(ii));
+            store_item(id, key, "value");
+            log.newItem(id, key);
+        }
+        flush_vbucket_to_disk(id, keysPerVbucket);
+    }
+    log.commit1();
+    log.commit2();
+    log.flush();
+    log.close();
+
+    resetEngineAndWarmup("warmup_tasks_per_shard=2;warmup_batch_size=2;"
+                         "alog_path=" +
+                         alogPath);
+
+    EXPECT_EQ(2 * keysPerVbucket, engine->getEpStats().warmedUpValues);
+}
+
+// Check that the AccessScanner writes a sorted access log of the resident
+// keys, and that warmup loads the values of (only) those keys from it
+TEST_F(WarmupTest, SortedAccessLogWrittenAndLoaded) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    const int numKeys = 10;
+    std::vector<StoredDocKey> keys;
+    for (int ii = 0; ii < numKeys; ++ii) {
+        keys.push_back(makeStoredDocKey("key" + std::to_string(ii)));
+        store_item(vbid, keys.back(), "value");
+    }
+    flush_vbucket_to_disk(vbid, numKeys);
+
+    // Only the resident (even) keys are logged
+    for (int ii = 1; ii < numKeys; ii += 2) {
+        evict_key(vbid, keys[ii]);
+    }
+
+    const std::string alogPath = test_dbname + "/access.log";
+    engine->getConfiguration().setAlogPath(alogPath);
+    AccessScanner scanner(
+            *store, engine->getConfiguration(), engine->getEpStats(), 1000);
+    scanner.run();
+    auto& lpAuxioQ = *task_executor->getLpTaskQ()[AUXIO_TASK_IDX];
+    for (size_t ii = 0; ii < store->getVBuckets().getNumShards(); ++ii) {
+        runNextTask(lpAuxioQ, "Item Access Scanner on vb:0");
+    }
+    const auto shard = store->getVBuckets().getShardByVbId(vbid)->getId();
+    const auto logFile = alogPath + "." + std::to_string(shard);
+    ASSERT_TRUE(SortedAccessLog::isSortedAccessLog(logFile));
+
+    // Enabling traffic once half of the values are loaded means the values
+    // loaded are the ones from the access log (rather than all of them, by
+    // the LoadingData phase)
+    resetEngineAndWarmup("alog_path=" + alogPath +
+                         ";warmup_min_items_threshold=50");
+
+    EXPECT_EQ(numKeys, engine->getEpStats().warmedUpKeys);
+    EXPECT_EQ(numKeys / 2, engine->getEpStats().warmedUpValues);
+    EXPECT_EQ(std::to_string(numKeys / 2),
+              getWarmupStats()["ep_warmup_estimated_value_count"]);
+    auto vb = store->getVBucket(vbid);
+    for (int ii = 0; ii < numKeys; ++ii) {
+        const auto* sv = vb->ht.findForRead(keys[ii], TrackReference::No)
+                                 .storedValue;
+        ASSERT_TRUE(sv) << keys[ii];
+        EXPECT_EQ(ii % 2 == 0, sv->isResident()) << keys[ii];
+    }
+}
+
 TEST_F(WarmupTest, TwoStateChangesAtSameSeqno) {
     // 1) Do a normal state change to replica
     EXPECT_EQ(ENGINE_SUCCESS,
@@ -644,6 +814,116 @@ TEST_F(WarmupTest, MB_31450) {
     MB_31450(false);
 }
 
+// Test fixture for the bloom filters saved at shutdown and restored by
+// warmup (full eviction only)
+class BloomFilterWarmupTest : public WarmupTest {
+protected:
+    void SetUp() override {
+        config_string += "item_eviction_policy=full_eviction";
+        WarmupTest::SetUp();
+
+        setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+        for (int ii = 0; ii < 10; ++ii) {
+            keys.push_back(makeStoredDocKey("key" + std::to_string(ii)));
+            store_item(vbid, keys.back(), "value");
+        }
+        flush_vbucket_to_disk(vbid, keys.size());
+
+        // Half of the keys are only on disk (added to the filter when
+        // ejected), the others are saved from the HashTable at shutdown
+        for (size_t ii = 0; ii < keys.size(); ii += 2) {
+            evict_key(vbid, keys[ii]);
+        }
+    }
+
+    /// Shut the engine down cleanly (saving the bloom filters) and create
+    /// a new one ready to warm up
+    void cleanShutdownAndEnableWarmup() {
+        engine->destroyInner(/*force*/ false);
+        resetEngineAndEnableWarmup();
+        ASSERT_TRUE(cb::io::isFile(getBloomFilterFileName()));
+    }
+
+    std::string getBloomFilterFileName() const {
+        return std::string(test_dbname) + "/" + std::to_string(vbid.get()) +
+               ".bloomfilter";
+    }
+
+    void writeBloomFilterFile(const std::string& buffer) {
+        FILE* file = fopen(getBloomFilterFileName().c_str(), "wb");
+        ASSERT_NE(nullptr, file);
+        ASSERT_EQ(1, fwrite(buffer.data(), buffer.size(), 1, file));
+        ASSERT_EQ(0, fclose(file));
+    }
+
+    /// Check warmup didn't restore a filter, and removed the file
+    void expectFilterNotRestored() {
+        runReadersUntilWarmedUp();
+        auto vb = store->getVBucket(vbid);
+        ASSERT_TRUE(vb);
+        EXPECT_EQ(0, vb->getNumOfKeysInFilter());
+        EXPECT_FALSE(cb::io::isFile(getBloomFilterFileName()));
+    }
+
+    std::vector<StoredDocKey> keys;
+};
+
+// The bloom filter saved at a clean shutdown is restored by warmup, and
+// knows about every key on disk
+TEST_F(BloomFilterWarmupTest, RestoredAfterCleanShutdown) {
+    cleanShutdownAndEnableWarmup();
+
+    runReadersUntilWarmedUp();
+    auto vb = store->getVBucket(vbid);
+    ASSERT_TRUE(vb);
+    EXPECT_LT(0, vb->getNumOfKeysInFilter());
+    for (const auto& key : keys) {
+        EXPECT_TRUE(vb->maybeKeyExistsInFilter(key)) << key.to_string();
+    }
+    // The file is stale once the vbucket is modified
+    EXPECT_FALSE(cb::io::isFile(getBloomFilterFileName()));
+}
+
+// The data files may have been written to after the filter was saved if the
+// shutdown wasn't clean
+TEST_F(BloomFilterWarmupTest, NotRestoredAfterUncleanShutdown) {
+    cleanShutdownAndEnableWarmup();
+    const auto saved = cb::io::loadFile(getBloomFilterFileName());
+    runReadersUntilWarmedUp();
+
+    // A forced shutdown doesn't save the filters; put back the file of the
+    // previous shutdown (which matches the seqno on disk)
+    engine->destroyInner(/*force*/ true);
+    resetEngineAndEnableWarmup();
+    ASSERT_FALSE(cb::io::isFile(getBloomFilterFileName()));
+    writeBloomFilterFile(saved);
+
+    expectFilterNotRestored();
+}
+
+// A filter saved at a different seqno than the vbucket is warmed up to
+// doesn't have all of its keys
+TEST_F(BloomFilterWarmupTest, NotRestoredForOtherSeqno) {
+    cleanShutdownAndEnableWarmup();
+    // The header is in network byte order: magic, vbid, then persistedSeqno
+    auto buffer = cb::io::loadFile(getBloomFilterFileName());
+    const uint64_t seqno = htonll(keys.size() + 1);
+    std::memcpy(&buffer[2 * sizeof(uint32_t)], &seqno, sizeof(seqno));
+    writeBloomFilterFile(buffer);
+
+    expectFilterNotRestored();
+}
+
+// A filter which doesn't match the checksum in its header is not restored
+TEST_F(BloomFilterWarmupTest, NotRestoredIfCorrupt) {
+    cleanShutdownAndEnableWarmup();
+    auto buffer = cb::io::loadFile(getBloomFilterFileName());
+    buffer.back() ^= 0xff;
+    writeBloomFilterFile(buffer);
+
+    expectFilterNotRestored();
+}
+
 // Test fixture for Durability-related Warmup tests.
 class DurabilityWarmupTest : public DurabilityKVBucketTest {
 protected:
@@ -248,6 +248,67 @@ TEST_F(HashTableTest, Resize) {
     verifyFound(h, keys);
 }
 
+// Check the fingerprint index gives the same results as walking the chains,
+// both when the fingerprint blocks have overflowed (small table) and when
+// they haven't.
+TEST_F(HashTableTest, FingerprintIndex) {
+    HashTable h(global_stats,
+                makeFactory(),
+                5,
+                3,
+                HashTableIndexMode::Fingerprint);
+    ASSERT_EQ(HashTableIndexMode::Fingerprint, h.getIndexMode());
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+    verifyFound(h, keys);
+
+    // Grow so the blocks no longer overflow.
+    h.resize(6143);
+    verifyFound(h, keys);
+    for (const auto& key : generateKeys(2000, 1000)) {
+        EXPECT_FALSE(h.findForRead(key).storedValue);
+    }
+
+    // Delete every other key; the remaining ones must still be found and
+    // the deleted ones must not.
+    std::vector<StoredDocKey> remaining;
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        if (ii % 2) {
+            ASSERT_TRUE(del(h, keys[ii]));
+            EXPECT_FALSE(h.findForRead(keys[ii]).storedValue);
+        } else {
+            remaining.push_back(keys[ii]);
+        }
+    }
+    verifyFound(h, remaining);
+    EXPECT_EQ(static_cast<int>(remaining.size()), count(h));
+
+    // Shrink again (blocks overflow), then delete the rest.
+    h.resize(5);
+    verifyFound(h, remaining);
+    for (const auto& key : remaining) {
+        ASSERT_TRUE(del(h, key));
+        EXPECT_FALSE(h.findForRead(key).storedValue);
+    }
+    EXPECT_EQ(0, count(h));
+
+    // Re-populating after a clear must work too.
+    storeMany(h, keys);
+    h.clear();
+    for (const auto& key : keys) {
+        EXPECT_FALSE(h.findForRead(key).storedValue);
+    }
+}
+
+TEST_F(HashTableTest, IndexModeParse) {
+    EXPECT_EQ(HashTableIndexMode::Chained, parseHashTableIndexMode("chained"));
+    EXPECT_EQ(HashTableIndexMode::Fingerprint,
+              parseHashTableIndexMode("fingerprint"));
+    EXPECT_EQ("fingerprint", to_string(HashTableIndexMode::Fingerprint));
+    EXPECT_THROW(parseHashTableIndexMode("open"), std::invalid_argument);
+}
+
 class AccessGenerator : public Generator<bool> {
 public:
 
@@ -428,6 +428,73 @@ TEST_P(KVBucketParamTest, GetKeyStatsNMVB) {
                                    WantsDeleted::No));
 }
 
+// Test that getMulti returns the results in request order, even when the keys
+// are spread over different vbuckets and some of them need a bgfetch.
+TEST_P(KVBucketParamTest, GetMulti) {
+    const auto resident = makeStoredDocKey("resident");
+    const auto evicted1 = makeStoredDocKey("evicted1");
+    const auto evicted2 = makeStoredDocKey("evicted2");
+    const auto missing = makeStoredDocKey("missing");
+    store_item(vbid, resident, "value");
+    store_item(vbid, evicted1, "value1");
+    store_item(vbid, evicted2, "value2");
+
+    const bool persistent =
+            engine->getConfiguration().getBucketType() == "persistent";
+    if (persistent) {
+        flush_vbucket_to_disk(vbid, 3);
+        evict_key(vbid, evicted1);
+        evict_key(vbid, evicted2);
+    }
+
+    const std::vector<cb::GetMultiKey> keys{{evicted1, vbid},
+                                            {resident, Vbid(1)},
+                                            {resident, vbid},
+                                            {missing, vbid},
+                                            {evicted2, vbid}};
+    const auto options = static_cast<get_options_t>(
+            QUEUE_BG_FETCH | HONOR_STATES | TRACK_REFERENCE | DELETE_TEMP |
+            HIDE_LOCKED_CAS | TRACK_STATISTICS);
+
+    auto results = store->getMulti(keys, cookie, options);
+    ASSERT_EQ(keys.size(), results.size());
+    EXPECT_EQ(ENGINE_NOT_MY_VBUCKET, results[1].getStatus());
+    EXPECT_EQ(ENGINE_SUCCESS, results[2].getStatus());
+    if (persistent) {
+        EXPECT_EQ(ENGINE_EWOULDBLOCK, results[0].getStatus());
+        EXPECT_EQ(ENGINE_EWOULDBLOCK, results[4].getStatus());
+        size_t misses = 2;
+        if (engine->getConfiguration().getItemEvictionPolicy() ==
+            "full_eviction") {
+            EXPECT_EQ(ENGINE_EWOULDBLOCK, results[3].getStatus());
+            ++misses;
+        } else {
+            EXPECT_EQ(ENGINE_KEY_ENOENT, results[3].getStatus());
+        }
+
+        // All of the misses should be fetched by a single run of the
+        // BgFetcher, in a single KVStore::getMulti batch
+        auto& stats = engine->getEpStats();
+        const auto batches = stats.getMultiBatchSizeHisto.getValueCount();
+        const auto fetched = stats.bg_fetched.load();
+        runBGFetcherTask();
+        EXPECT_EQ(batches + 1, stats.getMultiBatchSizeHisto.getValueCount());
+        EXPECT_EQ(misses, stats.getMultiBatchSizeHisto.getMaxValue());
+        EXPECT_EQ(fetched + misses, stats.bg_fetched);
+        results = store->getMulti(keys, cookie, options);
+        ASSERT_EQ(keys.size(), results.size());
+    }
+
+    EXPECT_EQ(ENGINE_SUCCESS, results[0].getStatus());
+    EXPECT_EQ("value1", results[0].item->getValue()->to_s());
+    EXPECT_EQ(ENGINE_NOT_MY_VBUCKET, results[1].getStatus());
+    EXPECT_EQ(ENGINE_SUCCESS, results[2].getStatus());
+    EXPECT_EQ("value", results[2].item->getValue()->to_s());
+    EXPECT_EQ(ENGINE_KEY_ENOENT, results[3].getStatus());
+    EXPECT_EQ(ENGINE_SUCCESS, results[4].getStatus());
+    EXPECT_EQ("value2", results[4].item->getValue()->to_s());
+}
+
 // Replace tests //////////////////////////////////////////////////////////////
 
 // Test replace against a non-existent key.
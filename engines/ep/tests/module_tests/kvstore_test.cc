@@ -949,6 +949,30 @@ TEST_F(CouchKVStoreErrorInjectionTest, getMulti_open_doc_with_docinfo) {
     EXPECT_EQ(ENGINE_TMPFAIL, itms[DiskDocKey{items.at(0)}].value.getStatus());
 }
 
+/**
+ * getMulti reads the documents of a batch in file order; with read-ahead
+ * configured the documents following each read are advised to the OS.
+ */
+TEST_F(CouchKVStoreErrorInjectionTest, getMulti_read_ahead) {
+    config.setReadAheadMax(64 * 1024);
+    kvstore.reset(new CouchKVStore(config, ops));
+    initialize_kv_store(kvstore.get());
+
+    populate_items(20);
+    vb_bgfetch_queue_t itms(make_bgfetch_queue());
+    {
+        EXPECT_CALL(ops, advise(_, _, _, _, COUCHSTORE_FILE_ADVICE_WILLNEED))
+                .Times(AtLeast(1));
+        kvstore->getMulti(Vbid(0), itms);
+    }
+    for (const auto& item : items) {
+        const auto& fetched = itms[DiskDocKey{item}].value;
+        ASSERT_EQ(ENGINE_SUCCESS, fetched.getStatus());
+        EXPECT_EQ(item.getKey(), fetched.item->getKey());
+        EXPECT_EQ(item.getBySeqno(), fetched.item->getBySeqno());
+    }
+}
+
 /**
  * Injects error during CouchKVStore::compactDB/couchstore_compact_db_ex
  */
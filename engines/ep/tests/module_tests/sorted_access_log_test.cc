@@ -0,0 +1,135 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "sorted_access_log.h"
+
+#include "mutation_log.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <folly/portability/GTest.h>
+#include <platform/dirutils.h>
+
+#include <cstdio>
+#include <stdexcept>
+
+class SortedAccessLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tmp_log_filename = cb::io::mktemp("salt_test");
+    }
+
+    void TearDown() override {
+        cb::io::rmrf(tmp_log_filename);
+    }
+
+    /// Write a log with the given keys for vb:0 and a single key for vb:3
+    void writeLog(std::vector<std::string> keys, bool commit = true) {
+        SortedAccessLogWriter writer(tmp_log_filename);
+        std::vector<StoredDocKey> vb0;
+        for (const auto& key : keys) {
+            vb0.push_back(makeStoredDocKey(key));
+        }
+        writer.addVBucket(Vbid(0), std::move(vb0));
+        writer.addVBucket(Vbid(3), {makeStoredDocKey("x")});
+        if (commit) {
+            writer.commit();
+        }
+    }
+
+    std::string tmp_log_filename;
+};
+
+// Keys are read back for each vBucket sorted and without duplicates
+TEST_F(SortedAccessLogTest, WriteAndRead) {
+    writeLog({"c", "a", "b", "a"});
+    ASSERT_TRUE(SortedAccessLog::isSortedAccessLog(tmp_log_filename));
+
+    SortedAccessLogReader reader(tmp_log_filename);
+    EXPECT_EQ(4, reader.getNumKeys());
+
+    auto keys = reader.getKeys(Vbid(0));
+    EXPECT_EQ(3, keys.size());
+    for (const auto* expected : {"a", "b", "c"}) {
+        ASSERT_FALSE(keys.done());
+        EXPECT_EQ(makeStoredDocKey(expected), StoredDocKey(keys.next()));
+    }
+    EXPECT_TRUE(keys.done());
+
+    keys = reader.getKeys(Vbid(3));
+    ASSERT_FALSE(keys.done());
+    EXPECT_EQ(makeStoredDocKey("x"), StoredDocKey(keys.next()));
+    EXPECT_TRUE(keys.done());
+
+    // A vBucket which isn't in the log has no keys
+    keys = reader.getKeys(Vbid(1));
+    EXPECT_TRUE(keys.done());
+    EXPECT_EQ(0, keys.size());
+}
+
+TEST_F(SortedAccessLogTest, AddVBucketTwice) {
+    SortedAccessLogWriter writer(tmp_log_filename);
+    writer.addVBucket(Vbid(0), {makeStoredDocKey("a")});
+    EXPECT_THROW(writer.addVBucket(Vbid(0), {makeStoredDocKey("b")}),
+                 std::logic_error);
+    writer.commit();
+    EXPECT_THROW(writer.addVBucket(Vbid(1), {makeStoredDocKey("b")}),
+                 std::logic_error);
+    EXPECT_EQ(1, writer.getNumKeys());
+}
+
+// A log which was never committed must not be used
+TEST_F(SortedAccessLogTest, Incomplete) {
+    writeLog({"a", "b"}, false);
+    EXPECT_TRUE(SortedAccessLog::isSortedAccessLog(tmp_log_filename));
+    EXPECT_THROW(SortedAccessLogReader reader(tmp_log_filename),
+                 std::runtime_error);
+}
+
+TEST_F(SortedAccessLogTest, CorruptSection) {
+    writeLog({"a", "b"});
+
+    // Flip a bit in the first key of vb:0 (just after the header and the
+    // length of the key)
+    FILE* fp = fopen(tmp_log_filename.c_str(), "r+b");
+    ASSERT_NE(nullptr, fp);
+    ASSERT_EQ(0, fseek(fp, 16 + 2, SEEK_SET));
+    const int byte = fgetc(fp);
+    ASSERT_EQ(0, fseek(fp, 16 + 2, SEEK_SET));
+    fputc(byte ^ 0x01, fp);
+    fclose(fp);
+
+    SortedAccessLogReader reader(tmp_log_filename);
+    EXPECT_THROW(reader.getKeys(Vbid(0)), std::runtime_error);
+
+    // The other vBucket is still intact
+    auto keys = reader.getKeys(Vbid(3));
+    EXPECT_EQ(makeStoredDocKey("x"), StoredDocKey(keys.next()));
+}
+
+// A MutationLog isn't mistaken for a sorted access log
+TEST_F(SortedAccessLogTest, MutationLog) {
+    {
+        MutationLog ml(tmp_log_filename);
+        ml.open();
+        ml.newItem(Vbid(0), makeStoredDocKey("a"));
+        ml.commit1();
+        ml.commit2();
+    }
+    EXPECT_FALSE(SortedAccessLog::isSortedAccessLog(tmp_log_filename));
+    EXPECT_THROW(SortedAccessLogReader reader(tmp_log_filename),
+                 std::runtime_error);
+}
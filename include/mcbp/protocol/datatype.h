@@ -42,6 +42,14 @@ using protocol_binary_datatype_t = uint8_t;
 #define PROTOCOL_BINARY_DATATYPE_SNAPPY uint8_t(cb::mcbp::Datatype::Snappy)
 #define PROTOCOL_BINARY_DATATYPE_XATTR uint8_t(cb::mcbp::Datatype::Xattr)
 
+/*
+ * The value is compressed with zstd. This is only ever sent by a DCP
+ * producer to a client which enabled it with the "enable_zstd_compression"
+ * DCP control, and is not one of the datatypes a client may send (it is
+ * not included in mcbp::datatype::highest).
+ */
+#define PROTOCOL_BINARY_DATATYPE_ZSTD uint8_t(0x08)
+
 /*
  * Bitmask that defines datatypes that can only be valid when a document body
  * exists. i.e. When the document is not soft-deleted
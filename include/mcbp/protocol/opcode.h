@@ -119,6 +119,10 @@ enum class ClientOpcode : uint8_t {
      * vbuckets on the node */
     GetAllVbSeqnos = 0x48,
 
+    /* Fetch a batch of documents (possibly spanning multiple vbuckets)
+     * with a single request. See docs/BinaryProtocol.md */
+    GetMulti = 0x49,
+
     /* DCP */
     DcpOpen = 0x50,
     DcpAddStream = 0x51,
@@ -12,6 +12,7 @@
 #include <string>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <boost/optional/optional_fwd.hpp>
 #include <gsl/gsl>
@@ -108,6 +109,12 @@ struct EngineErrorCasPair {
     engine_errc status;
     uint64_t cas;
 };
+
+/// A single key (and the vbucket it lives in) requested through get_multi
+struct GetMultiKey {
+    DocKey key;
+    Vbid vbucket;
+};
 } // namespace cb
 
 /**
@@ -330,6 +337,35 @@ struct MEMCACHED_PUBLIC_CLASS EngineIface {
                                         Vbid vbucket,
                                         DocStateFilter documentStateFilter) = 0;
 
+    /**
+     * Retrieve a batch of (alive) items.
+     *
+     * Engines which can look up multiple keys more efficiently than
+     * individually (for instance by grouping the keys per vbucket and
+     * fetching all of the non-resident items from disk in a single batch)
+     * should override this method.
+     *
+     * Every key which returns cb::engine_errc::would_block must result in
+     * exactly one call to notify_io_complete for the cookie once that key
+     * may be retried. The core counts these notifications and only resumes
+     * the command once all of them have arrived.
+     *
+     * @param cookie The cookie provided by the frontend
+     * @param keys the keys to look up
+     * @param results populated with one entry per element in keys (in the
+     *                same order)
+     */
+    virtual void get_multi(gsl::not_null<const void*> cookie,
+                           const std::vector<cb::GetMultiKey>& keys,
+                           std::vector<cb::EngineErrorItemPair>& results) {
+        results.clear();
+        results.reserve(keys.size());
+        for (const auto& k : keys) {
+            results.emplace_back(
+                    get(cookie, k.key, k.vbucket, DocStateFilter::Alive));
+        }
+    }
+
     /**
      * Optionally retrieve an item. Only non-deleted items may be fetched
      * through this interface (Documents in deleted state may be evicted
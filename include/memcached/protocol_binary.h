@@ -261,6 +261,42 @@ protected:
 };
 static_assert(sizeof(SetCtrlTokenPayload) == 8, "Unexpected size");
 
+/**
+ * The value of a GetMulti request is a sequence of entries, each starting
+ * with this header immediately followed by keylen bytes of key:
+ *
+ *     vbucket (uint16_t, network byte order)
+ *     keylen  (uint16_t, network byte order)
+ *     key     (keylen bytes)
+ */
+class GetMultiKeyHeader {
+public:
+    Vbid getVBucket() const {
+        return vbucket.ntoh();
+    }
+    void setVBucket(Vbid vbucket) {
+        GetMultiKeyHeader::vbucket = vbucket.hton();
+    }
+    uint16_t getKeylen() const {
+        return ntohs(keylen);
+    }
+    void setKeylen(uint16_t keylen) {
+        GetMultiKeyHeader::keylen = htons(keylen);
+    }
+
+    cb::const_byte_buffer getBuffer() const {
+        return {reinterpret_cast<const uint8_t*>(this), sizeof(*this)};
+    }
+
+protected:
+    Vbid vbucket{0};
+    uint16_t keylen = 0;
+};
+static_assert(sizeof(GetMultiKeyHeader) == 4, "Unexpected size");
+
+/// The maximum number of keys which may be requested in a single GetMulti
+const size_t GetMultiMaxKeys = 1024;
+
 #pragma pack()
 } // namespace request
 } // namespace mcbp
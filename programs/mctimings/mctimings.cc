@@ -64,32 +64,33 @@ public:
 
         // loop though all the buckets in the json object and print them
         // to std out
-        uint64_t lastBuckLow = bucketsLow;
+        uint64_t lastBuckLow = toNanoseconds(bucketsLow);
         for (auto bucket : dataArray) {
             // Get the current bucket's highest value it would track counts for
-            auto buckHigh = bucket[0].get<uint64_t>();
+            auto buckHigh = toNanoseconds(bucket[0].get<uint64_t>());
             // Get the counts for this bucket
             auto count = bucket[1].get<uint64_t>();
             // Get the percentile of counts that are <= buckHigh
             auto percentile = bucket[2].get<double>();
 
             if (lastBuckLow != buckHigh) {
-                // Cast the high bucket width to us, ms and seconds so we
+                // Cast the high bucket width to ns, us, ms and seconds so we
                 // can check which units we should be using for this bucket
-                auto buckHighUs = microseconds(buckHigh);
-                auto buckHighMs = duration_cast<milliseconds>(buckHighUs);
-                auto buckHighS = duration_cast<seconds>(buckHighUs);
+                auto buckHighNs = nanoseconds(buckHigh);
+                auto buckHighUs = duration_cast<microseconds>(buckHighNs);
+                auto buckHighMs = duration_cast<milliseconds>(buckHighNs);
+                auto buckHighS = duration_cast<seconds>(buckHighNs);
 
                 // If the bucket width values are in the order of tens of
-                // seconds or milli seconds then print them as seconds or milli
-                // seconds respectively. Otherwise print them as micro seconds
+                // seconds, milli seconds or micro seconds then print them
+                // as seconds, milli seconds or micro seconds respectively.
+                // Otherwise print them as nano seconds
 
                 // We're using tens of unit thresh holds so that each bucket
                 // has 2 sig fig of differentiation in their width, so we dont
                 // have buckets that are [1 - 1]s    100     (90.000%)
                 if (buckHighS.count() > 10) {
-                    auto low =
-                            duration_cast<seconds>(microseconds(lastBuckLow));
+                    auto low = duration_cast<seconds>(nanoseconds(lastBuckLow));
                     dump("s",
                          low.count(),
                          buckHighS.count(),
@@ -97,14 +98,22 @@ public:
                          percentile);
                 } else if (buckHighMs.count() > 10) {
                     auto low = duration_cast<milliseconds>(
-                            microseconds(lastBuckLow));
+                            nanoseconds(lastBuckLow));
                     dump("ms",
                          low.count(),
                          buckHighMs.count(),
                          count,
                          percentile);
+                } else if (buckHighUs.count() > 10) {
+                    auto low = duration_cast<microseconds>(
+                            nanoseconds(lastBuckLow));
+                    dump("us",
+                         low.count(),
+                         buckHighUs.count(),
+                         count,
+                         percentile);
                 } else {
-                    dump("us", lastBuckLow, buckHigh, count, percentile);
+                    dump("ns", lastBuckLow, buckHigh, count, percentile);
                 }
             }
             // Set the low bucket value to this buckets high width value.
@@ -124,9 +133,25 @@ private:
             total = cb::jsonGet<uint64_t>(root, "total");
             data = cb::jsonGet<nlohmann::json>(root, "data");
             bucketsLow = cb::jsonGet<uint64_t>(root, "bucketsLow");
+            // Older servers (and the subdoc_execute stat) report the
+            // histogram in microseconds without a unit
+            auto unit = root.find("unit");
+            if (unit != root.end() && unit->get<std::string>() == "ns") {
+                nanosecondValues = true;
+            }
         }
     }
 
+    /// Convert a value from the histogram to nanoseconds
+    uint64_t toNanoseconds(uint64_t value) const {
+        if (nanosecondValues) {
+            return value;
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::microseconds(value))
+                .count();
+    }
+
     void dump(const char* timeunit,
               int64_t low,
               int64_t high,
@@ -172,6 +197,11 @@ private:
      * Total number of counts recorded in the histogram
      */
     uint64_t total = 0;
+    /**
+     * Set if the values in the histogram are nanoseconds rather than
+     * microseconds
+     */
+    bool nanosecondValues = false;
 };
 
 std::string opcode2string(cb::mcbp::ClientOpcode opcode) {
@@ -517,6 +517,29 @@ void BinprotGetCommand::encode(std::vector<uint8_t>& buf) const {
     buf.insert(buf.end(), key.begin(), key.end());
 }
 
+BinprotGetMultiCommand& BinprotGetMultiCommand::addKey(std::string key,
+                                                      Vbid vbucket) {
+    keys.emplace_back(std::move(key), vbucket);
+    return *this;
+}
+
+void BinprotGetMultiCommand::encode(std::vector<uint8_t>& buf) const {
+    size_t payload_len = 0;
+    for (const auto& k : keys) {
+        payload_len += sizeof(cb::mcbp::request::GetMultiKeyHeader) +
+                       k.first.size();
+    }
+    writeHeader(buf, payload_len, 0);
+    for (const auto& k : keys) {
+        cb::mcbp::request::GetMultiKeyHeader hdr;
+        hdr.setVBucket(k.second);
+        hdr.setKeylen(gsl::narrow<uint16_t>(k.first.size()));
+        auto header = hdr.getBuffer();
+        buf.insert(buf.end(), header.begin(), header.end());
+        buf.insert(buf.end(), k.first.begin(), k.first.end());
+    }
+}
+
 void BinprotGetAndLockCommand::encode(std::vector<uint8_t>& buf) const {
     writeHeader(buf, 0, sizeof(lock_timeout));
     cb::mcbp::request::GetLockedPayload payload;
@@ -551,6 +551,27 @@ public:
     void encode(std::vector<uint8_t>& buf) const override;
 };
 
+/**
+ * Fetch a batch of keys with a single request. The server sends one
+ * response per key (in the order they were added) which may be read with
+ * BinprotGetResponse.
+ */
+class BinprotGetMultiCommand
+    : public BinprotCommandT<BinprotGetMultiCommand,
+                             cb::mcbp::ClientOpcode::GetMulti> {
+public:
+    BinprotGetMultiCommand& addKey(std::string key, Vbid vbucket = Vbid(0));
+
+    size_t getNumKeys() const {
+        return keys.size();
+    }
+
+    void encode(std::vector<uint8_t>& buf) const override;
+
+protected:
+    std::vector<std::pair<std::string, Vbid>> keys;
+};
+
 class BinprotGetAndLockCommand
     : public BinprotCommandT<BinprotGetAndLockCommand,
                              cb::mcbp::ClientOpcode::GetLocked> {
@@ -95,6 +95,7 @@ bool is_valid_opcode(ClientOpcode opcode) {
     case ClientOpcode::TapCheckpointStart:
     case ClientOpcode::TapCheckpointEnd:
     case ClientOpcode::GetAllVbSeqnos:
+    case ClientOpcode::GetMulti:
     case ClientOpcode::DcpOpen:
     case ClientOpcode::DcpAddStream:
     case ClientOpcode::DcpCloseStream:
@@ -287,6 +288,7 @@ bool is_durability_supported(ClientOpcode opcode) {
     case ClientOpcode::TapCheckpointStart:
     case ClientOpcode::TapCheckpointEnd:
     case ClientOpcode::GetAllVbSeqnos:
+    case ClientOpcode::GetMulti:
     case ClientOpcode::DcpOpen:
     case ClientOpcode::DcpAddStream:
     case ClientOpcode::DcpCloseStream:
@@ -455,6 +457,7 @@ bool is_reorder_supported(ClientOpcode opcode) {
     case ClientOpcode::TapCheckpointStart:
     case ClientOpcode::TapCheckpointEnd:
     case ClientOpcode::GetAllVbSeqnos:
+    case ClientOpcode::GetMulti:
     case ClientOpcode::DcpOpen:
     case ClientOpcode::DcpAddStream:
     case ClientOpcode::DcpCloseStream:
@@ -695,6 +698,8 @@ std::string to_string(cb::mcbp::ClientOpcode opcode) {
         return "TAP_CHECKPOINT_END";
     case ClientOpcode::GetAllVbSeqnos:
         return "GET_ALL_VB_SEQNOS";
+    case ClientOpcode::GetMulti:
+        return "GET_MULTI";
     case ClientOpcode::DcpOpen:
         return "DCP_OPEN";
     case ClientOpcode::DcpAddStream:
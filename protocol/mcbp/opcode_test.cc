@@ -94,6 +94,7 @@ const std::map<cb::mcbp::ClientOpcode, std::string> client_blueprint = {
          {ClientOpcode::TapCheckpointStart, "TAP_CHECKPOINT_START"},
          {ClientOpcode::TapCheckpointEnd, "TAP_CHECKPOINT_END"},
          {ClientOpcode::GetAllVbSeqnos, "GET_ALL_VB_SEQNOS"},
+         {ClientOpcode::GetMulti, "GET_MULTI"},
          {ClientOpcode::DcpOpen, "DCP_OPEN"},
          {ClientOpcode::DcpAddStream, "DCP_ADD_STREAM"},
          {ClientOpcode::DcpCloseStream, "DCP_CLOSE_STREAM"},
@@ -150,6 +150,7 @@ bool Request::isQuiet() const {
         case ClientOpcode::TapCheckpointStart:
         case ClientOpcode::TapCheckpointEnd:
         case ClientOpcode::GetAllVbSeqnos:
+        case ClientOpcode::GetMulti:
         case ClientOpcode::DcpOpen:
         case ClientOpcode::DcpAddStream:
         case ClientOpcode::DcpCloseStream:
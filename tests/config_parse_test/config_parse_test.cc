@@ -871,6 +871,25 @@ TEST_F(SettingsTest, max_packet_size) {
     }
 }
 
+TEST_F(SettingsTest, NetworkBackend) {
+    nonStringValuesShouldFail("network_backend");
+
+    for (const auto backend :
+         {NetworkBackend::Default,
+          NetworkBackend::EpollChangelist,
+          NetworkBackend::IoUring}) {
+        nlohmann::json obj;
+        obj["network_backend"] = to_string(backend);
+        Settings settings(obj);
+        EXPECT_EQ(backend, settings.getNetworkBackend());
+        EXPECT_TRUE(settings.has.network_backend);
+    }
+
+    nlohmann::json obj;
+    obj["network_backend"] = "foo";
+    expectFail<std::invalid_argument>(obj);
+}
+
 TEST_F(SettingsTest, max_connections) {
     nonNumericValuesShouldFail("max_connections");
 
@@ -1466,6 +1485,19 @@ TEST(SettingsUpdateTest, MaxPacketSizeIsDynamic) {
               settings.getMaxPacketSize());
 }
 
+TEST(SettingsUpdateTest, NetworkBackendIsNotDynamic) {
+    Settings settings;
+    Settings updated;
+    // setting it to the same value should work
+    updated.setNetworkBackend(settings.getNetworkBackend());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should fail
+    updated.setNetworkBackend(NetworkBackend::EpollChangelist);
+    EXPECT_THROW(settings.updateSettings(updated, false),
+                 std::invalid_argument);
+}
+
 TEST(SettingsUpdateTest, SaslMechanismsIsDynamic) {
     Settings settings;
     Settings updated;
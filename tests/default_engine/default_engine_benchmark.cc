@@ -0,0 +1,208 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks measuring how the get / set throughput of the default engine
+ * (memcached buckets) scales with the number of front end threads, and
+ * with the number of item partitions the cache is split into.
+ *
+ * The first argument of each benchmark is the number of item partitions;
+ * run with --benchmark_counters_tabular=true to get ops/s per thread count.
+ */
+
+#include <benchmark/benchmark.h>
+#include <engines/default_engine/default_engine_public.h>
+#include <logger/logger.h>
+#include <memcached/engine.h>
+#include <programs/engine_testapp/mock_cookie.h>
+#include <programs/engine_testapp/mock_server.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Number of keys each thread operates on
+static const size_t numKeys = 10000;
+
+class DefaultEngineBench : public benchmark::Fixture {
+public:
+    void SetUp(const benchmark::State& state) override {
+        if (state.thread_index == 0) {
+            init_mock_server();
+            EngineIface* handle = nullptr;
+            if (create_memcache_instance(get_mock_server_api, &handle) !=
+                ENGINE_SUCCESS) {
+                throw std::runtime_error(
+                        "DefaultEngineBench: Failed to create engine");
+            }
+            const std::string config =
+                    "cache_size=1073741824;item_partitions=" +
+                    std::to_string(state.range(0));
+            if (handle->initialize(config.c_str()) != ENGINE_SUCCESS) {
+                throw std::runtime_error(
+                        "DefaultEngineBench: Failed to initialize engine");
+            }
+            engine.store(handle);
+        } else {
+            // 'engine' setup by thread:0; wait until it has completed.
+            while (engine.load() == nullptr) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        if (state.thread_index == 0) {
+            // Wait for the other threads to complete before nuking the
+            // engine
+            while (running.load() != 0) {
+                std::this_thread::yield();
+            }
+            engine.exchange(nullptr)->destroy(false);
+        }
+    }
+
+protected:
+    std::vector<std::string> makeKeys(const benchmark::State& state) {
+        std::vector<std::string> keys;
+        keys.reserve(numKeys);
+        for (size_t ii = 0; ii < numKeys; ++ii) {
+            keys.emplace_back("Thread" + std::to_string(state.thread_index) +
+                              "::key_" + std::to_string(ii));
+        }
+        return keys;
+    }
+
+    void store(EngineIface* h, const void* cookie, const std::string& key) {
+        const DocKey docKey(key, DocKeyEncodesCollectionId::No);
+        auto ret = h->allocate(
+                cookie, docKey, 32, 0, 0, PROTOCOL_BINARY_RAW_BYTES, Vbid(0));
+        if (ret.first != cb::engine_errc::success) {
+            throw std::runtime_error("DefaultEngineBench: allocate failed");
+        }
+        uint64_t cas = 0;
+        h->store(cookie,
+                 ret.second.get(),
+                 cas,
+                 OPERATION_SET,
+                 {},
+                 DocumentState::Alive);
+    }
+
+    std::atomic<EngineIface*> engine{nullptr};
+    std::atomic<int> running{0};
+};
+
+/**
+ * Each thread performs get operations on its own set of (existing) keys.
+ */
+BENCHMARK_DEFINE_F(DefaultEngineBench, Get)(benchmark::State& state) {
+    ++running;
+    auto* h = engine.load();
+    const auto* cookie = create_mock_cookie();
+    const auto keys = makeKeys(state);
+    for (const auto& key : keys) {
+        store(h, cookie, key);
+    }
+
+    size_t ii = 0;
+    while (state.KeepRunning()) {
+        const DocKey key(keys[ii++ % numKeys], DocKeyEncodesCollectionId::No);
+        auto ret = h->get(cookie, key, Vbid(0), DocStateFilter::Alive);
+        benchmark::DoNotOptimize(ret);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    destroy_mock_cookie(cookie);
+    --running;
+}
+
+/**
+ * Each thread performs set operations on its own set of keys.
+ */
+BENCHMARK_DEFINE_F(DefaultEngineBench, Set)(benchmark::State& state) {
+    ++running;
+    auto* h = engine.load();
+    const auto* cookie = create_mock_cookie();
+    const auto keys = makeKeys(state);
+
+    size_t ii = 0;
+    while (state.KeepRunning()) {
+        store(h, cookie, keys[ii++ % numKeys]);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    destroy_mock_cookie(cookie);
+    --running;
+}
+
+/**
+ * Mixed workload; 90% gets and 10% sets.
+ */
+BENCHMARK_DEFINE_F(DefaultEngineBench, GetSet90_10)(benchmark::State& state) {
+    ++running;
+    auto* h = engine.load();
+    const auto* cookie = create_mock_cookie();
+    const auto keys = makeKeys(state);
+    for (const auto& key : keys) {
+        store(h, cookie, key);
+    }
+
+    size_t ii = 0;
+    while (state.KeepRunning()) {
+        const auto& k = keys[ii % numKeys];
+        if ((ii % 10) == 0) {
+            store(h, cookie, k);
+        } else {
+            const DocKey key(k, DocKeyEncodesCollectionId::No);
+            auto ret = h->get(cookie, key, Vbid(0), DocStateFilter::Alive);
+            benchmark::DoNotOptimize(ret);
+        }
+        ++ii;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    destroy_mock_cookie(cookie);
+    --running;
+}
+
+// Compare a single partition (the old, single lock behaviour) against
+// a partitioned cache with an increasing number of front end threads.
+static void PartitionsAndThreads(benchmark::internal::Benchmark* b) {
+    for (int partitions : {1, 16, 64}) {
+        b->Arg(partitions);
+    }
+    b->ThreadRange(1, 32)->UseRealTime();
+}
+
+BENCHMARK_REGISTER_F(DefaultEngineBench, Get)->Apply(PartitionsAndThreads);
+BENCHMARK_REGISTER_F(DefaultEngineBench, Set)->Apply(PartitionsAndThreads);
+BENCHMARK_REGISTER_F(DefaultEngineBench, GetSet90_10)
+        ->Apply(PartitionsAndThreads);
+
+int main(int argc, char** argv) {
+    cb::logger::createBlackholeLogger();
+    mock_init_alloc_hooks();
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    ::benchmark::RunSpecifiedBenchmarks();
+    destroy_memcache_engine();
+    return 0;
+}
@@ -16,11 +16,11 @@
  */
 
 /*
- * Benchmark tests to compare TimingHistogram against HdrHistogram
+ * Benchmark tests for the various HdrHistogram configurations
  * */
 
 #include <benchmark/benchmark.h>
-#include <daemon/timing_histogram.h>
+#include <daemon/timings.h>
 #include <folly/portability/GTest.h>
 #include <nlohmann/json.hpp>
 #include <utilities/hdrhistogram.h>
@@ -59,7 +59,7 @@ void HistoAddNs(HdrHistogramEmpty& histo, std::chrono::nanoseconds v) {
 }
 
 template <>
-void HistoAddNs(TimingHistogram& histo, std::chrono::nanoseconds v) {
+void HistoAddNs(Hdr1sfNanoSecHistogram& histo, std::chrono::nanoseconds v) {
     histo.add(v);
 }
 
@@ -203,19 +203,21 @@ void HistogramToJson(benchmark::State& state) {
     }
 }
 
-BENCHMARK_TEMPLATE(HistogramConstructionDestructionHeap, TimingHistogram);
+BENCHMARK_TEMPLATE(HistogramConstructionDestructionHeap,
+                   Hdr1sfNanoSecHistogram);
 BENCHMARK_TEMPLATE(HistogramConstructionDestructionHeap, HdrHistogramBench);
 BENCHMARK_TEMPLATE(HistogramConstructionDestructionHeap, HdrHistogramEmpty);
 
-BENCHMARK_TEMPLATE(HistogramConstructionDestructionStack, TimingHistogram);
+BENCHMARK_TEMPLATE(HistogramConstructionDestructionStack,
+                   Hdr1sfNanoSecHistogram);
 BENCHMARK_TEMPLATE(HistogramConstructionDestructionStack, HdrHistogramBench);
 BENCHMARK_TEMPLATE(HistogramConstructionDestructionStack, HdrHistogramEmpty);
 
-BENCHMARK_TEMPLATE(HistogramAdd, TimingHistogram)
+BENCHMARK_TEMPLATE(HistogramAdd, Hdr1sfNanoSecHistogram)
         ->Threads(4)
         ->Arg(1000)
         ->UseRealTime();
-BENCHMARK_TEMPLATE(HistogramAdd, TimingHistogram)
+BENCHMARK_TEMPLATE(HistogramAdd, Hdr1sfNanoSecHistogram)
         ->Threads(1)
         ->Arg(1000)
         ->UseRealTime();
@@ -228,15 +230,53 @@ BENCHMARK_TEMPLATE(HistogramAdd, HdrHistogramBench)
         ->Arg(1000)
         ->UseRealTime();
 
-BENCHMARK_TEMPLATE(HistogramToString, TimingHistogram)->Arg(10000);
+BENCHMARK_TEMPLATE(HistogramToString, Hdr1sfNanoSecHistogram)->Arg(10000);
 BENCHMARK_TEMPLATE(HistogramToString, HdrHistogramBench)->Arg(10000);
 BENCHMARK_TEMPLATE(HistogramToString, HdrHistogramEmpty)->Arg(10000);
 
-BENCHMARK_TEMPLATE(HistogramReset, TimingHistogram);
+BENCHMARK_TEMPLATE(HistogramReset, Hdr1sfNanoSecHistogram);
 BENCHMARK_TEMPLATE(HistogramReset, HdrHistogramBench);
 BENCHMARK_TEMPLATE(HistogramReset, HdrHistogramEmpty);
 
-BENCHMARK_TEMPLATE(HistogramAggregation, TimingHistogram)->Arg(100);
+BENCHMARK_TEMPLATE(HistogramAggregation, Hdr1sfNanoSecHistogram)->Arg(100);
 BENCHMARK_TEMPLATE(HistogramAggregation, HdrHistogramBench)->Arg(100);
 
+/**
+ * Benchmark the cost of recording a command timing; each benchmark thread
+ * records into its own per-thread histograms.
+ */
+static void TimingsCollect(benchmark::State& state) {
+    static Timings timings;
+    if (state.thread_index == 0) {
+        timings.initialize(state.threads);
+        // make sure the vector of values is set up
+        GetNextLogNormalValue();
+    }
+
+    while (state.KeepRunning()) {
+        timings.collect(state.thread_index,
+                        cb::mcbp::ClientOpcode::Get,
+                        std::chrono::nanoseconds(GetNextLogNormalValue()));
+    }
+}
+
+static void TimingsGenerate(benchmark::State& state) {
+    Timings timings;
+    timings.initialize(state.range(0));
+    for (int thread = 0; thread < state.range(0); ++thread) {
+        for (int ii = 0; ii < 10000; ++ii) {
+            timings.collect(thread,
+                            cb::mcbp::ClientOpcode::Get,
+                            std::chrono::nanoseconds(GetNextLogNormalValue()));
+        }
+    }
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(
+                timings.generate(cb::mcbp::ClientOpcode::Get));
+    }
+}
+
+BENCHMARK(TimingsCollect)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(TimingsGenerate)->Arg(1)->Arg(4)->Arg(16);
+
 BENCHMARK_MAIN()
\ No newline at end of file
@@ -2296,6 +2296,83 @@ TEST_P(GetAllVbSeqnoValidatorTest, InvalidVbucketState) {
     }
 }
 
+// cb::mcbp::ClientOpcode::GetMulti
+class GetMultiValidatorTest : public ::testing::WithParamInterface<bool>,
+                              public ValidatorTest {
+public:
+    GetMultiValidatorTest() : ValidatorTest(GetParam()) {
+    }
+
+protected:
+    /// Append an entry for the given key to the value
+    void addKey(Vbid vbid, const std::string& key) {
+        cb::mcbp::request::GetMultiKeyHeader hdr;
+        hdr.setVBucket(vbid);
+        hdr.setKeylen(gsl::narrow<uint16_t>(key.size()));
+        auto buf = hdr.getBuffer();
+        value.insert(value.end(), buf.begin(), buf.end());
+        value.insert(value.end(), key.begin(), key.end());
+    }
+
+    cb::mcbp::Status validate() {
+        packet.resize(sizeof(cb::mcbp::Request) + value.size());
+        auto& req = *reinterpret_cast<cb::mcbp::Request*>(packet.data());
+        req = {};
+        req.setMagic(cb::mcbp::Magic::ClientRequest);
+        req.setOpcode(cb::mcbp::ClientOpcode::GetMulti);
+        req.setDatatype(cb::mcbp::Datatype::Raw);
+        req.setBodylen(gsl::narrow<uint32_t>(value.size()));
+        std::copy(value.begin(),
+                  value.end(),
+                  packet.begin() + sizeof(cb::mcbp::Request));
+        return ValidatorTest::validate(cb::mcbp::ClientOpcode::GetMulti,
+                                       packet.data());
+    }
+
+    /// The key "key" in the default collection (if collections is enabled)
+    const std::string key{"\0key", 4};
+    std::vector<uint8_t> value;
+    std::vector<uint8_t> packet;
+};
+
+TEST_P(GetMultiValidatorTest, CorrectMessage) {
+    addKey(Vbid(0), key);
+    addKey(Vbid(1), key);
+    addKey(Vbid(1023), key);
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(GetMultiValidatorTest, NoKeys) {
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, TruncatedHeader) {
+    addKey(Vbid(0), key);
+    value.push_back(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, TruncatedKey) {
+    addKey(Vbid(0), key);
+    value.pop_back();
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, ZeroLengthKey) {
+    addKey(Vbid(0), key);
+    addKey(Vbid(0), {});
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, TooManyKeys) {
+    for (size_t ii = 0; ii < cb::mcbp::request::GetMultiMaxKeys; ++ii) {
+        addKey(Vbid(0), key);
+    }
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+    addKey(Vbid(0), key);
+    EXPECT_EQ(cb::mcbp::Status::E2big, validate());
+}
+
 // cb::mcbp::ClientOpcode::GetLocked
 class GetLockedValidatorTest : public ::testing::WithParamInterface<bool>,
                                public ValidatorTest {
@@ -3490,6 +3567,10 @@ INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
                         GetAllVbSeqnoValidatorTest,
                         ::testing::Bool(),
                         ::testing::PrintToStringParamName());
+INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
+                        GetMultiValidatorTest,
+                        ::testing::Bool(),
+                        ::testing::PrintToStringParamName());
 INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
                         GetLockedValidatorTest,
                         ::testing::Bool(),
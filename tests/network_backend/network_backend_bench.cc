@@ -0,0 +1,160 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmark comparing the network backends available for the front end
+ * threads. Each connection is a socketpair where the "server" end is a
+ * bufferevent echoing back everything it receives (just like the front
+ * end threads responding to small requests), and the "client" end sends
+ * a small (header sized) request and waits for the response. With the
+ * io_uring backend the server end is driven by an IoUringBackend (like the
+ * connections of the front end threads).
+ */
+
+#include <benchmark/benchmark.h>
+#include <daemon/io_uring_backend.h>
+#include <daemon/network_backend.h>
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/util.h>
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+/// A request which is the size of a memcached binary protocol header
+static const std::array<char, 24> request{};
+
+class EchoPipes {
+public:
+    EchoPipes(NetworkBackend backend, size_t connections)
+        : base(create_event_base(backend)) {
+        if (!base) {
+            throw std::runtime_error("EchoPipes: Failed to create event base");
+        }
+        if (backend == NetworkBackend::IoUring) {
+            io_uring = IoUringBackend::create(base);
+            if (!io_uring) {
+                event_base_free(base);
+                throw std::runtime_error("EchoPipes: io_uring not available");
+            }
+        }
+        for (size_t ii = 0; ii < connections; ++ii) {
+            evutil_socket_t fds[2];
+            if (evutil_socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+                throw std::runtime_error("EchoPipes: socketpair failed");
+            }
+            evutil_make_socket_nonblocking(fds[0]);
+            evutil_make_socket_nonblocking(fds[1]);
+
+            auto* server = io_uring ? io_uring->attach(fds[0])
+                                    : bufferevent_socket_new(
+                                              base,
+                                              fds[0],
+                                              BEV_OPT_CLOSE_ON_FREE);
+            bufferevent_setcb(server, echo_callback, nullptr, nullptr, this);
+            bufferevent_enable(server, EV_READ);
+
+            auto* client = bufferevent_socket_new(
+                    base, fds[1], BEV_OPT_CLOSE_ON_FREE);
+            bufferevent_setcb(
+                    client, response_callback, nullptr, nullptr, this);
+            bufferevent_enable(client, EV_READ);
+
+            servers.push_back(server);
+            clients.push_back(client);
+        }
+    }
+
+    ~EchoPipes() {
+        for (auto* bev : servers) {
+            if (io_uring) {
+                io_uring->detach(bev);
+            }
+            bufferevent_free(bev);
+        }
+        for (auto* bev : clients) {
+            bufferevent_free(bev);
+        }
+        io_uring.reset();
+        event_base_free(base);
+    }
+
+    /// Send a request on all connections and wait for all of the
+    /// responses to arrive
+    void roundtrip() {
+        received = 0;
+        for (auto* bev : clients) {
+            bufferevent_write(bev, request.data(), request.size());
+        }
+        const size_t expected = clients.size() * request.size();
+        while (received < expected) {
+            event_base_loop(base, EVLOOP_ONCE);
+        }
+    }
+
+protected:
+    static void echo_callback(bufferevent* bev, void*) {
+        bufferevent_write_buffer(bev, bufferevent_get_input(bev));
+    }
+
+    static void response_callback(bufferevent* bev, void* ctx) {
+        auto* input = bufferevent_get_input(bev);
+        const auto nb = evbuffer_get_length(input);
+        evbuffer_drain(input, nb);
+        reinterpret_cast<EchoPipes*>(ctx)->received += nb;
+    }
+
+    event_base* base;
+    std::unique_ptr<IoUringBackend> io_uring;
+    std::vector<bufferevent*> servers;
+    std::vector<bufferevent*> clients;
+    size_t received = 0;
+};
+
+static void NetworkBackendRoundtrip(benchmark::State& state) {
+    const auto backend = NetworkBackend(state.range(0));
+    if (backend == NetworkBackend::IoUring && !IoUringBackend::isSupported()) {
+        state.SkipWithError("Built without io_uring support");
+        return;
+    }
+    EchoPipes pipes(backend, state.range(1));
+    state.SetLabel(to_string(backend));
+
+    for (auto _ : state) {
+        pipes.roundtrip();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+static void NetworkBackendArguments(benchmark::internal::Benchmark* b) {
+    for (const auto backend : {NetworkBackend::Default,
+                               NetworkBackend::EpollChangelist,
+                               NetworkBackend::IoUring}) {
+        for (int connections = 1; connections <= 512; connections *= 8) {
+            b->Args({int(backend), connections});
+        }
+    }
+}
+
+BENCHMARK(NetworkBackendRoundtrip)
+        ->ArgNames({"backend", "connections"})
+        ->Apply(NetworkBackendArguments);
+
+BENCHMARK_MAIN();
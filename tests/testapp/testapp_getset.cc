@@ -608,6 +608,76 @@ TEST_P(GetSetTest, TestGetSuccess) {
     EXPECT_EQ(document.value, stored.value);
 }
 
+TEST_P(GetSetTest, TestGetMulti) {
+    MemcachedConnection& conn = getConnection();
+    conn.mutate(document, Vbid(0), MutationType::Set);
+
+    const auto missing = name + "_missing";
+    BinprotGetMultiCommand cmd;
+    cmd.addKey(name).addKey(missing).addKey(name);
+    conn.sendCommand(cmd);
+
+    // We should get one response per key in the order they were requested
+    for (const auto& key : {name, missing, name}) {
+        BinprotGetResponse rsp;
+        conn.recvResponse(rsp);
+        EXPECT_EQ(cb::mcbp::ClientOpcode::GetMulti, rsp.getOp());
+        EXPECT_EQ(key, rsp.getKeyString());
+        if (key == name) {
+            ASSERT_TRUE(rsp.isSuccess()) << to_string(rsp.getStatus());
+            EXPECT_EQ(document.info.flags, rsp.getDocumentFlags());
+            EXPECT_EQ(document.value, rsp.getDataString());
+        } else {
+            EXPECT_EQ(cb::mcbp::Status::KeyEnoent, rsp.getStatus());
+        }
+    }
+}
+
+// The keys of a GetMulti must stay valid when the command blocks on a
+// background fetch (and the request is moved out of the input buffer)
+TEST_P(GetSetTest, TestGetMultiNonResident) {
+    if (!mcd_env->getTestBucket().supportsPersistence()) {
+        std::cout << "Note: skipping test '"
+                  << ::testing::UnitTest::GetInstance()
+                             ->current_test_info()
+                             ->name()
+                  << "' as the underlying engine don't support eviction.\n";
+        return;
+    }
+    MemcachedConnection& conn = getConnection();
+    const auto evicted = name + "_evicted";
+    const auto resident = name + "_resident";
+    const auto stored = storeAndPersistItem(Vbid(0), evicted);
+    auto& admin = getAdminConnection();
+    admin.selectBucket(bucketName);
+    admin.evict(evicted, Vbid(0));
+    document.info.id = resident;
+    conn.mutate(document, Vbid(0), MutationType::Set);
+
+    const auto missing = name + "_missing";
+    BinprotGetMultiCommand cmd;
+    cmd.addKey(evicted).addKey(missing).addKey(resident).addKey(evicted);
+    conn.sendCommand(cmd);
+
+    for (const auto& key : {evicted, missing, resident, evicted}) {
+        BinprotGetResponse rsp;
+        conn.recvResponse(rsp);
+        EXPECT_EQ(cb::mcbp::ClientOpcode::GetMulti, rsp.getOp());
+        EXPECT_EQ(key, rsp.getKeyString());
+        if (key == missing) {
+            EXPECT_EQ(cb::mcbp::Status::KeyEnoent, rsp.getStatus());
+            continue;
+        }
+        ASSERT_TRUE(rsp.isSuccess()) << to_string(rsp.getStatus());
+        if (key == evicted) {
+            EXPECT_EQ(stored.value, rsp.getDataString());
+        } else {
+            EXPECT_EQ(document.info.flags, rsp.getDocumentFlags());
+            EXPECT_EQ(document.value, rsp.getDataString());
+        }
+    }
+}
+
 TEST_P(GetSetTest, TestAppend) {
     MemcachedConnection& conn = getConnection();
     document.info.datatype = cb::mcbp::Datatype::Raw;
@@ -281,6 +281,27 @@ TEST_P(StatsTest, TestAppend) {
     EXPECT_EQ(11, stats["cmd_set"].get<size_t>());
 }
 
+/// Verify that medium sized values are sent by reference over plaintext
+/// connections, and copied over TLS
+TEST_P(StatsTest, TestBytesCopiedReferenced) {
+    MemcachedConnection& conn = getConnection();
+
+    Document doc;
+    doc.info.cas = mcbp::cas::Wildcard;
+    doc.info.id = name;
+    doc.value = std::string(1024, 'a');
+    conn.mutate(doc, Vbid(0), MutationType::Set);
+    conn.get(name, Vbid(0));
+
+    auto stats = conn.stats("");
+    EXPECT_NE(0, stats["bytes_copied"].get<size_t>());
+    if (GetParam() == TransportProtocols::McbpSsl) {
+        EXPECT_EQ(0, stats["bytes_referenced"].get<size_t>());
+    } else {
+        EXPECT_LE(doc.value.size(), stats["bytes_referenced"].get<size_t>());
+    }
+}
+
 /// Verify that we don't keep invalid pointers around when the packet is
 /// relocated as part of EWB
 TEST_P(StatsTest, MB37147_TestEWBReturnFromStat) {
@@ -23,6 +23,7 @@
 #include <cstring>
 #include <iostream>
 #include <sstream>
+#include <string>
 #include <vector>
 
 struct test_harness* test_harness;
@@ -328,6 +329,66 @@ static enum test_result remove_test(EngineIface* h) {
     return SUCCESS;
 }
 
+/*
+ * Store enough items to make the hash table grow (the buckets are moved to
+ * the new table incrementally as part of the mutations), and verify that
+ * all of the items may be found (and removed) while the table is expanding
+ * and after the expansion completed.
+ */
+static enum test_result hash_table_expansion_test(EngineIface* h) {
+    const int num_items = 200000;
+    uint64_t cas = 0;
+    mutation_descr_t mut_info;
+    const auto* cookie = test_harness->create_cookie();
+
+    auto make_key = [](int ii) {
+        return "expansion_test_key_" + std::to_string(ii);
+    };
+
+    for (int ii = 0; ii < num_items; ++ii) {
+        const auto k = make_key(ii);
+        DocKey key(k, DocKeyEncodesCollectionId::No);
+        auto ret = h->allocate(
+                cookie, key, 1, 0, 0, PROTOCOL_BINARY_RAW_BYTES, Vbid(0));
+        cb_assert(ret.first == cb::engine_errc::success);
+        cb_assert(h->store(cookie,
+                           ret.second.get(),
+                           cas,
+                           OPERATION_SET,
+                           {},
+                           DocumentState::Alive) == ENGINE_SUCCESS);
+
+        // Verify that a previously stored item is still reachable
+        const auto o = make_key(ii / 2);
+        DocKey old(o, DocKeyEncodesCollectionId::No);
+        ret = h->get(cookie, old, Vbid(0), DocStateFilter::Alive);
+        cb_assert(ret.first == cb::engine_errc::success);
+    }
+
+    // Remove every other item, and verify that the rest are still there
+    for (int ii = 0; ii < num_items; ii += 2) {
+        const auto k = make_key(ii);
+        DocKey key(k, DocKeyEncodesCollectionId::No);
+        cas = 0;
+        cb_assert(h->remove(cookie, key, cas, Vbid(0), {}, mut_info) ==
+                  ENGINE_SUCCESS);
+    }
+
+    for (int ii = 0; ii < num_items; ++ii) {
+        const auto k = make_key(ii);
+        DocKey key(k, DocKeyEncodesCollectionId::No);
+        auto ret = h->get(cookie, key, Vbid(0), DocStateFilter::Alive);
+        if ((ii % 2) == 0) {
+            cb_assert(ret.first == cb::engine_errc::no_such_key);
+        } else {
+            cb_assert(ret.first == cb::engine_errc::success);
+        }
+    }
+
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
 /*
  * Make sure we can successfully perform a flush operation and that any item
  * stored before the flush can not be retrieved
@@ -501,6 +562,130 @@ static enum test_result lru_test(EngineIface* h) {
     return SUCCESS;
 }
 
+/*
+ * With multiple item partitions the LRU is maintained per partition, so we
+ * can't predict which keys get evicted. Verify that the items which got
+ * evicted are accounted for, and that all of the others may be read back.
+ */
+static enum test_result partitioned_lru_test(EngineIface* h) {
+    uint64_t cas = 0;
+    int ii;
+
+    const auto* cookie = test_harness->create_cookie();
+    evictions = 0;
+    for (ii = 0; ii < 10000; ++ii) {
+        uint8_t key[1024];
+        DocKey allocate_key(key,
+                            snprintf(reinterpret_cast<char*>(key),
+                                     sizeof(key),
+                                     "lru_test_key_%08d",
+                                     ii),
+                            DocKeyEncodesCollectionId::No);
+        auto ret = h->allocate(cookie,
+                               allocate_key,
+                               4096,
+                               0,
+                               0,
+                               PROTOCOL_BINARY_RAW_BYTES,
+                               Vbid(0));
+        cb_assert(ret.first == cb::engine_errc::success);
+        cb_assert(h->store(cookie,
+                           ret.second.get(),
+                           cas,
+                           OPERATION_SET,
+                           {},
+                           DocumentState::Alive) == ENGINE_SUCCESS);
+        cb_assert(h->get_stats(cookie, {}, {}, eviction_stats_handler) ==
+                  ENGINE_SUCCESS);
+        if (evictions >= 2) {
+            break;
+        }
+    }
+
+    cb_assert(ii < 10000);
+    uint32_t missing = 0;
+    for (int jj = 0; jj <= ii; ++jj) {
+        uint8_t key[1024];
+        DocKey get_key(key,
+                       snprintf(reinterpret_cast<char*>(key),
+                                sizeof(key),
+                                "lru_test_key_%08d",
+                                jj),
+                       DocKeyEncodesCollectionId::No);
+        auto ret = h->get(cookie, get_key, Vbid(0), DocStateFilter::Alive);
+        if (ret.first == cb::engine_errc::no_such_key) {
+            ++missing;
+        } else {
+            cb_assert(ret.first == cb::engine_errc::success);
+            cb_assert(ret.second != nullptr);
+        }
+    }
+    assert_equal(evictions, missing);
+
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
+/*
+ * Once the memory limit is reached, a store must be able to evict items of
+ * its slab class from the other partitions when its own partition has none
+ * of them (the first page of a class is the only one allowed beyond the
+ * limit, whichever partition allocates it).
+ */
+static enum test_result partitioned_evict_other_partition_test(
+        EngineIface* h) {
+    uint64_t cas = 0;
+    int ii;
+
+    const auto* cookie = test_harness->create_cookie();
+    evictions = 0;
+    auto store = [h, cookie, &cas](const char* prefix, int ii, size_t size) {
+        uint8_t key[1024];
+        DocKey allocate_key(key,
+                            snprintf(reinterpret_cast<char*>(key),
+                                     sizeof(key),
+                                     "%s_%08d",
+                                     prefix,
+                                     ii),
+                            DocKeyEncodesCollectionId::No);
+        auto ret = h->allocate(cookie,
+                               allocate_key,
+                               size,
+                               0,
+                               0,
+                               PROTOCOL_BINARY_RAW_BYTES,
+                               Vbid(0));
+        cb_assert(ret.first == cb::engine_errc::success);
+        return h->store(cookie,
+                        ret.second.get(),
+                        cas,
+                        OPERATION_SET,
+                        {},
+                        DocumentState::Alive);
+    };
+
+    // Fill the cache with small items
+    for (ii = 0; ii < 100000; ++ii) {
+        cb_assert(store("small_key", ii, 4096) == ENGINE_SUCCESS);
+        cb_assert(h->get_stats(cookie, {}, {}, eviction_stats_handler) ==
+                  ENGINE_SUCCESS);
+        if (evictions >= 2) {
+            break;
+        }
+    }
+    cb_assert(ii < 100000);
+
+    // Then store large items spread over all the partitions; only one page
+    // of their class may be allocated, so most of them must be stored by
+    // evicting from another partition
+    for (ii = 0; ii < 200; ++ii) {
+        cb_assert(store("large_key", ii, 64 * 1024) == ENGINE_SUCCESS);
+    }
+
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
 static enum test_result get_stats_test(EngineIface* h) {
     return PENDING;
 }
@@ -673,6 +858,13 @@ std::vector<engine_test_t> get_tests() {
                        NULL,
                        NULL,
                        NULL),
+             TEST_CASE("hash table expansion test",
+                       hash_table_expansion_test,
+                       NULL,
+                       NULL,
+                       NULL,
+                       NULL,
+                       NULL),
              TEST_CASE("flush test", flush_test, NULL, NULL, NULL, NULL, NULL),
              TEST_CASE("get item info test",
                        get_item_info_test,
@@ -695,7 +887,21 @@ std::vector<engine_test_t> get_tests() {
                        lru_test,
                        NULL,
                        NULL,
-                       "cache_size=48",
+                       "cache_size=48;item_partitions=1",
+                       NULL,
+                       NULL),
+             TEST_CASE("LRU test with multiple item partitions",
+                       partitioned_lru_test,
+                       NULL,
+                       NULL,
+                       "cache_size=48;item_partitions=16",
+                       NULL,
+                       NULL),
+             TEST_CASE("Evict from other item partitions",
+                       partitioned_evict_other_partition_test,
+                       NULL,
+                       NULL,
+                       "cache_size=48;item_partitions=16",
                        NULL,
                        NULL),
 #endif
@@ -392,6 +392,20 @@ public:
     }
 };
 
+/** Histogram to store counts for nanosecond intervals
+ *  Can hold a range of 0ns to 60000000000ns (60 seconds) with a
+ *  precision of 1 significant figures
+ */
+class Hdr1sfNanoSecHistogram : public HdrHistogram {
+public:
+    Hdr1sfNanoSecHistogram()
+        : HdrHistogram(0, 60000000000, 1, Iterator::IterMode::Percentiles){};
+    bool add(std::chrono::nanoseconds v, size_t count = 1) {
+        return addValueAndCount(static_cast<uint64_t>(v.count()),
+                                static_cast<uint64_t>(count));
+    }
+};
+
 using HdrMicroSecBlockTimer = GenericBlockTimer<Hdr1sfMicroSecHistogram, 0>;
 using HdrMicroSecStopwatch = MicrosecondStopwatch<Hdr1sfMicroSecHistogram>;
 